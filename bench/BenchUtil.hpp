@@ -0,0 +1,263 @@
+//***********************************************************************************************
+//Impromptu Modular: Modules for VCV Rack by Marc Boulé
+//
+//See ./LICENSE.md for all licenses
+//***********************************************************************************************
+
+// Shared pieces of the headless benchmarks: model lookup, a minimal engine loop with cables and expanders,
+//   scripted input signals and timing statistics.
+
+#pragma once
+
+#include "rack.hpp"
+#include <chrono>
+
+using namespace rack;
+
+extern Plugin *pluginInstance;
+void init(rack::Plugin *p);
+
+
+// ******** Models ********
+
+inline Plugin* benchPlugin() {
+	static Plugin plugin;
+	if (plugin.models.empty()) {
+		plugin.slug = "ImpromptuModular";
+		init(&plugin);
+	}
+	return &plugin;
+}
+
+inline Model* findModel(const std::string& slug) {
+	for (Model* model : benchPlugin()->models) {
+		if (model->slug == slug)
+			return model;
+	}
+	return nullptr;
+}
+
+
+// ******** Rig ********
+
+// A handful of modules stepped like Rack v1's engine does it: every module is processed, then every cable copies
+//   its output to its input (so a cable adds one sample of delay), then the expander messages are flipped.
+struct Rig {
+	struct Cable {
+		Module* outputModule;
+		int outputId;
+		Module* inputModule;
+		int inputId;
+	};
+
+	std::vector<Module*> modules;
+	std::vector<Cable> cables;
+	Module::ProcessArgs args;
+
+
+	Rig(float sampleRate) {
+		APP->engine->sampleRate = sampleRate;
+		args.sampleRate = sampleRate;
+		args.sampleTime = 1.0f / sampleRate;
+	}
+
+	~Rig() {
+		for (Module* module : modules) {
+			std::vector<Module*>& engineModules = APP->engine->modules;
+			engineModules.erase(std::remove(engineModules.begin(), engineModules.end(), module), engineModules.end());
+			delete module;
+		}
+	}
+
+	// the global random generator is reseeded before each module is created, so that modules whose own generator
+	//   is unseeded (and modules that use random::uniform() directly) give the same results on every run
+	Module* add(const std::string& slug, uint64_t seed = 1) {
+		static int nextId = 0;
+		Model* model = findModel(slug);
+		if (!model) {
+			fprintf(stderr, "Unknown model %s\n", slug.c_str());
+			exit(1);
+		}
+		random::seed(seed, 0x5DEECE66DULL);
+		Module* module = model->createModule();
+		module->id = nextId++;
+		modules.push_back(module);
+		APP->engine->modules.push_back(module);
+		module->onAdd();
+		module->onSampleRateChange();
+		return module;
+	}
+
+	void placeRight(Module* left, Module* right) {
+		left->rightExpander.moduleId = right->id;
+		left->rightExpander.module = right;
+		right->leftExpander.moduleId = left->id;
+		right->leftExpander.module = left;
+	}
+
+	void connect(Module* outputModule, int outputId, Module* inputModule, int inputId) {
+		outputModule->outputs[outputId].channels = 1;
+		inputModule->inputs[inputId].channels = 1;
+		cables.push_back(Cable{outputModule, outputId, inputModule, inputId});
+	}
+
+	void connectAllOutputs() {
+		for (Module* module : modules) {
+			for (Output& output : module->outputs) {
+				if (output.channels == 0)
+					output.channels = 1;
+			}
+		}
+	}
+
+	void step() {
+		for (Module* module : modules) {
+			module->process(args);
+		}
+		stepCablesAndExpanders();
+	}
+
+	void stepCablesAndExpanders() {
+		for (Cable& cable : cables) {
+			Output& output = cable.outputModule->outputs[cable.outputId];
+			Input& input = cable.inputModule->inputs[cable.inputId];
+			input.channels = output.channels;
+			for (int c = 0; c < output.channels; c++) {
+				input.voltages[c] = output.voltages[c];
+			}
+		}
+		for (Module* module : modules) {
+			if (module->leftExpander.messageFlipRequested) {
+				std::swap(module->leftExpander.producerMessage, module->leftExpander.consumerMessage);
+				module->leftExpander.messageFlipRequested = false;
+			}
+			if (module->rightExpander.messageFlipRequested) {
+				std::swap(module->rightExpander.producerMessage, module->rightExpander.consumerMessage);
+				module->rightExpander.messageFlipRequested = false;
+			}
+		}
+	}
+};
+
+
+// ******** Scripted signals ********
+
+// Square clock with a given period in samples (may be fractional), high for the first half of the period
+struct ClockScript {
+	double period;
+	double phase = 0.0;
+
+	ClockScript(double _period) : period(_period) {}
+
+	float next() {
+		float v = (phase < period * 0.5) ? 10.0f : 0.0f;
+		phase += 1.0;
+		if (phase >= period)
+			phase -= period;
+		return v;
+	}
+};
+
+// 1 ms trigger at a given sample, repeated every interval samples (0 for a single trigger)
+struct TriggerScript {
+	long start;
+	long interval;
+	long length;
+	long count = 0;
+
+	TriggerScript(long _start, long _interval, float sampleRate) : start(_start), interval(_interval) {
+		length = std::max(1L, (long)(sampleRate * 0.001f));
+	}
+
+	float next() {
+		long t = count++ - start;
+		if (t < 0)
+			return 0.0f;
+		if (interval > 0)
+			t %= interval;
+		return (t < length) ? 10.0f : 0.0f;
+	}
+};
+
+// Stepped CV that takes a new semitone value each time the clock it follows goes high
+struct SteppedCvScript {
+	uint32_t lcg;
+	float value = 0.0f;
+	bool lastHigh = false;
+
+	SteppedCvScript(uint32_t seed) : lcg(seed) {}
+
+	float next(float clock) {
+		bool high = clock >= 1.0f;
+		if (high && !lastHigh) {
+			lcg = lcg * 1664525u + 1013904223u;
+			value = (float)((lcg >> 16) % 25) / 12.0f;
+		}
+		lastHigh = high;
+		return value;
+	}
+};
+
+
+// ******** Statistics ********
+
+// Sorted sample set with mean, percentiles and max
+struct Stats {
+	std::vector<double> values;
+
+	void add(double v) {values.push_back(v);}
+	size_t count() const {return values.size();}
+	void finish() {std::sort(values.begin(), values.end());}
+	double mean() const {
+		if (values.empty())
+			return 0.0;
+		double sum = 0.0;
+		for (double v : values)
+			sum += v;
+		return sum / values.size();
+	}
+	double percentile(double p) const {// call finish() first
+		if (values.empty())
+			return 0.0;
+		size_t i = std::min(values.size() - 1, (size_t)(p * values.size()));
+		return values[i];
+	}
+	double max() const {return values.empty() ? 0.0 : values.back();}
+	double min() const {return values.empty() ? 0.0 : values.front();}
+};
+
+typedef std::chrono::steady_clock BenchClock;
+
+inline double elapsedNs(BenchClock::time_point t0, BenchClock::time_point t1) {
+	return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+}
+
+// smallest time measured between two back to back clock reads, subtracted from every timed call
+inline double timerOverheadNs() {
+	static double overhead = -1.0;
+	if (overhead < 0.0) {
+		overhead = 1e9;
+		for (int i = 0; i < 10000; i++) {
+			BenchClock::time_point t0 = BenchClock::now();
+			BenchClock::time_point t1 = BenchClock::now();
+			overhead = std::min(overhead, elapsedNs(t0, t1));
+		}
+	}
+	return overhead;
+}
+
+
+// ******** 64-bit FNV-1a, used to compare output traces ********
+
+struct TraceHash {
+	uint64_t hash = 0xCBF29CE484222325ULL;
+
+	void addInt(int32_t v) {
+		for (int i = 0; i < 4; i++) {
+			hash ^= (uint64_t)((v >> (i * 8)) & 0xFF);
+			hash *= 0x100000001B3ULL;
+		}
+	}
+	// voltages are compared to the millivolt, so that the traces do not depend on compiler float contractions
+	void addVoltage(float v) {addInt((int32_t)std::lround(v * 1000.0f));}
+};
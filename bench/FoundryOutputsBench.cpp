@@ -0,0 +1,184 @@
+//***********************************************************************************************
+//Impromptu Modular: Modules for VCV Rack by Marc Boulé
+//
+//See ./LICENSE.md for all licenses
+//***********************************************************************************************
+
+// Foundry's CV, gate and velocity outputs computed by the vector pass (Sequencer::calcOutputsSimd()) against the
+//   scalar reference (calcCvOutputAndDecSlideStepsRemain(), calcGateOutput() and calcVelOutput()).
+// Two sequencers with the same random content are clocked in lockstep (each track at its own rate, with resets and
+//   retrigger windows, running and stopped, in the three velocity modes), one computes its outputs with each method,
+//   and every output of every sample is compared. Then the cost of each method per sample is measured.
+// Usage: foundry_outputs_bench [-t seconds]
+
+
+#include "BenchUtil.hpp"
+#include "FoundrySequencer.hpp"
+
+
+static const float sampleRate = 44100.0f;
+
+
+// Sequencer with its clocking, as done by Foundry::process()
+struct SeqHarness {
+	Sequencer seq;
+	bool holdTiedNotes = true;
+	int velocityMode;
+	int stopAtEndOfSong = 0;
+	RefreshCounter refresh;
+	ModuleRandom rng;
+	SampleTimings timings;
+	Trigger clockTriggers[Sequencer::NUM_TRACKS];
+	int clkInSources[Sequencer::NUM_TRACKS] = {0, 1, 2, 3};
+	ClockScript* clocks[Sequencer::NUM_TRACKS];
+	long retrigRemain = 0;
+	bool running = true;
+
+	SeqHarness(int _velocityMode) : velocityMode(_velocityMode) {
+		refresh.onSampleRateChange();
+		rng.seed = 1234;
+		rng.reseed();
+		seq.construct(&holdTiedNotes, &velocityMode, &stopAtEndOfSong, &refresh, &rng);
+		seq.onReset(true);
+		for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
+			seq.setTrackIndexEdit(trkn);
+			seq.onRandomize(true);
+			clocks[trkn] = new ClockScript(sampleRate / (4.0 + 1.5 * trkn));
+		}
+		seq.setTrackIndexEdit(0);
+		seq.initRun(true, false);
+	}
+
+	~SeqHarness() {
+		for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++)
+			delete clocks[trkn];
+	}
+
+	// clocks the tracks for sample i, returns the gateRunning argument of the output calculations
+	bool step(long i) {
+		running = (i / (long)(3 * sampleRate)) % 4 != 3;// stopped one fourth of the time
+		if (i % (long)(2 * sampleRate) == (long)sampleRate) {// reset with gates retriggered, as Foundry does
+			seq.initRun(true, false);
+			for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++)
+				clockTriggers[trkn].reset();
+			retrigRemain = timings.clockIgnoreOnReset;
+		}
+		float clockVoltages[Sequencer::NUM_TRACKS];
+		for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++)
+			clockVoltages[trkn] = clocks[trkn]->next();
+		if (running && retrigRemain == 0) {
+			bool clockTrigged[Sequencer::NUM_TRACKS];
+			for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
+				clockTrigged[trkn] = clockTriggers[trkn].process(clockVoltages[trkn]);
+				if (clockTrigged[clkInSources[trkn]])
+					seq.clockStep(trkn, true);
+			}
+			seq.process();
+		}
+		bool gateRunning = running && retrigRemain == 0;
+		if (retrigRemain > 0)
+			retrigRemain--;
+		return gateRunning;
+	}
+
+	void outputsSimd(bool gateRunning, float* cv, float* gate, float* vel) {
+		simd::float_4 cvOut, gateOut, velOut;
+		seq.calcOutputsSimd(cvOut, gateOut, velOut, running, gateRunning, true, clockTriggers, clkInSources, timings.gateTrigger);
+		cvOut.store(cv);
+		gateOut.store(gate);
+		velOut.store(vel);
+	}
+
+	void outputsScalar(bool gateRunning, float* cv, float* gate, float* vel) {
+		for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
+			cv[trkn] = seq.calcCvOutputAndDecSlideStepsRemain(trkn, running, true);
+			gate[trkn] = seq.calcGateOutput(trkn, gateRunning, clockTriggers[clkInSources[trkn]], timings.gateTrigger);
+			vel[trkn] = seq.calcVelOutput(trkn, gateRunning, true);
+		}
+	}
+};
+
+
+// returns the number of samples where the two methods differ; the velocity scale factor is folded into one
+//   multiplication in the vector pass, hence the small tolerance on velocity
+static long compare(int velocityMode, long numSamples) {
+	SeqHarness simdSeq(velocityMode);
+	SeqHarness scalarSeq(velocityMode);
+	long mismatches = 0;
+	for (long i = 0; i < numSamples; i++) {
+		bool gateRunningSimd = simdSeq.step(i);
+		bool gateRunningScalar = scalarSeq.step(i);
+		float cvA[4], gateA[4], velA[4], cvB[4], gateB[4], velB[4];
+		simdSeq.outputsSimd(gateRunningSimd, cvA, gateA, velA);
+		scalarSeq.outputsScalar(gateRunningScalar, cvB, gateB, velB);
+		bool same = true;
+		for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
+			same &= cvA[trkn] == cvB[trkn];
+			same &= gateA[trkn] == gateB[trkn];
+			same &= std::fabs(velA[trkn] - velB[trkn]) <= 1e-5f;
+		}
+		if (!same) {
+			if (mismatches < 5)
+				printf("  sample %ld: simd cv %g %g %g %g gate %g %g %g %g vel %g %g %g %g, scalar cv %g %g %g %g gate %g %g %g %g vel %g %g %g %g\n", i,
+					cvA[0], cvA[1], cvA[2], cvA[3], gateA[0], gateA[1], gateA[2], gateA[3], velA[0], velA[1], velA[2], velA[3],
+					cvB[0], cvB[1], cvB[2], cvB[3], gateB[0], gateB[1], gateB[2], gateB[3], velB[0], velB[1], velB[2], velB[3]);
+			mismatches++;
+		}
+	}
+	return mismatches;
+}
+
+
+enum OutputMethods {METHOD_NONE, METHOD_SCALAR, METHOD_SIMD};
+
+// total time of a run, in ns per sample, with the sequencer clocking included
+static double timeRun(int method, long numSamples) {
+	SeqHarness h(0);
+	float cv[4], gate[4], vel[4];
+	float sink = 0.0f;
+	BenchClock::time_point t0 = BenchClock::now();
+	for (long i = 0; i < numSamples; i++) {
+		bool gateRunning = h.step(i);
+		if (method == METHOD_SIMD)
+			h.outputsSimd(gateRunning, cv, gate, vel);
+		else if (method == METHOD_SCALAR)
+			h.outputsScalar(gateRunning, cv, gate, vel);
+		else
+			continue;
+		sink += cv[1] + gate[2] + vel[3];
+	}
+	BenchClock::time_point t1 = BenchClock::now();
+	if (sink == 12345.678f)// keeps the results alive
+		printf(" ");
+	return elapsedNs(t0, t1) / numSamples;
+}
+
+
+int main(int argc, char* argv[]) {
+	float seconds = 20.0f;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-t" && i + 1 < argc)
+			seconds = (float)std::atof(argv[++i]);
+	}
+	APP->engine->sampleRate = sampleRate;
+	const long numSamples = (long)(seconds * sampleRate);
+
+	long totalMismatches = 0;
+	for (int velocityMode = 0; velocityMode < 3; velocityMode++) {
+		long mismatches = compare(velocityMode, numSamples);
+		printf("velocity mode %d: %ld of %ld samples differ\n", velocityMode, mismatches, numSamples);
+		totalMismatches += mismatches;
+	}
+
+	// best of a few runs, less the clocking alone
+	double best[3] = {1e9, 1e9, 1e9};
+	for (int r = 0; r < 5; r++) {
+		for (int method = METHOD_NONE; method <= METHOD_SIMD; method++)
+			best[method] = std::min(best[method], timeRun(method, numSamples));
+	}
+	printf("outputs of the four tracks per sample: scalar %.1f ns, simd %.1f ns (clocking alone %.1f ns)\n",
+		best[METHOD_SCALAR] - best[METHOD_NONE], best[METHOD_SIMD] - best[METHOD_NONE], best[METHOD_NONE]);
+
+	return totalMismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,298 @@
+//***********************************************************************************************
+//Impromptu Modular: Modules for VCV Rack by Marc Boulé
+//
+//See ./LICENSE.md for all licenses
+//***********************************************************************************************
+
+// Clock edge to output latency of the sequencers: each sequencer gets a jittered 8 Hz clock and periodic resets
+//   (on a clock edge, and 0.5 ms and 1.5 ms ahead of one), either directly on its inputs or through a Clkd (one
+//   sample of cable delay). For every clock and reset edge the number of samples until the first change on any of the
+//   observed outputs is recorded, and the distributions are reported for three kinds of edges: clocks, resets, and
+//   clocks that come within 2 ms after a reset (where clockIgnoreOnReset applies).
+// The observed outputs are also hashed (to the millivolt) and compared to golden traces, so that a change in timing
+//   or in what is output shows up as a failure.
+// Usage: latency_bench [-g goldenFile [--update]]
+
+
+#include "BenchUtil.hpp"
+
+
+struct LatencyCase {
+	std::string name;
+	std::string slug;
+	bool viaClkd;// when true, a Clkd drives the clock and reset inputs (its reset input gets the reset script)
+	std::vector<int> clockInputs;
+	int resetInput;
+	std::vector<int> observedOutputs;
+};
+
+static std::vector<int> range(int first, int count) {
+	std::vector<int> ids;
+	for (int i = 0; i < count; i++)
+		ids.push_back(first + i);
+	return ids;
+}
+
+static const std::vector<LatencyCase> cases = {
+	{"PS16", "Phrase-Seq-16", false, {3}, 2, range(0, 3)},
+	{"PS32", "Phrase-Seq-32", false, {3}, 2, range(0, 6)},
+	{"SMS", "Semi-ModularSynth", false, {3}, 2, range(0, 3)},
+	{"Foundry", "Foundry", false, {6}, 5, range(0, 12)},
+	{"GS64", "Gate-Seq-64", false, {0}, 1, range(0, 4)},
+	{"WS32", "Write-Seq-32", false, {6}, 7, range(0, 6)},
+	{"WS64", "Write-Seq-64", false, {6, 7}, 8, range(0, 8)},
+	{"BBS", "Big-Button-Seq", false, {0}, 5, range(0, 6)},
+	{"BBS2", "Big-Button-Seq2", false, {0}, 5, range(0, 12)},
+	{"Clkd>PS16", "Phrase-Seq-16", true, {3}, 2, range(0, 3)},
+	{"Clkd>Foundry", "Foundry", true, {6}, 5, range(0, 12)},
+	{"Clkd>GS64", "Gate-Seq-64", true, {0}, 1, range(0, 4)},
+};
+
+static const float sampleRates[] = {44100.0f, 48000.0f, 96000.0f, 192000.0f};
+
+// Clkd ids used for the chains
+static const int CLKD_RESET_INPUT = 0;
+static const int CLKD_CLK1_OUTPUT = 1;// first sub clock, set to x4 (8 Hz at the default 120 BPM)
+static const int CLKD_RESET_OUTPUT = 4;
+static const int CLKD_RATIO1_PARAM = 0;
+static const float CLKD_RATIO_X4 = 5.0f;// index of 4 in ratioValues
+
+static const float runSeconds = 10.0f;
+
+
+// Scripted clock and reset voltages for one run
+struct Timeline {
+	std::vector<float> clock;
+	std::vector<float> reset;
+
+	Timeline(float sampleRate, long numSamples) : clock(numSamples, 0.0f), reset(numSamples, 0.0f) {
+		uint32_t lcg = 2024;
+		const double basePeriod = sampleRate / 8.0;
+		const long resetLength = std::max(1L, (long)(sampleRate * 0.001f));
+		const long resetLeads[3] = {0, (long)(sampleRate * 0.0005f), (long)(sampleRate * 0.0015f)};
+		double edge = basePeriod;
+		for (int e = 0; edge < numSamples; e++) {
+			lcg = lcg * 1664525u + 1013904223u;
+			double period = basePeriod * (0.9 + 0.2 * (double)(lcg >> 8) / 16777216.0);// +/- 10% jitter
+			long start = (long)edge;
+			long end = std::min(numSamples, (long)(edge + period * 0.5));
+			for (long i = start; i < end; i++)
+				clock[i] = 10.0f;
+			if (e % 16 == 15) {
+				long resetStart = start - resetLeads[(e / 16) % 3];
+				for (long i = resetStart; i < std::min(numSamples, resetStart + resetLength); i++)
+					reset[i] = 10.0f;
+			}
+			edge += period;
+		}
+	}
+};
+
+
+struct EdgeDetector {
+	bool high = false;
+	bool process(float v) {
+		bool rise = !high && v >= 1.0f;
+		high = v >= 1.0f;
+		return rise;
+	}
+};
+
+
+enum EdgeKinds {EDGE_CLOCK, EDGE_RESET, EDGE_CLOCK_AFTER_RESET, NUM_EDGE_KINDS};
+static const char* edgeKindNames[NUM_EDGE_KINDS] = {"clock", "reset", "clock<2ms"};
+
+
+struct LatencyResult {
+	Stats latencies[NUM_EDGE_KINDS];
+	int noChange[NUM_EDGE_KINDS] = {};
+	uint64_t hash = 0;
+};
+
+
+static LatencyResult runCase(const LatencyCase& lc, float sampleRate) {
+	const long numSamples = (long)(runSeconds * sampleRate);
+	Timeline timeline(sampleRate, numSamples);
+
+	Rig rig(sampleRate);
+	Module* clkd = nullptr;
+	if (lc.viaClkd) {
+		clkd = rig.add("Clocked-Clkd");
+		clkd->params[CLKD_RATIO1_PARAM].setValue(CLKD_RATIO_X4);
+		clkd->onReset();
+		clkd->inputs[CLKD_RESET_INPUT].channels = 1;
+	}
+	Module* seq = rig.add(lc.slug);
+	seq->onRandomize();// the default sequences of some of the modules are silent
+	if (clkd) {
+		for (int id : lc.clockInputs)
+			rig.connect(clkd, CLKD_CLK1_OUTPUT, seq, id);
+		rig.connect(clkd, CLKD_RESET_OUTPUT, seq, lc.resetInput);
+	}
+	else {
+		for (int id : lc.clockInputs)
+			seq->inputs[id].channels = 1;
+		seq->inputs[lc.resetInput].channels = 1;
+	}
+	for (int id : lc.observedOutputs)
+		seq->outputs[id].channels = 1;
+
+	LatencyResult result;
+	TraceHash trace;
+	EdgeDetector clockEdge;
+	EdgeDetector resetEdge;
+	std::vector<float> lastOutputs(lc.observedOutputs.size(), 0.0f);
+	long lastResetSample = -1000000;
+	long pendingSample = -1;// sample of the edge waiting for an output change, -1 when none
+	int pendingKind = EDGE_CLOCK;
+
+	for (long i = 0; i < numSamples; i++) {
+		if (clkd) {
+			clkd->inputs[CLKD_RESET_INPUT].setVoltage(timeline.reset[i]);
+		}
+		else {
+			for (int id : lc.clockInputs)
+				seq->inputs[id].setVoltage(timeline.clock[i]);
+			seq->inputs[lc.resetInput].setVoltage(timeline.reset[i]);
+		}
+		rig.step();
+
+		// edges: the scripted ones for a direct connection, or the ones Clkd outputs in this sample for a chain
+		float clockNow = clkd ? clkd->outputs[CLKD_CLK1_OUTPUT].getVoltage() : timeline.clock[i];
+		float resetNow = clkd ? clkd->outputs[CLKD_RESET_OUTPUT].getVoltage() : timeline.reset[i];
+		bool clockRise = clockEdge.process(clockNow);
+		bool resetRise = resetEdge.process(resetNow);
+		if (resetRise || clockRise) {
+			if (pendingSample >= 0)
+				result.noChange[pendingKind]++;
+			pendingSample = i;
+			if (resetRise) {
+				pendingKind = EDGE_RESET;
+				lastResetSample = i;
+			}
+			else {
+				pendingKind = (i - lastResetSample < (long)(sampleRate * 0.002f)) ? EDGE_CLOCK_AFTER_RESET : EDGE_CLOCK;
+			}
+		}
+
+		bool changed = false;
+		for (size_t o = 0; o < lc.observedOutputs.size(); o++) {
+			float v = seq->outputs[lc.observedOutputs[o]].getVoltage();
+			if (v != lastOutputs[o])
+				changed = true;
+			lastOutputs[o] = v;
+			trace.addVoltage(v);
+		}
+		if (changed && pendingSample >= 0) {
+			result.latencies[pendingKind].add((double)(i - pendingSample));
+			pendingSample = -1;
+		}
+	}
+	if (pendingSample >= 0)
+		result.noChange[pendingKind]++;
+	for (int k = 0; k < NUM_EDGE_KINDS; k++)
+		result.latencies[k].finish();
+	result.hash = trace.hash;
+	return result;
+}
+
+
+// most frequent latencies, as "latency:count" pairs
+static std::string histogram(const Stats& stats, size_t maxBins) {
+	std::map<long, int> counts;
+	for (double v : stats.values)
+		counts[(long)v]++;
+	std::vector<std::pair<int, long> > bins;
+	for (auto& c : counts)
+		bins.push_back(std::make_pair(-c.second, c.first));
+	std::sort(bins.begin(), bins.end());
+	std::string ret;
+	for (size_t b = 0; b < std::min(maxBins, bins.size()); b++)
+		ret += string::f(" %ld:%d", bins[b].second, -bins[b].first);
+	return ret;
+}
+
+
+static std::string goldenKey(const LatencyCase& lc, float sampleRate) {
+	return string::f("%s@%d", lc.name.c_str(), (int)sampleRate);
+}
+
+static std::map<std::string, uint64_t> readGolden(const std::string& path) {
+	std::map<std::string, uint64_t> golden;
+	FILE* file = fopen(path.c_str(), "r");
+	if (!file)
+		return golden;
+	char key[128];
+	unsigned long long hash;
+	while (fscanf(file, "%127s %llx", key, &hash) == 2)
+		golden[key] = hash;
+	fclose(file);
+	return golden;
+}
+
+
+int main(int argc, char* argv[]) {
+	std::string goldenPath;
+	bool update = false;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-g" && i + 1 < argc)
+			goldenPath = argv[++i];
+		else if (arg == "--update")
+			update = true;
+		else {
+			fprintf(stderr, "Usage: %s [-g goldenFile [--update]]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::map<std::string, uint64_t> golden = readGolden(goldenPath);
+	std::string newGolden;
+	int failures = 0;
+
+	printf("Latency in samples from edge to first output change (min / median / p99 / max, most frequent latency:count)\n");
+	for (const LatencyCase& lc : cases) {
+		for (float sampleRate : sampleRates) {
+			LatencyResult result = runCase(lc, sampleRate);
+			std::string key = goldenKey(lc, sampleRate);
+			for (int k = 0; k < NUM_EDGE_KINDS; k++) {
+				const Stats& s = result.latencies[k];
+				if (s.count() == 0 && result.noChange[k] == 0)
+					continue;
+				printf("%-22s %-9s n %3d  none %3d   %4.0f / %4.0f / %4.0f / %4.0f  %s\n", key.c_str(), edgeKindNames[k],
+					(int)s.count(), result.noChange[k], s.min(), s.percentile(0.5), s.percentile(0.99), s.max(), histogram(s, 4).c_str());
+			}
+			newGolden += string::f("%s %016llx\n", key.c_str(), (unsigned long long)result.hash);
+			if (!goldenPath.empty() && !update) {
+				auto it = golden.find(key);
+				if (it == golden.end()) {
+					printf("%-22s trace MISSING from %s\n", key.c_str(), goldenPath.c_str());
+					failures++;
+				}
+				else if (it->second != result.hash) {
+					printf("%-22s trace MISMATCH (%016llx, golden %016llx)\n", key.c_str(), (unsigned long long)result.hash, (unsigned long long)it->second);
+					failures++;
+				}
+			}
+		}
+	}
+
+	if (update) {
+		FILE* file = fopen(goldenPath.c_str(), "w");
+		if (!file) {
+			fprintf(stderr, "Cannot write %s\n", goldenPath.c_str());
+			return 1;
+		}
+		fputs(newGolden.c_str(), file);
+		fclose(file);
+		printf("Golden traces written to %s\n", goldenPath.c_str());
+	}
+	else if (!goldenPath.empty()) {
+		if (failures > 0) {
+			printf("%d trace(s) differ from %s\n", failures, goldenPath.c_str());
+			return 1;
+		}
+		printf("All traces match %s\n", goldenPath.c_str());
+	}
+	return 0;
+}
@@ -0,0 +1,137 @@
+//***********************************************************************************************
+//Impromptu Modular: Modules for VCV Rack by Marc Boulé
+//
+//See ./LICENSE.md for all licenses
+//***********************************************************************************************
+
+// Per-module process() cost: every registered model is run alone at 44.1, 48, 96 and 192 kHz, first idle (no input
+//   connected) and then driven (scripted clock, reset, CV and gate inputs), and each process() call is timed.
+// Usage: process_bench [-t seconds] [slug ...]  (no slug means all models)
+
+
+#include "BenchUtil.hpp"
+
+
+// Input ids of the scripted signals for each model, -1 when unused; models not listed are only run idle
+struct Drive {
+	const char* slug;
+	std::vector<int> clocks;
+	int reset;
+	std::vector<int> cvs;
+	std::vector<int> gates;
+};
+
+static const std::vector<Drive> drives = {
+	{"Big-Button-Seq", {0}, 5, {}, {}},
+	{"Big-Button-Seq2", {0}, 5, {10}, {}},
+	{"Chord-Key", {}, -1, {0}, {1}},
+	{"Chord-Key-Expander", {}, -1, {0, 1, 2, 3}, {}},
+	{"Clocked", {}, 4, {}, {}},
+	{"Clocked-Clkd", {}, 0, {}, {}},
+	{"Cv-Pad", {}, -1, {0}, {}},
+	{"Foundry", {6}, 5, {1, 2, 3, 4}, {}},
+	{"Four-View", {}, -1, {0, 1, 2, 3}, {}},
+	{"Gate-Seq-64", {0}, 1, {3}, {}},
+	{"Part-Gate-Split", {}, -1, {0, 2}, {1}},
+	{"Phrase-Seq-16", {3}, 2, {1, 7}, {}},
+	{"Phrase-Seq-32", {3}, 2, {1, 7}, {}},
+	{"Prob-Key", {}, -1, {0, 3}, {5}},
+	{"Semi-ModularSynth", {3}, 2, {1, 7}, {}},
+	{"TactG", {}, -1, {}, {0}},
+	{"Twelve-Key", {}, -1, {1}, {0}},
+	{"Write-Seq-32", {6}, 7, {1}, {2}},
+	{"Write-Seq-64", {6, 7}, 8, {1}, {2}},
+};
+
+static const float sampleRates[] = {44100.0f, 48000.0f, 96000.0f, 192000.0f};
+
+
+static const Drive* findDrive(const std::string& slug) {
+	for (const Drive& drive : drives) {
+		if (slug == drive.slug)
+			return &drive;
+	}
+	return nullptr;
+}
+
+
+static void runScenario(const std::string& slug, float sampleRate, const Drive* drive, float seconds) {
+	Rig rig(sampleRate);
+	Module* module = rig.add(slug);
+	rig.connectAllOutputs();
+
+	// 8 Hz clock (16th notes at 120 BPM), reset on a clock edge after 1 s and then every 2 s
+	ClockScript clock(sampleRate / 8.0);
+	TriggerScript reset((long)sampleRate, (long)(2.0f * sampleRate), sampleRate);
+	SteppedCvScript cv(12345);
+	if (drive) {
+		for (int id : drive->clocks)
+			module->inputs[id].channels = 1;
+		if (drive->reset >= 0)
+			module->inputs[drive->reset].channels = 1;
+		for (int id : drive->cvs)
+			module->inputs[id].channels = 1;
+		for (int id : drive->gates)
+			module->inputs[id].channels = 1;
+	}
+
+	const long numSamples = (long)(seconds * sampleRate);
+	const double overhead = timerOverheadNs();
+	Stats stats;
+	stats.values.reserve(numSamples);
+	for (long i = 0; i < numSamples; i++) {
+		if (drive) {
+			float clk = clock.next();
+			float cvValue = cv.next(clk);
+			for (int id : drive->clocks)
+				module->inputs[id].setVoltage(clk);
+			if (drive->reset >= 0)
+				module->inputs[drive->reset].setVoltage(reset.next());
+			for (int id : drive->cvs)
+				module->inputs[id].setVoltage(cvValue);
+			for (int id : drive->gates)
+				module->inputs[id].setVoltage(clk);
+		}
+		BenchClock::time_point t0 = BenchClock::now();
+		module->process(rig.args);
+		BenchClock::time_point t1 = BenchClock::now();
+		stats.add(std::max(0.0, elapsedNs(t0, t1) - overhead));
+		rig.stepCablesAndExpanders();
+	}
+	stats.finish();
+
+	printf("%-20s %-7s %5.1f kHz   mean %8.1f ns   p99 %8.1f ns   worst %9.1f ns\n", slug.c_str(), drive ? "driven" : "idle",
+		sampleRate / 1000.0f, stats.mean(), stats.percentile(0.99), stats.max());
+}
+
+
+int main(int argc, char* argv[]) {
+	float seconds = 2.0f;
+	std::vector<std::string> slugs;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-t" && i + 1 < argc)
+			seconds = (float)std::atof(argv[++i]);
+		else
+			slugs.push_back(arg);
+	}
+	if (slugs.empty()) {
+		for (Model* model : benchPlugin()->models)
+			slugs.push_back(model->slug);
+	}
+
+	printf("process() time per sample, %g s per run, timer overhead of %.1f ns removed\n", seconds, timerOverheadNs());
+	for (const std::string& slug : slugs) {
+		if (!findModel(slug)) {
+			fprintf(stderr, "Unknown model %s\n", slug.c_str());
+			return 1;
+		}
+		const Drive* drive = findDrive(slug);
+		for (float sampleRate : sampleRates) {
+			runScenario(slug, sampleRate, nullptr, seconds);
+			if (drive)
+				runScenario(slug, sampleRate, drive, seconds);
+		}
+	}
+	return 0;
+}
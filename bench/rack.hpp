@@ -0,0 +1,1032 @@
+//***********************************************************************************************
+//Impromptu Modular: Modules for VCV Rack by Marc Boulé
+//***********************************************************************************************
+
+// Headless stand-in for the Rack v1 SDK header, used only by the benchmarks in this directory (see Makefile here).
+// The engine side (ports, params, lights, dsp, random, simd) behaves like Rack v1 so that process() does the same work
+//   as in Rack; everything that is only reached from the GUI (widgets, windows, fonts, history, json) is an empty
+//   placeholder, so that the plugin sources compile and link unchanged without Rack, GLFW, NanoVG or jansson.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <set>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <cassert>
+#include <climits>
+#include <pmmintrin.h>
+
+
+#define ENUMS(name, count) name, name ## _LAST = name + (count) - 1
+#define CHECKMARK_STRING "✔"
+#define CHECKMARK(cond) ((cond) ? CHECKMARK_STRING : "")
+#define RIGHT_ARROW "▸"
+#define RACK_MOD_CTRL 2
+#define RACK_MOD_MASK 15
+#define DEPRECATED
+#define WARN(...) fprintf(stderr, __VA_ARGS__)
+#define INFO(...) fprintf(stderr, __VA_ARGS__)
+#define DEBUG(...) fprintf(stderr, __VA_ARGS__)
+
+// GLFW (only the constants that the sources use, with GLFW's values)
+#define GLFW_PRESS 1
+#define GLFW_RELEASE 0
+#define GLFW_REPEAT 2
+#define GLFW_MOD_SHIFT 0x0001
+#define GLFW_MOD_CONTROL 0x0002
+#define GLFW_MOD_ALT 0x0004
+#define GLFW_MOD_SUPER 0x0008
+#define GLFW_MOD_CAPS_LOCK 0x0010
+#define GLFW_MOD_NUM_LOCK 0x0020
+#define GLFW_MOUSE_BUTTON_LEFT 0
+#define GLFW_MOUSE_BUTTON_RIGHT 1
+#define GLFW_KEY_SPACE 32
+#define GLFW_KEY_APOSTROPHE 39
+#define GLFW_KEY_COMMA 44
+#define GLFW_KEY_MINUS 45
+#define GLFW_KEY_PERIOD 46
+#define GLFW_KEY_SLASH 47
+#define GLFW_KEY_0 48
+#define GLFW_KEY_1 49
+#define GLFW_KEY_2 50
+#define GLFW_KEY_3 51
+#define GLFW_KEY_4 52
+#define GLFW_KEY_5 53
+#define GLFW_KEY_6 54
+#define GLFW_KEY_7 55
+#define GLFW_KEY_8 56
+#define GLFW_KEY_9 57
+#define GLFW_KEY_SEMICOLON 59
+#define GLFW_KEY_EQUAL 61
+#define GLFW_KEY_A 65
+#define GLFW_KEY_B 66
+#define GLFW_KEY_C 67
+#define GLFW_KEY_D 68
+#define GLFW_KEY_E 69
+#define GLFW_KEY_F 70
+#define GLFW_KEY_G 71
+#define GLFW_KEY_H 72
+#define GLFW_KEY_I 73
+#define GLFW_KEY_J 74
+#define GLFW_KEY_K 75
+#define GLFW_KEY_L 76
+#define GLFW_KEY_M 77
+#define GLFW_KEY_N 78
+#define GLFW_KEY_O 79
+#define GLFW_KEY_P 80
+#define GLFW_KEY_Q 81
+#define GLFW_KEY_R 82
+#define GLFW_KEY_S 83
+#define GLFW_KEY_T 84
+#define GLFW_KEY_U 85
+#define GLFW_KEY_V 86
+#define GLFW_KEY_W 87
+#define GLFW_KEY_X 88
+#define GLFW_KEY_Y 89
+#define GLFW_KEY_Z 90
+#define GLFW_KEY_LEFT_BRACKET 91
+#define GLFW_KEY_BACKSLASH 92
+#define GLFW_KEY_RIGHT_BRACKET 93
+#define GLFW_KEY_GRAVE_ACCENT 96
+#define GLFW_KEY_WORLD_1 161
+#define GLFW_KEY_WORLD_2 162
+#define GLFW_KEY_ESCAPE 256
+#define GLFW_KEY_ENTER 257
+#define GLFW_KEY_TAB 258
+#define GLFW_KEY_BACKSPACE 259
+#define GLFW_KEY_INSERT 260
+#define GLFW_KEY_DELETE 261
+#define GLFW_KEY_RIGHT 262
+#define GLFW_KEY_LEFT 263
+#define GLFW_KEY_DOWN 264
+#define GLFW_KEY_UP 265
+#define GLFW_KEY_PAGE_UP 266
+#define GLFW_KEY_PAGE_DOWN 267
+#define GLFW_KEY_HOME 268
+#define GLFW_KEY_END 269
+#define GLFW_KEY_CAPS_LOCK 280
+#define GLFW_KEY_SCROLL_LOCK 281
+#define GLFW_KEY_NUM_LOCK 282
+#define GLFW_KEY_PRINT_SCREEN 283
+#define GLFW_KEY_PAUSE 284
+#define GLFW_KEY_F1 290
+#define GLFW_KEY_F2 291
+#define GLFW_KEY_F3 292
+#define GLFW_KEY_F4 293
+#define GLFW_KEY_F5 294
+#define GLFW_KEY_F6 295
+#define GLFW_KEY_F7 296
+#define GLFW_KEY_F8 297
+#define GLFW_KEY_F9 298
+#define GLFW_KEY_F10 299
+#define GLFW_KEY_F11 300
+#define GLFW_KEY_F12 301
+#define GLFW_KEY_F13 302
+#define GLFW_KEY_F14 303
+#define GLFW_KEY_F15 304
+#define GLFW_KEY_F16 305
+#define GLFW_KEY_F17 306
+#define GLFW_KEY_F18 307
+#define GLFW_KEY_F19 308
+#define GLFW_KEY_F20 309
+#define GLFW_KEY_F21 310
+#define GLFW_KEY_F22 311
+#define GLFW_KEY_F23 312
+#define GLFW_KEY_F24 313
+#define GLFW_KEY_F25 314
+#define GLFW_KEY_KP_0 320
+#define GLFW_KEY_KP_1 321
+#define GLFW_KEY_KP_2 322
+#define GLFW_KEY_KP_3 323
+#define GLFW_KEY_KP_4 324
+#define GLFW_KEY_KP_5 325
+#define GLFW_KEY_KP_6 326
+#define GLFW_KEY_KP_7 327
+#define GLFW_KEY_KP_8 328
+#define GLFW_KEY_KP_9 329
+#define GLFW_KEY_KP_DECIMAL 330
+#define GLFW_KEY_KP_DIVIDE 331
+#define GLFW_KEY_KP_MULTIPLY 332
+#define GLFW_KEY_KP_SUBTRACT 333
+#define GLFW_KEY_KP_ADD 334
+#define GLFW_KEY_KP_ENTER 335
+#define GLFW_KEY_KP_EQUAL 336
+#define GLFW_KEY_LEFT_SHIFT 340
+#define GLFW_KEY_LEFT_CONTROL 341
+#define GLFW_KEY_LEFT_ALT 342
+#define GLFW_KEY_LEFT_SUPER 343
+#define GLFW_KEY_RIGHT_SHIFT 344
+#define GLFW_KEY_RIGHT_CONTROL 345
+#define GLFW_KEY_RIGHT_ALT 346
+#define GLFW_KEY_RIGHT_SUPER 347
+#define GLFW_KEY_MENU 348
+inline void glfwSetClipboardString(void*, const char*) {}
+inline const char* glfwGetClipboardString(void*) {return nullptr;}
+
+
+// NanoVG (drawing is never reached)
+struct NVGcolor {float r, g, b, a;};
+struct NVGcontext;
+struct NVGpaint {};
+inline NVGcolor nvgRGBAf(float r, float g, float b, float a) {NVGcolor c = {r, g, b, a}; return c;}
+inline NVGcolor nvgRGBf(float r, float g, float b) {return nvgRGBAf(r, g, b, 1.0f);}
+inline NVGcolor nvgRGBA(unsigned char r, unsigned char g, unsigned char b, unsigned char a) {return nvgRGBAf(r / 255.0f, g / 255.0f, b / 255.0f, a / 255.0f);}
+inline NVGcolor nvgRGB(unsigned char r, unsigned char g, unsigned char b) {return nvgRGBA(r, g, b, 255);}
+inline NVGcolor nvgTransRGBA(NVGcolor c, unsigned char a) {c.a = a / 255.0f; return c;}
+inline void nvgText(NVGcontext*, float, float, const char*, const char*) {}
+inline void nvgFillColor(NVGcontext*, NVGcolor) {}
+inline void nvgFontFaceId(NVGcontext*, int) {}
+inline void nvgTextLetterSpacing(NVGcontext*, float) {}
+inline void nvgMoveTo(NVGcontext*, float, float) {}
+inline void nvgLineTo(NVGcontext*, float, float) {}
+inline void nvgStrokeWidth(NVGcontext*, float) {}
+inline void nvgStrokeColor(NVGcontext*, NVGcolor) {}
+inline void nvgStroke(NVGcontext*) {}
+inline void nvgBeginPath(NVGcontext*) {}
+inline void nvgRoundedRect(NVGcontext*, float, float, float, float, float) {}
+inline void nvgRect(NVGcontext*, float, float, float, float) {}
+inline void nvgFontSize(NVGcontext*, float) {}
+inline void nvgFill(NVGcontext*) {}
+inline void nvgSave(NVGcontext*) {}
+inline void nvgRestore(NVGcontext*) {}
+inline void nvgTranslate(NVGcontext*, float, float) {}
+inline void nvgScissor(NVGcontext*, float, float, float, float) {}
+inline void nvgGlobalCompositeOperation(NVGcontext*, int) {}
+inline void nvgCircle(NVGcontext*, float, float, float) {}
+inline void nvgClosePath(NVGcontext*) {}
+inline void nvgFillPaint(NVGcontext*, NVGpaint) {}
+inline void nvgTextAlign(NVGcontext*, int) {}
+inline NVGpaint nvgRadialGradient(NVGcontext*, float, float, float, float, NVGcolor, NVGcolor) {return NVGpaint();}
+inline NVGpaint nvgLinearGradient(NVGcontext*, float, float, float, float, NVGcolor, NVGcolor) {return NVGpaint();}
+#define NVG_LIGHTER 0
+#define NVG_ALIGN_CENTER 1
+#define NVG_ALIGN_LEFT 2
+#define NVG_ALIGN_RIGHT 4
+
+
+// jansson (patches are not saved or loaded by the benchmarks, so every value is null)
+struct json_t;
+struct json_error_t {char text[160];};
+inline json_t* json_object() {return nullptr;}
+inline json_t* json_array() {return nullptr;}
+inline json_t* json_integer(long long) {return nullptr;}
+inline json_t* json_real(double) {return nullptr;}
+inline json_t* json_boolean(bool) {return nullptr;}
+inline json_t* json_string(const char*) {return nullptr;}
+inline json_t* json_true() {return nullptr;}
+inline json_t* json_false() {return nullptr;}
+inline json_t* json_null() {return nullptr;}
+inline json_t* json_object_get(const json_t*, const char*) {return nullptr;}
+inline int json_object_set_new(json_t*, const char*, json_t*) {return 0;}
+inline int json_object_set(json_t*, const char*, json_t*) {return 0;}
+inline long long json_integer_value(const json_t*) {return 0;}
+inline double json_number_value(const json_t*) {return 0.0;}
+inline double json_real_value(const json_t*) {return 0.0;}
+inline const char* json_string_value(const json_t*) {return nullptr;}
+inline bool json_is_true(const json_t*) {return false;}
+inline bool json_is_false(const json_t*) {return false;}
+inline bool json_is_array(const json_t*) {return false;}
+inline bool json_is_object(const json_t*) {return false;}
+inline bool json_is_integer(const json_t*) {return false;}
+inline bool json_is_number(const json_t*) {return false;}
+inline bool json_boolean_value(const json_t*) {return false;}
+inline json_t* json_array_get(const json_t*, size_t) {return nullptr;}
+inline int json_array_insert_new(json_t*, size_t, json_t*) {return 0;}
+inline int json_array_append_new(json_t*, json_t*) {return 0;}
+inline size_t json_array_size(const json_t*) {return 0;}
+inline void json_decref(json_t*) {}
+inline json_t* json_incref(json_t* j) {return j;}
+inline json_t* json_loads(const char*, size_t, json_error_t*) {return nullptr;}
+inline json_t* json_loadf(FILE*, size_t, json_error_t*) {return nullptr;}
+inline char* json_dumps(const json_t*, size_t) {return nullptr;}
+inline int json_dumpf(const json_t*, FILE*, size_t) {return 0;}
+#define JSON_INDENT(n) ((n) & 0x1F)
+#define JSON_REAL_PRECISION(n) (((n) & 0x1F) << 11)
+#define JSON_COMPACT 0x20
+
+
+namespace rack {
+struct Plugin;
+struct Model;
+
+
+inline int clamp(int x, int a, int b) {return std::max(std::min(x, b), a);}
+inline float clamp(float x, float a, float b) {return std::fmax(std::fmin(x, b), a);}
+inline int eucMod(int a, int b) {int m = a % b; if (m < 0) m += b; return m;}
+inline int eucDiv(int a, int b) {int d = a / b; if (d * b != a && (a < 0) != (b < 0)) d--; return d;}
+inline void eucDivMod(int a, int b, int* div, int* mod) {*div = a / b; *mod = a % b; if (*mod < 0) {(*div)--; *mod += b;}}
+inline float interpolateLinear(const float* p, float x) {int xi = (int)x; float xf = x - xi; return p[xi] + (p[xi + 1] - p[xi]) * xf;}
+inline float rescale(float x, float a, float b, float c, float d) {return c + (x - a) / (b - a) * (d - c);}
+inline float crossfade(float a, float b, float p) {return a + (b - a) * p;}
+inline bool isEven(int x) {return x % 2 == 0;}
+
+
+namespace math {
+struct Vec {
+	float x = 0.f, y = 0.f;
+	Vec() {}
+	Vec(float x, float y) : x(x), y(y) {}
+	Vec plus(Vec b) const {return Vec(x + b.x, y + b.y);}
+	Vec minus(Vec b) const {return Vec(x - b.x, y - b.y);}
+	Vec mult(float s) const {return Vec(x * s, y * s);}
+	Vec mult(Vec b) const {return Vec(x * b.x, y * b.y);}
+	Vec div(float s) const {return Vec(x / s, y / s);}
+	Vec neg() const {return Vec(-x, -y);}
+	Vec flip() const {return Vec(y, x);}
+	bool isEqual(Vec b) const {return x == b.x && y == b.y;}
+};
+struct Rect {
+	Vec pos, size;
+	Rect() {}
+	Rect(Vec pos, Vec size) : pos(pos), size(size) {}
+	bool isContaining(Vec v) const {return v.x >= pos.x && v.x < pos.x + size.x && v.y >= pos.y && v.y < pos.y + size.y;}
+	Vec getCenter() const {return pos.plus(size.mult(0.5f));}
+};
+using rack::clamp; using rack::rescale; using rack::eucMod;
+inline bool isNear(float a, float b, float eps = 1e-6f) {return std::fabs(a - b) <= eps;}
+inline float normalizeZero(float x) {return x + 0.f;}
+}
+using math::Vec; using math::Rect;
+inline float mm2px(float mm) {return mm * 75.f / 25.4f;}
+inline Vec mm2px(Vec mm) {return mm.mult(75.f / 25.4f);}
+static const int PORT_MAX_CHANNELS = 16;
+
+
+namespace simd {
+// same representation as Rack's float_4 (one SSE register), so that vector code costs the same as in Rack
+struct float_4 {
+	__m128 v;
+	float_4() {}
+	float_4(__m128 v) : v(v) {}
+	float_4(float x) {v = _mm_set1_ps(x);}
+	float_4(float a, float b, float c, float d) {v = _mm_setr_ps(a, b, c, d);}
+	static float_4 zero() {return float_4(_mm_setzero_ps());}
+	static float_4 load(const float* x) {return float_4(_mm_loadu_ps(x));}
+	void store(float* x) {_mm_storeu_ps(x, v);}
+	static float_4 mask() {return float_4(_mm_castsi128_ps(_mm_set1_epi32(-1)));}
+	float& operator[](int i) {return ((float*)&v)[i];}
+	const float& operator[](int i) const {return ((const float*)&v)[i];}
+};
+inline float_4 operator+(float_4 a, float_4 b) {return float_4(_mm_add_ps(a.v, b.v));}
+inline float_4 operator-(float_4 a, float_4 b) {return float_4(_mm_sub_ps(a.v, b.v));}
+inline float_4 operator*(float_4 a, float_4 b) {return float_4(_mm_mul_ps(a.v, b.v));}
+inline float_4 operator/(float_4 a, float_4 b) {return float_4(_mm_div_ps(a.v, b.v));}
+inline float_4 operator-(float_4 a) {return float_4(_mm_sub_ps(_mm_setzero_ps(), a.v));}
+inline float_4 operator&(float_4 a, float_4 b) {return float_4(_mm_and_ps(a.v, b.v));}
+inline float_4 operator|(float_4 a, float_4 b) {return float_4(_mm_or_ps(a.v, b.v));}
+inline float_4 operator^(float_4 a, float_4 b) {return float_4(_mm_xor_ps(a.v, b.v));}
+inline float_4 operator~(float_4 a) {return a ^ float_4::mask();}
+inline float_4 operator<(float_4 a, float_4 b) {return float_4(_mm_cmplt_ps(a.v, b.v));}
+inline float_4 operator>(float_4 a, float_4 b) {return float_4(_mm_cmpgt_ps(a.v, b.v));}
+inline float_4 operator<=(float_4 a, float_4 b) {return float_4(_mm_cmple_ps(a.v, b.v));}
+inline float_4 operator>=(float_4 a, float_4 b) {return float_4(_mm_cmpge_ps(a.v, b.v));}
+inline float_4 operator==(float_4 a, float_4 b) {return float_4(_mm_cmpeq_ps(a.v, b.v));}
+inline float_4 operator!=(float_4 a, float_4 b) {return float_4(_mm_cmpneq_ps(a.v, b.v));}
+inline float_4& operator+=(float_4& a, float_4 b) {return a = a + b;}
+inline float_4& operator-=(float_4& a, float_4 b) {return a = a - b;}
+inline float_4& operator*=(float_4& a, float_4 b) {return a = a * b;}
+inline float_4 ifelse(float_4 mask, float_4 a, float_4 b) {return (mask & a) | float_4(_mm_andnot_ps(mask.v, b.v));}
+inline float_4 fmin(float_4 a, float_4 b) {return float_4(_mm_min_ps(a.v, b.v));}
+inline float_4 fmax(float_4 a, float_4 b) {return float_4(_mm_max_ps(a.v, b.v));}
+inline float_4 clamp(float_4 x, float_4 a, float_4 b) {return fmin(fmax(x, a), b);}
+inline int movemask(float_4 a) {return _mm_movemask_ps(a.v);}
+}
+
+
+namespace random {
+// xoroshiro128+ as in Rack, with a fixed seed so that benchmark runs are repeatable (see seed())
+struct Xoroshiro128Plus {
+	uint64_t state[2] = {0x9E3779B97F4A7C15ULL, 0xD1B54A32D192ED03ULL};
+	static uint64_t rotl(uint64_t x, int k) {return (x << k) | (x >> (64 - k));}
+	uint64_t next() {
+		uint64_t s0 = state[0];
+		uint64_t s1 = state[1];
+		uint64_t result = s0 + s1;
+		s1 ^= s0;
+		state[0] = rotl(s0, 55) ^ s1 ^ (s1 << 14);
+		state[1] = rotl(s1, 36);
+		return result;
+	}
+};
+inline Xoroshiro128Plus& rng() {static Xoroshiro128Plus r; return r;}
+inline void seed(uint64_t s0, uint64_t s1) {rng().state[0] = s0; rng().state[1] = s1; for (int i = 0; i < 50; i++) rng().next();}
+inline uint64_t u64() {return rng().next();}
+inline uint32_t u32() {return (uint32_t)(u64() >> 32);}
+inline float uniform() {return (u32() >> 8) / 16777216.f;}
+inline float normal() {const float radius = std::sqrt(-2.f * std::log(1.f - uniform())); const float theta = 2.f * (float)M_PI * uniform(); return radius * std::sin(theta);}
+}
+
+
+namespace string {
+inline std::string f(const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	char buf[1024];
+	vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+	return buf;
+}
+}
+
+namespace asset {
+// empty paths, so that the plugin settings file is neither read nor written by the benchmarks
+inline std::string plugin(Plugin*, const std::string&) {return "";}
+inline std::string system(const std::string&) {return "";}
+inline std::string user(const std::string&) {return "";}
+}
+
+
+namespace dsp {
+struct SchmittTrigger {
+	bool state = true;
+	void reset() {state = true;}
+	bool process(float in) {
+		if (state) {
+			if (in <= 0.f)
+				state = false;
+		}
+		else if (in >= 1.f) {
+			state = true;
+			return true;
+		}
+		return false;
+	}
+	bool isHigh() {return state;}
+};
+struct BooleanTrigger {
+	bool state = true;
+	void reset() {state = true;}
+	bool process(bool s) {bool triggered = s && !state; state = s; return triggered;}
+};
+struct PulseGenerator {
+	float remaining = 0.f;
+	void reset() {remaining = 0.f;}
+	bool process(float deltaTime) {if (remaining > 0.f) {remaining -= deltaTime; return true;} return false;}
+	void trigger(float duration = 1e-3f) {if (duration > remaining) remaining = duration;}
+};
+struct RCFilter {
+	float c = 0.f;
+	float xstate[1] = {0.f};
+	float ystate[1] = {0.f};
+	void setCutoff(float r) {c = 2.f / r;}
+	void process(float x) {
+		float y = (x + xstate[0] - ystate[0] * (1 - c)) / (1 + c);
+		xstate[0] = x;
+		ystate[0] = y;
+	}
+	float lowpass() {return ystate[0];}
+	float highpass() {return xstate[0] - ystate[0];}
+};
+// same buffer handling as Rack's MinBlepGenerator; the step shape is a windowed-sinc integral computed here instead of
+//   Rack's minimum-phase table, which only changes the ripple, not the work done per sample or per discontinuity
+template <int Z, int O, typename T = float>
+struct MinBlepGenerator {
+	T buf[2 * Z] = {};
+	int pos = 0;
+	float impulse[2 * Z * O + 1];
+	MinBlepGenerator() {
+		float sum = 0.f;
+		for (int i = 0; i <= 2 * Z * O; i++) {
+			float x = (float)(i - Z * O) / O;
+			float sinc = (x == 0.f) ? 1.f : std::sin((float)M_PI * x) / ((float)M_PI * x);
+			float window = 0.42f - 0.5f * std::cos(2.f * (float)M_PI * i / (2 * Z * O)) + 0.08f * std::cos(4.f * (float)M_PI * i / (2 * Z * O));
+			sum += sinc * window;
+			impulse[i] = sum;
+		}
+		for (int i = 0; i <= 2 * Z * O; i++) {
+			impulse[i] = impulse[i] / sum - 1.f;
+		}
+	}
+	void insertDiscontinuity(float p, T x) {
+		if (!(-1 < p && p <= 0))
+			return;
+		for (int j = 0; j < 2 * Z; j++) {
+			float minBlepIndex = ((float)j - p) * O;
+			int index = (int)minBlepIndex;
+			float frac = minBlepIndex - index;
+			float a = impulse[std::min(index, 2 * Z * O)];
+			float b = impulse[std::min(index + 1, 2 * Z * O)];
+			buf[(pos + j) % (2 * Z)] += x * (a + (b - a) * frac);
+		}
+	}
+	T process() {
+		T v = buf[pos];
+		buf[pos] = T(0);
+		pos = (pos + 1) % (2 * Z);
+		return v;
+	}
+};
+template <int OVERSAMPLE, int QUALITY, typename T = float>
+struct Decimator {
+	T inBuffer[OVERSAMPLE * QUALITY] = {};
+	float kernel[OVERSAMPLE * QUALITY];
+	int inIndex = 0;
+	Decimator(float cutoff = 0.9f) {
+		float sum = 0.f;
+		for (int i = 0; i < OVERSAMPLE * QUALITY; i++) {
+			float x = (i - (OVERSAMPLE * QUALITY - 1) / 2.f) * cutoff / OVERSAMPLE;
+			kernel[i] = (x == 0.f) ? 1.f : std::sin((float)M_PI * x) / ((float)M_PI * x);
+			sum += kernel[i];
+		}
+		for (int i = 0; i < OVERSAMPLE * QUALITY; i++) {
+			kernel[i] /= sum;
+		}
+	}
+	void reset() {inIndex = 0; std::memset(inBuffer, 0, sizeof(inBuffer));}
+	T process(T* in) {
+		std::memcpy(&inBuffer[inIndex], in, OVERSAMPLE * sizeof(T));
+		inIndex += OVERSAMPLE;
+		inIndex %= OVERSAMPLE * QUALITY;
+		T out = 0.f;
+		for (int i = 0; i < OVERSAMPLE * QUALITY; i++) {
+			int index = inIndex - 1 - i;
+			index = (index + OVERSAMPLE * QUALITY) % (OVERSAMPLE * QUALITY);
+			out += kernel[i] * inBuffer[index];
+		}
+		return out;
+	}
+};
+template <typename T>
+T quadraticBipolar(T x) {T x2 = x * x; return (x >= 0.f) ? x2 : -x2;}
+template <typename T, typename F>
+void stepRK4(T t, T dt, T x[], int len, F f) {
+	T k1[len], k2[len], k3[len], k4[len], yi[len];
+	f(t, x, k1);
+	for (int i = 0; i < len; i++) yi[i] = x[i] + k1[i] * dt / 2.f;
+	f(t + dt / 2.f, yi, k2);
+	for (int i = 0; i < len; i++) yi[i] = x[i] + k2[i] * dt / 2.f;
+	f(t + dt / 2.f, yi, k3);
+	for (int i = 0; i < len; i++) yi[i] = x[i] + k3[i] * dt;
+	f(t + dt, yi, k4);
+	for (int i = 0; i < len; i++) x[i] += dt * (k1[i] + 2.f * k2[i] + 2.f * k3[i] + k4[i]) / 6.f;
+}
+static const float FREQ_C4 = 261.6256f;
+template <typename T, size_t S>
+struct RingBuffer {
+	T data[S];
+	size_t start = 0;
+	size_t end = 0;
+	size_t mask(size_t i) const {return i & (S - 1);}
+	void push(T t) {size_t i = mask(end++); data[i] = t;}
+	T shift() {return data[mask(start++)];}
+	void clear() {start = end;}
+	bool empty() const {return start == end;}
+	bool full() const {return end - start == S;}
+	size_t size() const {return end - start;}
+};
+struct ClockDivider {
+	uint32_t clock = 0;
+	uint32_t division = 1;
+	void reset() {clock = 0;}
+	void setDivision(uint32_t d) {division = d;}
+	uint32_t getDivision() {return division;}
+	uint32_t getClock() {return clock;}
+	bool process() {if (++clock >= division) {clock = 0; return true;} return false;}
+};
+}
+
+
+struct Font {int handle = -1;};
+struct Svg {};
+
+
+struct Plugin {
+	std::string slug;
+	std::list<Model*> models;
+	void addModel(Model* model);
+};
+
+
+namespace engine {
+struct Module;
+
+struct Param {
+	float value = 0.f;
+	float getValue() {return value;}
+	void setValue(float v) {value = v;}
+};
+
+struct Port {
+	float voltages[PORT_MAX_CHANNELS] = {};
+	uint8_t channels = 0;// 0 when no cable, the benchmarks "connect" a port by setting it to 1 or more
+	float getVoltage(int c = 0) {return voltages[c];}
+	void setVoltage(float v, int c = 0) {voltages[c] = v;}
+	float getPolyVoltage(int c) {return isMonophonic() ? getVoltage(0) : getVoltage(c);}
+	float getNormalVoltage(float n, int c = 0) {return isConnected() ? getVoltage(c) : n;}
+	float getNormalPolyVoltage(float n, int c) {return isConnected() ? getPolyVoltage(c) : n;}
+	float* getVoltages(int firstChannel = 0) {return &voltages[firstChannel];}
+	void readVoltages(float* v) {for (int c = 0; c < channels; c++) v[c] = voltages[c];}
+	void writeVoltages(const float* v) {for (int c = 0; c < channels; c++) voltages[c] = v[c];}
+	simd::float_4 getVoltageSimd4(int c) {return simd::float_4::load(&voltages[c]);}
+	void setVoltageSimd(simd::float_4 v, int c) {v.store(&voltages[c]);}
+	float getVoltageSum() {float sum = 0.f; for (int c = 0; c < channels; c++) sum += voltages[c]; return sum;}
+	bool isConnected() {return channels > 0;}
+	bool isMonophonic() {return channels == 1;}
+	bool isPolyphonic() {return channels > 1;}
+	int getChannels() {return channels;}
+	void setChannels(int channels) {
+		// as in Rack, a port without a cable stays at 0 channels, and a connected one never goes below 1
+		if (this->channels == 0)
+			return;
+		for (int c = channels; c < this->channels; c++)
+			voltages[c] = 0.f;
+		if (channels == 0)
+			channels = 1;
+		this->channels = channels;
+	}
+};
+struct Input : Port {};
+struct Output : Port {};
+
+struct Light {
+	float value = 0.f;
+	void setBrightness(float brightness) {value = brightness;}
+	float getBrightness() {return value;}
+	void setSmoothBrightness(float brightness, float deltaTime) {
+		if (brightness < value) {
+			const float lambda = 30.f;// fade out
+			value += (brightness - value) * lambda * deltaTime;
+		}
+		else {
+			value = brightness;
+		}
+	}
+};
+
+struct ParamQuantity {
+	Module* module = nullptr;
+	int paramId = 0;
+	float minValue = 0.f;
+	float maxValue = 1.f;
+	float defaultValue = 0.f;
+	std::string label;
+	std::string unit;
+	float displayBase = 0.f;
+	float displayMultiplier = 1.f;
+	float displayOffset = 0.f;
+	bool randomizeEnabled = true;
+	bool snapEnabled = false;
+	virtual ~ParamQuantity() {}
+	Param* getParam();
+	virtual void setValue(float value) {if (getParam()) getParam()->setValue(clamp(value, getMinValue(), getMaxValue()));}
+	virtual float getValue() {return getParam() ? getParam()->getValue() : 0.f;}
+	virtual float getMinValue() {return minValue;}
+	virtual float getMaxValue() {return maxValue;}
+	virtual float getDefaultValue() {return defaultValue;}
+	virtual float getDisplayValue() {return getValue() * displayMultiplier + displayOffset;}
+	virtual void setDisplayValue(float displayValue) {setValue((displayValue - displayOffset) / displayMultiplier);}
+	virtual std::string getDisplayValueString() {return string::f("%g", getDisplayValue());}
+	virtual void setDisplayValueString(std::string s) {setDisplayValue(std::atof(s.c_str()));}
+	virtual std::string getLabel() {return label;}
+	virtual std::string getUnit() {return unit;}
+	virtual std::string getString() {return getLabel() + ": " + getDisplayValueString() + getUnit();}
+	virtual void reset() {setValue(getDefaultValue());}
+	virtual void randomize() {if (isBounded()) setValue(minValue + random::uniform() * (maxValue - minValue));}
+	bool isBounded() {return std::isfinite(minValue) && std::isfinite(maxValue);}
+};
+
+struct Module {
+	struct Expander {
+		int moduleId = -1;
+		Module* module = nullptr;
+		void* producerMessage = nullptr;
+		void* consumerMessage = nullptr;
+		bool messageFlipRequested = false;
+	};
+	struct ProcessArgs {
+		float sampleRate;
+		float sampleTime;
+	};
+
+	int id = -1;
+	Model* model = nullptr;
+	std::vector<Param> params;
+	std::vector<Input> inputs;
+	std::vector<Output> outputs;
+	std::vector<Light> lights;
+	std::vector<ParamQuantity*> paramQuantities;
+	Expander leftExpander;
+	Expander rightExpander;
+	bool bypass = false;
+
+	virtual ~Module() {
+		for (ParamQuantity* paramQuantity : paramQuantities) {
+			delete paramQuantity;
+		}
+	}
+	void config(int numParams, int numInputs, int numOutputs, int numLights = 0) {
+		params.resize(numParams);
+		inputs.resize(numInputs);
+		outputs.resize(numOutputs);
+		lights.resize(numLights);
+		paramQuantities.resize(numParams, nullptr);
+	}
+	template <class TParamQuantity = ParamQuantity>
+	void configParam(int paramId, float minValue, float maxValue, float defaultValue, std::string label = "", std::string unit = "", float displayBase = 0.f, float displayMultiplier = 1.f, float displayOffset = 0.f) {
+		delete paramQuantities[paramId];
+		params[paramId].value = defaultValue;
+		ParamQuantity* q = new TParamQuantity;
+		q->module = this;
+		q->paramId = paramId;
+		q->minValue = minValue;
+		q->maxValue = maxValue;
+		q->defaultValue = defaultValue;
+		q->label = label;
+		q->unit = unit;
+		q->displayBase = displayBase;
+		q->displayMultiplier = displayMultiplier;
+		q->displayOffset = displayOffset;
+		paramQuantities[paramId] = q;
+	}
+	virtual void process(const ProcessArgs& args) {step();}
+	virtual void step() {}
+	virtual json_t* dataToJson() {return nullptr;}
+	virtual void dataFromJson(json_t*) {}
+	virtual void onAdd() {}
+	virtual void onRemove() {}
+	virtual void onReset() {}
+	virtual void onRandomize() {}
+	virtual void onSampleRateChange() {}
+};
+inline Param* ParamQuantity::getParam() {return module ? &module->params[paramId] : nullptr;}
+
+struct Engine {
+	float sampleRate = 44100.f;
+	std::vector<Module*> modules;// only what the benchmark added, for getModule()
+	float getSampleRate() {return sampleRate;}
+	float getSampleTime() {return 1.f / sampleRate;}
+	Module* getModule(int id) {for (Module* m : modules) {if (m->id == id) return m;} return nullptr;}
+};
+}
+using engine::Module; using engine::Param; using engine::Input; using engine::Output; using engine::Light; using engine::ParamQuantity; using engine::Port;
+
+
+// Everything below is only reached from the GUI
+
+
+namespace widget {struct Widget;}
+namespace event {
+using widget::Widget;
+struct Base {
+	void* context = nullptr;
+	template <class T> void consume(T*) const {}
+	void* getTarget() const {return nullptr;}
+	void setTarget(void*) const {}
+	bool isConsumed() const {return false;}
+};
+struct PositionBase {Vec pos;};
+struct KeyBase {int key = 0; int scancode = 0; std::string keyName; int action = 0; int mods = 0;};
+struct Hover : Base, PositionBase {Vec mouseDelta;};
+struct Button : Base, PositionBase {int button = 0; int action = 0; int mods = 0;};
+struct DoubleClick : Base {};
+struct HoverKey : Base, PositionBase, KeyBase {};
+struct SelectKey : Base, KeyBase {};
+struct HoverText : Base, PositionBase {int codepoint;};
+struct SelectText : Base {int codepoint;};
+struct HoverScroll : Base, PositionBase {Vec scrollDelta;};
+struct Enter : Base {}; struct Leave : Base {}; struct Select : Base {}; struct Deselect : Base {};
+struct DragBase : Base {int button = 0;};
+struct DragStart : DragBase {}; struct DragEnd : DragBase {}; struct DragMove : DragBase {Vec mouseDelta;};
+struct DragHover : DragBase, PositionBase {Widget* origin; Vec mouseDelta;};
+struct DragEnter : DragBase {Widget* origin;}; struct DragLeave : DragBase {Widget* origin;}; struct DragDrop : DragBase {Widget* origin;};
+struct Action : Base {}; struct Change : Base {}; struct Add : Base {}; struct Remove : Base {}; struct Show : Base {}; struct Hide : Base {};
+struct Zoom : Base {}; struct Reposition : Base {}; struct Resize : Base {};
+struct State {template <class T> void setSelected(T*) {} void setHovered(void*) {}};
+}
+
+namespace widget {
+struct Widget {
+	Rect box;
+	Widget* parent = nullptr;
+	std::list<Widget*> children;
+	bool visible = true;
+	bool requestedDelete = false;
+	struct DrawArgs {NVGcontext* vg; Rect clipBox; void* fb = nullptr;};
+	virtual ~Widget() {clearChildren();}
+	void addChild(Widget* child) {child->parent = this; children.push_back(child);}
+	void addChildBottom(Widget* child) {child->parent = this; children.push_front(child);}
+	void removeChild(Widget* child) {child->parent = nullptr; children.remove(child);}
+	void clearChildren() {for (Widget* child : children) delete child; children.clear();}
+	template <class T> T* getAncestorOfType() {return nullptr;}
+	template <class T> T* getFirstDescendantOfType() {return nullptr;}
+	Vec getRelativeOffset(Vec v, Widget*) {return v;}
+	Rect getViewport(Rect r = Rect()) {return r;}
+	void show() {visible = true;}
+	void hide() {visible = false;}
+	void requestDelete() {requestedDelete = true;}
+	virtual void step() {}
+	virtual void draw(const DrawArgs& args) {}
+	virtual void onHover(const event::Hover&) {}
+	virtual void onButton(const event::Button&) {}
+	virtual void onDoubleClick(const event::DoubleClick&) {}
+	virtual void onHoverKey(const event::HoverKey&) {}
+	virtual void onHoverText(const event::HoverText&) {}
+	virtual void onHoverScroll(const event::HoverScroll&) {}
+	virtual void onEnter(const event::Enter&) {}
+	virtual void onLeave(const event::Leave&) {}
+	virtual void onSelect(const event::Select&) {}
+	virtual void onDeselect(const event::Deselect&) {}
+	virtual void onSelectKey(const event::SelectKey&) {}
+	virtual void onSelectText(const event::SelectText&) {}
+	virtual void onDragStart(const event::DragStart&) {}
+	virtual void onDragEnd(const event::DragEnd&) {}
+	virtual void onDragMove(const event::DragMove&) {}
+	virtual void onDragHover(const event::DragHover&) {}
+	virtual void onDragEnter(const event::DragEnter&) {}
+	virtual void onDragLeave(const event::DragLeave&) {}
+	virtual void onDragDrop(const event::DragDrop&) {}
+	virtual void onAction(const event::Action&) {}
+	virtual void onChange(const event::Change&) {}
+	virtual void onZoom(const event::Zoom&) {}
+	virtual void onAdd(const event::Add&) {}
+	virtual void onRemove(const event::Remove&) {}
+	virtual void onShow(const event::Show&) {}
+	virtual void onHide(const event::Hide&) {}
+};
+struct TransparentWidget : Widget {};
+struct OpaqueWidget : Widget {};
+struct FramebufferWidget : Widget {bool dirty = true; float oversample = 1.f; void setDirty(bool d = true) {dirty = d;}};
+struct SvgWidget : Widget {std::shared_ptr<Svg> svg; void wrap() {} void setSvg(std::shared_ptr<Svg> s) {svg = s;}};
+struct TransformWidget : Widget {void identity() {} void translate(Vec) {} void rotate(float) {} void rotate(float, Vec) {} void scale(Vec) {}};
+}
+using widget::Widget; using widget::TransparentWidget; using widget::OpaqueWidget; using widget::FramebufferWidget; using widget::SvgWidget; using widget::TransformWidget;
+
+namespace ui {
+struct MenuEntry : OpaqueWidget {};
+struct MenuLabel : MenuEntry {std::string text;};
+struct MenuSeparator : MenuEntry {};
+struct Menu : OpaqueWidget {void setChildMenu(Menu* menu) {delete menu;}};
+struct MenuItem : MenuEntry {std::string text; std::string rightText; bool disabled = false; virtual Menu* createChildMenu() {return nullptr;}};
+struct MenuOverlay : OpaqueWidget {};
+struct TextField : OpaqueWidget {
+	std::string text;
+	std::string placeholder;
+	bool multiline = false;
+	int cursor = 0;
+	int selection = 0;
+	void setText(std::string t) {text = t;}
+	std::string getText() {return text;}
+	void selectAll() {}
+};
+struct Quantity {
+	virtual ~Quantity() {}
+	virtual void setValue(float) {}
+	virtual float getValue() {return 0.f;}
+	virtual float getDefaultValue() {return 0.f;}
+	virtual float getMinValue() {return 0.f;}
+	virtual float getMaxValue() {return 1.f;}
+	virtual std::string getLabel() {return "";}
+	virtual std::string getUnit() {return "";}
+	virtual float getDisplayValue() {return 0.f;}
+	virtual void setDisplayValue(float) {}
+	virtual std::string getDisplayValueString() {return "";}
+};
+struct Slider : OpaqueWidget {Quantity* quantity = nullptr;};
+struct Label : Widget {std::string text;};
+}
+using namespace ui;
+
+namespace app {
+struct CircularShadow : TransparentWidget {float blurRadius = 0.f; float opacity = 0.f;};
+struct ParamWidget : OpaqueWidget {ParamQuantity* paramQuantity = nullptr; virtual void reset() {} virtual void randomize() {}};
+struct Knob : ParamWidget {bool horizontal = false; bool smooth = true; bool snap = false; float speed = 1.f; float snapValue = 0.f;};
+struct SliderKnob : Knob {};
+struct SvgKnob : Knob {
+	FramebufferWidget* fb = nullptr;
+	CircularShadow* shadow = nullptr;
+	TransformWidget* tw = nullptr;
+	SvgWidget* sw = nullptr;
+	float minAngle = 0.f;
+	float maxAngle = 0.f;
+	SvgKnob() {fb = new FramebufferWidget; addChild(fb); shadow = new CircularShadow; fb->addChild(shadow); tw = new TransformWidget; fb->addChild(tw); sw = new SvgWidget; tw->addChild(sw);}
+	void setSvg(std::shared_ptr<Svg> svg) {sw->setSvg(svg);}
+};
+struct Switch : ParamWidget {bool momentary = false;};
+struct SvgSwitch : Switch {
+	FramebufferWidget* fb = nullptr;
+	CircularShadow* shadow = nullptr;
+	SvgWidget* sw = nullptr;
+	std::vector<std::shared_ptr<Svg>> frames;
+	bool latch = false;
+	SvgSwitch() {fb = new FramebufferWidget; addChild(fb); shadow = new CircularShadow; fb->addChild(shadow); sw = new SvgWidget; fb->addChild(sw);}
+	void addFrame(std::shared_ptr<Svg> svg) {frames.push_back(svg);}
+};
+struct PortWidget : OpaqueWidget {Module* module = nullptr; int portId = 0; enum Type {OUTPUT, INPUT}; Type type = OUTPUT;};
+struct SvgPort : PortWidget {
+	FramebufferWidget* fb = nullptr;
+	CircularShadow* shadow = nullptr;
+	SvgWidget* sw = nullptr;
+	SvgPort() {fb = new FramebufferWidget; addChild(fb); shadow = new CircularShadow; fb->addChild(shadow); sw = new SvgWidget; fb->addChild(sw);}
+	void setSvg(std::shared_ptr<Svg> svg) {sw->setSvg(svg);}
+};
+struct SvgScrew : Widget {
+	FramebufferWidget* fb = nullptr;
+	SvgWidget* sw = nullptr;
+	SvgScrew() {fb = new FramebufferWidget; addChild(fb); sw = new SvgWidget; fb->addChild(sw);}
+	void setSvg(std::shared_ptr<Svg> svg) {sw->setSvg(svg);}
+};
+struct SvgPanel : FramebufferWidget {void setBackground(std::shared_ptr<Svg>) {}};
+struct LightWidget : TransparentWidget {NVGcolor bgColor; NVGcolor color; NVGcolor borderColor;};
+struct MultiLightWidget : LightWidget {std::vector<NVGcolor> baseColors; void addBaseColor(NVGcolor c) {baseColors.push_back(c);}};
+struct ModuleLightWidget : MultiLightWidget {Module* module = nullptr; int firstLightId = 0;};
+struct CableWidget : OpaqueWidget {PortWidget* inputPort = nullptr; PortWidget* outputPort = nullptr; void setInput(PortWidget* p) {inputPort = p;} void setOutput(PortWidget* p) {outputPort = p;}};
+struct ModuleWidget : OpaqueWidget {
+	Model* model = nullptr;
+	Module* module = nullptr;
+	Widget* panel = nullptr;
+	std::vector<PortWidget*> inputs;
+	std::vector<PortWidget*> outputs;
+	std::vector<ParamWidget*> params;
+	~ModuleWidget() {delete module;}
+	void setModule(Module* m) {module = m;}
+	void setPanel(std::shared_ptr<Svg>) {}
+	void addParam(ParamWidget* p) {params.push_back(p); addChild(p);}
+	void addInput(PortWidget* p) {inputs.push_back(p); addChild(p);}
+	void addOutput(PortWidget* p) {outputs.push_back(p); addChild(p);}
+	PortWidget* getInput(int portId) {for (PortWidget* p : inputs) {if (p->portId == portId) return p;} return nullptr;}
+	PortWidget* getOutput(int portId) {for (PortWidget* p : outputs) {if (p->portId == portId) return p;} return nullptr;}
+	virtual void appendContextMenu(Menu*) {}
+	json_t* toJson() {return nullptr;}
+	void fromJson(json_t*) {}
+};
+struct RackWidget : OpaqueWidget {
+	Widget* moduleContainer = nullptr;
+	Widget* cableContainer = nullptr;
+	Vec mousePos;
+	void setModulePosNearest(ModuleWidget*, Vec) {}
+	void addModule(ModuleWidget* mw) {delete mw;}
+	ModuleWidget* getModule(int) {return nullptr;}
+	std::list<CableWidget*> getCablesOnPort(PortWidget*) {return std::list<CableWidget*>();}
+	void addCable(CableWidget* cable) {delete cable;}
+};
+struct Scene : OpaqueWidget {RackWidget* rack = nullptr;};
+}
+using namespace app;
+
+struct Window {
+	void* win = nullptr;
+	std::shared_ptr<Svg> loadSvg(const std::string&) {return std::make_shared<Svg>();}
+	std::shared_ptr<Font> loadFont(const std::string&) {return std::make_shared<Font>();}
+	int getMods() {return 0;}
+};
+
+namespace history {
+struct Action {std::string name; virtual ~Action() {} virtual void undo() {} virtual void redo() {}};
+struct ModuleAction : Action {int moduleId = -1;};
+struct ModuleAdd : ModuleAction {void setModule(ModuleWidget*) {}};
+struct State {void push(Action* action) {delete action;}};
+}
+
+struct Model {
+	Plugin* plugin = nullptr;
+	std::string slug;
+	std::string name;
+	std::string description;
+	virtual ~Model() {}
+	virtual Module* createModule() = 0;
+	virtual ModuleWidget* createModuleWidget() = 0;
+	virtual ModuleWidget* createModuleWidgetNull() = 0;
+};
+inline void Plugin::addModel(Model* model) {model->plugin = this; models.push_back(model);}
+
+struct Context {
+	Window* window;
+	engine::Engine* engine;
+	app::Scene* scene;
+	history::State* history;
+	event::State* event;
+};
+inline Context* contextGet() {
+	static Window window;
+	static engine::Engine engine;
+	static app::RackWidget rack;
+	static app::Scene scene;
+	static history::State history;
+	static event::State event;
+	static Context context = {&window, &engine, &scene, &history, &event};
+	scene.rack = &rack;
+	return &context;
+}
+#define APP rack::contextGet()
+
+template <class TModule, class TModuleWidget>
+Model* createModel(const std::string& slug) {
+	struct TModel : Model {
+		Module* createModule() override {TModule* m = new TModule; m->model = this; return m;}
+		ModuleWidget* createModuleWidget() override {TModule* m = new TModule; m->model = this; TModuleWidget* mw = new TModuleWidget(m); mw->model = this; return mw;}
+		ModuleWidget* createModuleWidgetNull() override {TModuleWidget* mw = new TModuleWidget(nullptr); mw->model = this; return mw;}
+	};
+	TModel* o = new TModel;
+	o->slug = slug;
+	return o;
+}
+template <class TWidget> TWidget* createWidget(Vec pos) {TWidget* o = new TWidget; o->box.pos = pos; return o;}
+template <class TWidget> TWidget* createWidgetCentered(Vec pos) {return createWidget<TWidget>(pos);}
+template <class TParamWidget> TParamWidget* createParam(Vec pos, Module* module, int paramId) {TParamWidget* o = new TParamWidget; o->box.pos = pos; if (module) o->paramQuantity = module->paramQuantities[paramId]; return o;}
+template <class TParamWidget> TParamWidget* createParamCentered(Vec pos, Module* module, int paramId) {return createParam<TParamWidget>(pos, module, paramId);}
+template <class TPortWidget> TPortWidget* createInput(Vec pos, Module* module, int inputId) {TPortWidget* o = new TPortWidget; o->box.pos = pos; o->module = module; o->type = PortWidget::INPUT; o->portId = inputId; return o;}
+template <class TPortWidget> TPortWidget* createInputCentered(Vec pos, Module* module, int inputId) {return createInput<TPortWidget>(pos, module, inputId);}
+template <class TPortWidget> TPortWidget* createOutput(Vec pos, Module* module, int outputId) {TPortWidget* o = new TPortWidget; o->box.pos = pos; o->module = module; o->type = PortWidget::OUTPUT; o->portId = outputId; return o;}
+template <class TPortWidget> TPortWidget* createOutputCentered(Vec pos, Module* module, int outputId) {return createOutput<TPortWidget>(pos, module, outputId);}
+template <class TModuleLightWidget> TModuleLightWidget* createLight(Vec pos, Module* module, int firstLightId) {TModuleLightWidget* o = new TModuleLightWidget; o->box.pos = pos; o->module = module; o->firstLightId = firstLightId; return o;}
+template <class TModuleLightWidget> TModuleLightWidget* createLightCentered(Vec pos, Module* module, int firstLightId) {return createLight<TModuleLightWidget>(pos, module, firstLightId);}
+template <class TMenuLabel = MenuLabel> TMenuLabel* createMenuLabel(std::string text) {TMenuLabel* o = new TMenuLabel; o->text = text; return o;}
+template <class TMenuItem = MenuItem> TMenuItem* createMenuItem(std::string text, std::string rightText = "") {TMenuItem* o = new TMenuItem; o->text = text; o->rightText = rightText; return o;}
+inline ui::Menu* createMenu() {return new ui::Menu;}
+
+
+// componentlibrary (only the components that the sources use)
+struct GrayModuleLightWidget : ModuleLightWidget {};
+struct RedLight : GrayModuleLightWidget {}; struct GreenLight : GrayModuleLightWidget {}; struct BlueLight : GrayModuleLightWidget {};
+struct YellowLight : GrayModuleLightWidget {}; struct WhiteLight : GrayModuleLightWidget {};
+struct GreenRedLight : GrayModuleLightWidget {}; struct RedGreenBlueLight : GrayModuleLightWidget {};
+template <typename BASE> struct LargeLight : BASE {}; template <typename BASE> struct MediumLight : BASE {};
+template <typename BASE> struct SmallLight : BASE {}; template <typename BASE> struct TinyLight : BASE {};
+template <typename BASE> struct LEDBezelLight : BASE {}; template <typename BASE> struct LEDSliderLight : BASE {};
+struct LEDBezel : SvgSwitch {}; struct TL1105 : SvgSwitch {}; struct CKSS : SvgSwitch {}; struct CKSSThree : SvgSwitch {};
+struct CKD6 : SvgSwitch {}; struct LEDButton : SvgSwitch {};
+struct PJ301MPort : SvgPort {};
+struct ScrewSilver : SvgScrew {}; struct ScrewBlack : SvgScrew {};
+struct RoundKnob : SvgKnob {}; struct RoundSmallBlackKnob : RoundKnob {}; struct RoundBlackKnob : RoundKnob {};
+struct Trimpot : SvgKnob {}; struct BefacoTinyKnob : SvgKnob {};
+struct SvgSlider : SliderKnob {
+	FramebufferWidget* fb = nullptr;
+	SvgWidget* background = nullptr;
+	SvgWidget* handle = nullptr;
+	Vec minHandlePos;
+	Vec maxHandlePos;
+	SvgSlider() {fb = new FramebufferWidget; addChild(fb); background = new SvgWidget; fb->addChild(background); handle = new SvgWidget; fb->addChild(handle);}
+	void setBackgroundSvg(std::shared_ptr<Svg> svg) {background->setSvg(svg);}
+	void setHandleSvg(std::shared_ptr<Svg> svg) {handle->setSvg(svg);}
+	void setHandlePosCentered(Vec minPos, Vec maxPos) {minHandlePos = minPos; maxHandlePos = maxPos;}
+};
+struct LEDSlider : SvgSlider {};
+static const NVGcolor SCHEME_RED = {1, 0, 0, 1}, SCHEME_GREEN = {0, 1, 0, 1}, SCHEME_BLUE = {0, 0, 1, 1}, SCHEME_YELLOW = {1, 1, 0, 1};
+static const NVGcolor SCHEME_WHITE = {1, 1, 1, 1}, SCHEME_ORANGE = {1, .5f, 0, 1}, SCHEME_PURPLE = {1, 0, 1, 1}, SCHEME_BLACK = {0, 0, 0, 1};
+static const NVGcolor SCHEME_BLACK_TRANSPARENT = {0, 0, 0, 0}, SCHEME_LIGHT_GRAY = {.5f, .5f, .5f, 1}, SCHEME_DARK_GRAY = {.2f, .2f, .2f, 1}, SCHEME_CYAN = {0, 1, 1, 1};
+static const float RACK_GRID_WIDTH = 15.f;
+static const float RACK_GRID_HEIGHT = 380.f;
+
+}// namespace rack
+
+
+template <typename F>
+struct DeferWrapper {F f; ~DeferWrapper() {f();}};
+template <typename F>
+DeferWrapper<F> deferWrapper(F f) {return DeferWrapper<F>{f};}
+#define DEFER_CAT2(a, b) a##b
+#define DEFER_CAT(a, b) DEFER_CAT2(a, b)
+#define DEFER(code) auto DEFER_CAT(_defer_, __COUNTER__) = deferWrapper([&]() code)
@@ -69,6 +69,7 @@ struct BigButtonSeq : Module {
 	bool writeFillsToMemory;
 	bool quantizeBig;
 	bool nextStepHits;
+	ModuleRandom rng;// only the seed options are saved
 	
 	// No need to save, with reset
 	long clockIgnoreOnReset;
@@ -137,8 +138,14 @@ struct BigButtonSeq : Module {
 		writeFillsToMemory = false;
 		quantizeBig = true;
 		nextStepHits = false;
+		rng.init();
 		resetNonJson();
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+	}
+	
 	void resetNonJson() {
 		clockIgnoreOnReset = (long) (clockIgnoreOnResetDuration * APP->engine->getSampleRate());
 		lastPeriod = 2.0;
@@ -150,7 +157,7 @@ struct BigButtonSeq : Module {
 
 	void onRandomize() override {
 		int chanRnd = calcChan();
-		gates[chanRnd][bank[chanRnd]] = random::u64();
+		gates[chanRnd][bank[chanRnd]] = rng.u64();
 	}
 
 	
@@ -191,6 +198,9 @@ struct BigButtonSeq : Module {
 		// nextStepHits
 		json_object_set_new(rootJ, "nextStepHits", json_boolean(nextStepHits));
 
+		// rng
+		rng.dataToJson(rootJ);
+
 		return rootJ;
 	}
 
@@ -252,6 +262,9 @@ struct BigButtonSeq : Module {
 		if (nextStepHitsJ)
 			nextStepHits = json_is_true(nextStepHitsJ);
 
+		// rng
+		rng.dataFromJson(rootJ);
+
 		resetNonJson();
 	}
 
@@ -343,7 +356,7 @@ struct BigButtonSeq : Module {
 				// Random (toggle gate according to probability knob)
 				float rnd01 = params[RND_PARAM].getValue() / 100.0f + inputs[RND_INPUT].getVoltage() / 10.0f;
 				if (rnd01 > 0.0f) {
-					if (random::uniform() < rnd01)// random::uniform is [0.0, 1.0), see include/util/common.hpp
+					if (rng.uniform() < rnd01)// rng.uniform is [0.0, 1.0)
 						toggleGate(channel);
 				}
 				lastPeriod = clockTime > 2.0 ? 2.0 : clockTime;
@@ -355,6 +368,7 @@ struct BigButtonSeq : Module {
 		// Reset
 		if (resetTrigger.process(params[RESET_PARAM].getValue() + inputs[RESET_INPUT].getVoltage())) {
 			clockIgnoreOnReset = (long) (clockIgnoreOnResetDuration * args.sampleRate);
+			rng.onSeqReset();
 			indexStep = 0;
 			outPulse.trigger(0.001f);
 			outLightPulse.trigger(0.02f);
@@ -381,7 +395,7 @@ struct BigButtonSeq : Module {
 		
 		// lights
 		if (refresh.processLights()) {
-			float deltaTime = (float)sampleTime * (RefreshCounter::displayRefreshStepSkips);
+			float deltaTime = (float)sampleTime * (refresh.displayRefreshStepSkips);
 
 			// Gate light outputs
 			bool bigLightPulseState = bigLightPulse.process(deltaTime);
@@ -393,7 +407,7 @@ struct BigButtonSeq : Module {
 				lights[(CHAN_LIGHTS + i) * 2 + 0].setBrightness(i == channel ? (1.0f - lights[(CHAN_LIGHTS + i) * 2 + 1].getBrightness()) : 0.0f);
 			}
 
-			deltaTime = (float)sampleTime * (RefreshCounter::displayRefreshStepSkips >> 2);
+			deltaTime = (float)sampleTime * (refresh.displayRefreshStepSkips >> 2);
 			
 			// Big button lights
 			lights[BIG_LIGHT].setBrightness(bank[channel] == 1 ? 1.0f : 0.0f);
@@ -571,6 +585,10 @@ struct BigButtonSeqWidget : ModuleWidget {
 		nhitsItem->module = module;
 		menu->addChild(nhitsItem);
 
+		RandomSeedItem *seedItem = createMenuItem<RandomSeedItem>("Random seed", RIGHT_ARROW);
+		seedItem->rngPtr = &module->rng;
+		menu->addChild(seedItem);
+
 		MetronomeItem *metroItem = createMenuItem<MetronomeItem>("Metronome light", RIGHT_ARROW);
 		metroItem->module = module;
 		menu->addChild(metroItem);
@@ -707,8 +725,7 @@ struct BigButtonSeqWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((BigButtonSeq*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((BigButtonSeq*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((BigButtonSeq*)module)->panelTheme);
 		}
 		Widget::step();
 	}
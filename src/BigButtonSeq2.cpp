@@ -79,6 +79,8 @@ struct BigButtonSeq2 : Module {
 	bool quantizeBig;
 	bool nextStepHits;
 	bool sampleAndHold;
+	int clockBusSource;// 0 when the clock input is a regular clock, 1 to 4 when it is a clock bus (see ClockBusChannelIds)
+	ModuleRandom rng;// only the seed options are saved
 	
 	// No need to save, with reset
 	long clockIgnoreOnReset;
@@ -115,7 +117,7 @@ struct BigButtonSeq2 : Module {
 	inline void clearGate(int _chan, int _step) {gates[_chan][bank[_chan]][_step >> 6] &= ~(((uint64_t)1) << (uint64_t)(_step & 0x3F));}
 	inline void toggleGate(int _chan, int _step) {gates[_chan][bank[_chan]][_step >> 6] ^= (((uint64_t)1) << (uint64_t)(_step & 0x3F));}
 	inline void clearGates(int _chan, int bnk) {gates[_chan][bnk][0] = 0; gates[_chan][bnk][1] = 0;}
-	inline void randomizeGates(int _chan, int bnk) {gates[_chan][bnk][0] = random::u64(); gates[_chan][bnk][1] = random::u64();}
+	inline void randomizeGates(int _chan, int bnk) {gates[_chan][bnk][0] = rng.u64(); gates[_chan][bnk][1] = rng.u64();}
 	inline void writeCV(int _chan, int _step, float cvValue) {cv[_chan][bank[_chan]][_step] = cvValue;}
 	inline void writeCV(int _chan, int bnk, int _step, float cvValue) {cv[_chan][bnk][_step] = cvValue;}
 	inline void sampleOutput(int _chan) {sampleHoldBuf[_chan] = cv[_chan][bank[_chan]][indexStep];}
@@ -164,8 +166,15 @@ struct BigButtonSeq2 : Module {
 		quantizeBig = true;
 		nextStepHits = false;
 		sampleAndHold = false;
+		clockBusSource = 0;
+		rng.init();
 		resetNonJson();
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+	}
+	
 	void resetNonJson() {
 		clockIgnoreOnReset = (long) (clockIgnoreOnResetDuration * APP->engine->getSampleRate());
 		lastPeriod = 2.0;
@@ -180,7 +189,7 @@ struct BigButtonSeq2 : Module {
 		int chanRnd = calcChan();
 		randomizeGates(chanRnd, bank[chanRnd]);
 		for (int s = 0; s < 128; s++)
-			writeCV(chanRnd, bank[chanRnd], s, ((float)(random::u32() % 5)) + ((float)(random::u32() % 12)) / 12.0f - 2.0f);
+			writeCV(chanRnd, bank[chanRnd], s, ((float)(rng.u32() % 5)) + ((float)(rng.u32() % 12)) / 12.0f - 2.0f);
 	}
 
 	
@@ -250,6 +259,12 @@ struct BigButtonSeq2 : Module {
 		// sampleAndHold
 		json_object_set_new(rootJ, "sampleAndHold", json_boolean(sampleAndHold));
 
+		// clockBusSource
+		json_object_set_new(rootJ, "clockBusSource", json_integer(clockBusSource));
+		
+		// rng
+		rng.dataToJson(rootJ);
+
 		return rootJ;
 	}
 
@@ -351,6 +366,14 @@ struct BigButtonSeq2 : Module {
 		json_t *sampleAndHoldJ = json_object_get(rootJ, "sampleAndHold");
 		if (sampleAndHoldJ)
 			sampleAndHold = json_is_true(sampleAndHoldJ);
+
+		// clockBusSource
+		json_t *clockBusSourceJ = json_object_get(rootJ, "clockBusSource");
+		if (clockBusSourceJ)
+			clockBusSource = clamp((int)json_integer_value(clockBusSourceJ), 0, 4);
+
+		// rng
+		rng.dataFromJson(rootJ);
 		
 		resetNonJson();
 	}
@@ -486,7 +509,7 @@ struct BigButtonSeq2 : Module {
 		
 		// Clock
 		if (clockIgnoreOnReset == 0l) {			
-			if (clockTrigger.process(inputs[CLK_INPUT].getVoltage() + params[CLOCK_PARAM].getValue())) {
+			if (clockTrigger.process(getClockBusClock(inputs[CLK_INPUT], clockBusSource) + params[CLOCK_PARAM].getValue())) {
 				if ((++indexStep) >= length) indexStep = 0;
 				
 				// Fill button
@@ -511,7 +534,7 @@ struct BigButtonSeq2 : Module {
 				// Random (toggle gate according to probability knob)
 				float rnd01 = params[RND_PARAM].getValue() / 100.0f + inputs[RND_INPUT].getVoltage() / 10.0f;
 				if (rnd01 > 0.0f) {
-					if (random::uniform() < rnd01)// random::uniform is [0.0, 1.0), see include/util/common.hpp
+					if (rng.uniform() < rnd01)// rng.uniform is [0.0, 1.0)
 						toggleGate(channel, indexStep);
 				}
 				lastPeriod = clockTime > 2.0 ? 2.0 : clockTime;
@@ -521,8 +544,9 @@ struct BigButtonSeq2 : Module {
 			
 		
 		// Reset
-		if (resetTrigger.process(params[RESET_PARAM].getValue() + inputs[RESET_INPUT].getVoltage())) {
+		if (resetTrigger.process(params[RESET_PARAM].getValue() + inputs[RESET_INPUT].getVoltage() + getClockBusChannel(inputs[CLK_INPUT], clockBusSource, CLKBUS_RESET))) {
 			clockIgnoreOnReset = (long) (clockIgnoreOnResetDuration * args.sampleRate);
+			rng.onSeqReset();
 			indexStep = 0;
 			//outPulse.trigger(0.001f);
 			outLightPulse.trigger(0.02f);
@@ -555,7 +579,7 @@ struct BigButtonSeq2 : Module {
 		
 		// lights
 		if (refresh.processLights()) {
-			float deltaTime = (float)sampleTime * RefreshCounter::displayRefreshStepSkips;
+			float deltaTime = (float)sampleTime * refresh.displayRefreshStepSkips;
 
 			// Gate light outputs
 			bool bigLightPulseState = bigLightPulse.process(deltaTime);
@@ -567,7 +591,7 @@ struct BigButtonSeq2 : Module {
 				lights[(CHAN_LIGHTS + i) * 2 + 0].setBrightness(i == channel ? (1.0f - lights[(CHAN_LIGHTS + i) * 2 + 1].getBrightness()) : 0.0f);
 			}
 			
-			deltaTime = (float)sampleTime * (RefreshCounter::displayRefreshStepSkips >> 2);
+			deltaTime = (float)sampleTime * (refresh.displayRefreshStepSkips >> 2);
 
 			// Big button lights
 			lights[BIG_LIGHT].setBrightness(bank[channel] == 1 ? 1.0f : 0.0f);
@@ -796,6 +820,14 @@ struct BigButtonSeq2Widget : ModuleWidget {
 		MetronomeItem *metroItem = createMenuItem<MetronomeItem>("Metronome light", RIGHT_ARROW);
 		metroItem->module = module;
 		menu->addChild(metroItem);
+
+		ClockBusSourceItem *busItem = createMenuItem<ClockBusSourceItem>("Clock input is poly clock bus", RIGHT_ARROW);
+		busItem->clockBusSourcePtr = &module->clockBusSource;
+		menu->addChild(busItem);
+
+		RandomSeedItem *seedItem = createMenuItem<RandomSeedItem>("Random seed", RIGHT_ARROW);
+		seedItem->rngPtr = &module->rng;
+		menu->addChild(seedItem);
 	}	
 	
 	
@@ -941,8 +973,7 @@ struct BigButtonSeq2Widget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((BigButtonSeq2*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((BigButtonSeq2*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((BigButtonSeq2*)module)->panelTheme);
 		}
 		Widget::step();
 	}
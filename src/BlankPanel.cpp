@@ -77,8 +77,7 @@ struct BlankPanelWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((BlankPanel*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((BlankPanel*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((BlankPanel*)module)->panelTheme);
 		}
 		Widget::step();
 	}
@@ -40,7 +40,7 @@ struct ChordKey : Module {
 	
 	
 	// Expander
-	// none
+	ExpanderSender<float[5]> toExpander;// messages to FourView or ChordKeyExpander: 4 CV values, panelTheme
 		
 	// Constants
 	static const int NUM_CHORDS = 25;// C4 to C6 incl
@@ -137,6 +137,11 @@ struct ChordKey : Module {
 		autostepPaste = 0;
 		resetNonJson();
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+	}
+	
 	void resetNonJson() {
 		noteLightCounter = 0ul;
 		// C-major triad with base note on C4
@@ -406,7 +411,7 @@ struct ChordKey : Module {
 					keys[index][cni] = pkInfo.key;
 				}
 				else {
-					offWarning = (long) (warningTime * args.sampleRate / RefreshCounter::displayRefreshStepSkips);
+					offWarning = (long) (warningTime * args.sampleRate / refresh.displayRefreshStepSkips);
 					offWarningChan = cni;
 				}
 			}	
@@ -518,12 +523,15 @@ struct ChordKey : Module {
 		if (refresh.processInputs()) {
 			// To Expander
 			if (rightExpander.module && (rightExpander.module->model == modelFourView || rightExpander.module->model == modelChordKeyExpander)) {
-				float *messageToExpander = (float*)(rightExpander.module->leftExpander.producerMessage);
+				float *messageToExpander = toExpander.message;
 				for (int cni = 0; cni < 4; cni++) {
 					messageToExpander[cni] = octs[index][cni] >= 0 ? cvOuts[cni] : -100.0f;
 				}
 				messageToExpander[4] = (float)panelTheme;
-				rightExpander.module->leftExpander.messageFlipRequested = true;
+				toExpander.sendRight(this);
+			}
+			else {
+				toExpander.reset();
 			}
 		}
 	}
@@ -569,7 +577,7 @@ struct ChordKeyWidget : ModuleWidget {
 			else {
 				displayStr[0] = '-';
 				if (module->offWarning > 0l && index == module->offWarningChan) {
-					bool warningFlashState = calcWarningFlash(module->offWarning, (long) (module->warningTime * APP->engine->getSampleRate() / RefreshCounter::displayRefreshStepSkips));
+					bool warningFlashState = calcWarningFlash(module->offWarning, (long) (module->warningTime * APP->engine->getSampleRate() / module->refresh.displayRefreshStepSkips));
 					if (!warningFlashState) 
 						displayStr[0] = 'X';
 				}
@@ -964,8 +972,7 @@ struct ChordKeyWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((ChordKey*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((ChordKey*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((ChordKey*)module)->panelTheme);
 		}
 		Widget::step();
 	}
@@ -32,7 +32,8 @@ struct ChordKeyExpander : Module {
 	const float unusedValue = -100.0f;
 
 	// Expander
-	float leftMessages[2][5] = {};// messages from mother (CvPad or ChordKey): 4 CV values, panelTheme
+	ExpanderChannel<float[5]> fromMother;// messages from mother (ChordKey): 4 CV values, panelTheme
+	ExpanderSender<float[5]> toExpander;// messages to FourView or ChordKeyExpander, same format
 
 	// Need to save, no reset
 	// none
@@ -54,8 +55,7 @@ struct ChordKeyExpander : Module {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		onReset();
 		
-		leftExpander.producerMessage = leftMessages[0];
-		leftExpander.consumerMessage = leftMessages[1];
+		fromMother.construct(&leftExpander);
 		
 		char strBuf[32];
 		for (int c = 0; c < 4; c++) {
@@ -70,10 +70,16 @@ struct ChordKeyExpander : Module {
 	void onReset() override {
 		resetNonJson();
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+	}
+	
 	void resetNonJson() {
 		for (int i = 0; i < 4; i++) {
 			chordValues[i] = unusedValue;
 		}
+		fromMother.reset();// mother doesn't resend an unchanged chord, so take the last message again on the next refresh
 		fillEnabledNotes();// uses chordValues[]
 		updateRanges();// uses enabledNotes[]
 	}
@@ -99,13 +105,16 @@ struct ChordKeyExpander : Module {
 			bool motherPresent = (leftExpander.module && leftExpander.module->model == modelChordKey);
 			if (motherPresent) {
 				// From Mother
-				float *messagesFromMother = (float*)leftExpander.consumerMessage;
-				for (int i = 0; i < 4; i++) {
-					chordValues[i] = messagesFromMother[i];
+				if (fromMother.receive()) {
+					float *messagesFromMother = fromMother.data();
+					for (int i = 0; i < 4; i++) {
+						chordValues[i] = messagesFromMother[i];
+					}
+					panelTheme = clamp((int)(messagesFromMother[4] + 0.5f), 0, 1);
 				}
-				panelTheme = clamp((int)(messagesFromMother[4] + 0.5f), 0, 1);
 			}	
 			else {
+				fromMother.reset();
 				for (int i = 0; i < 4; i++) {
 					chordValues[i] = unusedValue;
 				}
@@ -146,12 +155,15 @@ struct ChordKeyExpander : Module {
 		if (refresh.processInputs()) {
 			// To Expander
 			if (rightExpander.module && (rightExpander.module->model == modelFourView || rightExpander.module->model == modelChordKeyExpander)) {
-				float *messageToExpander = (float*)(rightExpander.module->leftExpander.producerMessage);
+				float *messageToExpander = toExpander.message;
 				for (int i = 0; i < 4; i++) {
 					messageToExpander[i] = chordValues[i];
 				}
 				messageToExpander[4] = (float)panelTheme;
-				rightExpander.module->leftExpander.messageFlipRequested = true;
+				toExpander.sendRight(this);
+			}
+			else {
+				toExpander.reset();
 			}
 		}		
 	}// process()
@@ -268,8 +280,7 @@ struct ChordKeyExpanderWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((ChordKeyExpander*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((ChordKeyExpander*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((ChordKeyExpander*)module)->panelTheme);
 		}
 		Widget::step();
 	}
@@ -28,6 +28,8 @@ class Clock {
 	static constexpr double guard = 0.0005;// in seconds, region for sync to occur right before end of length of last iteration; sub clocks must be low during this period
 	bool *resetClockOutputsHigh;
 	bool *trigOut;
+	bool *subSampleEdges;
+	double carry;// when subSampleEdges, fractional sample time that was left over when the frame ended, the next frame starts there
 	
 	public:
 	
@@ -35,8 +37,9 @@ class Clock {
 		reset();
 	}
 	
-	void reset() {
+	void reset(double carryGiven = 0.0) {
 		step = -1.0;
+		carry = carryGiven;
 	}
 	bool isReset() {
 		return step == -1.0;
@@ -44,13 +47,14 @@ class Clock {
 	double getStep() {
 		return step;
 	}
-	void construct(Clock* clkGiven, bool *resetClockOutputsHighPtr, bool *trigOutPtr) {
+	void construct(Clock* clkGiven, bool *resetClockOutputsHighPtr, bool *trigOutPtr, bool *subSampleEdgesPtr) {
 		syncSrc = clkGiven;
 		resetClockOutputsHigh = resetClockOutputsHighPtr;
 		trigOut = trigOutPtr;
+		subSampleEdges = subSampleEdgesPtr;
 	}
 	void start() {
-		step = 0.0;
+		step = (*subSampleEdges ? carry : 0.0);
 	}
 	
 	void setup(double lengthGiven, int iterationsGiven, double sampleTimeGiven) {
@@ -64,7 +68,7 @@ class Clock {
 			step += sampleTime;
 			if ( (syncSrc != nullptr) && (iterations == 1) && (step > (length - guard)) ) {// if in sync region
 				if (syncSrc->isReset()) {
-					reset();
+					reset(syncSrc->carry);
 				}// else nothing needs to be done, just wait and step stays the same
 			}
 			else {
@@ -72,7 +76,7 @@ class Clock {
 					iterations--;
 					step -= length;
 					if (iterations <= 0) 
-						reset();// frame done
+						reset(step);// frame done
 				}
 			}
 		}
@@ -91,7 +95,15 @@ class Clock {
 			return (step < (length * 0.5)) ? 1 : 0;
 		}
 		return (*resetClockOutputsHigh) ? 1 : 0;
-	}	
+	}
+	
+	double getEdgeAge(int high) {// time since the last edge, valid when high has just changed (call isHigh() first)
+		if (step < 0.0)
+			return 0.0;
+		if (high == 1)
+			return step;
+		return step - (*trigOut ? 0.001 : length * 0.5);
+	}
 };
 
 
@@ -156,6 +168,8 @@ struct Clkd : Module {
 	bool momentaryRunInput;// true = trigger (original rising edge only version), false = level sensitive (emulated with rising and falling detection)
 	int displayIndex;
 	bool trigOuts[4];// output triggers when true, one for each clock output, master is index 0. 
+	bool subSampleEdges;// clock edges are placed at their exact time within the sample, using band-limited steps
+	bool clockBus;// master clock output is polyphonic and carries all clocks, reset, run and bpm (see ClockBusChannelIds)
 
 	// No need to save, with reset
 	long editingBpmMode;// 0 when no edit bpmMode, downward step counter timer when edit, negative upward when show can't edit ("--") 
@@ -171,6 +185,7 @@ struct Clkd : Module {
 	float newMasterLength;
 	float masterLength;
 	float clkOutputs[4];
+	float clkEdgeAges[4];// in samples, only used when subSampleEdges
 	
 	// No need to save, no reset
 	bool scheduledReset = false;
@@ -187,6 +202,7 @@ struct Clkd : Module {
 	Trigger displayDownTrigger;
 	dsp::PulseGenerator resetPulse;
 	dsp::PulseGenerator runPulse;
+	BandLimitedEdge clkEdges[4];
 
 	
 	int getRatioDoubled(int ratioKnobIndex) {
@@ -225,9 +241,9 @@ struct Clkd : Module {
 		}
 		configParam<BpmParam>(BPM_PARAM, (float)(bpmMin), (float)(bpmMax), 120.0f, "Master clock", " BPM");// must be a snap knob, code in step() assumes that a rounded value is read from the knob	(chaining considerations vs BPM detect)
 		
-		clk[0].construct(nullptr, &resetClockOutputsHigh, &trigOuts[0]);
+		clk[0].construct(nullptr, &resetClockOutputsHigh, &trigOuts[0], &subSampleEdges);
 		for (int i = 1; i < 4; i++) {
-			clk[i].construct(&clk[0], &resetClockOutputsHigh, &trigOuts[i]);		
+			clk[i].construct(&clk[0], &resetClockOutputsHigh, &trigOuts[i], &subSampleEdges);		
 		}
 		onReset();
 		
@@ -246,6 +262,8 @@ struct Clkd : Module {
 		for (int i = 0; i < 4; i++) {
 			trigOuts[i] = false;
 		}
+		subSampleEdges = false;
+		clockBus = false;
 		resetNonJson(false);
 	}
 	void resetNonJson(bool delayed) {// delay thread sensitive parts (i.e. schedule them so that process() will do them)
@@ -269,6 +287,7 @@ struct Clkd : Module {
 		for (int i = 0; i < 4; i++) {
 			clk[i].reset();
 			clkOutputs[i] = resetClockOutputsHigh ? 10.0f : 0.0f;
+			clkEdgeAges[i] = 0.0f;
 			bufferedKnobs[i] = params[RATIO_PARAMS + i].getValue();// must be done before the getRatioDoubled() a few lines down
 		}
 		for (int i = 0; i < 3; i++) {
@@ -318,6 +337,12 @@ struct Clkd : Module {
 		// momentaryRunInput
 		json_object_set_new(rootJ, "momentaryRunInput", json_boolean(momentaryRunInput));
 		
+		// subSampleEdges
+		json_object_set_new(rootJ, "subSampleEdges", json_boolean(subSampleEdges));
+		
+		// clockBus
+		json_object_set_new(rootJ, "clockBus", json_boolean(clockBus));
+		
 		// displayIndex
 		json_object_set_new(rootJ, "displayIndex", json_integer(displayIndex));
 		
@@ -393,6 +418,16 @@ struct Clkd : Module {
 		if (momentaryRunInputJ)
 			momentaryRunInput = json_is_true(momentaryRunInputJ);
 
+		// subSampleEdges
+		json_t *subSampleEdgesJ = json_object_get(rootJ, "subSampleEdges");
+		if (subSampleEdgesJ)
+			subSampleEdges = json_is_true(subSampleEdgesJ);
+
+		// clockBus
+		json_t *clockBusJ = json_object_get(rootJ, "clockBus");
+		if (clockBusJ)
+			clockBus = json_is_true(clockBusJ);
+
 		// displayIndex
 		json_t *displayIndexJ = json_object_get(rootJ, "displayIndex");
 		if (displayIndexJ)
@@ -445,12 +480,13 @@ struct Clkd : Module {
 			}
 		}
 		else {
-			cantRunWarning = (long) (0.7 * sampleRate / RefreshCounter::displayRefreshStepSkips);
+			cantRunWarning = (long) (0.7 * sampleRate / refresh.displayRefreshStepSkips);
 		}
 	}
 
 	
 	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
 		resetClkd(false);
 	}		
 	
@@ -541,7 +577,7 @@ struct Clkd : Module {
 						}
 					}
 				}
-				editingBpmMode = (long) (3.0 * sampleRate / RefreshCounter::displayRefreshStepSkips);
+				editingBpmMode = (long) (3.0 * sampleRate / refresh.displayRefreshStepSkips);
 			}
 		}// userInputs refresh
 	
@@ -634,7 +670,9 @@ struct Clkd : Module {
 				clk[0].setup(masterLength, 1, sampleTime);// must call setup before start. length = double_period
 				clk[0].start();
 			}
-			clkOutputs[0] = clk[0].isHigh() ? 10.0f : 0.0f;		
+			int high = clk[0].isHigh();
+			clkOutputs[0] = high ? 10.0f : 0.0f;		
+			clkEdgeAges[0] = subSampleEdges ? (float)(clk[0].getEdgeAge(high) * sampleRate) : 0.0f;
 			
 			// Sub clocks
 			for (int i = 1; i < 4; i++) {
@@ -654,7 +692,9 @@ struct Clkd : Module {
 					clk[i].setup(length, iterations, sampleTime);
 					clk[i].start();
 				}
-				clkOutputs[i] = clk[i].isHigh() ? 10.0f : 0.0f;
+				high = clk[i].isHigh();
+				clkOutputs[i] = high ? 10.0f : 0.0f;
+				clkEdgeAges[i] = subSampleEdges ? (float)(clk[i].getEdgeAge(high) * sampleRate) : 0.0f;
 			}
 
 			// Step clocks
@@ -664,17 +704,30 @@ struct Clkd : Module {
 		
 		// outputs
 		for (int i = 0; i < 4; i++) {
-			outputs[CLK_OUTPUTS + i].setVoltage(clkOutputs[i]);
+			outputs[CLK_OUTPUTS + i].setVoltage(clkEdges[i].process(clkOutputs[i], clkEdgeAges[i], subSampleEdges));
 		}
 		outputs[RESET_OUTPUT].setVoltage((resetPulse.process((float)sampleTime) ? 10.0f : 0.0f));
 		outputs[RUN_OUTPUT].setVoltage((runPulse.process((float)sampleTime) ? 10.0f : 0.0f));
 		outputs[BPM_OUTPUT].setVoltage( inputs[BPM_INPUT].isConnected() ? inputs[BPM_INPUT].getVoltage() : log2f(0.5f / masterLength));
+		if (clockBus) {
+			Output& busOut = outputs[CLK_OUTPUTS + 0];
+			busOut.setChannels(CLKBUS_NUM_CHANNELS);
+			for (int i = 1; i < 4; i++) {
+				busOut.setVoltage(outputs[CLK_OUTPUTS + i].getVoltage(), CLKBUS_MASTER + i);
+			}
+			busOut.setVoltage(outputs[RESET_OUTPUT].getVoltage(), CLKBUS_RESET);
+			busOut.setVoltage(outputs[RUN_OUTPUT].getVoltage(), CLKBUS_RUN);
+			busOut.setVoltage(outputs[BPM_OUTPUT].getVoltage(), CLKBUS_BPM);
+		}
+		else {
+			outputs[CLK_OUTPUTS + 0].setChannels(1);
+		}
 			
 		
 		// lights
 		if (refresh.processLights()) {
 			// Reset light
-			lights[RESET_LIGHT].setSmoothBrightness(resetLight, (float)sampleTime * (RefreshCounter::displayRefreshStepSkips >> 2));	
+			lights[RESET_LIGHT].setSmoothBrightness(resetLight, (float)sampleTime * (refresh.displayRefreshStepSkips >> 2));	
 			resetLight = 0.0f;
 			
 			// Run light
@@ -683,7 +736,7 @@ struct Clkd : Module {
 			// BPM light
 			bool warningFlashState = true;
 			if (cantRunWarning > 0l) 
-				warningFlashState = calcWarningFlash(cantRunWarning, (long) (0.7 * sampleRate / RefreshCounter::displayRefreshStepSkips));
+				warningFlashState = calcWarningFlash(cantRunWarning, (long) (0.7 * sampleRate / refresh.displayRefreshStepSkips));
 			lights[BPMSYNC_LIGHT + 0].setBrightness((bpmDetectionMode && warningFlashState) ? 1.0f : 0.0f);
 			lights[BPMSYNC_LIGHT + 1].setBrightness((bpmDetectionMode && warningFlashState) ? (float)((ppqn - 2)*(ppqn - 2))/440.0f : 0.0f);			
 			
@@ -719,18 +772,17 @@ struct ClkdWidget : ModuleWidget {
 	SvgPanel* darkPanel;
 	PortWidget* slaveResetRunBpmInputs[3];
 
-	struct BpmRatioDisplayWidget : LightWidget {//TransparentWidget {
+	struct BpmRatioDisplayWidget : CachedDisplayWidget {
 		Clkd *module;
 		std::shared_ptr<Font> font;
 		std::string fontPath;
-		char displayStr[16];
 
 		
 		BpmRatioDisplayWidget() {
 			fontPath = std::string(asset::plugin(pluginInstance, "res/fonts/Segment14.ttf"));
 		}
 		
-		void draw(const DrawArgs &args) override {
+		void drawDisplay(const DrawArgs &args) override {
 			if (!(font = APP->window->loadFont(fontPath))) {
 				return;
 			}
@@ -742,6 +794,10 @@ struct ClkdWidget : ModuleWidget {
 			nvgFillColor(args.vg, nvgTransRGBA(textColor, displayAlpha));
 			nvgText(args.vg, textPos.x, textPos.y, "~~~", NULL);
 			nvgFillColor(args.vg, textColor);
+			nvgText(args.vg, textPos.x, textPos.y, displayStr, NULL);
+		}
+
+		void updateDisplay() override {
 			if (module == NULL) {
 				snprintf(displayStr, 4, "120");
 			}
@@ -770,7 +826,6 @@ struct ClkdWidget : ModuleWidget {
 				snprintf(displayStr, 4, "%3u", (unsigned)((60.0f / module->masterLength) + 0.5f));
 			}
 			displayStr[3] = 0;// more safety
-			nvgText(args.vg, textPos.x, textPos.y, displayStr, NULL);
 		}
 	};		
 	
@@ -786,6 +841,18 @@ struct ClkdWidget : ModuleWidget {
 			module->momentaryRunInput = !module->momentaryRunInput;
 		}
 	};
+	struct ClockBusItem : MenuItem {
+		Clkd *module;
+		void onAction(const event::Action &e) override {
+			module->clockBus = !module->clockBus;
+		}
+	};
+	struct SubSampleEdgesItem : MenuItem {
+		Clkd *module;
+		void onAction(const event::Action &e) override {
+			module->subSampleEdges = !module->subSampleEdges;
+		}
+	};
 	struct ResetHighItem : MenuItem {
 		Clkd *module;
 		void onAction(const event::Action &e) override {
@@ -856,6 +923,14 @@ struct ClkdWidget : ModuleWidget {
 		MomentaryRunInputItem *runInItem = createMenuItem<MomentaryRunInputItem>("Run CV input is level sensitive", CHECKMARK(!module->momentaryRunInput));
 		runInItem->module = module;
 		menu->addChild(runInItem);
+
+		SubSampleEdgesItem *sseItem = createMenuItem<SubSampleEdgesItem>("Sub-sample accurate clock edges", CHECKMARK(module->subSampleEdges));
+		sseItem->module = module;
+		menu->addChild(sseItem);
+
+		ClockBusItem *busItem = createMenuItem<ClockBusItem>("Poly clock bus on master clock output", CHECKMARK(module->clockBus));
+		busItem->module = module;
+		menu->addChild(busItem);
 		
 		TrigOutsItem *trigItem = createMenuItem<TrigOutsItem>("Send triggers (instead of gates)", RIGHT_ARROW);
 		trigItem->module = module;
@@ -898,6 +973,9 @@ struct ClkdWidget : ModuleWidget {
 
 	ClkdWidget(Clkd *module) {
 		setModule(module);
+		if (module) {
+			registerClockWidget(this);
+		}
 		
 		// Main panels from Inkscape
         setPanel(APP->window->loadSvg(asset::plugin(pluginInstance, "res/light/Clkd.svg")));
@@ -1011,12 +1089,15 @@ struct ClkdWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((Clkd*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((Clkd*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((Clkd*)module)->panelTheme);
 		}
 		Widget::step();
 	}
 	
+	~ClkdWidget() {
+		unregisterClockWidget(this);
+	}
+	
 	void onHoverKey(const event::HoverKey& e) override {
 		if (e.action == GLFW_PRESS) {
 			if ( e.key == GLFW_KEY_SPACE && ((e.mods & RACK_MOD_MASK) == 0) ) {
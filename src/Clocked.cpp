@@ -27,6 +27,15 @@ class Clock {
 	Clock* syncSrc = nullptr; // only subclocks will have this set to master clock
 	static constexpr double guard = 0.0005;// in seconds, region for sync to occur right before end of length of last iteration; sub clocks must be low during this period
 	bool *resetClockOutputsHigh;
+	bool *subSampleEdges;
+	double carry;// when subSampleEdges, fractional sample time that was left over when the frame ended, the next frame starts there
+	// edge times within the double period, only recalculated when length, swing or pulse width change (see calcEdges())
+	double edgeLength = -1.0;
+	float edgeSwingParam;
+	float edgePulseWidth;
+	double p2;// end of first pulse (first pulse starts at 0)
+	double p3;// start of second pulse
+	double p4;// end of second pulse
 	
 	public:
 	
@@ -34,8 +43,9 @@ class Clock {
 		reset();
 	}
 	
-	void reset() {
+	void reset(double carryGiven = 0.0) {
 		step = -1.0;
+		carry = carryGiven;
 	}
 	bool isReset() {
 		return step == -1.0;
@@ -43,12 +53,13 @@ class Clock {
 	double getStep() {
 		return step;
 	}
-	void construct(Clock* clkGiven, bool *resetClockOutputsHighPtr) {
+	void construct(Clock* clkGiven, bool *resetClockOutputsHighPtr, bool *subSampleEdgesPtr) {
 		syncSrc = clkGiven;
 		resetClockOutputsHigh = resetClockOutputsHighPtr;
+		subSampleEdges = subSampleEdgesPtr;
 	}
 	void start() {
-		step = 0.0;
+		step = (*subSampleEdges ? carry : 0.0);
 	}
 	
 	void setup(double lengthGiven, int iterationsGiven, double sampleTimeGiven) {
@@ -62,7 +73,7 @@ class Clock {
 			step += sampleTime;
 			if ( (syncSrc != nullptr) && (iterations == 1) && (step > (length - guard)) ) {// if in sync region
 				if (syncSrc->isReset()) {
-					reset();
+					reset(syncSrc->carry);
 				}// else nothing needs to be done, just wait and step stays the same
 			}
 			else {
@@ -70,7 +81,7 @@ class Clock {
 					iterations--;
 					step -= length;
 					if (iterations <= 0) 
-						reset();// frame done
+						reset(step);// frame done
 				}
 			}
 		}
@@ -82,26 +93,35 @@ class Clock {
 		length *= lengthStretchFactor;
 	}
 	
-	int isHigh(float swingParam, float pulseWidth) {
+	void calcEdges(float swingParam, float pulseWidth) {
 		// last 0.5ms (guard time) must be low so that sync mechanism will work properly (i.e. no missed pulses)
 		//   this will automatically be the case, since code below disallows any pulses or inter-pulse times less than 1ms
+		// all following values are in seconds
+		float onems = 0.001f;
+		float period = (float)length / 2.0f;
+		float swing = (period - 2.0f * onems) * swingParam;// swingParam is [-1 : 1]
+		float p2min = onems;
+		float p2max = period - onems - std::fabs(swing);
+		if (p2max < p2min) {
+			p2max = p2min;
+		}
+		
+		//double p1 = 0.0;// implicit, no need 
+		p2 = (double)((p2max - p2min) * pulseWidth + p2min);// pulseWidth is [0 : 1]
+		p3 = (double)(period + swing);
+		p4 = ((double)(period + swing)) + p2;
+		
+		edgeLength = length;
+		edgeSwingParam = swingParam;
+		edgePulseWidth = pulseWidth;
+	}
+	
+	int isHigh(float swingParam, float pulseWidth) {
 		int high = 0;
 		if (step >= 0.0) {
-			// all following values are in seconds
-			float onems = 0.001f;
-			float period = (float)length / 2.0f;
-			float swing = (period - 2.0f * onems) * swingParam;// swingParam is [-1 : 1]
-			float p2min = onems;
-			float p2max = period - onems - std::fabs(swing);
-			if (p2max < p2min) {
-				p2max = p2min;
+			if (length != edgeLength || swingParam != edgeSwingParam || pulseWidth != edgePulseWidth) {
+				calcEdges(swingParam, pulseWidth);
 			}
-			
-			//double p1 = 0.0;// implicit, no need 
-			double p2 = (double)((p2max - p2min) * pulseWidth + p2min);// pulseWidth is [0 : 1]
-			double p3 = (double)(period + swing);
-			double p4 = ((double)(period + swing)) + p2;
-			
 			if (step <= p2)
 				high = 1;
 			else if ((step >= p3) && (step <= p4))
@@ -110,7 +130,17 @@ class Clock {
 		else if (*resetClockOutputsHigh)
 			high = 1;
 		return high;
-	}	
+	}
+	
+	double getEdgeAge(int high) {// time since the last edge, valid when high has just changed (call isHigh() first)
+		if (step < 0.0)
+			return 0.0;
+		if (high == 1)
+			return step;
+		if (high == 2)
+			return step - p3;
+		return (step > p4 ? step - p4 : step - p2);
+	}
 };
 
 
@@ -118,13 +148,29 @@ class Clock {
 
 
 class ClockDelay {
-	long stepCounter;
+	// edges are stored in a fixed-size ring buffer as they are written, and replayed delaySamples later;
+	//   the capacity covers any sub-clock ratio over delays of several bars, if it ever fills, the oldest edge is applied early
+	static const uint32_t EDGE_CAPACITY = 256;// power of 2
+	
+	struct Edge {
+		uint32_t step;
+		bool high;
+		float age;// only used when sub-sample edges are on, see Clock::getEdgeAge()
+	};
+	
+	Edge edges[EDGE_CAPACITY];
+	uint32_t edgeHead;// next edge to write
+	uint32_t edgeTail;// next edge to read
+	uint32_t stepCounter;// wraps around, edge steps are compared by difference
 	int lastWriteValue;
 	bool readState;
-	long stepRise1;
-	long stepFall1;
-	long stepRise2;
-	long stepFall2;
+	float readEdgeAge;
+	
+	void applyEdge(const Edge& edge) {
+		readState = edge.high;
+		readEdgeAge = edge.age;
+		edgeTail++;
+	}
 	
 	public:
 	
@@ -132,54 +178,274 @@ class ClockDelay {
 		reset(true);
 	}
 	
-	void setup() {
-	}
-	
 	void reset(bool resetClockOutputsHigh) {
-		stepCounter = 0l;
+		edgeHead = 0;
+		edgeTail = 0;
+		stepCounter = 0;
 		lastWriteValue = 0;
 		readState = resetClockOutputsHigh;
-		stepRise1 = 0l;
-		stepFall1 = 0l;
-		stepRise2 = 0l;
-		stepFall2 = 0l;
+		readEdgeAge = 0.0f;
 	}
 	
-	void write(int value) {
-		if (value == 1) {// first pulse is high
-			if (lastWriteValue == 0) // if got rise 1
-				stepRise1 = stepCounter;
-		}
-		else if (value == 2) {// second pulse is high
-			if (lastWriteValue == 0) // if got rise 2
-				stepRise2 = stepCounter;
-		}
-		else {// value = 0 (pulse is low)
-			if (lastWriteValue == 1) // if got fall 1
-				stepFall1 = stepCounter;
-			else if (lastWriteValue == 2) // if got fall 2
-				stepFall2 = stepCounter;
+	void write(int value, float edgeAge) {
+		// value is 0 when low, 1 or 2 when in first or second pulse
+		if ((value != 0) != (lastWriteValue != 0)) {
+			if (edgeHead - edgeTail >= EDGE_CAPACITY) {
+				applyEdge(edges[edgeTail & (EDGE_CAPACITY - 1)]);
+			}
+			Edge& edge = edges[edgeHead & (EDGE_CAPACITY - 1)];
+			edge.step = stepCounter;
+			edge.high = (value != 0);
+			edge.age = edgeAge;
+			edgeHead++;
 		}
-		
 		lastWriteValue = value;
 	}
 	
 	bool read(long delaySamples) {
-		long delayedStepCounter = stepCounter - delaySamples;
-		if (delayedStepCounter == stepRise1 || delayedStepCounter == stepRise2)
-			readState = true;
-		else if (delayedStepCounter == stepFall1 || delayedStepCounter == stepFall2)
-			readState = false;
-		stepCounter++;
-		if (stepCounter > 1e8) {// keep within long's bounds (could go higher or could allow negative)
-			stepCounter -= 1e8;// 192000 samp/s * 2s * 64 * (3/4) = 18.4 Msamp
-			stepRise1 -= 1e8;
-			stepFall1 -= 1e8;
-			stepRise2 -= 1e8;
-			stepFall2 -= 1e8;
+		uint32_t delayedStepCounter = stepCounter - (uint32_t)delaySamples;
+		// all edges that are due are applied, so that a delay that shrinks does not strand any of them
+		while (edgeTail != edgeHead && (int32_t)(delayedStepCounter - edges[edgeTail & (EDGE_CAPACITY - 1)].step) >= 0) {
+			applyEdge(edges[edgeTail & (EDGE_CAPACITY - 1)]);
 		}
+		stepCounter++;
 		return readState;
 	}
+	
+	float getEdgeAge() {// age of the edge last returned by read(), in samples
+		return readEdgeAge;
+	}
+};
+
+
+//*****************************************************************************
+
+
+class ScheduledClock {
+	// event-scheduled counterpart of a Clock followed by a ClockDelay, used when the scheduled engine is on: the edges of the current
+	//   double period are sample positions that are only recomputed when the period starts or when its length, swing or pulse width 
+	//   change, and delayed edges are queued with the sample at which they are due, so that nothing is done between two events
+	// the edges are not sample-identical to those of Clock: Clock adds sampleTime on every sample, and when an edge or the end 
+	//   of a frame falls on a sample boundary the rounding of that sum can move the edge by one sample; with sub-sample edges 
+	//   off, Clock also drops the leftover of each frame, so it can fall behind by a sample per frame when a frame is a whole 
+	//   number of samples (here positions are exact, so that drift doesn't happen)
+	static const uint32_t EDGE_CAPACITY = 256;// power of 2, see ClockDelay
+	static constexpr double guard = 0.0005;// in seconds, see Clock
+	
+	struct Edge {
+		int64_t sample;// sample of the undelayed edge
+		bool high;
+		float age;// see Clock::getEdgeAge(), in samples
+	};
+	
+	ScheduledClock* syncSrc = nullptr;// only subclocks will have this set to master clock
+	bool *resetClockOutputsHigh = nullptr;
+	bool *subSampleEdges = nullptr;
+	bool active;// false when stopped
+	bool frameEnded;// when active is false, true if the frame ended normally (periodStart is then where the next frame starts)
+	double periodStart;// position of the start of the current double period, in samples (fractional when sub-sample edges)
+	double length;// double period, in seconds
+	int iterations;// double periods left in the frame, including the current one
+	double sampleRate;
+	float swingParam = 0.0f;
+	float pulseWidth = 0.5f;
+	double p2;// end of first pulse, in samples from periodStart (see Clock::calcEdges())
+	double p3;// start of second pulse
+	double p4;// end of second pulse
+	int high;// undelayed state, 0 when low, 1 or 2 when in first or second pulse
+	int64_t nextSourceEvent;// sample at which high must be re-evaluated
+	Edge edges[EDGE_CAPACITY];
+	uint32_t edgeHead;// next edge to write
+	uint32_t edgeTail;// next edge to output
+	long delay = 0;// in samples
+	bool outHigh;
+	float outEdgeAge;
+	
+	void calcEdges() {
+		// same as Clock::calcEdges(), with the results converted to samples
+		float onems = 0.001f;
+		float period = (float)length / 2.0f;
+		float swing = (period - 2.0f * onems) * swingParam;// swingParam is [-1 : 1]
+		float p2min = onems;
+		float p2max = period - onems - std::fabs(swing);
+		if (p2max < p2min) {
+			p2max = p2min;
+		}
+		p2 = (double)((p2max - p2min) * pulseWidth + p2min) * sampleRate;// pulseWidth is [0 : 1]
+		p3 = (double)(period + swing) * sampleRate;
+		p4 = p3 + p2;
+	}
+	
+	void setHigh(int newHigh, double pos, int64_t n) {
+		if ((newHigh != 0) != (high != 0)) {
+			if (edgeHead - edgeTail >= EDGE_CAPACITY) {
+				applyEdge(edges[edgeTail & (EDGE_CAPACITY - 1)]);
+			}
+			Edge& edge = edges[edgeHead & (EDGE_CAPACITY - 1)];
+			edge.sample = n;
+			edge.high = (newHigh != 0);
+			if (newHigh == 1)
+				edge.age = (float)pos;
+			else if (newHigh == 2)
+				edge.age = (float)(pos - p3);
+			else
+				edge.age = (float)(pos > p4 ? pos - p4 : pos - p2);
+			edgeHead++;
+		}
+		high = newHigh;
+	}
+	
+	void update(int64_t n) {
+		// steps over the double periods that ended, then sets high for sample n and finds the sample of the next source event
+		double lengthSamples = length * sampleRate;
+		double pos = (double)n - periodStart;
+		while (syncSrc == nullptr || iterations > 1) {
+			if (pos < lengthSamples) {
+				break;
+			}
+			periodStart += lengthSamples;
+			pos -= lengthSamples;
+			iterations--;
+			if (iterations <= 0) {// frame done, the master restarts it on this same sample (see Clocked::processScheduledEvents())
+				active = false;
+				frameEnded = true;
+				nextSourceEvent = 0;
+				return;
+			}
+		}
+		
+		int64_t next;
+		if (syncSrc != nullptr && iterations == 1 && pos > lengthSamples - guard * sampleRate) {// in sync region, wait for the master
+			setHigh(0, pos, n);
+			nextSourceEvent = NEVER;
+			return;
+		}
+		if (pos <= p2) {
+			setHigh(1, pos, n);
+			next = (int64_t)std::floor(periodStart + p2) + 1;
+		}
+		else if (pos < p3) {
+			setHigh(0, pos, n);
+			next = (int64_t)std::ceil(periodStart + p3);
+		}
+		else if (pos <= p4) {
+			setHigh(2, pos, n);
+			next = (int64_t)std::floor(periodStart + p4) + 1;
+		}
+		else {
+			setHigh(0, pos, n);
+			if (syncSrc != nullptr && iterations == 1)
+				next = (int64_t)std::floor(periodStart + lengthSamples - guard * sampleRate) + 1;
+			else
+				next = (int64_t)std::ceil(periodStart + lengthSamples);
+		}
+		nextSourceEvent = (next > n ? next : n + 1);// rounding can't stall the clock
+	}
+	
+	void applyEdge(const Edge& edge) {
+		outHigh = edge.high;
+		outEdgeAge = edge.age;
+		edgeTail++;
+	}
+	
+	public:
+	
+	static const int64_t NEVER = INT64_MAX;
+	
+	ScheduledClock() {
+		reset();
+	}
+	
+	void construct(ScheduledClock* clkGiven, bool *resetClockOutputsHighPtr, bool *subSampleEdgesPtr) {
+		syncSrc = clkGiven;
+		resetClockOutputsHigh = resetClockOutputsHighPtr;
+		subSampleEdges = subSampleEdgesPtr;
+		reset();
+	}
+	
+	void reset() {
+		active = false;
+		frameEnded = false;
+		high = 0;
+		nextSourceEvent = NEVER;// sub clocks are restarted by the master
+		if (syncSrc == nullptr) {
+			nextSourceEvent = 0;// master is restarted right away
+		}
+		edgeHead = 0;
+		edgeTail = 0;
+		outHigh = (resetClockOutputsHigh != nullptr && *resetClockOutputsHigh);
+		outEdgeAge = 0.0f;
+	}
+	bool isActive() {
+		return active;
+	}
+	double getStep(int64_t n) {// in seconds, -1.0 when stopped, as Clock::getStep()
+		return active ? ((double)n - periodStart) / sampleRate : -1.0;
+	}
+	bool inSyncRegion(int64_t n) {
+		return active && iterations == 1 && ((double)n - periodStart) > (length - guard) * sampleRate;
+	}
+	double getRestartPos(int64_t n) {// where a new frame starts when restarted on sample n, carries the fraction of a sample when sub-sample edges
+		return (*subSampleEdges && frameEnded) ? periodStart : (double)n;
+	}
+	
+	void start(double startPos, double lengthGiven, int iterationsGiven, double sampleRateGiven, int64_t n) {
+		active = true;
+		frameEnded = false;
+		periodStart = startPos;
+		length = lengthGiven;
+		iterations = iterationsGiven;
+		sampleRate = sampleRateGiven;
+		calcEdges();
+		update(n);
+	}
+	
+	void setShape(float swingParamGiven, float pulseWidthGiven, int64_t n) {
+		if (swingParamGiven != swingParam || pulseWidthGiven != pulseWidth) {
+			swingParam = swingParamGiven;
+			pulseWidth = pulseWidthGiven;
+			if (active) {
+				calcEdges();
+				update(n);
+			}
+		}
+	}
+	void setDelay(long delayGiven) {
+		delay = delayGiven;
+	}
+	void applyNewLength(double lengthStretchFactor, int64_t n) {
+		if (active) {
+			periodStart = (double)n - ((double)n - periodStart) * lengthStretchFactor;
+			length *= lengthStretchFactor;
+			calcEdges();
+			update(n);
+		}
+	}
+	
+	int64_t getNextEvent() {
+		int64_t nextOutputEvent = NEVER;
+		if (edgeTail != edgeHead) {
+			nextOutputEvent = edges[edgeTail & (EDGE_CAPACITY - 1)].sample + delay;
+		}
+		return nextSourceEvent < nextOutputEvent ? nextSourceEvent : nextOutputEvent;
+	}
+	void processSource(int64_t n) {
+		if (active && n >= nextSourceEvent) {
+			update(n);
+		}
+	}
+	void processOutput(int64_t n) {
+		// all edges that are due are applied, so that a delay that shrinks does not strand any of them
+		while (edgeTail != edgeHead && n - delay >= edges[edgeTail & (EDGE_CAPACITY - 1)].sample) {
+			applyEdge(edges[edgeTail & (EDGE_CAPACITY - 1)]);
+		}
+	}
+	bool getOutput() {
+		return outHigh;
+	}
+	float getEdgeAge() {// age of the last output edge, in samples
+		return outEdgeAge;
+	}
 };
 
 
@@ -229,7 +495,8 @@ struct Clocked : Module {
 	
 	
 	// Expander
-	float rightMessages[2][8] = {};// messages from expander
+	ExpanderChannel<float[8]> fromExpander;// messages from expander
+	ExpanderSender<float[1]> toExpander;// messages to expander: panelTheme
 		
 
 	// Constants
@@ -251,6 +518,10 @@ struct Clocked : Module {
 	int ppqn;
 	bool resetClockOutputsHigh;
 	bool momentaryRunInput;// true = trigger (original rising edge only version), false = level sensitive (emulated with rising and falling detection)
+	bool subSampleEdges;// clock edges are placed at their exact time within the sample, using band-limited steps
+	bool clockBus;// master clock output is polyphonic and carries all clocks, reset, run and bpm (see ClockBusChannelIds)
+	int pllMode;// BPM detection follower: 0 = double period measurement, 1 to 3 = PLL with light, medium and heavy smoothing
+	bool scheduledEngine;// clocks are advanced from one edge to the next (see ScheduledClock) instead of every sample
 
 
 	// No need to save, with reset
@@ -259,18 +530,25 @@ struct Clocked : Module {
 	double sampleTime;
 	Clock clk[4];
 	ClockDelay delay[3];// only channels 1 to 3 have delay
+	ScheduledClock sclk[4];// used instead of clk and delay when scheduledEngine
+	int64_t sampleCount;// samples run by the scheduled engine since the last reset
+	int64_t nextEvent;// earliest sample at which one of the sclk has something to do
 	float bufferedRatioKnobs[4];// 0 = mast bpm knob, 1..3 is ratio knobs
 	bool syncRatios[4];// 0 index unused
 	int ratiosDoubled[4];
 	int extPulseNumber;// 0 to ppqn * 2 - 1
-	double extIntervalTime;
+	double extIntervalTime;// in PLL mode, this is the time since the previous edge
 	double timeoutTime;
+	double pllPeriod;// PLL estimate of the time between two ppqn edges, 0.0 when not yet known
+	int pllLockCount;// number of consecutive edges that arrived close to their predicted phase
+	bool pllJumpPending;// previous edge interval was far from the estimate, a second one in a row is taken as a tempo change
 	float pulseWidth[4];
 	float swingAmount[4];
 	long delaySamples[4];
 	float newMasterLength;
 	float masterLength;
 	float clkOutputs[4];
+	float clkEdgeAges[4];// in samples, only used when subSampleEdges
 	
 	// No need to save, no reset
 	bool scheduledReset = false;
@@ -287,6 +565,7 @@ struct Clocked : Module {
 	Trigger bpmModeDownTrigger;
 	dsp::PulseGenerator resetPulse;
 	dsp::PulseGenerator runPulse;
+	BandLimitedEdge clkEdges[4];
 
 	
 	int getRatioDoubled(int ratioKnobIndex) {
@@ -309,9 +588,22 @@ struct Clocked : Module {
 		return ret;
 	}
 	
+	void calcSubClockLength(int i, double* length, int* iterations) {
+		int ratioDoubled = ratiosDoubled[i];
+		if (ratioDoubled < 0) { // if div 
+			ratioDoubled *= -1;
+			*length = masterLength * ((double)ratioDoubled) / 2.0;
+			*iterations = 1l + (ratioDoubled % 2);		
+		}
+		else {// mult 
+			*length = (2.0f * masterLength) / ((double)ratioDoubled);
+			*iterations = ratioDoubled / (2l - (ratioDoubled % 2l));							
+		}
+	}
+	
 	void updatePulseSwingDelay() {
 		bool expanderPresent = (rightExpander.module && rightExpander.module->model == modelClockedExpander);
-		float *messagesFromExpander = (float*)rightExpander.consumerMessage;// could be invalid pointer when !expanderPresent, so read it only when expanderPresent
+		float *messagesFromExpander = fromExpander.data();// stale when !expanderPresent, so read it only when expanderPresent
 		for (int i = 0; i < 4; i++) {
 			// Pulse Width
 			pulseWidth[i] = params[PW_PARAMS + i].getValue();
@@ -337,15 +629,36 @@ struct Clocked : Module {
 			if (ratioValue < 0)
 				ratioValue = 1.0f / (-1.0f * ratioValue);
 			delaySamples[i] = (long)(masterLength * delayFraction * sampleRate / (ratioValue * 2.0));
-		}				
+		}
+		
+		if (scheduledEngine) {
+			for (int i = 0; i < 4; i++) {
+				sclk[i].setShape(swingAmount[i], pulseWidth[i], sampleCount);
+				sclk[i].setDelay(delaySamples[i]);
+			}
+			updateNextEvent();
+		}
+	}
+	
+	void updateNextEvent() {
+		nextEvent = ScheduledClock::NEVER;
+		for (int i = 0; i < 4; i++) {
+			int64_t clkNextEvent = sclk[i].getNextEvent();
+			if (clkNextEvent < nextEvent) {
+				nextEvent = clkNextEvent;
+			}
+		}
+	}
+	
+	double getMasterStep() {// in seconds, -1.0 when master clock is reset
+		return scheduledEngine ? sclk[0].getStep(sampleCount) : clk[0].getStep();
 	}
 
 	
 	Clocked() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 
-		rightExpander.producerMessage = rightMessages[0];
-		rightExpander.consumerMessage = rightMessages[1];
+		fromExpander.construct(&rightExpander);
 
 		configParam<BpmParam>(RATIO_PARAMS + 0, (float)(bpmMin), (float)(bpmMax), 120.0f, "Master clock", " BPM");// must be a snap knob, code in step() assumes that a rounded value is read from the knob	(chaining considerations vs BPM detect)
 		configParam(RESET_PARAM, 0.0f, 1.0f, 0.0f, "Reset");
@@ -370,9 +683,13 @@ struct Clocked : Module {
 			configParam(DELAY_PARAMS + 1 + i, 0.0f, 8.0f - 1.0f, 0.0f, strBuf);
 		}
 		
-		clk[0].construct(nullptr, &resetClockOutputsHigh);
+		clk[0].construct(nullptr, &resetClockOutputsHigh, &subSampleEdges);
+		for (int i = 1; i < 4; i++) {
+			clk[i].construct(&clk[0], &resetClockOutputsHigh, &subSampleEdges);		
+		}
+		sclk[0].construct(nullptr, &resetClockOutputsHigh, &subSampleEdges);
 		for (int i = 1; i < 4; i++) {
-			clk[i].construct(&clk[0], &resetClockOutputsHigh);		
+			sclk[i].construct(&sclk[0], &resetClockOutputsHigh, &subSampleEdges);		
 		}
 		onReset();
 		
@@ -388,6 +705,10 @@ struct Clocked : Module {
 		ppqn = 4;
 		resetClockOutputsHigh = true;
 		momentaryRunInput = true;
+		subSampleEdges = false;
+		clockBus = false;
+		pllMode = 0;
+		scheduledEngine = false;
 		resetNonJson(false);
 	}
 	void resetNonJson(bool delayed) {// delay thread sensitive parts (i.e. schedule them so that process() will do them)
@@ -408,20 +729,26 @@ struct Clocked : Module {
 	void resetClocked(bool hardReset) {// set hardReset to true to revert learned BPM to 120 in sync mode, or else when false, learned bmp will stay persistent
 		sampleRate = (double)(APP->engine->getSampleRate());
 		sampleTime = 1.0 / sampleRate;
+		sampleCount = 0;
 		for (int i = 0; i < 4; i++) {
 			clk[i].reset();
 			if (i < 3) 
 				delay[i].reset(resetClockOutputsHigh);
+			sclk[i].reset();
 			bufferedRatioKnobs[i] = params[RATIO_PARAMS + i].getValue();// must be done before the getRatioDoubled() a few lines down
 			syncRatios[i] = false;
 			ratiosDoubled[i] = getRatioDoubled(i);
 			clkOutputs[i] = resetClockOutputsHigh ? 10.0f : 0.0f;
+			clkEdgeAges[i] = 0.0f;
 		}
 		updatePulseSwingDelay();
 		extPulseNumber = -1;
 		extIntervalTime = 0.0;
 		timeoutTime = 2.0 / ppqn + 0.1;// worst case. This is a double period at 30 BPM (4s), divided by the expected number of edges in the double period 
 									   //   which is 2*ppqn, plus epsilon. This timeoutTime is only used for timingout the 2nd clock edge
+		pllPeriod = 0.0;
+		pllLockCount = 0;
+		pllJumpPending = false;
 		if (inputs[BPM_INPUT].isConnected()) {
 			if (bpmDetectionMode) {
 				if (hardReset)
@@ -434,9 +761,61 @@ struct Clocked : Module {
 			newMasterLength = 120.0f / bufferedRatioKnobs[0];
 		newMasterLength = clamp(newMasterLength, masterLengthMin, masterLengthMax);
 		masterLength = newMasterLength;
+		nextEvent = 0;
 	}	
 	
 	
+	bool isPllLocked() {
+		return pllLockCount >= 4;
+	}
+	
+	void pllProcessEdge() {
+		// called on every BPM input edge (extPulseNumber already advanced) when in PLL mode; extIntervalTime is the time since the previous edge
+		// the period estimate is smoothed, and the master length is set so that the clock reaches the phase of the next edge when it is predicted to arrive
+		static const double pllGains[4] = {1.0, 0.5, 0.25, 0.1};// index is pllMode
+		double gain = pllGains[pllMode];
+		double nominal = 1.0 / (double)(ppqn * 2);// phase advance per edge, as a fraction of a double period
+		
+		// frequency
+		if (pllPeriod > 0.0) {
+			double err = extIntervalTime / pllPeriod - 1.0;
+			if (std::fabs(err) > 0.25) {
+				if (pllJumpPending) {// two far intervals in a row: tempo change, restart from this interval
+					pllPeriod = extIntervalTime;
+					pllLockCount = 0;
+				}
+				pllJumpPending = !pllJumpPending;
+			}
+			else {
+				pllPeriod += gain * (extIntervalTime - pllPeriod);
+				pllJumpPending = false;
+			}
+		}
+		else if (extIntervalTime > 0.0) {// first interval since start
+			pllPeriod = extIntervalTime;
+		}
+		
+		// phase
+		if (pllPeriod > 0.0) {
+			double masterStep = getMasterStep();
+			double phase = masterStep < 0.0 ? 0.0 : masterStep / masterLength;
+			double travel = (double)(extPulseNumber + 1) * nominal - phase;
+			travel -= std::floor(travel + 0.5);// wrap to [-0.5 : 0.5[
+			if (std::fabs(travel - nominal) < nominal * 0.25) {
+				if (pllLockCount < 4)
+					pllLockCount++;
+			}
+			else
+				pllLockCount = 0;
+			travel = nominal + std::fmin(1.0, gain * 2.0) * (travel - nominal);
+			travel = std::fmin(std::fmax(travel, nominal * 0.5), nominal * 2.0);// bounded correction per edge
+			newMasterLength = clamp((float)(pllPeriod / travel), masterLengthMin / 1.5f, masterLengthMax * 1.5f);// extended range as in double period mode
+			timeoutTime = pllPeriod * 4.0 + 0.1;// stop only when a few edges are missing
+		}
+		extIntervalTime = 0.0;
+	}
+	
+	
 	json_t *dataToJson() override {
 		json_t *rootJ = json_object();
 		
@@ -464,6 +843,18 @@ struct Clocked : Module {
 		// momentaryRunInput
 		json_object_set_new(rootJ, "momentaryRunInput", json_boolean(momentaryRunInput));
 		
+		// subSampleEdges
+		json_object_set_new(rootJ, "subSampleEdges", json_boolean(subSampleEdges));
+		
+		// clockBus
+		json_object_set_new(rootJ, "clockBus", json_boolean(clockBus));
+		
+		// pllMode
+		json_object_set_new(rootJ, "pllMode", json_integer(pllMode));
+
+		// scheduledEngine
+		json_object_set_new(rootJ, "scheduledEngine", json_boolean(scheduledEngine));
+		
 		// clockMaster
 		json_object_set_new(rootJ, "clockMaster", json_boolean(clockMaster.id == id));
 		
@@ -545,6 +936,26 @@ struct Clocked : Module {
 		if (momentaryRunInputJ)
 			momentaryRunInput = json_is_true(momentaryRunInputJ);
 
+		// subSampleEdges
+		json_t *subSampleEdgesJ = json_object_get(rootJ, "subSampleEdges");
+		if (subSampleEdgesJ)
+			subSampleEdges = json_is_true(subSampleEdgesJ);
+
+		// clockBus
+		json_t *clockBusJ = json_object_get(rootJ, "clockBus");
+		if (clockBusJ)
+			clockBus = json_is_true(clockBusJ);
+
+		// pllMode
+		json_t *pllModeJ = json_object_get(rootJ, "pllMode");
+		if (pllModeJ)
+			pllMode = clamp((int)json_integer_value(pllModeJ), 0, 3);
+
+		// scheduledEngine
+		json_t *scheduledEngineJ = json_object_get(rootJ, "scheduledEngine");
+		if (scheduledEngineJ)
+			scheduledEngine = json_is_true(scheduledEngineJ);
+
 		resetNonJson(true);
 		
 		// clockMaster
@@ -580,16 +991,54 @@ struct Clocked : Module {
 			}
 		}
 		else {
-			cantRunWarning = (long) (0.7 * sampleRate / RefreshCounter::displayRefreshStepSkips);
+			cantRunWarning = (long) (0.7 * sampleRate / refresh.displayRefreshStepSkips);
 		}
 	}
 
 	
 	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
 		resetClocked(false);
 	}		
 	
 
+	void processScheduledEvents() {
+		// scheduled engine, only called on the samples where at least one of the clocks has an edge to output or to compute
+		ScheduledClock& master = sclk[0];
+		master.processSource(sampleCount);
+		if (!master.isActive()) {
+			// See if ratio knobs changed (or unitinialized)
+			for (int i = 1; i < 4; i++) {
+				if (syncRatios[i]) {
+					sclk[i].reset();// force reset (thus refresh) of that sub-clock
+					ratiosDoubled[i] = getRatioDoubled(i);
+					syncRatios[i] = false;
+				}
+			}
+			// restart master, and the sub clocks that are reset or are waiting for the master to sync
+			double startPos = master.getRestartPos(sampleCount);
+			master.start(startPos, masterLength, 1, sampleRate, sampleCount);
+			for (int i = 1; i < 4; i++) {
+				if (!sclk[i].isActive() || sclk[i].inSyncRegion(sampleCount)) {
+					double length;
+					int iterations;
+					calcSubClockLength(i, &length, &iterations);
+					sclk[i].start(startPos, length, iterations, sampleRate, sampleCount);
+				}
+			}
+		}
+		for (int i = 0; i < 4; i++) {
+			if (i > 0) {
+				sclk[i].processSource(sampleCount);
+			}
+			sclk[i].processOutput(sampleCount);
+			clkOutputs[i] = sclk[i].getOutput() ? 10.0f : 0.0f;
+			clkEdgeAges[i] = subSampleEdges ? sclk[i].getEdgeAge() : 0.0f;
+		}
+		updateNextEvent();
+	}
+	
+
 	void process(const ProcessArgs &args) override {
 		// Scheduled reset
 		if (scheduledReset) {
@@ -668,7 +1117,7 @@ struct Clocked : Module {
 						}
 					}
 				}
-				editingBpmMode = (long) (3.0 * sampleRate / RefreshCounter::displayRefreshStepSkips);
+				editingBpmMode = (long) (3.0 * sampleRate / refresh.displayRefreshStepSkips);
 			}
 		}// userInputs refresh
 	
@@ -699,12 +1148,14 @@ struct Clocked : Module {
 						extPulseNumber++;
 						if (extPulseNumber >= ppqn * 2)// *2 because working with double_periods
 							extPulseNumber = 0;
-						if (extPulseNumber == 0)// if first pulse, start interval timer
+						if (pllMode != 0)
+							pllProcessEdge();
+						else if (extPulseNumber == 0)// if first pulse, start interval timer
 							extIntervalTime = 0.0;
 						else {
 							// all other ppqn pulses except the first one. now we have an interval upon which to plan a strecth 
 							double timeLeft = extIntervalTime * (double)(ppqn * 2 - extPulseNumber) / ((double)extPulseNumber);
-							newMasterLength = clamp(clk[0].getStep() + timeLeft, masterLengthMin / 1.5f, masterLengthMax * 1.5f);// extended range for better sync ability (20-450 BPM)
+							newMasterLength = clamp(getMasterStep() + timeLeft, masterLengthMin / 1.5f, masterLengthMax * 1.5f);// extended range for better sync ability (20-450 BPM)
 							timeoutTime = extIntervalTime * ((double)(1 + extPulseNumber) / ((double)extPulseNumber)) + 0.1; // when a second or higher clock edge is received, 
 							//  the timeout is the predicted next edge (whici is extIntervalTime + extIntervalTime / extPulseNumber) plus epsilon
 						}
@@ -738,13 +1189,23 @@ struct Clocked : Module {
 			double lengthStretchFactor = ((double)newMasterLength) / ((double)masterLength);
 			for (int i = 0; i < 4; i++) {
 				clk[i].applyNewLength(lengthStretchFactor);
+				sclk[i].applyNewLength(lengthStretchFactor, sampleCount);
 			}
 			masterLength = newMasterLength;
+			if (scheduledEngine) {
+				updateNextEvent();
+			}
 		}
 		
 		
 		// main clock engine
-		if (running) {
+		if (running && scheduledEngine) {
+			if (sampleCount >= nextEvent) {
+				processScheduledEvents();
+			}
+			sampleCount++;
+		}
+		else if (running) {
 			// See if clocks finished their prescribed number of iteratios of double periods (and syncWait for sub) or 
 			//    if they were forced reset and if so, recalc and restart them
 			
@@ -761,28 +1222,23 @@ struct Clocked : Module {
 				clk[0].setup(masterLength, 1, sampleTime);// must call setup before start. length = double_period
 				clk[0].start();
 			}
-			clkOutputs[0] = clk[0].isHigh(swingAmount[0], pulseWidth[0]) ? 10.0f : 0.0f;		
+			int high = clk[0].isHigh(swingAmount[0], pulseWidth[0]);
+			clkOutputs[0] = high ? 10.0f : 0.0f;		
+			clkEdgeAges[0] = subSampleEdges ? (float)(clk[0].getEdgeAge(high) * sampleRate) : 0.0f;
 			
 			// Sub clocks
 			for (int i = 1; i < 4; i++) {
 				if (clk[i].isReset()) {
 					double length;
 					int iterations;
-					int ratioDoubled = ratiosDoubled[i];
-					if (ratioDoubled < 0) { // if div 
-						ratioDoubled *= -1;
-						length = masterLength * ((double)ratioDoubled) / 2.0;
-						iterations = 1l + (ratioDoubled % 2);		
-					}
-					else {// mult 
-						length = (2.0f * masterLength) / ((double)ratioDoubled);
-						iterations = ratioDoubled / (2l - (ratioDoubled % 2l));							
-					}
+					calcSubClockLength(i, &length, &iterations);
 					clk[i].setup(length, iterations, sampleTime);
 					clk[i].start();
 				}
-				delay[i - 1].write(clk[i].isHigh(swingAmount[i], pulseWidth[i]));
+				high = clk[i].isHigh(swingAmount[i], pulseWidth[i]);
+				delay[i - 1].write(high, subSampleEdges ? (float)(clk[i].getEdgeAge(high) * sampleRate) : 0.0f);
 				clkOutputs[i] = delay[i - 1].read(delaySamples[i]) ? 10.0f : 0.0f;
+				clkEdgeAges[i] = delay[i - 1].getEdgeAge();
 			}
 
 			// Step clocks
@@ -792,17 +1248,30 @@ struct Clocked : Module {
 		
 		// outputs
 		for (int i = 0; i < 4; i++) {
-			outputs[CLK_OUTPUTS + i].setVoltage(clkOutputs[i]);
+			outputs[CLK_OUTPUTS + i].setVoltage(clkEdges[i].process(clkOutputs[i], clkEdgeAges[i], subSampleEdges));
 		}
 		outputs[RESET_OUTPUT].setVoltage((resetPulse.process((float)sampleTime) ? 10.0f : 0.0f));
 		outputs[RUN_OUTPUT].setVoltage((runPulse.process((float)sampleTime) ? 10.0f : 0.0f));
 		outputs[BPM_OUTPUT].setVoltage( inputs[BPM_INPUT].isConnected() ? inputs[BPM_INPUT].getVoltage() : log2f(1.0f / masterLength));
+		if (clockBus) {
+			Output& busOut = outputs[CLK_OUTPUTS + 0];
+			busOut.setChannels(CLKBUS_NUM_CHANNELS);
+			for (int i = 1; i < 4; i++) {
+				busOut.setVoltage(outputs[CLK_OUTPUTS + i].getVoltage(), CLKBUS_MASTER + i);
+			}
+			busOut.setVoltage(outputs[RESET_OUTPUT].getVoltage(), CLKBUS_RESET);
+			busOut.setVoltage(outputs[RUN_OUTPUT].getVoltage(), CLKBUS_RUN);
+			busOut.setVoltage(outputs[BPM_OUTPUT].getVoltage(), CLKBUS_BPM);
+		}
+		else {
+			outputs[CLK_OUTPUTS + 0].setChannels(1);
+		}
 			
 		
 		// lights
 		if (refresh.processLights()) {
 			// Reset light
-			lights[RESET_LIGHT].setSmoothBrightness(resetLight, (float)sampleTime * (RefreshCounter::displayRefreshStepSkips >> 2));	
+			lights[RESET_LIGHT].setSmoothBrightness(resetLight, (float)sampleTime * (refresh.displayRefreshStepSkips >> 2));	
 			resetLight = 0.0f;
 			
 			// Run light
@@ -811,9 +1280,10 @@ struct Clocked : Module {
 			// BPM light
 			bool warningFlashState = true;
 			if (cantRunWarning > 0l) 
-				warningFlashState = calcWarningFlash(cantRunWarning, (long) (0.7 * sampleRate / RefreshCounter::displayRefreshStepSkips));
-			lights[BPMSYNC_LIGHT + 0].setBrightness((bpmDetectionMode && warningFlashState) ? 1.0f : 0.0f);
-			lights[BPMSYNC_LIGHT + 1].setBrightness((bpmDetectionMode && warningFlashState) ? (float)((ppqn - 2)*(ppqn - 2))/440.0f : 0.0f);			
+				warningFlashState = calcWarningFlash(cantRunWarning, (long) (0.7 * sampleRate / refresh.displayRefreshStepSkips));
+			bool pllUnlocked = pllMode != 0 && running && !isPllLocked() && inputs[BPM_INPUT].isConnected();// shown as red
+			lights[BPMSYNC_LIGHT + 0].setBrightness((bpmDetectionMode && warningFlashState && !pllUnlocked) ? 1.0f : 0.0f);
+			lights[BPMSYNC_LIGHT + 1].setBrightness((bpmDetectionMode && warningFlashState) ? (pllUnlocked ? 1.0f : (float)((ppqn - 2)*(ppqn - 2))/440.0f) : 0.0f);			
 			
 			// ratios synched lights
 			for (int i = 1; i < 4; i++)
@@ -833,9 +1303,12 @@ struct Clocked : Module {
 			
 			// To Expander
 			if (rightExpander.module && rightExpander.module->model == modelClockedExpander) {
-				float *messageToExpander = (float*)(rightExpander.module->leftExpander.producerMessage);
+				float *messageToExpander = toExpander.message;
 				messageToExpander[0] = (float)panelTheme;
-				rightExpander.module->leftExpander.messageFlipRequested = true;
+				toExpander.sendRight(this);
+			}
+			else {
+				toExpander.reset();
 			}
 		}// lightRefreshCounter
 	}// process()
@@ -846,12 +1319,11 @@ struct ClockedWidget : ModuleWidget {
 	SvgPanel* darkPanel;
 	PortWidget* slaveResetRunBpmInputs[3];
 
-	struct RatioDisplayWidget : LightWidget {//TransparentWidget {
+	struct RatioDisplayWidget : CachedDisplayWidget {
 		Clocked *module;
 		int knobIndex;
 		std::shared_ptr<Font> font;
 		std::string fontPath;
-		char displayStr[16];
 		const std::string delayLabelsClock[8] = {"D 0", "/16",   "1/8",  "1/4", "1/3",     "1/2", "2/3",     "3/4"};
 		const std::string delayLabelsNote[8]  = {"D 0", "/64",   "/32",  "/16", "/8t",     "1/8", "/4t",     "/8d"};
 
@@ -860,7 +1332,7 @@ struct ClockedWidget : ModuleWidget {
 			fontPath = std::string(asset::plugin(pluginInstance, "res/fonts/Segment14.ttf"));
 		}
 		
-		void draw(const DrawArgs &args) override {
+		void drawDisplay(const DrawArgs &args) override {
 			if (!(font = APP->window->loadFont(fontPath))) {
 				return;
 			}
@@ -872,6 +1344,10 @@ struct ClockedWidget : ModuleWidget {
 			nvgFillColor(args.vg, nvgTransRGBA(textColor, displayAlpha));
 			nvgText(args.vg, textPos.x, textPos.y, "~~~", NULL);
 			nvgFillColor(args.vg, textColor);
+			nvgText(args.vg, textPos.x, textPos.y, displayStr, NULL);
+		}
+
+		void updateDisplay() override {
 			if (module == NULL) {
 				if (knobIndex == 0)
 					snprintf(displayStr, 4, "120");
@@ -931,7 +1407,6 @@ struct ClockedWidget : ModuleWidget {
 				}
 			}
 			displayStr[3] = 0;// more safety
-			nvgText(args.vg, textPos.x, textPos.y, displayStr, NULL);
 		}
 	};		
 	
@@ -953,6 +1428,51 @@ struct ClockedWidget : ModuleWidget {
 			module->momentaryRunInput = !module->momentaryRunInput;
 		}
 	};
+	struct ClockBusItem : MenuItem {
+		Clocked *module;
+		void onAction(const event::Action &e) override {
+			module->clockBus = !module->clockBus;
+		}
+	};
+	struct SubSampleEdgesItem : MenuItem {
+		Clocked *module;
+		void onAction(const event::Action &e) override {
+			module->subSampleEdges = !module->subSampleEdges;
+		}
+	};
+	struct ScheduledEngineItem : MenuItem {
+		Clocked *module;
+		void onAction(const event::Action &e) override {
+			module->scheduledEngine = !module->scheduledEngine;
+			module->resetClocked(false);
+		}
+	};
+	struct PllModeItem : MenuItem {
+		Clocked *module;
+		
+		struct PllModeSubItem : MenuItem {
+			Clocked *module;
+			int setVal;
+			void onAction(const event::Action &e) override {
+				module->pllMode = setVal;
+				module->resetClocked(false);
+			}
+		};
+		
+		Menu *createChildMenu() override {
+			Menu *menu = new Menu;
+			
+			const std::string pllModeNames[4] = {"Double period (default)", "PLL, light smoothing", "PLL, medium smoothing", "PLL, heavy smoothing"};
+			for (int i = 0; i < 4; i++) {
+				PllModeSubItem *pllItem = createMenuItem<PllModeSubItem>(pllModeNames[i], CHECKMARK(module->pllMode == i));
+				pllItem->module = module;
+				pllItem->setVal = i;
+				menu->addChild(pllItem);
+			}
+			
+			return menu;
+		}
+	};
 	struct ResetHighItem : MenuItem {
 		Clocked *module;
 		void onAction(const event::Action &e) override {
@@ -1003,6 +1523,22 @@ struct ClockedWidget : ModuleWidget {
 		runInItem->module = module;
 		menu->addChild(runInItem);
 
+		SubSampleEdgesItem *sseItem = createMenuItem<SubSampleEdgesItem>("Sub-sample accurate clock edges", CHECKMARK(module->subSampleEdges));
+		sseItem->module = module;
+		menu->addChild(sseItem);
+
+		ScheduledEngineItem *seItem = createMenuItem<ScheduledEngineItem>("Event-scheduled clock engine (lower CPU)", CHECKMARK(module->scheduledEngine));
+		seItem->module = module;
+		menu->addChild(seItem);
+
+		ClockBusItem *busItem = createMenuItem<ClockBusItem>("Poly clock bus on master clock output", CHECKMARK(module->clockBus));
+		busItem->module = module;
+		menu->addChild(busItem);
+
+		PllModeItem *pllItem = createMenuItem<PllModeItem>("BPM detection follower", RIGHT_ARROW);
+		pllItem->module = module;
+		menu->addChild(pllItem);
+
 		menu->addChild(new MenuLabel());// empty line
 
 		MenuLabel *expLabel = new MenuLabel();
@@ -1032,7 +1568,7 @@ struct ClockedWidget : ModuleWidget {
 				else if ( (paramId >= Clocked::PW_PARAMS + 0) && (paramId <= Clocked::PW_PARAMS + 3) )
 					dispIndex = paramId - Clocked::PW_PARAMS;
 				module->notifyingSource[dispIndex] = paramId;
-				module->notifyInfo[dispIndex] = (long) (Clocked::delayInfoTime * module->sampleRate / RefreshCounter::displayRefreshStepSkips);
+				module->notifyInfo[dispIndex] = (long) (Clocked::delayInfoTime * module->sampleRate / module->refresh.displayRefreshStepSkips);
 			}
 			Knob::onDragMove(e);
 		}
@@ -1046,7 +1582,7 @@ struct ClockedWidget : ModuleWidget {
 				if ( (paramId >= Clocked::DELAY_PARAMS + 1) && (paramId <= Clocked::DELAY_PARAMS + 3) )
 					dispIndex = paramId - Clocked::DELAY_PARAMS;
 				module->notifyingSource[dispIndex] = paramId;
-				module->notifyInfo[dispIndex] = (long) (Clocked::delayInfoTime * module->sampleRate / RefreshCounter::displayRefreshStepSkips);
+				module->notifyInfo[dispIndex] = (long) (Clocked::delayInfoTime * module->sampleRate / module->refresh.displayRefreshStepSkips);
 			}
 			Knob::onDragMove(e);
 		}
@@ -1055,6 +1591,9 @@ struct ClockedWidget : ModuleWidget {
 	
 	ClockedWidget(Clocked *module) {
 		setModule(module);
+		if (module) {
+			registerClockWidget(this);
+		}
 		
 		// Main panels from Inkscape
         setPanel(APP->window->loadSvg(asset::plugin(pluginInstance, "res/light/Clocked.svg")));
@@ -1170,12 +1709,15 @@ struct ClockedWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((Clocked*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((Clocked*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((Clocked*)module)->panelTheme);
 		}
 		Widget::step();
 	}
 	
+	~ClockedWidget() {
+		unregisterClockWidget(this);
+	}
+	
 	void onHoverKey(const event::HoverKey& e) override {
 		if (e.action == GLFW_PRESS) {
 			if ( e.key == GLFW_KEY_SPACE && ((e.mods & RACK_MOD_MASK) == 0) ) {
@@ -18,6 +18,27 @@ static const unsigned int ON_STOP_EXT_RST_MSK = 0x4;
 static const unsigned int ON_START_EXT_RST_MSK = 0x8;
 
 
+struct BandLimitedEdge {
+	// used on clock outputs when sub-sample edges are on: each edge is a minBLEP step placed at its fractional position
+	//   within the sample, so that edges don't jitter by up to one sample when a ratio doesn't divide the sample rate
+	dsp::MinBlepGenerator<16, 16, float> minBlep;
+	float lastValue = 0.0f;
+	
+	float process(float value, float edgeAge, bool bandLimited) {// edgeAge is the time between the edge and the current sample, in samples ([0 : 1[)
+		if (!bandLimited) {
+			// keep tracking the output so that turning the option on doesn't insert a step for an edge that already happened
+			lastValue = value;
+			return value;
+		}
+		if (value != lastValue) {
+			minBlep.insertDiscontinuity(-clamp(edgeAge, 0.0f, 0.999f), value - lastValue);
+			lastValue = value;
+		}
+		return value + minBlep.process();
+	}
+};
+
+
 	
 struct RatioParam : ParamQuantity {
 	float getDisplayValue() override {
@@ -166,34 +187,29 @@ struct OnStopItem : MenuItem {
 
 // must have done validateClockModule() before calling this
 static void autopatch(PortWidget **slaveResetRunBpmInputs, bool *slaveResetClockOutputsHighPtr) {
-	for (Widget* widget : APP->scene->rack->moduleContainer->children) {
-		ModuleWidget* moduleWidget = dynamic_cast<ModuleWidget *>(widget);
-		if (moduleWidget) {
-			int otherId = moduleWidget->module->id;
-			if (otherId == clockMaster.id && moduleWidget->model->slug.substr(0, 7) == std::string("Clocked")) {
-				// here we have found the clock master, so autopatch to it
-				// first we need to find the PortWidgets of the proper outputs of the clock master
-				PortWidget* masterResetRunBpmOutputs[3];
-				for (PortWidget* outputWidgetOnMaster : moduleWidget->outputs) {
-					int outId = outputWidgetOnMaster->portId;
-					if (outId >= 4 && outId <= 6) {
-						masterResetRunBpmOutputs[outId - 4] = outputWidgetOnMaster;
-					}
-				}
-				// now we can make the actual cables between master and slave
-				for (int i = 0; i < 3; i++) {
-					std::list<CableWidget*> cablesOnSlaveInput = APP->scene->rack->getCablesOnPort(slaveResetRunBpmInputs[i]);
-					if (cablesOnSlaveInput.empty()) {
-						CableWidget* cable = new CableWidget();
-						cable->setInput(slaveResetRunBpmInputs[i]);
-						cable->setOutput(masterResetRunBpmOutputs[i]);
-						APP->scene->rack->addCable(cable);
-					}
-				}
-				*slaveResetClockOutputsHighPtr = clockMaster.resetClockOutputsHigh;
-				return;
+	ModuleWidget* moduleWidget = findClockWidget(clockMaster.id);
+	if (moduleWidget) {
+		// here we have found the clock master, so autopatch to it
+		// first we need to find the PortWidgets of the proper outputs of the clock master
+		PortWidget* masterResetRunBpmOutputs[3];
+		for (PortWidget* outputWidgetOnMaster : moduleWidget->outputs) {
+			int outId = outputWidgetOnMaster->portId;
+			if (outId >= 4 && outId <= 6) {
+				masterResetRunBpmOutputs[outId - 4] = outputWidgetOnMaster;
+			}
+		}
+		// now we can make the actual cables between master and slave
+		for (int i = 0; i < 3; i++) {
+			std::list<CableWidget*> cablesOnSlaveInput = APP->scene->rack->getCablesOnPort(slaveResetRunBpmInputs[i]);
+			if (cablesOnSlaveInput.empty()) {
+				CableWidget* cable = new CableWidget();
+				cable->setInput(slaveResetRunBpmInputs[i]);
+				cable->setOutput(masterResetRunBpmOutputs[i]);
+				APP->scene->rack->addCable(cable);
 			}
 		}
+		*slaveResetClockOutputsHighPtr = clockMaster.resetClockOutputsHigh;
+		return;
 	}
 	// assert(false);
 	// here the clock master was not found; this should never happen, since AutopatchToMasterItem is never invoked when a valid master does not exist
@@ -23,7 +23,8 @@ struct ClockedExpander : Module {
 
 
 	// Expander
-	float leftMessages[2][1] = {};// messages from mother
+	ExpanderChannel<float[1]> fromMother;// messages from mother
+	ExpanderSender<float[8]> toMother;// messages to mother
 
 
 	// No need to save, no reset
@@ -34,8 +35,7 @@ struct ClockedExpander : Module {
 	ClockedExpander() {
 		config(0, NUM_INPUTS, 0, 0);
 		
-		leftExpander.producerMessage = leftMessages[0];
-		leftExpander.consumerMessage = leftMessages[1];
+		fromMother.construct(&leftExpander);
 		
 		panelTheme = (loadDarkAsDefault() ? 1 : 0);
 	}
@@ -49,15 +49,20 @@ struct ClockedExpander : Module {
 			bool motherPresent = (leftExpander.module && leftExpander.module->model == modelClocked);
 			if (motherPresent) {
 				// To Mother
-				float *messagesToMother = (float*)leftExpander.module->rightExpander.producerMessage;
+				float *messagesToMother = toMother.message;
 				for (int i = 0; i < 8; i++) {
 					messagesToMother[i] = inputs[i].getVoltage();
 				}
-				leftExpander.module->rightExpander.messageFlipRequested = true;
+				toMother.sendLeft(this);
 				
 				// From Mother
-				float *messagesFromMother = (float*)leftExpander.consumerMessage;
-				panelTheme = clamp((int)(messagesFromMother[0] + 0.5f), 0, 1);			
+				if (fromMother.receive()) {
+					panelTheme = clamp((int)(fromMother.data()[0] + 0.5f), 0, 1);
+				}
+			}
+			else {
+				fromMother.reset();
+				toMother.reset();
 			}		
 		}// expanderRefreshCounter
 	}// process()
@@ -97,8 +102,7 @@ struct ClockedExpanderWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((ClockedExpander*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((ClockedExpander*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((ClockedExpander*)module)->panelTheme);
 		}
 		Widget::step();
 	}
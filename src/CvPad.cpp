@@ -65,6 +65,7 @@ struct CvPad : Module {
 	
 	// No need to save, no reset
 	RefreshCounter refresh;
+	ExpanderSender<float[5]> toExpander;// messages to FourView: 4 CV values, panelTheme
 	int bank = 0;
 	float cvKnobValue = 0.0f;
 	Trigger padTriggers[N_PADS];
@@ -132,6 +133,11 @@ struct CvPad : Module {
 		highSensitivityCvKnob = true;
 		resetNonJson();
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+	}
+	
 	void resetNonJson() {
 		for (int p = 0; p < N_PADS; p++) {
 			cvsCpBuf[p] = 0.0f;
@@ -337,7 +343,7 @@ struct CvPad : Module {
 		if (refresh.processInputs()) {
 			// To Expander
 			if (rightExpander.module && rightExpander.module->model == modelFourView) {
-				float *messageToExpander = (float*)(rightExpander.module->leftExpander.producerMessage);
+				float *messageToExpander = toExpander.message;
 				if (config == 4) {// 1x16
 					messageToExpander[0] = outputs[CV_OUTPUTS + 0].getVoltage();
 					for (int i = 1; i < 4; i++) {
@@ -356,7 +362,10 @@ struct CvPad : Module {
 					}
 				}
 				messageToExpander[4] = (float)panelTheme;
-				rightExpander.module->leftExpander.messageFlipRequested = true;
+				toExpander.sendRight(this);
+			}
+			else {
+				toExpander.reset();
 			}			
 		}
 	}
@@ -999,8 +1008,7 @@ struct CvPadWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((CvPad*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((CvPad*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((CvPad*)module)->panelTheme);
 		}
 		Widget::step();
 	}
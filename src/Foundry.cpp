@@ -90,7 +90,8 @@ struct Foundry : Module {
 									1 + // TRKCV_INPUT with connected
 									7 + // GATECV_INPUT, GATEPCV_INPUT, TIEDCV_INPUT, SLIDECV_INPUT, WRITE_SRC_INPUT, LEFTCV_INPUT, RIGHTCV_INPUT
 									2; // SYNC_SEQCV_PARAM, WRITEMODE_PARAM
-	float rightMessages[2][messageSize] = {};// messages from expander
+	ExpanderChannel<float[messageSize]> fromExpander;// messages from expander
+	ExpanderSender<float[1 + 2 + Sequencer::NUM_TRACKS]> toExpander;// messages to expander: panelTheme, write lights
 		
 	// Constants
 	enum EditPSDisplayStateIds {DISP_NORMAL, DISP_MODE_SEQ, DISP_MODE_SONG, DISP_LEN, DISP_REPS, DISP_TRANSPOSE, DISP_ROTATE, DISP_PPQN, DISP_DELAY, DISP_COPY_SEQ, DISP_PASTE_SEQ, DISP_COPY_SONG, DISP_PASTE_SONG, DISP_COPY_SONG_CUST};
@@ -110,6 +111,8 @@ struct Foundry : Module {
 	int seqCVmethod;// 0 is 0-10V, 1 is C2-D7#, 2 is TrigIncr
 	bool running;
 	bool resetOnRun;
+	int clockBusSource;// 0 when the clock input is a regular clock, 1 to 4 when it is a clock bus (see ClockBusChannelIds)
+	ModuleRandom rng;// only the seed options are saved
 	bool attached;
 	int velEditMode;// 0 is velocity (aka CV2), 1 is gate-prob, 2 is slide-rate
 	int writeMode;// 0 is both, 1 is CV only, 2 is CV2 only
@@ -132,6 +135,7 @@ struct Foundry : Module {
 	// No need to save, no reset
 	int cpSongStart;// no need to initialize
 	RefreshCounter refresh;
+	SampleTimings timings;
 	float resetLight = 0.0f;
 	int sequenceKnob = 0;
 	int velocityKnob = 0;
@@ -181,12 +185,11 @@ struct Foundry : Module {
 	Foundry() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		
-		rightExpander.producerMessage = rightMessages[0];
-		rightExpander.consumerMessage = rightMessages[1];
+		fromExpander.construct(&rightExpander);
 		
 		// must init those that have no-connect info to non-connected, or else mother may read 0.0 init value if ever refresh limiters make it such that after a connection of expander the mother reads before the first pass through the expander's writing code, and this may do something undesired (ex: change track in Foundry on expander connected while track CV jack is empty)
 		for (int i = 0; i < (Sequencer::NUM_TRACKS * 2 + 1); i++) {
-			rightMessages[1][i] = std::numeric_limits<float>::quiet_NaN();
+			fromExpander.frames[1].data[i] = std::numeric_limits<float>::quiet_NaN();
 		}
 
 		char strBuf[32];
@@ -232,7 +235,7 @@ struct Foundry : Module {
 		configParam(RESET_PARAM, 0.0f, 1.0f, 0.0f, "Reset");
 		configParam(AUTOSTEP_PARAM, 0.0f, 1.0f, 1.0f, "Autostep");		
 		
-		seq.construct(&holdTiedNotes, &velocityMode, &stopAtEndOfSong);
+		seq.construct(&holdTiedNotes, &velocityMode, &stopAtEndOfSong, &refresh, &rng);
 		onReset();
 		
 		panelTheme = (loadDarkAsDefault() ? 1 : 0);
@@ -250,6 +253,8 @@ struct Foundry : Module {
 		seqCVmethod = 0;
 		running = true;
 		resetOnRun = false;
+		clockBusSource = 0;
+		rng.init();
 		attached = false;
 		velEditMode = 0;
 		writeMode = 0;
@@ -258,6 +263,12 @@ struct Foundry : Module {
 		mergeTracks = 0;// no merging
 		resetNonJson(false);// no need to propagate initRun calls in seq, since seq.onReset() has initRun() in it
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+		timings.onSampleRateChange();
+	}
+	
 	void resetNonJson(bool propagateInitRun) {
 		editingSequence = isEditingSequence();
 		cpMode = getCPMode();
@@ -273,8 +284,9 @@ struct Foundry : Module {
 		initRun(propagateInitRun);
 	}
 	void initRun(bool propagateInitRun) {
-		clockIgnoreOnReset = (long) (clockIgnoreOnResetDuration * APP->engine->getSampleRate());
+		clockIgnoreOnReset = timings.clockIgnoreOnReset;
 		if (propagateInitRun) {
+			rng.onSeqReset();
 			seq.initRun(editingSequence, true);
 		}
 	}
@@ -322,6 +334,12 @@ struct Foundry : Module {
 		// resetOnRun
 		json_object_set_new(rootJ, "resetOnRun", json_boolean(resetOnRun));
 		
+		// clockBusSource
+		json_object_set_new(rootJ, "clockBusSource", json_integer(clockBusSource));
+		
+		// rng
+		rng.dataToJson(rootJ);
+		
 		// attached
 		json_object_set_new(rootJ, "attached", json_boolean(attached));
 
@@ -403,6 +421,11 @@ struct Foundry : Module {
 		if (resetOnRunJ)
 			resetOnRun = json_is_true(resetOnRunJ);
 
+		// clockBusSource
+		json_t *clockBusSourceJ = json_object_get(rootJ, "clockBusSource");
+		if (clockBusSourceJ)
+			clockBusSource = clamp((int)json_integer_value(clockBusSourceJ), 0, 4);
+
 		// attached
 		json_t *attachedJ = json_object_get(rootJ, "attached");
 		if (attachedJ)
@@ -423,6 +446,9 @@ struct Foundry : Module {
 		if (stopAtEndOfSongJ)
 			stopAtEndOfSong = json_integer_value(stopAtEndOfSongJ);
 
+		// rng (before seq, so that its run state is drawn from the reseeded generator)
+		rng.dataFromJson(rootJ);
+
 		// seq
 		seq.dataFromJson(rootJ, isEditingSequence());
 		
@@ -492,13 +518,13 @@ struct Foundry : Module {
 		static const float revertDisplayTime = 0.7f;// seconds
 		
 		bool expanderPresent = (rightExpander.module && rightExpander.module->model == modelFoundryExpander);
-		float *messagesFromExpander = (float*)rightExpander.consumerMessage;// could be invalid pointer when !expanderPresent, so read it only when expanderPresent
+		float *messagesFromExpander = fromExpander.data();// stale when !expanderPresent, so read it only when expanderPresent
 		
 		
 		//********** Buttons, knobs, switches and inputs **********
 		
 		// Run button
-		if (runningTrigger.process(params[RUN_PARAM].getValue() + inputs[RUNCV_INPUT].getVoltage())) {// no input refresh here, don't want to introduce startup skew
+		if (runningTrigger.process(params[RUN_PARAM].getValue() + inputs[RUNCV_INPUT].getVoltage() + getClockBusChannel(inputs[CLOCK_INPUTS + 0], clockBusSource, CLKBUS_RUN))) {// no input refresh here, don't want to introduce startup skew
 			running = !running;
 			if (running) {
 				if (resetOnRun) {
@@ -511,6 +537,8 @@ struct Foundry : Module {
 		}
 
 		if (refresh.processInputs()) {
+			seq.invalidateNextSteps();// edits below, and those of the UI thread since the last scan
+			
 			// Seq / song switch
 			bool newEditingSequence = isEditingSequence();
 			if (newEditingSequence != editingSequence) {
@@ -602,10 +630,10 @@ struct Foundry : Module {
 						}
 					}
 					if (displayState != DISP_COPY_SONG_CUST)
-						revertDisplay = (long) (revertDisplayTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						revertDisplay = (long) (revertDisplayTime * sampleRate / refresh.displayRefreshStepSkips);
 				}
 				else
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 			}
 			// Paste 
 			if (pasteTrigger.process(params[PASTE_PARAM].getValue())) {
@@ -621,10 +649,10 @@ struct Foundry : Module {
 						}
 					}
 					if (displayState != DISP_COPY_SONG_CUST)
-						revertDisplay = (long) (revertDisplayTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						revertDisplay = (long) (revertDisplayTime * sampleRate / refresh.displayRefreshStepSkips);
 				}
 				else
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 			}			
 			
 			
@@ -691,7 +719,7 @@ struct Foundry : Module {
 					if (editingSequence) {
 						seq.setLength(stepPressed + 1, multiTracks);
 					}
-					revertDisplay = (long) (revertDisplayTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					revertDisplay = (long) (revertDisplayTime * sampleRate / refresh.displayRefreshStepSkips);
 				}
 				else {
 					if (!running || !attached) {// not running or detached
@@ -710,7 +738,7 @@ struct Foundry : Module {
 						}
 					}
 					else {// attached and running
-						attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 					}
 				}
 			}
@@ -724,7 +752,7 @@ struct Foundry : Module {
 						displayState = DISP_NORMAL;
 				}
 				else
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 			}
 			
 			// Clk res/delay button
@@ -738,7 +766,7 @@ struct Foundry : Module {
 						displayState = DISP_NORMAL;
 				}
 				else
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 			}
 			
 			// Transpose/Rotate button
@@ -754,7 +782,7 @@ struct Foundry : Module {
 						displayState = DISP_NORMAL;
 				}
 				else if (attached)
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 			}			
 
 			// Begin/End buttons
@@ -764,7 +792,7 @@ struct Foundry : Module {
 					displayState = DISP_NORMAL;
 				}
 				else if (attached)
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 			}	
 			if (endTrigger.process(params[END_PARAM].getValue())) {
 				if (!editingSequence && !attached) {
@@ -772,7 +800,7 @@ struct Foundry : Module {
 					displayState = DISP_NORMAL;
 				}
 				else if (attached)
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 			}	
 
 			// Rep/Len button
@@ -784,7 +812,7 @@ struct Foundry : Module {
 						displayState = DISP_NORMAL;
 				}
 				else
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 			}	
 
 			// Track Inc/Dec buttons
@@ -806,7 +834,7 @@ struct Foundry : Module {
 					}
 					else {
 						multiTracks = false;
-						attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 					}
 				}
 			}	
@@ -817,7 +845,7 @@ struct Foundry : Module {
 					multiSteps = !multiSteps;
 				else if (attached) {
 					multiSteps = false;
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 				}
 			}	
 			
@@ -912,7 +940,7 @@ struct Foundry : Module {
 							if (!attached || (attached && !running))
 								seq.modPhraseSeqNum(deltaSeqKnob, multiTracks);
 							else
-								attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+								attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 						}
 					}	
 				}
@@ -954,7 +982,7 @@ struct Foundry : Module {
 							}
 						}
 						else if (attached)
-							attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+							attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 					}
 				}
 				phraseKnob = newPhraseKnob;
@@ -967,7 +995,7 @@ struct Foundry : Module {
 					if (editingSequence) {
 						displayState = DISP_NORMAL;
 						if (seq.applyNewOctave(3 - octn, multiSteps ? cpSeqLength : 1, sampleRate, multiTracks))
-							tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+							tiedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 					}
 				}
 			}
@@ -982,7 +1010,7 @@ struct Foundry : Module {
 					}
 					else {
 						if (seq.applyNewKey(pkInfo.key, multiSteps ? cpSeqLength : 1, sampleRate, pkInfo.isRightClick, multiTracks))
-							tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+							tiedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 					}							
 				}
 			}
@@ -998,7 +1026,7 @@ struct Foundry : Module {
 				if (editingSequence) {
 					displayState = DISP_NORMAL;
 					if (seq.toggleGateP(multiSteps ? cpSeqLength : 1, multiTracks)) 
-						tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						tiedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 					else if (seq.getAttribute(true).getGateP())
 						velEditMode = 1;
 				}
@@ -1007,7 +1035,7 @@ struct Foundry : Module {
 				if (editingSequence) {
 					displayState = DISP_NORMAL;
 					if (seq.toggleSlide(multiSteps ? cpSeqLength : 1, multiTracks))
-						tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						tiedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 					else if (seq.getAttribute(true).getSlide())
 						velEditMode = 2;
 				}
@@ -1027,11 +1055,13 @@ struct Foundry : Module {
 		//********** Clock and reset **********
 		
 		// Clock
+		bool clockedOrReset = false;
 		if (running && clockIgnoreOnReset == 0l) {
 			bool clockTrigged[Sequencer::NUM_TRACKS];
 			for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
-				clockTrigged[trkn] = clockTriggers[trkn].process(inputs[CLOCK_INPUTS + trkn].getVoltage());
+				clockTrigged[trkn] = clockTriggers[trkn].process(trkn == 0 ? getClockBusClock(inputs[CLOCK_INPUTS + 0], clockBusSource) : inputs[CLOCK_INPUTS + trkn].getVoltage());
 				if (clockTrigged[clkInSources[trkn]]) {
+					clockedOrReset = true;
 					bool stopRequested = seq.clockStep(trkn, editingSequence);
 					if (stopRequested) {
 						running = false;
@@ -1043,7 +1073,7 @@ struct Foundry : Module {
 		}
 				
 		// Reset
-		if (resetTrigger.process(inputs[RESET_INPUT].getVoltage() + params[RESET_PARAM].getValue())) {
+		if (resetTrigger.process(inputs[RESET_INPUT].getVoltage() + getClockBusChannel(inputs[CLOCK_INPUTS + 0], clockBusSource, CLKBUS_RESET) + params[RESET_PARAM].getValue())) {
 			initRun(true);
 			resetLight = 1.0f;
 			displayState = DISP_NORMAL;
@@ -1052,7 +1082,12 @@ struct Foundry : Module {
 				if (expanderPresent && !std::isnan(messagesFromExpander[Sequencer::NUM_TRACKS + trkn]) && seqCVmethod == 2)
 					seq.setSeqIndexEdit(0, trkn);
 			}
+			clockedOrReset = true;
 		}
+		
+		// Next steps, computed ahead of the clock edges that will use them
+		if (running && !clockedOrReset)
+			seq.calcNextSteps(editingSequence, clkInSources);
 
 
 		
@@ -1061,14 +1096,21 @@ struct Foundry : Module {
 		
 		
 		// CV, gate and velocity outputs
-		float cvOut[Sequencer::NUM_TRACKS];
-		float gateOut[Sequencer::NUM_TRACKS];
-		float velOut[Sequencer::NUM_TRACKS];
+		simd::float_4 cvOut;
+		simd::float_4 gateOut;
+		simd::float_4 velOut;
+		bool retriggingOnReset = (clockIgnoreOnReset != 0l && retrigGatesOnReset);
+#ifdef FOUNDRY_SIMD_OUTPUTS
+		seq.calcOutputsSimd(cvOut, gateOut, velOut, running, running && !retriggingOnReset, editingSequence, clockTriggers, clkInSources, timings.gateTrigger);
+#else
 		for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
-			cvOut[trkn] = (seq.calcCvOutputAndDecSlideStepsRemain(trkn, running, editingSequence));
-			bool retriggingOnReset = (clockIgnoreOnReset != 0l && retrigGatesOnReset);
-			gateOut[trkn] = (seq.calcGateOutput(trkn, running && !retriggingOnReset, clockTriggers[clkInSources[trkn]], sampleRate));
-			velOut[trkn] = (seq.calcVelOutput(trkn, running && !retriggingOnReset, editingSequence) - (velocityBipol ? 5.0f : 0.0f));			
+			cvOut[trkn] = seq.calcCvOutputAndDecSlideStepsRemain(trkn, running, editingSequence);
+			gateOut[trkn] = seq.calcGateOutput(trkn, running && !retriggingOnReset, clockTriggers[clkInSources[trkn]], timings.gateTrigger);
+			velOut[trkn] = seq.calcVelOutput(trkn, running && !retriggingOnReset, editingSequence);
+		}
+#endif
+		if (velocityBipol) {
+			velOut -= 5.0f;
 		}
 		if (mergeTracks == 0) {
 			outputs[CV_OUTPUTS + 0].setChannels(1);
@@ -1125,11 +1167,9 @@ struct Foundry : Module {
 				outputs[GATE_OUTPUTS + trkn].setVoltage(0.0f);
 				outputs[VEL_OUTPUTS + trkn].setVoltage(0.0f);			
 			}
-			for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
-				outputs[CV_OUTPUTS + 0].setVoltage(cvOut[trkn], trkn);
-				outputs[GATE_OUTPUTS + 0].setVoltage(gateOut[trkn], trkn);
-				outputs[VEL_OUTPUTS + 0].setVoltage(velOut[trkn], trkn);			
-			}
+			outputs[CV_OUTPUTS + 0].setVoltageSimd(cvOut, 0);
+			outputs[GATE_OUTPUTS + 0].setVoltageSimd(gateOut, 0);
+			outputs[VEL_OUTPUTS + 0].setVoltageSimd(velOut, 0);
 		}
 
 
@@ -1221,7 +1261,7 @@ struct Foundry : Module {
 				float red = 0.0f;
 				if (editingSequence || (attached && running)) {
 					if (tiedWarning > 0l) {
-						bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+						bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips));
 						red = (warningFlashState && (i == (6 - octLightIndex))) ? 1.0f : 0.0f;
 					}
 					else				
@@ -1247,7 +1287,7 @@ struct Foundry : Module {
 						unsigned long editingType = seq.getEditingType();
 						if (editingType > 0ul) {
 							if (i == seq.getEditingGateKeyLight()) {
-								float dimMult = ((float) editingType / (float)(Sequencer::gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+								float dimMult = ((float) editingType / (float)(Sequencer::gateTime * sampleRate / refresh.displayRefreshStepSkips));
 								green *= dimMult;
 								red *= dimMult;
 							}
@@ -1266,7 +1306,7 @@ struct Foundry : Module {
 					}
 					else {
 						if (tiedWarning > 0l) {
-							bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+							bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips));
 							red = (warningFlashState && i == keyLightIndex) ? 1.0f : 0.0f;
 						}
 						else {
@@ -1283,7 +1323,7 @@ struct Foundry : Module {
 			else 
 				setGreenRed(GATE_LIGHT, editingGates ? 1.0f : 0.0f, editingGates ? 0.45f : 1.0f);
 			if (tiedWarning > 0l) {
-				bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+				bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips));
 				lights[TIE_LIGHT].setBrightness(warningFlashState ? 1.0f : 0.0f);
 			}
 			else
@@ -1295,7 +1335,7 @@ struct Foundry : Module {
 			lights[SLIDE_LIGHT].setBrightness(attributesVisual.getSlide() ? 1.0f : 0.0f);
 			
 			// Reset light
-			lights[RESET_LIGHT].setSmoothBrightness(resetLight, args.sampleTime * (RefreshCounter::displayRefreshStepSkips >> 2));
+			lights[RESET_LIGHT].setSmoothBrightness(resetLight, args.sampleTime * (refresh.displayRefreshStepSkips >> 2));
 			resetLight = 0.0f;
 			
 			// Run light
@@ -1303,7 +1343,7 @@ struct Foundry : Module {
 
 			// Attach light
 			if (attachedWarning > 0l) {
-				bool warningFlashState = calcWarningFlash(attachedWarning, (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+				bool warningFlashState = calcWarningFlash(attachedWarning, (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips));
 				lights[ATTACH_LIGHT].setBrightness(warningFlashState ? 1.0f : 0.0f);
 			}
 			else
@@ -1339,14 +1379,17 @@ struct Foundry : Module {
 			
 			// To Expander
 			if (rightExpander.module && rightExpander.module->model == modelFoundryExpander) {
-				float *messagesToExpander = (float*)(rightExpander.module->leftExpander.producerMessage);
+				float *messagesToExpander = toExpander.message;
 				messagesToExpander[0] = (float)panelTheme;
 				messagesToExpander[1] = (((writeMode & 0x2) == 0) && editingSequence) ? 1.0f : 0.0f;// lights[WRITE_SEL_LIGHTS + 0].setBrightness()
 				messagesToExpander[2] = (((writeMode & 0x1) == 0) && editingSequence) ? 1.0f : 0.0f;// lights[WRITE_SEL_LIGHTS + 1].setBrightness()
 				for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
 					messagesToExpander[3 + trkn] = (editingSequence && ((writeMode & 0x1) == 0) && (multiTracks || seq.getTrackIndexEdit() == trkn)) ? 1.0f : 0.0f;
 				}	
-				rightExpander.module->leftExpander.messageFlipRequested = true;
+				toExpander.sendRight(this);
+			}
+			else {
+				toExpander.reset();
 			}
 		}// lightRefreshCounter
 				
@@ -1378,11 +1421,10 @@ struct FoundryWidget : ModuleWidget {
 	SvgPanel* darkPanel;
 	
 	template <int NUMCHAR>
-	struct DisplayWidget : LightWidget {//TransparentWidget {// a centered display, must derive from this
+	struct DisplayWidget : CachedDisplayWidget {// a centered display, must derive from this
 		Foundry *module;
 		std::shared_ptr<Font> font;
 		std::string fontPath;
-		char displayStr[16];
 		static const int textFontSize = 15;
 		static constexpr float textOffsetY = 19.9f; // 18.2f for 14 pt, 19.7f for 15pt
 		
@@ -1398,7 +1440,7 @@ struct FoundryWidget : ModuleWidget {
 			fontPath = std::string(asset::plugin(pluginInstance, "res/fonts/Segment14.ttf"));
 		}
 		
-		void draw(const DrawArgs &args) override {
+		void drawDisplay(const DrawArgs &args) override {
 			if (!(font = APP->window->loadFont(fontPath))) {
 				return;
 			}
@@ -1411,22 +1453,24 @@ struct FoundryWidget : ModuleWidget {
 			std::string initString(NUMCHAR,'~');
 			nvgText(args.vg, textPos.x, textPos.y, initString.c_str(), NULL);
 			nvgFillColor(args.vg, textColor);
-			char overlayChar = printText();
 			nvgText(args.vg, textPos.x, textPos.y, displayStr, NULL);
-			if (overlayChar != 0) {
-				displayStr[0] = overlayChar;
-				displayStr[1] = 0;
-				nvgText(args.vg, textPos.x, textPos.y, displayStr, NULL);
+			if (displayAux != 0) {
+				char overlayStr[2] = {(char)displayAux, 0};
+				nvgText(args.vg, textPos.x, textPos.y, overlayStr, NULL);
 			}
 		}
 		
+		void updateDisplay() override {
+			displayAux = printText();// overlay char
+		}
+		
 		virtual char printText() = 0;
 	};
 	
 	struct VelocityDisplayWidget : DisplayWidget<4> {
 		VelocityDisplayWidget(Vec _pos, Vec _size, Foundry *_module) : DisplayWidget(_pos, _size, _module) {};
 
-		void draw(const DrawArgs &args) override {
+		void drawDisplay(const DrawArgs &args) override {
 			if (!(font = APP->window->loadFont(fontPath))) {
 				return;
 			}
@@ -1436,19 +1480,19 @@ struct FoundryWidget : ModuleWidget {
 			nvgTextLetterSpacing(args.vg, -0.4);
 
 			Vec textPos = VecPx(6.3f, textOffsetY);
-			char useRed = printText();
-			if (useRed == 1)
+			bool useRed = (displayAux == 1);
+			if (useRed)
 				textColor = nvgRGB(0xE0, 0xD0, 0x30);
 			nvgFillColor(args.vg, nvgTransRGBA(textColor, displayAlpha));
 			nvgText(args.vg, textPos.x, textPos.y, "~", NULL);
 			std::string initString(".~~");
 			nvgText(args.vg, textPos.x + offsetXfrac, textPos.y, initString.c_str(), NULL);
-			if (useRed == 1)
+			if (useRed)
 				textColor = nvgRGB(0xFF, 0x2C, 0x20);
 			nvgFillColor(args.vg, textColor);
 			nvgText(args.vg, textPos.x + offsetXfrac, textPos.y, &displayStr[1], NULL);
-			displayStr[1] = 0;
-			nvgText(args.vg, textPos.x, textPos.y, displayStr, NULL);
+			char firstCharStr[2] = {displayStr[0], 0};
+			nvgText(args.vg, textPos.x, textPos.y, firstCharStr, NULL);
 		}
 
 		char printText() override {
@@ -1590,7 +1634,7 @@ struct FoundryWidget : ModuleWidget {
 						if (editingSequence) {
 							int activeTrack = module->seq.getTrackIndexEdit();
 							bool expanderPresent = (module->rightExpander.module && module->rightExpander.module->model == modelFoundryExpander);
-							float *messagesFromExpander = (float*)module->rightExpander.consumerMessage;// could be invalid pointer when !expanderPresent, so read it only when expanderPresent
+							float *messagesFromExpander = module->fromExpander.data();// stale when !expanderPresent, so read it only when expanderPresent
 							if (!expanderPresent || std::isnan(messagesFromExpander[Sequencer::NUM_TRACKS + activeTrack])) {
 								module->seq.setSeqIndexEdit(totalNum - 1, activeTrack);
 								if (module->multiTracks) {
@@ -1990,6 +2034,14 @@ struct FoundryWidget : ModuleWidget {
 		rorItem->module = module;
 		menu->addChild(rorItem);
 
+		ClockBusSourceItem *busItem = createMenuItem<ClockBusSourceItem>("Clock input is poly clock bus", RIGHT_ARROW);
+		busItem->clockBusSourcePtr = &module->clockBusSource;
+		menu->addChild(busItem);
+
+		RandomSeedItem *seedItem = createMenuItem<RandomSeedItem>("Random seed", RIGHT_ARROW);
+		seedItem->rngPtr = &module->rng;
+		menu->addChild(seedItem);
+
 		HoldTiedItem *holdItem = createMenuItem<HoldTiedItem>("Hold tied notes", CHECKMARK(module->holdTiedNotes));
 		holdItem->module = module;
 		menu->addChild(holdItem);
@@ -2083,7 +2135,7 @@ struct FoundryWidget : ModuleWidget {
 					if (module->editingSequence) {
 						for (int trkn = 0; trkn < Sequencer::NUM_TRACKS; trkn++) {
 							bool expanderPresent = (module->rightExpander.module && module->rightExpander.module->model == modelFoundryExpander);
-							float *messagesFromExpander = (float*)module->rightExpander.consumerMessage;// could be invalid pointer when !expanderPresent, so read it only when expanderPresent
+							float *messagesFromExpander = module->fromExpander.data();// stale when !expanderPresent, so read it only when expanderPresent
 							if (!expanderPresent || std::isnan(messagesFromExpander[Sequencer::NUM_TRACKS + trkn])) {
 								if (module->multiTracks || (trkn == module->seq.getTrackIndexEdit())) {
 									module->seq.setSeqIndexEdit(0, trkn);
@@ -2415,8 +2467,7 @@ struct FoundryWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((Foundry*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((Foundry*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((Foundry*)module)->panelTheme);
 		}
 		Widget::step();
 	}
@@ -41,7 +41,8 @@ struct FoundryExpander : Module {
 	};
 	
 	// Expander
-	float leftMessages[2][1 + 2 + Sequencer::NUM_TRACKS] = {};// messages from mother
+	ExpanderChannel<float[1 + 2 + Sequencer::NUM_TRACKS]> fromMother;// messages from mother
+	ExpanderSender<float[NUM_INPUTS + 2]> toMother;// messages to mother
 
 
 	// No need to save
@@ -55,8 +56,7 @@ struct FoundryExpander : Module {
 		configParam(SYNC_SEQCV_PARAM, 0.0f, 1.0f, 0.0f, "Sync Seq#");// 1.0f is top position
 		configParam(WRITEMODE_PARAM, 0.0f, 1.0f, 0.0f, "Write mode");
 	
-		leftExpander.producerMessage = leftMessages[0];
-		leftExpander.consumerMessage = leftMessages[1];
+		fromMother.construct(&leftExpander);
 		
 		panelTheme = (loadDarkAsDefault() ? 1 : 0);
 	}
@@ -68,10 +68,10 @@ struct FoundryExpander : Module {
 			expanderRefreshCounter = 0;
 			
 			bool motherPresent = leftExpander.module && leftExpander.module->model == modelFoundry;
-			float *messagesFromMother = (float*)leftExpander.consumerMessage;// could be invalid pointer when !expanderPresent, so read it only when expanderPresent
+			float *messagesFromMother = fromMother.data();// stale when !motherPresent, so read it only when motherPresent
 			if (motherPresent) {
 				// To Mother
-				float *messagesToMother = (float*)leftExpander.module->rightExpander.producerMessage;
+				float *messagesToMother = toMother.message;
 				int i = 0;
 				for (; i < GATECV_INPUT; i++) {
 					messagesToMother[i] = (inputs[i].isConnected() ? inputs[i].getVoltage() : std::numeric_limits<float>::quiet_NaN());
@@ -81,10 +81,16 @@ struct FoundryExpander : Module {
 				}
 				messagesToMother[i++] = params[SYNC_SEQCV_PARAM].getValue();
 				messagesToMother[i++] = params[WRITEMODE_PARAM].getValue();
-				leftExpander.module->rightExpander.messageFlipRequested = true;
+				toMother.sendLeft(this);
 
 				// From Mother
-				panelTheme = clamp((int)(messagesFromMother[0] + 0.5f), 0, 1);
+				if (fromMother.receive()) {
+					panelTheme = clamp((int)(messagesFromMother[0] + 0.5f), 0, 1);
+				}
+			}
+			else {
+				fromMother.reset();
+				toMother.reset();
 			}		
 
 			// From Mother
@@ -180,8 +186,7 @@ struct FoundryExpanderWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((FoundryExpander*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((FoundryExpander*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((FoundryExpander*)module)->panelTheme);
 		}
 		Widget::step();
 	}
@@ -6,11 +6,12 @@
 #include "FoundrySequencer.hpp"
 
 
-void Sequencer::construct(bool* _holdTiedNotesPtr, int* _velocityModePtr, int* _stopAtEndOfSongPtr) {// don't want regaular constructor mechanism
+void Sequencer::construct(bool* _holdTiedNotesPtr, int* _velocityModePtr, int* _stopAtEndOfSongPtr, RefreshCounter* _refreshPtr, ModuleRandom* _rngPtr) {// don't want regaular constructor mechanism
 	velocityModePtr = _velocityModePtr;
-	sek[0].construct(0, nullptr, _holdTiedNotesPtr, _stopAtEndOfSongPtr);
+	refreshPtr = _refreshPtr;
+	sek[0].construct(0, nullptr, _holdTiedNotesPtr, _stopAtEndOfSongPtr, _rngPtr);
 	for (int trkn = 1; trkn < NUM_TRACKS; trkn++)
-		sek[trkn].construct(trkn, &sek[0], _holdTiedNotesPtr, _stopAtEndOfSongPtr);
+		sek[trkn].construct(trkn, &sek[0], _holdTiedNotesPtr, _stopAtEndOfSongPtr, _rngPtr);
 }
 
 
@@ -152,7 +153,7 @@ bool Sequencer::setGateType(int keyn, int multiSteps, float sampleRate, bool aut
 	if (autostepClick){ // if right-click then move to next step
 		moveStepIndexEdit(1, false);
 		editingGateKeyLight = keyn;
-		editingType = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+		editingType = (unsigned long) (gateTime * sampleRate / refreshPtr->displayRefreshStepSkips);
 		if ( ((APP->window->getMods() & RACK_MOD_MASK) == RACK_MOD_CTRL) && multiSteps < 2 )
 			setGateType(keyn, 1, sampleRate, false, multiTracks);
 	}
@@ -282,7 +283,7 @@ void Sequencer::writeCV(int trkn, float cvVal, int multiStepsCount, float sample
 	sek[trkn].writeCV(stepIndexEdit, cvVal, multiStepsCount);
 	editingGateCV[trkn] = cvVal;
 	editingGateCV2[trkn] = sek[trkn].getAttribute(stepIndexEdit).getVelocityVal();
-	editingGate[trkn] = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+	editingGate[trkn] = (unsigned long) (gateTime * sampleRate / refreshPtr->displayRefreshStepSkips);
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
 			if (i == trkn) continue;
@@ -309,7 +310,7 @@ bool Sequencer::applyNewOctave(int octn, int multiSteps, float sampleRate, bool
 		return true;
 	editingGateCV[trackIndexEdit] = sek[trackIndexEdit].applyNewOctave(stepIndexEdit, octn, multiSteps);
 	editingGateCV2[trackIndexEdit] = stepAttrib.getVelocityVal();
-	editingGate[trackIndexEdit] = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+	editingGate[trackIndexEdit] = (unsigned long) (gateTime * sampleRate / refreshPtr->displayRefreshStepSkips);
 	editingGateKeyLight = -1;
 	if (multiTracks) {
 		for (int i = 0; i < NUM_TRACKS; i++) {
@@ -331,7 +332,7 @@ bool Sequencer::applyNewKey(int keyn, int multiSteps, float sampleRate, bool aut
 	else {
 		editingGateCV[trackIndexEdit] = sek[trackIndexEdit].applyNewKey(stepIndexEdit, keyn, multiSteps);
 		editingGateCV2[trackIndexEdit] = stepAttrib.getVelocityVal();
-		editingGate[trackIndexEdit] = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+		editingGate[trackIndexEdit] = (unsigned long) (gateTime * sampleRate / refreshPtr->displayRefreshStepSkips);
 		editingGateKeyLight = -1;
 		if (multiTracks) {
 			for (int i = 0; i < NUM_TRACKS; i++) {
@@ -355,7 +356,7 @@ void Sequencer::moveStepIndexEditWithEditingGate(int delta, bool writeTrig, floa
 		StepAttributes stepAttrib = sek[trkn].getAttribute(stepIndexEdit);
 		if (!stepAttrib.getTied()) {// play if non-tied step
 			if (!writeTrig) {// in case autostep when simultaneous writeCV and stepCV (keep what was done in Write Input block above)
-				editingGate[trkn] = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+				editingGate[trkn] = (unsigned long) (gateTime * sampleRate / refreshPtr->displayRefreshStepSkips);
 				editingGateCV[trkn] = sek[trkn].getCV(stepIndexEdit);
 				editingGateCV2[trkn] = stepAttrib.getVelocityVal();
 				editingGateKeyLight = -1;
@@ -569,3 +570,60 @@ bool Sequencer::clockStep(int trkn, bool editingSequence) {// returns true to si
 	}
 	return false;
 }
+
+
+void Sequencer::calcNextSteps(bool editingSequence, int* clkInSources) {
+	// tracks that share a clock input are stepped in track order on the same edge, so each one draws from the generator
+	//   where the one before it on that clock leaves it
+	for (int trkn = 0; trkn < NUM_TRACKS; trkn++) {
+		if (sek[trkn].isNextStepValid())
+			continue;
+		if (editingSequence && delayedSeqNumberRequest[trkn] >= 0)
+			continue;// left to the edge, since it changes seqIndexEdit, which the UI thread reads and writes
+		const uint32_t* rngState = nullptr;
+		for (int prev = trkn - 1; prev >= 0; prev--) {
+			if (clkInSources[prev] == clkInSources[trkn]) {
+				if (sek[prev].isNextStepValid())
+					rngState = sek[prev].getNextStepRngState();
+				break;
+			}
+		}
+		sek[trkn].calcNextStep(editingSequence, delayedSeqNumberRequest[trkn], rngState);
+	}
+}
+
+
+void Sequencer::calcOutputsSimd(simd::float_4& cvOut, simd::float_4& gateOut, simd::float_4& velOut, bool running, bool gateRunning, bool editingSequence, Trigger* clockTriggers, int* clkInSources, unsigned long gateTriggerLength) {
+	// one lane per track; the per-track state is gathered first (branchy), then the arithmetic is done for all tracks in one pass
+	float cv[NUM_TRACKS];
+	float slideDelta[NUM_TRACKS];
+	float slideRemain[NUM_TRACKS];
+	float gate[NUM_TRACKS];
+	float vel[NUM_TRACKS];
+	
+	for (int trkn = 0; trkn < NUM_TRACKS; trkn++) {
+		if (editingSequence && !running)
+			cv[trkn] = (editingGate[trkn] > 0ul) ? editingGateCV[trkn] : sek[trkn].getCV(stepIndexEdit);
+		else
+			cv[trkn] = sek[trkn].getCV(editingSequence);
+		if (editingSequence && !gateRunning)// velocity follows the edit step while gates are retriggered on reset, as the gates do
+			vel[trkn] = (float)((editingGate[trkn] > 0ul) ? editingGateCV2[trkn] : sek[trkn].getAttribute(stepIndexEdit).getVelocityVal());
+		else
+			vel[trkn] = (float)(sek[trkn].getAttribute(editingSequence).getVelocityVal());
+		slideDelta[trkn] = sek[trkn].getSlideCVdelta();
+		slideRemain[trkn] = sek[trkn].getSlideStepsRemain();
+		sek[trkn].decSlideStepsRemain();
+		if (gateRunning)
+			gate[trkn] = sek[trkn].calcGate(clockTriggers[clkInSources[trkn]], gateTriggerLength) ? 1.0f : 0.0f;
+		else
+			gate[trkn] = (editingGate[trkn] > 0ul) ? 1.0f : 0.0f;
+	}
+	
+	float velScale = (*velocityModePtr == 0 ? 10.0f / 200.0f : (*velocityModePtr == 1 ? 10.0f / 127.0f : 1.0f / 12.0f));
+	cvOut = simd::float_4::load(cv);
+	if (running) {
+		cvOut -= simd::float_4::load(slideDelta) * simd::float_4::load(slideRemain);
+	}
+	gateOut = simd::float_4::load(gate) * 10.0f;
+	velOut = simd::fmin(simd::float_4::load(vel) * velScale, 10.0f);
+}
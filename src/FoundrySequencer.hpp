@@ -32,6 +32,7 @@ class Sequencer {
 	
 	// No need to save, no reset
 	int* velocityModePtr;
+	RefreshCounter* refreshPtr;
 	float editingGateCV[NUM_TRACKS];// no need to initialize, this goes with editingGate (output this only when editingGate > 0)
 	int editingGateCV2[NUM_TRACKS];// no need to initialize, this goes with editingGate (output this only when editingGate > 0)
 	int editingGateKeyLight;// no need to initialize, this goes with editingGate (use this only when editingGate > 0)
@@ -39,7 +40,7 @@ class Sequencer {
 	
 	public: 
 	
-	void construct(bool* _holdTiedNotesPtr, int* _velocityModePtr, int* _stopAtEndOfSongPtr);
+	void construct(bool* _holdTiedNotesPtr, int* _velocityModePtr, int* _stopAtEndOfSongPtr, RefreshCounter* _refreshPtr, ModuleRandom* _rngPtr);
 
 	void onReset(bool editingSequence);
 	void resetNonJson(bool editingSequence, bool propagateInitRun);
@@ -89,7 +90,7 @@ class Sequencer {
 		stepIndexEdit = _stepIndexEdit;
 		StepAttributes stepAttrib = sek[trackIndexEdit].getAttribute(stepIndexEdit);
 		if (!stepAttrib.getTied()) {// play if non-tied step
-			editingGate[trackIndexEdit] = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+			editingGate[trackIndexEdit] = (unsigned long) (gateTime * sampleRate / refreshPtr->displayRefreshStepSkips);
 			editingGateCV[trackIndexEdit] = sek[trackIndexEdit].getCV(stepIndexEdit);
 			editingGateCV2[trackIndexEdit] = stepAttrib.getVelocityVal();
 			editingGateKeyLight = -1;
@@ -187,6 +188,8 @@ class Sequencer {
 		sek[trackIndexEdit].toggleTied(stepn, 1);// will clear other attribs if new state is on
 	}
 
+	// Scalar output calculations for one track, the reference for calcOutputsSimd() (see bench/FoundryOutputsBench.cpp);
+	//   Foundry uses these, since the vector pass measures slower for four tracks, unless built with FOUNDRY_SIMD_OUTPUTS defined
 	float calcCvOutputAndDecSlideStepsRemain(int trkn, bool running, bool editingSequence) {
 		float cvout = 0.0f;
 		if (editingSequence && !running)
@@ -196,9 +199,9 @@ class Sequencer {
 		sek[trkn].decSlideStepsRemain();
 		return cvout;
 	}
-	float calcGateOutput(int trkn, bool running, Trigger clockTrigger, float sampleRate) {
+	float calcGateOutput(int trkn, bool running, Trigger& clockTrigger, unsigned long gateTriggerLength) {
 		if (running) 
-			return (sek[trkn].calcGate(clockTrigger, sampleRate) ? 10.0f : 0.0f);
+			return (sek[trkn].calcGate(clockTrigger, gateTriggerLength) ? 10.0f : 0.0f);
 		return (editingGate[trkn] > 0ul) ? 10.0f : 0.0f;
 	}
 	float calcVelOutput(int trkn, bool running, bool editingSequence) {
@@ -217,9 +220,11 @@ class Sequencer {
 			velRet = velRet / 12.0f;
 		return std::min(velRet, 10.0f);
 	}
+	// CV, gate and velocity outputs of all tracks; gateRunning is false while gates are retriggered on reset
+	void calcOutputsSimd(simd::float_4& cvOut, simd::float_4& gateOut, simd::float_4& velOut, bool running, bool gateRunning, bool editingSequence, Trigger* clockTriggers, int* clkInSources, unsigned long gateTriggerLength);
 	float calcKeyLightWithEditing(int keyScanIndex, int keyLightIndex, float sampleRate) {
 		if (editingGate[trackIndexEdit] > 0ul && editingGateKeyLight != -1)
-			return (keyScanIndex == editingGateKeyLight ? ((float) editingGate[trackIndexEdit] / (float)(gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips)) : 0.0f);
+			return (keyScanIndex == editingGateKeyLight ? ((float) editingGate[trackIndexEdit] / (float)(gateTime * sampleRate / refreshPtr->displayRefreshStepSkips)) : 0.0f);
 		return (keyScanIndex == keyLightIndex ? 1.0f : 0.0f);
 	}
 	
@@ -249,6 +254,11 @@ class Sequencer {
 	};
 	
 	bool clockStep(int trkn, bool editingSequence);// returns true to signal that run should be turned off
+	void calcNextSteps(bool editingSequence, int* clkInSources);// between clocks, see SequencerKernel::calcNextStep()
+	void invalidateNextSteps() {
+		for (int trkn = 0; trkn < NUM_TRACKS; trkn++)
+			sek[trkn].invalidateNextStep();
+	}
 	
 	void process() {
 		for (int trkn = 0; trkn < NUM_TRACKS; trkn++)
@@ -9,24 +9,13 @@
 const std::string SequencerKernel::modeLabels[NUM_MODES] = {"FWD", "REV", "PPG", "PEN", "BRN", "RND", "TKA"};
 
 
-const uint64_t SequencerKernel::advGateHitMaskLow[NUM_GATES] = 
-{0x0000000000FFFFFF, 0x0000FFFF0000FFFF, 0x0000FFFFFFFFFFFF, 0x0000FFFF00000000, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 
-//				25%					TRI		  			50%					T23		  			75%					FUL		
- 0x000000000000FFFF, 0xFFFF000000FFFFFF, 0x0000FFFF00000000, 0xFFFF000000000000, 0x0000000000000000, 0};
-//  			TR1 				DUO		  			TR2 	     		D2		  			TR3  TRIG		
-const uint64_t SequencerKernel::advGateHitMaskHigh[NUM_GATES] = 
-{0x0000000000000000, 0x000000000000FFFF, 0x0000000000000000, 0x000000000000FFFF, 0x00000000000000FF, 0x00000000FFFFFFFF, 
-//				25%					TRI		  			50%					T23		  			75%					FUL		
- 0x0000000000000000, 0x00000000000000FF, 0x0000000000000000, 0x00000000000000FF, 0x000000000000FFFF, 0};
-//  			TR1 				DUO		  			TR2 	     		D2		  			TR3  TRIG		
-
-
-void SequencerKernel::construct(int _id, SequencerKernel *_masterKernel, bool* _holdTiedNotesPtr, int* _stopAtEndOfSongPtr) {// don't want regaular constructor mechanism
+void SequencerKernel::construct(int _id, SequencerKernel *_masterKernel, bool* _holdTiedNotesPtr, int* _stopAtEndOfSongPtr, ModuleRandom* _rngPtr) {// don't want regaular constructor mechanism
 	id = _id;
 	ids = "id" + std::to_string(id) + "_";
 	masterKernel = _masterKernel;
 	holdTiedNotesPtr = _holdTiedNotesPtr;
 	stopAtEndOfSongPtr = _stopAtEndOfSongPtr;
+	rngPtr = _rngPtr;
 }
 
 
@@ -54,6 +43,7 @@ void SequencerKernel::onReset(bool editingSequence) {
 }
 void SequencerKernel::resetNonJson(bool editingSequence) {
 	clockPeriod = 0ul;
+	activePhrasesDirty = true;
 	initRun(editingSequence);
 }
 void SequencerKernel::initRun(bool editingSequence) {
@@ -65,15 +55,16 @@ void SequencerKernel::initRun(bool editingSequence) {
 	lastProbGateEnable = true;
 	calcGateCode(editingSequence);// uses stepIndexRun as the step and {phraseIndexRun or seqIndexEdit} to determine the seq
 	slideStepsRemain = 0ul;
+	nextStep.valid = false;
 }
 
 
 void SequencerKernel::onRandomize(bool editingSequence) {
 	// randomize sequence only
-	sequences[seqIndexEdit].randomize(MAX_STEPS, NUM_MODES);// code below uses lengths so this must be randomized first
+	sequences[seqIndexEdit].randomize(MAX_STEPS, NUM_MODES, *rngPtr);// code below uses lengths so this must be randomized first
 	for (int stepn = 0; stepn < MAX_STEPS; stepn++) {
-		cv[seqIndexEdit][stepn] = ((float)(random::u32() % 5)) + ((float)(random::u32() % 12)) / 12.0f - 2.0f;
-		attributes[seqIndexEdit][stepn].randomize();
+		cv[seqIndexEdit][stepn] = ((float)(rngPtr->u32() % 5)) + ((float)(rngPtr->u32() % 12)) / 12.0f - 2.0f;
+		attributes[seqIndexEdit][stepn].randomize(*rngPtr);
 	}
 	dirty[seqIndexEdit] = 1;
 	initRun(editingSequence);
@@ -353,11 +344,29 @@ void SequencerKernel::pasteSong(SongCPbuffer* songCPbuf, int startCP) {
 		songEndIndex = songCPbuf->endIndex;
 		runModeSong = songCPbuf->runModeSong;
 	}
+	activePhrasesDirty = true;
 }
 
 
-int SequencerKernel::clockStep(bool editingSequence, int delayedSeqNumberRequest) {// delayedSeqNumberRequest is only valid in seq mode (-1 means no request)
-	int phraseChangeOrStop = 0;//0 = nothing, 1 = phrase change, 2 = turn off run
+void SequencerKernel::calcNextStep(bool editingSequence, int delayedSeqNumberRequest, const uint32_t* rngState) {// delayedSeqNumberRequest is only valid in seq mode (-1 means no request)
+	// what the next clockStep() does to the run state, done on the live state and then undone; the generator draws are 
+	//   made on a copy, that starts from rngState (nullptr for the current state of the generator)
+	RunState liveRun;
+	saveRunState(&liveRun);
+	ModuleRandom* liveRngPtr = rngPtr;
+	ModuleRandom nextRng = *rngPtr;
+	if (rngState != nullptr)
+		nextRng.setState(rngState);
+	rngPtr = &nextRng;
+	nextRng.getState(nextStep.rngBefore);
+	nextStep.editingSequence = editingSequence;
+	nextStep.delayedSeqNumberRequest = delayedSeqNumberRequest;
+	if (masterKernel != nullptr) {
+		nextStep.masterStepIndexRun = masterKernel->getStepIndexRun();
+		nextStep.masterPhraseIndexRun = masterKernel->getPhraseIndexRun();
+	}
+	nextStep.phraseChangeOrStop = 0;//0 = nothing, 1 = phrase change, 2 = turn off run
+	nextStep.newStep = false;
 	
 	if (ppqnLeftToSkip > 0) {
 		ppqnLeftToSkip--;
@@ -368,10 +377,11 @@ int SequencerKernel::clockStep(bool editingSequence, int delayedSeqNumberRequest
 		if (ppqnCount >= ppsFiltered)
 			ppqnCount = 0;
 		if (ppqnCount == 0) {
-			float slideFromCV = getCV(editingSequence);
+			nextStep.newStep = true;
+			nextStep.slideFromCV = getCV(editingSequence);
 			int oldStepIndexRun = stepIndexRun;
 			if (moveStepIndexRun(false, editingSequence)) {// false means normal (not init)
-				phraseChangeOrStop = 1;// used by first track for random slaving, and also by all tracks for delayed Seq CV request
+				nextStep.phraseChangeOrStop = 1;// used by first track for random slaving, and also by all tracks for delayed Seq CV request
 				if (editingSequence) {
 					if (delayedSeqNumberRequest >= 0) {
 						seqIndexEdit = delayedSeqNumberRequest;
@@ -379,7 +389,7 @@ int SequencerKernel::clockStep(bool editingSequence, int delayedSeqNumberRequest
 					}
 					// check for end of seq if needed
 					// if (id == *stopAtEndOfSongPtr) {
-						// phraseChangeOrStop = 2;
+						// nextStep.phraseChangeOrStop = 2;
 						// stepIndexRun = oldStepIndexRun;
 					// }
 				}
@@ -388,7 +398,7 @@ int SequencerKernel::clockStep(bool editingSequence, int delayedSeqNumberRequest
 					bool songLoopOver = movePhraseIndexRun(false);// false means normal (not init)
 					// check for end of song if needed
 					if (songLoopOver && (id == *stopAtEndOfSongPtr)) {
-						phraseChangeOrStop = 2;
+						nextStep.phraseChangeOrStop = 2;
 						stepIndexRun = oldStepIndexRun;
 						phraseIndexRun = oldPhraseIndexRun;
 					}
@@ -397,24 +407,71 @@ int SequencerKernel::clockStep(bool editingSequence, int delayedSeqNumberRequest
 					}
 				}
 			}
-
-			// Slide
-			StepAttributes attribRun = getAttribute(editingSequence);
-			if (attribRun.getSlide()) {
-				slideStepsRemain = (unsigned long) (((float)clockPeriod * ppsFiltered) * ((float)attribRun.getSlideVal() / 100.0f));
-				if (slideStepsRemain != 0ul) {
-					float slideToCV = getCV(editingSequence);
-					slideCVdelta = (slideToCV - slideFromCV)/(float)slideStepsRemain;
-				}
-			}
-			else
-				slideStepsRemain = 0ul;
 		}// if (ppqnCount == 0)
 		calcGateCode(editingSequence);// uses stepIndexRun as the step and {phraseIndexRun or seqIndexEdit} to determine the seq
 	}
+	
+	saveRunState(&nextStep.run);
+	nextRng.getState(nextStep.rngAfter);
+	rngPtr = liveRngPtr;
+	loadRunState(liveRun);
+	nextStep.valid = true;
+}
+
+
+int SequencerKernel::clockStep(bool editingSequence, int delayedSeqNumberRequest) {// delayedSeqNumberRequest is only valid in seq mode (-1 means no request)
+	// commits nextStep, computed now when it is missing or stale
+	bool stale = !nextStep.valid || nextStep.editingSequence != editingSequence || nextStep.delayedSeqNumberRequest != delayedSeqNumberRequest || !rngPtr->hasState(nextStep.rngBefore);
+	if (masterKernel != nullptr)
+		stale |= (masterKernel->getStepIndexRun() != nextStep.masterStepIndexRun || masterKernel->getPhraseIndexRun() != nextStep.masterPhraseIndexRun);
+	if (stale)
+		calcNextStep(editingSequence, delayedSeqNumberRequest, nullptr);
+	
+	loadRunState(nextStep.run);
+	rngPtr->setState(nextStep.rngAfter);
+	if (nextStep.newStep) {
+		// Slide
+		StepAttributes attribRun = getAttribute(editingSequence);
+		if (attribRun.getSlide()) {
+			slideStepsRemain = (unsigned long) (((float)clockPeriod * getPulsesPerStep()) * ((float)attribRun.getSlideVal() / 100.0f));
+			if (slideStepsRemain != 0ul) {
+				float slideToCV = getCV(editingSequence);
+				slideCVdelta = (slideToCV - nextStep.slideFromCV)/(float)slideStepsRemain;
+			}
+		}
+		else
+			slideStepsRemain = 0ul;
+	}
 	clockPeriod = 0ul;
+	nextStep.valid = false;
 	
-	return phraseChangeOrStop;
+	return nextStep.phraseChangeOrStop;
+}
+
+
+void SequencerKernel::saveRunState(RunState* dest) {
+	dest->seqIndexEdit = seqIndexEdit;
+	dest->phraseIndexRun = phraseIndexRun;
+	dest->phraseIndexRunHistory = phraseIndexRunHistory;
+	dest->moveStepIndexRunIgnore = moveStepIndexRunIgnore;
+	dest->stepIndexRun = stepIndexRun;
+	dest->stepIndexRunHistory = stepIndexRunHistory;
+	dest->ppqnCount = ppqnCount;
+	dest->ppqnLeftToSkip = ppqnLeftToSkip;
+	dest->gateCode = gateCode;
+	dest->lastProbGateEnable = lastProbGateEnable;
+}
+void SequencerKernel::loadRunState(const RunState& src) {
+	seqIndexEdit = src.seqIndexEdit;
+	phraseIndexRun = src.phraseIndexRun;
+	phraseIndexRunHistory = src.phraseIndexRunHistory;
+	moveStepIndexRunIgnore = src.moveStepIndexRunIgnore;
+	stepIndexRun = src.stepIndexRun;
+	stepIndexRunHistory = src.stepIndexRunHistory;
+	ppqnCount = src.ppqnCount;
+	ppqnLeftToSkip = src.ppqnLeftToSkip;
+	gateCode = src.gateCode;
+	lastProbGateEnable = src.lastProbGateEnable;
 }
 
 
@@ -565,7 +622,7 @@ void SequencerKernel::calcGateCode(bool editingSequence) {
 	
 	// calc: ** lastProbGateEnable ** decision only when first ppqn of a non-tied step
 	if (ppqnCount == 0 && !attribute.getTied()) {
-		lastProbGateEnable = !attribute.getGateP() || (random::uniform() < ((float)attribute.getGatePVal() / 100.0f));// random::uniform is [0.0, 1.0), see include/util/common.hpp
+		lastProbGateEnable = !attribute.getGateP() || (rngPtr->uniform() < ((float)attribute.getGatePVal() / 100.0f));
 	}
 	
 	// calc: ** gateType ** 
@@ -580,11 +637,7 @@ void SequencerKernel::calcGateCode(bool editingSequence) {
 			gateCode = (ppqnCount == 0 ? 3 : 0);// trig on first ppqnCount
 		}
 		else {
-			uint64_t shiftAmt = ppqnCount * (96 / ppsFiltered);
-			if (shiftAmt >= 64)
-				gateCode = (int)((advGateHitMaskHigh[gateType] >> (shiftAmt - (uint64_t)64)) & (uint64_t)0x1);
-			else
-				gateCode = (int)((advGateHitMaskLow[gateType] >> shiftAmt) & (uint64_t)0x1);
+			gateCode = advGatePatterns[gateType].isHit(ppqnCount, ppsFiltered);
 		}
 	}
 }
@@ -691,7 +744,7 @@ bool SequencerKernel::moveStepIndexRun(bool init, bool editingSequence) {
 			if (init)
 				stepIndexRun = 0;
 			else {
-				stepIndexRun += (random::u32() % 3) - 1;
+				stepIndexRun += (rngPtr->u32() % 3) - 1;
 				if (stepIndexRun > endStep)
 					stepIndexRun = 0;
 				if (stepIndexRun < 0)
@@ -708,7 +761,7 @@ bool SequencerKernel::moveStepIndexRun(bool init, bool editingSequence) {
 			if (init)
 				stepIndexRun = 0;
 			else {
-				stepIndexRun = (random::u32() % (endStep + 1));
+				stepIndexRun = (rngPtr->u32() % (endStep + 1));
 				stepIndexRunHistory--;
 				if (stepIndexRunHistory <= 0x6000)
 					crossBoundary = true;
@@ -742,22 +795,53 @@ bool SequencerKernel::moveStepIndexRun(bool init, bool editingSequence) {
 }
 
 
+void SequencerKernel::updateActivePhrases() {
+	// rebuilds the list of non 0-rep phrases in the song, so that phrase moves don't have to scan the song
+	// flag is cleared before the rebuild, so that an edit made during the rebuild will trigger another one
+	activePhrasesDirty = false;
+	numActivePhrases = 0;
+	for (int phrn = 0; phrn <= MAX_PHRASES; phrn++) {
+		activePhrasesBefore[phrn] = numActivePhrases;
+		if (phrn >= songBeginIndex && phrn <= songEndIndex && phrn < MAX_PHRASES && phrases[phrn].getReps() != 0) {
+			activePhrases[numActivePhrases] = phrn;
+			numActivePhrases++;
+		}
+	}
+}
+
+
+int SequencerKernel::firstActivePhraseFrom(int phrn) {// returns -1 if no non 0-rep phrase in [phrn : songEndIndex]
+	int api = activePhrasesBefore[clamp(phrn, 0, MAX_PHRASES)];
+	return (api < numActivePhrases ? activePhrases[api] : -1);
+}
+
+
+int SequencerKernel::lastActivePhraseUpTo(int phrn) {// returns -1 if no non 0-rep phrase in [songBeginIndex : phrn]
+	int api = activePhrasesBefore[clamp(phrn + 1, 0, MAX_PHRASES)] - 1;
+	return (api >= 0 ? activePhrases[api] : -1);
+}
+
+
 bool SequencerKernel::movePhraseIndexBackward(bool init, bool rollover) {
 	int phrn = 0;
 	bool crossBoundary = false;
 
 	// search backward for next non 0-rep seq, ends up in same phrase if all reps in the song are 0
+	if (activePhrasesDirty)
+		updateActivePhrases();
 	if (init) {
 		phraseIndexRun = songEndIndex;
 		phrn = phraseIndexRun;
 	}
 	else
 		phrn = std::min(phraseIndexRun - 1, songEndIndex);// handle song jumped
-	for (; phrn >= songBeginIndex && phrases[phrn].getReps() == 0; phrn--);
-	if (phrn < songBeginIndex) {
+	phrn = lastActivePhraseUpTo(phrn);
+	if (phrn == -1) {
 		crossBoundary = true;
-		if (rollover)
-			for (phrn = songEndIndex; phrn > phraseIndexRun && phrases[phrn].getReps() == 0; phrn--);
+		if (rollover && numActivePhrases > 0 && activePhrases[numActivePhrases - 1] > phraseIndexRun)
+			phrn = activePhrases[numActivePhrases - 1];
+		else if (rollover)
+			phrn = std::min(phraseIndexRun, songEndIndex);
 		else
 			phrn = phraseIndexRun;
 		phraseIndexRunHistory--;
@@ -772,17 +856,21 @@ bool SequencerKernel::movePhraseIndexForeward(bool init, bool rollover) {
 	bool crossBoundary = false;
 	
 	// search fowrard for next non 0-rep seq, ends up in same phrase if all reps in the song are 0
+	if (activePhrasesDirty)
+		updateActivePhrases();
 	if (init) {
 		phraseIndexRun = songBeginIndex;
 		phrn = phraseIndexRun;
 	}
 	else
 		phrn = std::max(phraseIndexRun + 1, songBeginIndex);// handle song jumped
-	for (; phrn <= songEndIndex && phrases[phrn].getReps() == 0; phrn++);
-	if (phrn > songEndIndex) {
+	phrn = firstActivePhraseFrom(phrn);
+	if (phrn == -1) {
 		crossBoundary = true;
-		if (rollover)
-			for (phrn = songBeginIndex; phrn < phraseIndexRun && phrases[phrn].getReps() == 0; phrn++);
+		if (rollover && numActivePhrases > 0 && activePhrases[0] < phraseIndexRun)
+			phrn = activePhrases[0];
+		else if (rollover)
+			phrn = std::max(phraseIndexRun, songBeginIndex);
 		else
 			phrn = phraseIndexRun;
 		phraseIndexRunHistory--;
@@ -793,22 +881,16 @@ bool SequencerKernel::movePhraseIndexForeward(bool init, bool rollover) {
 
 
 void SequencerKernel::movePhraseIndexRandom(bool init, uint32_t randomValue) {
-	int phrn = songBeginIndex;
-	int tpi = 0;
-	
-	for (;phrn <= songEndIndex; phrn++) {
-		if (phrases[phrn].getReps() != 0) {
-			tempPhraseIndexes[tpi] = phrn;
-			tpi++;
-			if (init) break;
-		}
+	if (activePhrasesDirty)
+		updateActivePhrases();
+	if (numActivePhrases == 0) {
+		phraseIndexRun = songBeginIndex;
 	}
-	
-	if (init) {
-		phraseIndexRun = (tpi == 0 ? songBeginIndex : tempPhraseIndexes[0]);
+	else if (init) {
+		phraseIndexRun = activePhrases[0];
 	}
 	else {
-		phraseIndexRun = tempPhraseIndexes[randomValue % tpi];
+		phraseIndexRun = activePhrases[randomValue % numActivePhrases];
 	}
 }
 
@@ -875,12 +957,12 @@ bool SequencerKernel::movePhraseIndexRun(bool init) {
 		
 		case MODE_BRN :// brownian random; history base is 0x5000
 			phraseIndexRunHistory = 0x5000;
-			movePhraseIndexBrownian(init, random::u32());// no crossBoundary
+			movePhraseIndexBrownian(init, rngPtr->u32());// no crossBoundary
 		break;
 		
 		case MODE_RND :// random; history base is 0x6000
 			phraseIndexRunHistory = 0x6000;
-			movePhraseIndexRandom(init, random::u32());// no crossBoundary
+			movePhraseIndexRandom(init, rngPtr->u32());// no crossBoundary
 		break;
 		
 		case MODE_TKA:// use track A's phraseIndexRun; base is 0x7000
@@ -5,32 +5,33 @@
 #pragma once
 
 #include "ImpromptuModular.hpp"
+#include "GatePatterns.hpp"
 
 
 class StepAttributes {
-	unsigned long attributes;
+	uint32_t attributes;
 	
 	public:
 
-	static const unsigned long ATT_MSK_GATE =      0x01000000, gateShift = 24;
-	static const unsigned long ATT_MSK_GATEP =     0x02000000;
-	static const unsigned long ATT_MSK_SLIDE =     0x04000000;
-	static const unsigned long ATT_MSK_TIED =      0x08000000;
-	static const unsigned long ATT_MSK_GATETYPE =  0xF0000000, gateTypeShift = 28;
-	static const unsigned long ATT_MSK_VELOCITY =  0x000000FF, velocityShift = 0;
-	static const unsigned long ATT_MSK_GATEP_VAL = 0x0000FF00, gatePValShift = 8;
-	static const unsigned long ATT_MSK_SLIDE_VAL = 0x00FF0000, slideValShift = 16;
+	static const uint32_t ATT_MSK_GATE =      0x01000000, gateShift = 24;
+	static const uint32_t ATT_MSK_GATEP =     0x02000000;
+	static const uint32_t ATT_MSK_SLIDE =     0x04000000;
+	static const uint32_t ATT_MSK_TIED =      0x08000000;
+	static const uint32_t ATT_MSK_GATETYPE =  0xF0000000, gateTypeShift = 28;
+	static const uint32_t ATT_MSK_VELOCITY =  0x000000FF, velocityShift = 0;
+	static const uint32_t ATT_MSK_GATEP_VAL = 0x0000FF00, gatePValShift = 8;
+	static const uint32_t ATT_MSK_SLIDE_VAL = 0x00FF0000, slideValShift = 16;
 
 	static const int INIT_VELOCITY = 100;
 	static const int MAX_VELOCITY = 200;
 	static const int INIT_PROB = 50;// range is 0 to 100
 	static const int INIT_SLIDE = 10;// range is 0 to 100
 	
-	static const unsigned long ATT_MSK_INITSTATE = ((ATT_MSK_GATE) | (INIT_VELOCITY << velocityShift) | (INIT_PROB << gatePValShift) | (INIT_SLIDE << slideValShift));
+	static const uint32_t ATT_MSK_INITSTATE = ((ATT_MSK_GATE) | (INIT_VELOCITY << velocityShift) | (INIT_PROB << gatePValShift) | (INIT_SLIDE << slideValShift));
 
-	void clear() {attributes = 0ul;}
+	void clear() {attributes = 0u;}
 	void init() {attributes = ATT_MSK_INITSTATE;}
-	void randomize() {attributes = ( (random::u32() & (ATT_MSK_GATE | ATT_MSK_GATEP | ATT_MSK_SLIDE /*| ATT_MSK_TIED*/)) | ((random::u32() % 101) << gatePValShift) | ((random::u32() % 101) << slideValShift) | (random::u32() % (MAX_VELOCITY + 1)) ) ;}
+	void randomize(ModuleRandom& rng) {attributes = ( (rng.u32() & (ATT_MSK_GATE | ATT_MSK_GATEP | ATT_MSK_SLIDE /*| ATT_MSK_TIED*/)) | ((rng.u32() % 101) << gatePValShift) | ((rng.u32() % 101) << slideValShift) | (rng.u32() % (MAX_VELOCITY + 1)) ) ;}
 	
 	bool getGate() {return (attributes & ATT_MSK_GATE) != 0;}
 	int getGateType() {return (int)((attributes & ATT_MSK_GATETYPE) >> gateTypeShift);}
@@ -40,10 +41,10 @@ class StepAttributes {
 	bool getSlide() {return (attributes & ATT_MSK_SLIDE) != 0;}
 	int getSlideVal() {return (int)((attributes & ATT_MSK_SLIDE_VAL) >> slideValShift);}
 	int getVelocityVal() {return (int)((attributes & ATT_MSK_VELOCITY) >> velocityShift);}
-	unsigned long getAttribute() {return attributes;}
+	uint32_t getAttribute() {return attributes;}
 
 	void setGate(bool gate1State) {attributes &= ~ATT_MSK_GATE; if (gate1State) attributes |= ATT_MSK_GATE;}
-	void setGateType(int gateType) {attributes &= ~ATT_MSK_GATETYPE; attributes |= (((unsigned long)gateType) << gateTypeShift);}
+	void setGateType(int gateType) {attributes &= ~ATT_MSK_GATETYPE; attributes |= (((uint32_t)gateType) << gateTypeShift);}
 	void setTied(bool tiedState) {
 		attributes &= ~ATT_MSK_TIED; 
 		if (tiedState) {
@@ -52,11 +53,11 @@ class StepAttributes {
 		}
 	}
 	void setGateP(bool GatePState) {attributes &= ~ATT_MSK_GATEP; if (GatePState) attributes |= ATT_MSK_GATEP;}
-	void setGatePVal(int gatePval) {attributes &= ~ATT_MSK_GATEP_VAL; attributes |= (((unsigned long)gatePval) << gatePValShift);}
+	void setGatePVal(int gatePval) {attributes &= ~ATT_MSK_GATEP_VAL; attributes |= (((uint32_t)gatePval) << gatePValShift);}
 	void setSlide(bool slideState) {attributes &= ~ATT_MSK_SLIDE; if (slideState) attributes |= ATT_MSK_SLIDE;}
-	void setSlideVal(int slideVal) {attributes &= ~ATT_MSK_SLIDE_VAL; attributes |= (((unsigned long)slideVal) << slideValShift);}
-	void setVelocityVal(int _velocity) {attributes &= ~ATT_MSK_VELOCITY; attributes |= (((unsigned long)_velocity) << velocityShift);}
-	void setAttribute(unsigned long _attributes) {attributes = _attributes;}
+	void setSlideVal(int slideVal) {attributes &= ~ATT_MSK_SLIDE_VAL; attributes |= (((uint32_t)slideVal) << slideValShift);}
+	void setVelocityVal(int _velocity) {attributes &= ~ATT_MSK_VELOCITY; attributes |= (((uint32_t)_velocity) << velocityShift);}
+	void setAttribute(uint32_t _attributes) {attributes = _attributes;}
 };// class StepAttributes
 
 
@@ -65,23 +66,23 @@ class StepAttributes {
 
 class Phrase {
 	// a phrase is a sequence number and a number of repetitions; it is used to make a song
-	unsigned long phrase;
+	uint32_t phrase;
 	
 	public:
 
-	static const unsigned long PHR_MSK_SEQNUM = 0x00FF;
-	static const unsigned long PHR_MSK_REPS =   0xFF00, repShift = 8;// a rep is 0 to 99
+	static const uint32_t PHR_MSK_SEQNUM = 0x00FF;
+	static const uint32_t PHR_MSK_REPS =   0xFF00, repShift = 8;// a rep is 0 to 99
 	
 	void init() {phrase = (1 << repShift);}
-	void randomize(int maxSeqs) {phrase = ((random::u32() % maxSeqs) | ((random::u32() % 4 + 1) << repShift));}
+	void randomize(int maxSeqs, ModuleRandom& rng) {phrase = ((rng.u32() % maxSeqs) | ((rng.u32() % 4 + 1) << repShift));}
 	
 	int getSeqNum() {return (int)(phrase & PHR_MSK_SEQNUM);}
 	int getReps() {return (int)((phrase & PHR_MSK_REPS) >> repShift);}
-	unsigned long getPhraseJson() {return phrase - (1 << repShift);}// compression trick (store 0 instead of 1)
+	uint32_t getPhraseJson() {return phrase - (1 << repShift);}// compression trick (store 0 instead of 1)
 	
-	void setSeqNum(int seqn) {phrase &= ~PHR_MSK_SEQNUM; phrase |= ((unsigned long)seqn);}
-	void setReps(int _reps) {phrase &= ~PHR_MSK_REPS; phrase |= (((unsigned long)_reps) << repShift);}
-	void setPhraseJson(unsigned long _phrase) {phrase = (_phrase + (1 << repShift));}// compression trick (store 0 instead of 1)
+	void setSeqNum(int seqn) {phrase &= ~PHR_MSK_SEQNUM; phrase |= ((uint32_t)seqn);}
+	void setReps(int _reps) {phrase &= ~PHR_MSK_REPS; phrase |= (((uint32_t)_reps) << repShift);}
+	void setPhraseJson(uint32_t _phrase) {phrase = (_phrase + (1 << repShift));}// compression trick (store 0 instead of 1)
 };// class Phrase
 
 
@@ -89,19 +90,19 @@ class Phrase {
 
 
 class SeqAttributes {
-	unsigned long attributes;
+	uint32_t attributes;
 	
 	public:
 
-	static const unsigned long SEQ_MSK_LENGTH  =   0x000000FF;// number of steps in each sequence, min value is 1
-	static const unsigned long SEQ_MSK_RUNMODE =   0x0000FF00, runModeShift = 8;
-	static const unsigned long SEQ_MSK_TRANSPOSE = 0x007F0000, transposeShift = 16;
-	static const unsigned long SEQ_MSK_TRANSIGN =  0x00800000;// manually implement sign bit
-	static const unsigned long SEQ_MSK_ROTATE =    0x7F000000, rotateShift = 24;
-	static const unsigned long SEQ_MSK_ROTSIGN =   0x80000000;// manually implement sign bit (+ is right, - is left)
+	static const uint32_t SEQ_MSK_LENGTH  =   0x000000FF;// number of steps in each sequence, min value is 1
+	static const uint32_t SEQ_MSK_RUNMODE =   0x0000FF00, runModeShift = 8;
+	static const uint32_t SEQ_MSK_TRANSPOSE = 0x007F0000, transposeShift = 16;
+	static const uint32_t SEQ_MSK_TRANSIGN =  0x00800000;// manually implement sign bit
+	static const uint32_t SEQ_MSK_ROTATE =    0x7F000000, rotateShift = 24;
+	static const uint32_t SEQ_MSK_ROTSIGN =   0x80000000;// manually implement sign bit (+ is right, - is left)
 	
-	void init(int length, int runMode) {attributes = ((length) | (((unsigned long)runMode) << runModeShift));}
-	void randomize(int maxSteps, int numModes) {attributes = ( (2 + (random::u32() % (maxSteps - 1))) | (((unsigned long)(random::u32() % numModes) << runModeShift)) );}
+	void init(int length, int runMode) {attributes = ((length) | (((uint32_t)runMode) << runModeShift));}
+	void randomize(int maxSteps, int numModes, ModuleRandom& rng) {attributes = ( (2 + (rng.u32() % (maxSteps - 1))) | (((uint32_t)(rng.u32() % numModes) << runModeShift)) );}
 	
 	int getLength() {return (int)(attributes & SEQ_MSK_LENGTH);}
 	int getRunMode() {return (int)((attributes & SEQ_MSK_RUNMODE) >> runModeShift);}
@@ -117,23 +118,23 @@ class SeqAttributes {
 			ret *= -1;
 		return ret;
 	}
-	unsigned long getSeqAttrib() {return attributes;}
+	uint32_t getSeqAttrib() {return attributes;}
 	
-	void setLength(int length) {attributes &= ~SEQ_MSK_LENGTH; attributes |= ((unsigned long)length);}
-	void setRunMode(int runMode) {attributes &= ~SEQ_MSK_RUNMODE; attributes |= (((unsigned long)runMode) << runModeShift);}
+	void setLength(int length) {attributes &= ~SEQ_MSK_LENGTH; attributes |= ((uint32_t)length);}
+	void setRunMode(int runMode) {attributes &= ~SEQ_MSK_RUNMODE; attributes |= (((uint32_t)runMode) << runModeShift);}
 	void setTranspose(int transp) {
 		attributes &= ~ (SEQ_MSK_TRANSPOSE | SEQ_MSK_TRANSIGN); 
-		attributes |= (((unsigned long)abs(transp)) << transposeShift);
+		attributes |= (((uint32_t)abs(transp)) << transposeShift);
 		if (transp < 0) 
 			attributes |= SEQ_MSK_TRANSIGN;
 	}
 	void setRotate(int rotn) {
 		attributes &= ~ (SEQ_MSK_ROTATE | SEQ_MSK_ROTSIGN); 
-		attributes |= (((unsigned long)abs(rotn)) << rotateShift);
+		attributes |= (((uint32_t)abs(rotn)) << rotateShift);
 		if (rotn < 0) 
 			attributes |= SEQ_MSK_ROTSIGN;
 	}
-	void setSeqAttrib(unsigned long _attributes) {attributes = _attributes;}
+	void setSeqAttrib(uint32_t _attributes) {attributes = _attributes;}
 };// class SeqAttributes
 
 
@@ -161,13 +162,43 @@ class SequencerKernel {
 	private:
 	
 	// Gate types
-	static const int NUM_GATES = 12;	
-	static const uint64_t advGateHitMaskLow[NUM_GATES];		
-	static const uint64_t advGateHitMaskHigh[NUM_GATES];
+	static const int NUM_GATES = NUM_ADV_GATES;// see GatePatterns.hpp
 
 	// Constants
 	static constexpr float INIT_CV = 0.0f;
 
+	// Part of the state that a clock step changes
+	struct RunState {
+		int seqIndexEdit;// changed by a delayed seq number request
+		int phraseIndexRun;
+		unsigned long phraseIndexRunHistory;
+		bool moveStepIndexRunIgnore;
+		int stepIndexRun;
+		unsigned long stepIndexRunHistory;
+		int ppqnCount;
+		int ppqnLeftToSkip;
+		int gateCode;
+		bool lastProbGateEnable;
+	};
+	
+	// Run state after the next clock step, computed between clocks by calcNextStep() so that clockStep() only has to 
+	//   commit it; dropped on reset and on every user input scan of Foundry, and computed again on the edge when the 
+	//   generator was drawn from, or track A moved (TKA), since then. The slide depends on the clock period so it is 
+	//   done on the edge.
+	struct NextStep {
+		bool valid = false;
+		bool editingSequence;
+		int delayedSeqNumberRequest;
+		int masterStepIndexRun;// track A's when computed, read by the TKA run mode
+		int masterPhraseIndexRun;
+		uint32_t rngBefore[4];// generator state when computed
+		uint32_t rngAfter[4];
+		RunState run;
+		int phraseChangeOrStop;
+		bool newStep;// false when in a ppqn or delay pulse
+		float slideFromCV;
+	};
+
 	
 	// Need to save, with reset
 	int pulsesPerStep;// stored range is [1:49] so must ALWAYS read thgouth getPulsesPerStep(). Must do this because of knob
@@ -195,6 +226,11 @@ class SequencerKernel {
 	bool lastProbGateEnable;// true means gate calc as normal, false means last prob says turn gate off (used by current and consecutive tied steps)
 	unsigned long slideStepsRemain;// 0 when no slide under way, downward step counter when sliding
 	float slideCVdelta;// no need to initialize, this is only used when slideStepsRemain is not 0
+	std::atomic<bool> activePhrasesDirty;// set when reps or song begin/end change (UI thread), the lists below are then rebuilt on the next phrase move (audio thread)
+	int activePhrases[MAX_PHRASES];// indexes of the non 0-rep phrases in [songBeginIndex : songEndIndex], in order
+	int numActivePhrases;
+	int activePhrasesBefore[MAX_PHRASES + 1];// number of entries of activePhrases that are less than the index
+	NextStep nextStep;
 	
 	// No need to save, no reset
 	int id;
@@ -202,12 +238,13 @@ class SequencerKernel {
 	SequencerKernel *masterKernel;// nullprt for track 0, used for grouped run modes (tracks B,C,D follow A when random, for example)
 	bool* holdTiedNotesPtr;
 	int* stopAtEndOfSongPtr;
+	ModuleRandom* rngPtr;
 	
 	
 	
 	public: 
 	
-	void construct(int _id, SequencerKernel *_masterKernel, bool* _holdTiedNotesPtr, int* _stopAtEndOfSongPtr); // don't want regaular constructor mechanism
+	void construct(int _id, SequencerKernel *_masterKernel, bool* _holdTiedNotesPtr, int* _stopAtEndOfSongPtr, ModuleRandom* _rngPtr); // don't want regaular constructor mechanism
 
 	void onReset(bool editingSequence);
 	void resetNonJson(bool editingSequence);
@@ -249,14 +286,14 @@ class SequencerKernel {
 	}
 	
 	void setSeqIndexEdit(int _seqIndexEdit) {seqIndexEdit = _seqIndexEdit;}
-	void setPhraseIndexRun(int _phraseIndexRun) {phraseIndexRun = _phraseIndexRun;}
+	void setPhraseIndexRun(int _phraseIndexRun) {phraseIndexRun = _phraseIndexRun; nextStep.valid = false;}
 	void setPulsesPerStep(int _pps) {pulsesPerStep = _pps;}
 	void setDelay(int _delay) {delay = _delay;}
 	void setLength(int _length) {sequences[seqIndexEdit].setLength(_length);}
-	void setPhraseReps(int phrn, int _reps) {phrases[phrn].setReps(_reps);}
+	void setPhraseReps(int phrn, int _reps) {phrases[phrn].setReps(_reps); activePhrasesDirty = true;}
 	void setPhraseSeqNum(int phrn, int _seqn) {phrases[phrn].setSeqNum(_seqn);}
-	void setBegin(int phrn) {songBeginIndex = phrn; songEndIndex = std::max(phrn, songEndIndex);}
-	void setEnd(int phrn) {songEndIndex = phrn; songBeginIndex = std::min(phrn, songBeginIndex);}
+	void setBegin(int phrn) {songBeginIndex = phrn; songEndIndex = std::max(phrn, songEndIndex); activePhrasesDirty = true;}
+	void setEnd(int phrn) {songEndIndex = phrn; songBeginIndex = std::min(phrn, songBeginIndex); activePhrasesDirty = true;}
 	void setRunModeSong(int _runMode) {runModeSong = _runMode;}
 	void setRunModeSeq(int _runMode) {sequences[seqIndexEdit].setRunMode(_runMode);}
 	void setGate(int stepn, bool newGate, int count);
@@ -267,7 +304,7 @@ class SequencerKernel {
 	void setSlideVal(int stepn, int slideVal, int count);
 	void setVelocityVal(int stepn, int velocity, int count);
 	void setGateType(int stepn, int gateType, int count);
-	void setMoveStepIndexRunIgnore() {moveStepIndexRunIgnore = true;}
+	void setMoveStepIndexRunIgnore() {moveStepIndexRunIgnore = true; nextStep.valid = false;}
 	
 	int modRunModeSong(int delta) {
 		runModeSong = clamp(runModeSong += delta, 0, NUM_MODES - 1);
@@ -295,6 +332,7 @@ class SequencerKernel {
 		int rVal = phrases[phrn].getReps();
 		rVal = clamp(rVal + delta, 0, 99);
 		phrases[phrn].setReps(rVal);
+		activePhrasesDirty = true;
 		return rVal;
 	}		
 	int modPulsesPerStep(int delta) {
@@ -355,7 +393,9 @@ class SequencerKernel {
 	}
 	
 	float calcSlideOffset() {return (slideStepsRemain > 0ul ? (slideCVdelta * (float)slideStepsRemain) : 0.0f);}
-	bool calcGate(Trigger clockTrigger, float sampleRate) {
+	float getSlideStepsRemain() {return (float)slideStepsRemain;}
+	float getSlideCVdelta() {return (slideStepsRemain > 0ul ? slideCVdelta : 0.0f);}
+	bool calcGate(Trigger& clockTrigger, unsigned long gateTriggerLength) {// gateTriggerLength from SampleTimings
 		if (ppqnLeftToSkip != 0)
 			return false;
 		if (gateCode < 2) 
@@ -363,7 +403,7 @@ class SequencerKernel {
 		if (gateCode == 2)
 			return clockTrigger.isHigh();// clock period
 		// here gateCode is 3, meaning trigger
-		return clockPeriod < (unsigned long) (sampleRate * 0.01f);
+		return clockPeriod < gateTriggerLength;
 	}
 	
 
@@ -373,6 +413,10 @@ class SequencerKernel {
 	void pasteSong(SongCPbuffer* songCPbuf, int startCP);
 	
 	int clockStep(bool editingSequence, int delayedSeqNumberRequest);
+	void calcNextStep(bool editingSequence, int delayedSeqNumberRequest, const uint32_t* rngState);
+	bool isNextStepValid() {return nextStep.valid;}
+	void invalidateNextStep() {nextStep.valid = false;}
+	const uint32_t* getNextStepRngState() {return nextStep.rngAfter;}// generator state after the next clock step
 	void process() {
 		clockPeriod++;
 	}
@@ -400,10 +444,14 @@ class SequencerKernel {
 	bool moveStepIndexRun(bool init, bool editingSequence);
 	bool movePhraseIndexBackward(bool init, bool rollover);
 	bool movePhraseIndexForeward(bool init, bool rollover);
-	int tempPhraseIndexes[MAX_PHRASES];// used only in next method	
+	void updateActivePhrases();
+	int firstActivePhraseFrom(int phrn);
+	int lastActivePhraseUpTo(int phrn);
 	void movePhraseIndexRandom(bool init, uint32_t randomValue);	
 	void movePhraseIndexBrownian(bool init, uint32_t randomValue);	
 	bool movePhraseIndexRun(bool init);
+	void saveRunState(RunState* dest);
+	void loadRunState(const RunState& src);
 };// class SequencerKernel 
 
 
@@ -12,27 +12,66 @@
 #include "Interop.hpp"
 
 
-// Intervals (two notes)
-// // https://en.wikipedia.org/wiki/Interval_(music)#Main_intervals
-static const std::string intervalNames[13] = {"PER","MIN","MAJ","MIN","MAJ","PER","DIM","PER","MIN","MAJ","MIN","MAJ","PER"};
-static const int       intervalNumbers[13] = {  1,    2,    2,    3,    3,    4,   	5, 	  5,	6,	  6,	7,	  7,	8};
-// short										P1	  m2	M2	  m3	M3	  P4	d5	  P5	m6	  M6	m7	  M7	P8
-// semitone distance							0	  1		2	  3		4	  5		6	  7		8	  9		10	  11	12
-
-// Triads (three notes)
+// Chord types, given as semitone intervals from the root
+// https://en.wikipedia.org/wiki/Interval_(music)#Main_intervals
 // https://en.wikipedia.org/wiki/Chord_(music)#Examples
 // https://en.wikipedia.org/wiki/Chord_(music)#Suspended_chords
-static const int NUM_TRIADS = 6;
-static const int triadIntervals[NUM_TRIADS][2] =  {{4,7}, {4,8}, {3,7}, {3,6}, {2,7}, {5,7}};
-static const std::string triadNames[NUM_TRIADS] = {"MAJ", "AUG", "MIN", "DIM", "SUS", "SUS"};
-static const int       triadNumbers[NUM_TRIADS] = { -1,    -1,    -1,    -1,    2,     4};
+struct ChordType {
+	const char* name;
+	int number;// -1 when none
+	int numNotes;
+	int intervals[5];
+};
+static const int NUM_CHORD_TYPES = 11 + 6 + 9 + 3;
+static const ChordType chordTypes[NUM_CHORD_TYPES] = {
+	// intervals (two notes, always shown from the lowest note)
+	{"MIN", 2, 2, {0, 1}}, {"MAJ", 2, 2, {0, 2}}, {"MIN", 3, 2, {0, 3}}, {"MAJ", 3, 2, {0, 4}}, {"PER", 4, 2, {0, 5}}, {"DIM", 5, 2, {0, 6}}, 
+	{"PER", 5, 2, {0, 7}}, {"MIN", 6, 2, {0, 8}}, {"MAJ", 6, 2, {0, 9}}, {"MIN", 7, 2, {0, 10}}, {"MAJ", 7, 2, {0, 11}},
+	// triads
+	{"MAJ", -1, 3, {0, 4, 7}}, {"AUG", -1, 3, {0, 4, 8}}, {"MIN", -1, 3, {0, 3, 7}}, {"DIM", -1, 3, {0, 3, 6}}, {"SUS", 2, 3, {0, 2, 7}}, {"SUS", 4, 3, {0, 5, 7}},
+	// 4-note chords
+	{"MAJ", 6, 4, {0, 4, 7, 9}}, {"DOM", 7, 4, {0, 4, 7, 10}}, {"MAJ", 7, 4, {0, 4, 7, 11}}, {"AUG", 7, 4, {0, 4, 8, 10}}, {"MIN", 6, 4, {0, 3, 7, 9}}, 
+	{"MIN", 7, 4, {0, 3, 7, 10}}, {"M_M", 7, 4, {0, 3, 7, 11}}, {"DIM", 7, 4, {0, 3, 6, 9}}, {"0", 7, 4, {0, 3, 6, 10}},
+	// 5-note chords
+	{"DOM", 9, 5, {0, 4, 7, 10, 14}}, {"MAJ", 9, 5, {0, 4, 7, 11, 14}}, {"MIN", 9, 5, {0, 3, 7, 10, 14}}
+};
 
-// 4-note chords
-// https://en.wikipedia.org/wiki/Chord_(music)#Examples
-static const int NUM_CHORDS = 9;
-static const int chordIntervals[NUM_CHORDS][3]    {{4,7,9},{4,7,10},{4,7,11},{4,8,10},{3,7,9},{3,7,10},{3,7,11},{3,6,9},{3,6,10}};
-static const std::string chordNames[NUM_CHORDS] = {"MAJ",  "DOM",   "MAJ",   "AUG",   "MIN",  "MIN",   "M_M",   "DIM",  "0"};
-static const int       chordNumbers[NUM_CHORDS] = { 6,      7,       7,       7,       6,      7,       7,       7,      7};
+struct ChordTable {
+	// maps a pitch-class set, with bit 0 being the lowest note, to its chord type and root; built once at startup
+	struct Entry {
+		int8_t type;// index into chordTypes, -1 when no match
+		int8_t rootOffset;// semitones from the lowest note up to the root, 0 means no inversion
+	};
+	Entry entries[1 << 12];
+	
+	ChordTable() {
+		for (int i = 0; i < (1 << 12); i++) {
+			entries[i].type = -1;
+			entries[i].rootOffset = 0;
+		}
+		// all chords in root position first, then with the root one note above the bass, then two notes above, etc., 
+		//   so that the first matching voicing wins when two chords share a pitch-class set (MAJ 6 and MIN 7, SUS 2 and SUS 4)
+		for (int k = 0; k < 5; k++) {
+			for (int t = 0; t < NUM_CHORD_TYPES; t++) {
+				const ChordType& ct = chordTypes[t];
+				int inv = (k == 0 ? 0 : ct.numNotes - k);
+				if (inv < 0 || (k > 0 && (inv == 0 || ct.numNotes == 2))) {
+					continue;
+				}
+				int bassInterval = ct.intervals[inv] % 12;
+				int pcSet = 0;
+				for (int n = 0; n < ct.numNotes; n++) {
+					pcSet |= 1 << ((ct.intervals[n] - bassInterval + 12) % 12);
+				}
+				if (entries[pcSet].type == -1) {
+					entries[pcSet].type = t;
+					entries[pcSet].rootOffset = (12 - bassInterval) % 12;
+				}
+			}
+		}
+	}
+};
+static const ChordTable chordTable;
 
 
 
@@ -57,7 +96,7 @@ struct FourView : Module {
 	const float unusedValue = -100.0f;
 
 	// Expander
-	float leftMessages[2][5] = {};// messages from mother (CvPad or ChordKey): 4 CV values, panelTheme
+	ExpanderChannel<float[5]> fromMother;// messages from mother (CvPad or ChordKey): 4 CV values, panelTheme
 
 	// Need to save, no reset
 	int panelTheme;
@@ -84,8 +123,7 @@ struct FourView : Module {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		onReset();
 		
-		leftExpander.producerMessage = leftMessages[0];
-		leftExpander.consumerMessage = leftMessages[1];
+		fromMother.construct(&leftExpander);
 		
 		configParam(MODE_PARAM, 0.0, 1.0, 0.0, "Display mode");// 0.0 is left, notes by default left, chord right
 		
@@ -98,6 +136,11 @@ struct FourView : Module {
 		showSharp = true;
 		resetNonJson();
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+	}
+	
 	void resetNonJson() {
 		for (int i = 0; i < 4; i++) {
 			displayValues[i] = unusedValue;
@@ -210,12 +253,15 @@ struct FourView : Module {
 													  leftExpander.module->model == modelChordKeyExpander));
 
 		if (motherPresent) {
-			// From Mother
-			float *messagesFromMother = (float*)leftExpander.consumerMessage;
+			// From Mother (the CVs are copied every sample since the inputs below can overwrite displayValues)
+			float *messagesFromMother = fromMother.data();
 			memcpy(displayValues, messagesFromMother, 4 * 4);
-			panelTheme = clamp((int)(messagesFromMother[4] + 0.5f), 0, 1);
+			if (fromMother.receive()) {
+				panelTheme = clamp((int)(messagesFromMother[4] + 0.5f), 0, 1);
+			}
 		}	
 		else {
+			fromMother.reset();
 			for (int i = 0; i < 4; i++) {
 				displayValues[i] = unusedValue;
 			}
@@ -224,7 +270,7 @@ struct FourView : Module {
 		int numChanIn0 = inputs[CV_INPUTS + 0].isConnected() ? inputs[CV_INPUTS + 0].getChannels() : 0;
 		int i = 0;// write head
 		if (allowPolyOverride == 1) {
-			for (; i < numChanIn0; i++) {
+			for (; i < std::min(numChanIn0, 4); i++) {// channels 5-16 are read directly by calcDisplayChord()
 				displayValues[i] = inputs[CV_INPUTS].getVoltage(i);
 			}
 		}
@@ -236,252 +282,91 @@ struct FourView : Module {
 
 
 		if (refresh.processInputs()) {
+			if (params[MODE_PARAM].getValue() >= 0.5f) {
+				calcDisplayChord();
+			}
 		}// userInputs refresh
 		
 		
 		for (int i = 0; i < 4; i++) {
 			outputs[CV_OUTPUTS + i].setVoltage(displayValues[i] == unusedValue ? 0.0f : displayValues[i]);
 		}
-		
-		
-		if (refresh.processLights()) {
-			if (params[MODE_PARAM].getValue() >= 0.5f) {
-				calcDisplayChord();
-			}
-		}// lightRefreshCounter
-		
 	}
 	
 	void calcDisplayChord() {
-		// count notes and prepare sorted (will be sorted just in time later)
+		// notes are the 4 displays, plus the extra channels of a poly cable on input 1 (up to 16 notes)
+		int numChanIn0 = (allowPolyOverride == 1 && inputs[CV_INPUTS + 0].isConnected()) ? inputs[CV_INPUTS + 0].getChannels() : 0;
+		int packedNotes[PORT_MAX_CHANNELS];// contains pitch CVs multiplied by 12 and rounded to integers
 		int numNotes = 0;
-		int packedNotes[4];// contains pitch CVs multiplied by 12 and rounded to integers
 		for (int i = 0; i < 4; i++) {
 			if (displayValues[i] != unusedValue) {
-				int displayNote = (int)std::round(displayValues[i] * 12.0f);
-				int j = 0;
-				for (; j < numNotes; j++) {
-					if (packedNotes[j] == displayNote) 
-						break;// don't count duplicates
-				}
-				if (j == numNotes) {
-					packedNotes[numNotes] = displayNote;
-					numNotes ++;
-				}
+				packedNotes[numNotes++] = (int)std::round(displayValues[i] * 12.0f);
 			}
-		}		
+		}
+		for (int c = 4; c < numChanIn0; c++) {
+			packedNotes[numNotes++] = (int)std::round(inputs[CV_INPUTS + 0].getVoltage(c) * 12.0f);
+		}
 		
 		if (numNotes == 0) {
 			printDashes();
+			return;
 		}
-		else { 
-			// Single note
-			if (numNotes == 1) {
-				printNoteNoOct(packedNotes[0], &displayChord[0], showSharp);
-				displayChord[4] = 0;
-				displayChord[8] = 0;
-				displayChord[12] = 0;				
-			}
-			// Interval
-			else if (numNotes == 2) {
-				sortInt<2>(packedNotes);	
-				if (!printInterval(packedNotes)) {
-					printDashes();
-				}					
-			}
-			// Triad
-			else if (numNotes == 3) {
-				sortInt<3>(packedNotes);	
-				if (!printTriad(packedNotes)) {
-					printDashes();
-				}
-			}
-			// 4-note chord
-			else {
-				sortInt<4>(packedNotes);
-				if (!print4Chord(packedNotes)) {
-					printDashes();
-				}
-			}
-		}
-	}
-	
-	
-	void printDashes() {
-		snprintf(&displayChord[0 ], 4, " - ");
-		snprintf(&displayChord[4 ], 4, " - ");
-		snprintf(&displayChord[8 ], 4, " - ");
-		snprintf(&displayChord[12], 4, " - ");				
-	}
-	
-	template<int N>
-	void sortInt(int *a) {
-		int temp;
-		for (int i = 0; i < N; i++) {
-			for (int j = 0; j < N - i - 1; j++) {
-				if (a[j] > a[j + 1]) {
-					temp = a[j + 1];
-					a[j + 1] = a[j];
-					a[j] = temp;
-				}
-			}
-		}	
-	}
-	
-	
-	bool printInterval(int *packedNotes) {// prints to all of displayChord if match found 
-		int interval = packedNotes[1] - packedNotes[0];
 		
-		if (interval >= 0 && interval <= 12) {
-			printNoteNoOct(packedNotes[0], &displayChord[0], showSharp);
-			snprintf(&displayChord[4], 4, "%s", intervalNames[interval].c_str());
-			snprintf(&displayChord[8], 4, "%i", intervalNumbers[interval]);
-			displayChord[12] = 0;		
-			return true;
+		// pitch-class set relative to the lowest note
+		int bass = packedNotes[0];
+		bool severalNotes = false;
+		for (int n = 1; n < numNotes; n++) {
+			severalNotes |= (packedNotes[n] != bass);
+			bass = std::min(bass, packedNotes[n]);
 		}
-		return false;
-	}
-	
-	
-	bool printTriad(int *packedNotes) {// prints to all of displayChord if match found 
-		int interval1 = packedNotes[1] - packedNotes[0];			
-		int interval2 = packedNotes[2] - packedNotes[0];
-
-		// No inversion
-		for (int t = 0; t < NUM_TRIADS; t++) {
-			if (triadIntervals[t][0] == interval1 && triadIntervals[t][1] == interval2) {
-				printNoteNoOct(packedNotes[0], &displayChord[0], showSharp);
-				snprintf(&displayChord[4], 4, "%s", triadNames[t].c_str());
-				if (triadNumbers[t] != -1) {
-					snprintf(&displayChord[8], 4, "%i", triadNumbers[t]);
-				}
-				else {
-					displayChord[8] = 0;
-				}
-				displayChord[12] = 0;
-				return true;
-			}
+		int pcSet = 0;
+		for (int n = 0; n < numNotes; n++) {
+			pcSet |= 1 << eucMod(packedNotes[n] - bass, 12);
 		}
 		
-		// First inversion down (= second inversion up)
-		for (int t = 0; t < NUM_TRIADS; t++) {
-			int firstBase = -1 * (triadIntervals[t][1] - 12);
-			if (firstBase == interval1 && (triadIntervals[t][0] + firstBase) == interval2) {
-				printNoteNoOct(packedNotes[1], &displayChord[0], showSharp);
-				snprintf(&displayChord[4], 4, "%s", triadNames[t].c_str());
-				int inversionCursor = 8;
-				if (triadNumbers[t] != -1) {
-					inversionCursor += 4;
-					snprintf(&displayChord[8], 4, "%i", triadNumbers[t]);
-				}
-				else {
-					displayChord[12] = 0;
-				}
-				printNoteNoOct(packedNotes[0], &displayChord[inversionCursor + 1], showSharp);
-				displayChord[inversionCursor] = '/';
-				return true;
+		if (pcSet == 0x1) {
+			printNoteNoOct(bass, &displayChord[0], showSharp);
+			if (severalNotes) {// octaves
+				snprintf(&displayChord[4], 4, "PER");
+				snprintf(&displayChord[8], 4, "8");
 			}
-		}
-		
-		// Second inversion down (= first inversion up)
-		for (int t = 0; t < NUM_TRIADS; t++) {
-			if ((triadIntervals[t][1] - triadIntervals[t][0]) == interval1 && (12 - triadIntervals[t][0]) == interval2) {
-				printNoteNoOct(packedNotes[2], &displayChord[0], showSharp);
-				snprintf(&displayChord[4], 4, "%s", triadNames[t].c_str());
-				int inversionCursor = 8;
-				if (triadNumbers[t] != -1) {
-					inversionCursor += 4;
-					snprintf(&displayChord[8], 4, "%i", triadNumbers[t]);
-				}
-				else {
-					displayChord[12] = 0;
-				}
-				printNoteNoOct(packedNotes[0], &displayChord[inversionCursor + 1], showSharp);
-				displayChord[inversionCursor] = '/';
-				return true;
+			else {// single note
+				displayChord[4] = 0;
+				displayChord[8] = 0;
 			}
-		}
-
-		// At this point no triads were detected, so check for intervals
-		if ( (((interval2 % 12) == 0) || (((interval2 - interval1) % 12) == 0)) && printInterval(packedNotes)) {
-			return true;
+			displayChord[12] = 0;
+			return;
 		}
 		
-		return false;
-	}
-	
-	
-	bool print4Chord(int *packedNotes) {// prints to all of displayChord if match found 
-		int interval1 = packedNotes[1] - packedNotes[0];			
-		int interval2 = packedNotes[2] - packedNotes[0];
-		int interval3 = packedNotes[3] - packedNotes[0];
-
-		// No inversion
-		for (int c = 0; c < NUM_CHORDS; c++) {
-			if (chordIntervals[c][0] == interval1 && chordIntervals[c][1] == interval2 && chordIntervals[c][2] == interval3) {
-				printNoteNoOct(packedNotes[0], &displayChord[0], showSharp);// root note
-				snprintf(&displayChord[4], 4, "%s", chordNames[c].c_str());
-				snprintf(&displayChord[8], 4, "%i", chordNumbers[c]);
-				displayChord[12] = 0;// no inversion
-				return true;
-			}
-		}
-		// First inversion down (= third inversion up)
-		for (int c = 0; c < NUM_CHORDS; c++) {
-			int firstBase = -1 * (chordIntervals[c][2] - 12);
-			if (firstBase == interval1 && (chordIntervals[c][0] + firstBase) == interval2 && (chordIntervals[c][1] + firstBase) == interval3) {
-				printNoteNoOct(packedNotes[1], &displayChord[0], showSharp);// root note
-				snprintf(&displayChord[4], 4, "%s", chordNames[c].c_str());
-				snprintf(&displayChord[8], 4, "%i", chordNumbers[c]);
-				printNoteNoOct(packedNotes[0], &displayChord[12 + 1], showSharp);// base note of inversion
-				displayChord[12] = '/';
-				return true;
-			}
-		}
-		// Second inversion
-		for (int c = 0; c < NUM_CHORDS; c++) {
-			int firstBase = -1 * (chordIntervals[c][1] - 12);
-			if ((chordIntervals[c][2] - 12 + firstBase) == interval1 && firstBase == interval2 && (chordIntervals[c][0] + firstBase) == interval3) {
-				printNoteNoOct(packedNotes[2], &displayChord[0], showSharp);// root note
-				snprintf(&displayChord[4], 4, "%s", chordNames[c].c_str());
-				snprintf(&displayChord[8], 4, "%i", chordNumbers[c]);
-				printNoteNoOct(packedNotes[0], &displayChord[12 + 1], showSharp);// base note of inversion
-				displayChord[12] = '/';
-				return true;
-			}
-		}
-		// Third inversion down (= first inversion up)
-		for (int c = 0; c < NUM_CHORDS; c++) {
-			if ((chordIntervals[c][1] - chordIntervals[c][0]) == interval1 && (chordIntervals[c][2] - chordIntervals[c][0]) == interval2 && (12 - chordIntervals[c][0]) == interval3) {
-				printNoteNoOct(packedNotes[3], &displayChord[0], showSharp);// root note
-				snprintf(&displayChord[4], 4, "%s", chordNames[c].c_str());
-				snprintf(&displayChord[8], 4, "%i", chordNumbers[c]);
-				printNoteNoOct(packedNotes[0], &displayChord[12 + 1], showSharp);// base note of inversion
-				displayChord[12] = '/';
-				return true;
-			}
+		const ChordTable::Entry& entry = chordTable.entries[pcSet];
+		if (entry.type == -1) {
+			printDashes();
+			return;
 		}
-		
-		// At this point no 4-note chords were detected, so check for triads with and extra octave-related root note
-		// Since the triad's biggest interval is < 12, the octave-related note is either the first note or the 
-		//   fourth note since packedNotes are sorted
-		
-		// check if second note is octave-related to first note; if so, check for triad in last three notes
-		if (((interval1 % 12) == 0) && printTriad(&packedNotes[1])) {
-			return true;
+		const ChordType& ct = chordTypes[entry.type];
+		printNoteNoOct(bass + entry.rootOffset, &displayChord[0], showSharp);// root note
+		snprintf(&displayChord[4], 4, "%s", ct.name);
+		int inversionCursor = 8;
+		if (ct.number != -1) {
+			snprintf(&displayChord[8], 4, "%i", ct.number);
+			inversionCursor += 4;
 		}
-		
-		// check if last note is octave-related to first note; if so, check for triad in first three notes
-		if (((interval3 % 12) == 0) && printTriad(packedNotes)) {
-			return true;
+		else {
+			displayChord[8] = 0;
 		}
-		
-		// At this point no triads were detected, so check for intervals
-		if (((interval2 % 12) == 0) && (((interval3 - interval1) % 12) == 0) && printInterval(packedNotes)) {
-			return true;
+		displayChord[12] = 0;
+		if (entry.rootOffset != 0) {
+			displayChord[inversionCursor] = '/';
+			printNoteNoOct(bass, &displayChord[inversionCursor + 1], showSharp);// base note of inversion
 		}
-				
-		return false;
+	}
+	
+	
+	void printDashes() {
+		snprintf(&displayChord[0 ], 4, " - ");
+		snprintf(&displayChord[4 ], 4, " - ");
+		snprintf(&displayChord[8 ], 4, " - ");
+		snprintf(&displayChord[12], 4, " - ");				
 	}
 };// module
 
@@ -489,12 +374,11 @@ struct FourView : Module {
 struct FourViewWidget : ModuleWidget {
 	SvgPanel* darkPanel;
 
-	struct NotesDisplayWidget : LightWidget {//TransparentWidget {
+	struct NotesDisplayWidget : CachedDisplayWidget {
 		FourView* module;
 		int baseIndex;
 		std::shared_ptr<Font> font;
 		std::string fontPath;
-		char text[4];
 
 		NotesDisplayWidget(Vec _pos, Vec _size, FourView* _module, int _baseIndex) {
 			box.size = _size;
@@ -504,25 +388,25 @@ struct FourViewWidget : ModuleWidget {
 			fontPath = std::string(asset::plugin(pluginInstance, "res/fonts/Segment14.ttf"));
 		}
 		
-		void cvToStr() {
+		void updateDisplay() override {
 			if (module == NULL) {
-				snprintf(text, 4, " - ");
+				snprintf(displayStr, 4, " - ");
 			}	
 			else if (module->params[FourView::MODE_PARAM].getValue() >= 0.5f) {// chord mode
-				snprintf(text, 4, "%s", &module->displayChord[baseIndex<<2]);
+				snprintf(displayStr, 4, "%s", &module->displayChord[baseIndex<<2]);
 			}
 			else {// note mode
 				if (module->displayValues[baseIndex] != module->unusedValue) {
 					float cvVal = module->displayValues[baseIndex];
-					printNote(cvVal, text, module->showSharp);
+					printNote(cvVal, displayStr, module->showSharp);
 				}
 				else {
-					snprintf(text, 4, " - ");
+					snprintf(displayStr, 4, " - ");
 				}
 			}
 		}
 
-		void draw(const DrawArgs &args) override {
+		void drawDisplay(const DrawArgs &args) override {
 			if (!(font = APP->window->loadFont(fontPath))) {
 				return;
 			}
@@ -534,8 +418,7 @@ struct FourViewWidget : ModuleWidget {
 			nvgFillColor(args.vg, nvgTransRGBA(textColor, displayAlpha));
 			nvgText(args.vg, textPos.x, textPos.y, "~~~", NULL);
 			nvgFillColor(args.vg, textColor);
-			cvToStr();
-			nvgText(args.vg, textPos.x, textPos.y, text, NULL);
+			nvgText(args.vg, textPos.x, textPos.y, displayStr, NULL);
 		}
 	};
 
@@ -675,8 +558,7 @@ struct FourViewWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((FourView*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((FourView*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((FourView*)module)->panelTheme);
 		}
 		Widget::step();
 	}
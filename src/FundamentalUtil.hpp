@@ -64,6 +64,7 @@ struct VoltageControlledOscillator {
 	// For analog detuning effect
 	float pitchSlew = 0.0f;
 	int pitchSlewIndex = 0;
+	ModuleRandom* rngPtr = NULL;// global generator when NULL
 
 	float sinBuffer[OVERSAMPLE] = {};
 	float triBuffer[OVERSAMPLE] = {};
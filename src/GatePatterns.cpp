@@ -0,0 +1,33 @@
+//***********************************************************************************************
+//Impromptu Modular: Modules for VCV Rack by Marc Boulé
+//***********************************************************************************************
+
+
+#include "GatePatterns.hpp"
+
+
+const GatePattern advGatePatterns[NUM_ADV_GATES] = {
+	{{0x00FFFFFF, 0x00000000, 0x00000000}},// 25%
+	{{0x0000FFFF, 0x0000FFFF, 0x0000FFFF}},// TRI
+	{{0xFFFFFFFF, 0x0000FFFF, 0x00000000}},// 50%
+	{{0x00000000, 0x0000FFFF, 0x0000FFFF}},// T23
+	{{0xFFFFFFFF, 0xFFFFFFFF, 0x000000FF}},// 75%
+	{{0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF}},// FUL
+	{{0x0000FFFF, 0x00000000, 0x00000000}},// TR1
+	{{0x00FFFFFF, 0xFFFF0000, 0x000000FF}},// DUO
+	{{0x00000000, 0x0000FFFF, 0x00000000}},// TR2
+	{{0x00000000, 0xFFFF0000, 0x000000FF}},// D2
+	{{0x00000000, 0x00000000, 0x0000FFFF}},// TR3
+	{{0x00000000, 0x00000000, 0x00000000}} // TRIG
+};
+
+const GatePattern advGatePatternsGS[NUM_ADV_GATES_GS] = {
+	{{0x00FFFFFF, 0x00000000, 0x00000000}},// 1/4
+	{{0x00FFFFFF, 0xFFFF0000, 0x000000FF}},// DUO
+	{{0x00000000, 0xFFFF0000, 0x000000FF}},// D2
+	{{0x0000FFFF, 0x00000000, 0x00000000}},// TR1
+	{{0x00000000, 0x0000FFFF, 0x00000000}},// TR2
+	{{0x00000000, 0x00000000, 0x0000FFFF}},// TR3
+	{{0x00000000, 0x0000FFFF, 0x0000FFFF}},// TR23
+	{{0x0000FFFF, 0x0000FFFF, 0x0000FFFF}} // TRI
+};
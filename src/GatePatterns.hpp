@@ -0,0 +1,31 @@
+//***********************************************************************************************
+//Impromptu Modular: Modules for VCV Rack by Marc Boulé
+//***********************************************************************************************
+
+#pragma once
+
+#include "ImpromptuModular.hpp"
+
+
+// Advanced gate patterns, with one bit per 1/96th of a step so that any number of pulses per step that divides 96
+//   can be used; the bit of a given pulse is found with a single shift and mask
+struct GatePattern {
+	uint32_t bits[3];// bit 0 of bits[0] is the first 1/96th of the step
+	
+	int isHit(int ppqnCount, int pulsesPerStep) const {// pulsesPerStep must divide 96
+		return isHitAt((uint32_t)(ppqnCount * (96 / pulsesPerStep)));
+	}
+	int isHit24(int ppqnCount, int pulsesPerStep) const {// pulses spaced as in the original 24-bit masks (integer 24 / pulsesPerStep),
+		// for PhraseSeq16/32 and SemiModularSynth, whose pulses per step of 10, 14, 16, 18, 20 and 22 don't divide 24
+		return isHitAt((uint32_t)(ppqnCount * (24 / pulsesPerStep) * 4));
+	}
+	int isHitAt(uint32_t bitIndex) const {
+		return (int)((bits[bitIndex >> 5] >> (bitIndex & 0x1F)) & 0x1);
+	}
+};
+
+static const int NUM_ADV_GATES = 12;
+extern const GatePattern advGatePatterns[NUM_ADV_GATES];// PhraseSeq16/32, SemiModularSynth and Foundry (TRIG, the last one, is handled by the callers)
+
+static const int NUM_ADV_GATES_GS = 8;
+extern const GatePattern advGatePatternsGS[NUM_ADV_GATES_GS];// GateSeq64
@@ -55,7 +55,8 @@ struct GateSeq64 : Module {
 	
 	
 	// Expander
-	float rightMessages[2][6] = {};// messages from expander
+	ExpanderChannel<float[6]> fromExpander;// messages from expander
+	ExpanderSender<float[1]> toExpander;// messages to expander: panelTheme
 		
 
 	// Constants
@@ -81,6 +82,8 @@ struct GateSeq64 : Module {
 	SeqAttributesGS sequences[MAX_SEQS];
 	int phrase[64];// This is the song (series of phases; a phrase is a patten number)
 	bool resetOnRun;
+	int clockBusSource;// 0 when the clock input is a regular clock, 1 to 4 when it is a clock bus (see ClockBusChannelIds)
+	ModuleRandom rng;// only the seed options are saved
 	bool stopAtEndOfSong;
 	bool lock;
 
@@ -111,6 +114,7 @@ struct GateSeq64 : Module {
 	// No need to save, no reset
 	int stepConfigSync = 0;// 0 means no sync requested, 1 means synchronous read of lengths requested
 	RefreshCounter refresh;
+	SampleTimings timings;
 	float resetLight = 0.0f;
 	int sequenceKnob = 0;
 	Trigger modesTrigger;
@@ -149,9 +153,9 @@ struct GateSeq64 : Module {
 			stepIndexRun[3] = stepIndexRun[0];
 		}
 		else {
-			stepIndexRun[1] = random::u32() % len;
-			stepIndexRun[2] = random::u32() % len;
-			stepIndexRun[3] = random::u32() % len;
+			stepIndexRun[1] = rng.u32() % len;
+			stepIndexRun[2] = rng.u32() % len;
+			stepIndexRun[3] = rng.u32() % len;
 		}
 	}
 	bool ppsRequirementMet(int gateButtonIndex) {
@@ -162,12 +166,11 @@ struct GateSeq64 : Module {
 	GateSeq64() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		
-		rightExpander.producerMessage = rightMessages[0];
-		rightExpander.consumerMessage = rightMessages[1];
+		fromExpander.construct(&rightExpander);
 		
 		// must init those that have no-connect info to non-connected, or else mother may read 0.0 init value if ever refresh limiters make it such that after a connection of expander the mother reads before the first pass through the expander's writing code, and this may do something undesired (ex: change track in Foundry on expander connected while track CV jack is empty)
-		rightMessages[1][0] = std::numeric_limits<float>::quiet_NaN();
-		rightMessages[1][1] = std::numeric_limits<float>::quiet_NaN();
+		fromExpander.frames[1].data[0] = std::numeric_limits<float>::quiet_NaN();
+		fromExpander.frames[1].data[1] = std::numeric_limits<float>::quiet_NaN();
 		
 		char strBuf[32];
 		// Step LED buttons and GateMode lights
@@ -223,10 +226,18 @@ struct GateSeq64 : Module {
 			phrase[i] = 0;
 		}
 		resetOnRun = false;
+		clockBusSource = 0;
+		rng.init();
 		stopAtEndOfSong = false;
 		lock = false;
 		resetNonJson(false);
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+		timings.onSampleRateChange();
+	}
+	
 	void resetNonJson(bool delayed) {// delay thread sensitive parts (i.e. schedule them so that process() will do them)
 		displayState = DISP_GATE;
 		seqAttribCPbuffer.init(16, MODE_FWD);
@@ -253,7 +264,8 @@ struct GateSeq64 : Module {
 		}
 	}
 	void initRun() {// run button activated, or run edge in run input jack, or stepConfig switch changed, or fromJson()
-		clockIgnoreOnReset = (long) (clockIgnoreOnResetDuration * APP->engine->getSampleRate());
+		clockIgnoreOnReset = timings.clockIgnoreOnReset;
+		rng.onSeqReset();
 		phraseIndexRun = (runModeSong == MODE_REV ? phrases - 1 : 0);
 		phraseIndexRunHistory = 0;
 
@@ -264,16 +276,16 @@ struct GateSeq64 : Module {
 
 		ppqnCount = 0;
 		for (int i = 0; i < 4; i += stepConfig)
-			gateCode[i] = calcGateCode(attributes[seq][(i * 16) + stepIndexRun[i]], 0, pulsesPerStep);
+			gateCode[i] = calcGateCode(attributes[seq][(i * 16) + stepIndexRun[i]], 0, pulsesPerStep, rng);
 	}
 	
 	
 	void onRandomize() override {
 		if (isEditingSequence()) {
 			for (int s = 0; s < 64; s++) {
-				attributes[sequence][s].randomize();
+				attributes[sequence][s].randomize(rng);
 			}
-			sequences[sequence].randomize(16 * stepConfig, NUM_MODES);// ok to use stepConfig since CONFIG_PARAM is not randomizable		
+			sequences[sequence].randomize(16 * stepConfig, NUM_MODES, rng);// ok to use stepConfig since CONFIG_PARAM is not randomizable		
 		}
 	}
 	
@@ -334,6 +346,12 @@ struct GateSeq64 : Module {
 		// resetOnRun
 		json_object_set_new(rootJ, "resetOnRun", json_boolean(resetOnRun));
 		
+		// clockBusSource
+		json_object_set_new(rootJ, "clockBusSource", json_integer(clockBusSource));
+		
+		// rng
+		rng.dataToJson(rootJ);
+		
 		// stopAtEndOfSong
 		json_object_set_new(rootJ, "stopAtEndOfSong", json_boolean(stopAtEndOfSong));
 
@@ -516,6 +534,14 @@ struct GateSeq64 : Module {
 		if (resetOnRunJ)
 			resetOnRun = json_is_true(resetOnRunJ);
 
+		// clockBusSource
+		json_t *clockBusSourceJ = json_object_get(rootJ, "clockBusSource");
+		if (clockBusSourceJ)
+			clockBusSource = clamp((int)json_integer_value(clockBusSourceJ), 0, 4);
+
+		// rng
+		rng.dataFromJson(rootJ);
+
 		// stopAtEndOfSong
 		json_t *stopAtEndOfSongJ = json_object_get(rootJ, "stopAtEndOfSong");
 		if (stopAtEndOfSongJ)
@@ -545,7 +571,7 @@ struct GateSeq64 : Module {
 		bool editingSequence = isEditingSequence();// true = editing sequence, false = editing song
 		
 		// Run state button
-		if (runningTrigger.process(params[RUN_PARAM].getValue() + inputs[RUNCV_INPUT].getVoltage())) {// no input refresh here, don't want to introduce startup skew
+		if (runningTrigger.process(params[RUN_PARAM].getValue() + inputs[RUNCV_INPUT].getVoltage() + getClockBusChannel(inputs[CLOCK_INPUT], clockBusSource, CLKBUS_RUN))) {// no input refresh here, don't want to introduce startup skew
 			running = !running;
 			if (running) {
 				if (resetOnRun) {
@@ -617,13 +643,13 @@ struct GateSeq64 : Module {
 						phraseCPbuffer[i] = phrase[p];
 					seqCopied = false;// so that a cross paste can be detected
 				}
-				infoCopyPaste = (long) (revertDisplayTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+				infoCopyPaste = (long) (revertDisplayTime * sampleRate / refresh.displayRefreshStepSkips);
 				displayState = DISP_GATE;
 				blinkNum = blinkNumInit;
 			}
 			// Paste button
 			if (pasteTrigger.process(params[PASTE_PARAM].getValue())) {
-				infoCopyPaste = (long) (-1 * revertDisplayTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+				infoCopyPaste = (long) (-1 * revertDisplayTime * sampleRate / refresh.displayRefreshStepSkips);
 				startCP = 0;
 				if (countCP <= 8) {
 					startCP = editingSequence ? stepIndexEdit : phraseIndexEdit;
@@ -648,13 +674,13 @@ struct GateSeq64 : Module {
 						}
 						else if (params[CPMODE_PARAM].getValue() < 0.5f) {// 4 (randomize gates)
 							for (int s = 0; s < 64; s++)
-								if ( (random::u32() & 0x1) != 0)
+								if ( (rng.u32() & 0x1) != 0)
 									attributes[sequence][s].toggleGate();
 						}
 						else {// 8 (randomize probs)
 							for (int s = 0; s < 64; s++) {
-								attributes[sequence][s].setGateP((random::u32() & 0x1) != 0);
-								attributes[sequence][s].setGatePVal(random::u32() % 101);
+								attributes[sequence][s].setGateP((rng.u32() & 0x1) != 0);
+								attributes[sequence][s].setGatePVal(rng.u32() % 101);
 							}
 						}
 						startCP = 0;
@@ -678,7 +704,7 @@ struct GateSeq64 : Module {
 						}
 						else {// 8 (randomize phrases)
 							for (int p = 0; p < 64; p++)
-								phrase[p] = random::u32() % 64;
+								phrase[p] = rng.u32() % 64;
 						}
 						startCP = 0;
 						countCP = 64;
@@ -691,7 +717,7 @@ struct GateSeq64 : Module {
 			
 			// Write CV inputs 
 			bool expanderPresent = (rightExpander.module && rightExpander.module->model == modelGateSeq64Expander);
-			float *messagesFromExpander = (float*)rightExpander.consumerMessage;// could be invalid pointer when !expanderPresent, so read it only when expanderPresent
+			float *messagesFromExpander = fromExpander.data();// stale when !expanderPresent, so read it only when expanderPresent
 			if (expanderPresent) {
 				bool writeTrig = writeTrigger.process(messagesFromExpander[2]);
 				bool write0Trig = write0Trigger.process(messagesFromExpander[4]);
@@ -739,7 +765,7 @@ struct GateSeq64 : Module {
 				if (editingSequence) {
 					if (displayState == DISP_LENGTH) {
 						sequences[sequence].setLength(stepPressed % (16 * stepConfig) + 1);
-						revertDisplay = (long) (revertDisplayTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						revertDisplay = (long) (revertDisplayTime * sampleRate / refresh.displayRefreshStepSkips);
 					}
 					else if (displayState == DISP_MODES) {
 					}
@@ -748,7 +774,7 @@ struct GateSeq64 : Module {
 						/*if (!attributes[sequence][stepPressed].getGate()) {// clicked inactive, so turn gate on
 							attributes[sequence][stepPressed].setGate(true);
 							if (attributes[sequence][stepPressed].getGateP())
-								displayProbInfo = (long) (displayProbInfoTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+								displayProbInfo = (long) (displayProbInfoTime * sampleRate / refresh.displayRefreshStepSkips);
 							else
 								displayProbInfo = 0l;
 						}
@@ -759,7 +785,7 @@ struct GateSeq64 : Module {
 							}
 							else {
 								if (attributes[sequence][stepPressed].getGateP())
-									displayProbInfo = (long) (displayProbInfoTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+									displayProbInfo = (long) (displayProbInfoTime * sampleRate / refresh.displayRefreshStepSkips);
 								else
 									displayProbInfo = 0l;
 							}
@@ -769,7 +795,7 @@ struct GateSeq64 : Module {
 						if (!attributes[sequence][stepPressed].getGate()) {// clicked inactive, so turn gate on
 							attributes[sequence][stepPressed].setGate(true);
 							if (attributes[sequence][stepPressed].getGateP())
-								displayProbInfo = (long) (displayProbInfoTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+								displayProbInfo = (long) (displayProbInfoTime * sampleRate / refresh.displayRefreshStepSkips);
 							else
 								displayProbInfo = 0l;
 						}
@@ -787,14 +813,14 @@ struct GateSeq64 : Module {
 						phrases = stepPressed + 1;
 						if (phrases > 64) phrases = 64;
 						if (phrases < 1 ) phrases = 1;
-						revertDisplay = (long) (revertDisplayTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						revertDisplay = (long) (revertDisplayTime * sampleRate / refresh.displayRefreshStepSkips);
 					}
 					else if (displayState == DISP_MODES) {
 					}
 					else {
 						phraseIndexEdit = stepPressed;
 						if (running)
-							editingPhraseSongRunning = (long) (editingPhraseSongRunningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+							editingPhraseSongRunning = (long) (editingPhraseSongRunningTime * sampleRate / refresh.displayRefreshStepSkips);
 						else
 							phraseIndexRun = stepPressed;
 					}
@@ -812,7 +838,7 @@ struct GateSeq64 : Module {
 					displayState = DISP_MODES;
 				else
 					displayState = DISP_GATE;
-				modeHoldDetect.start((long) (holdDetectTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+				modeHoldDetect.start((long) (holdDetectTime * sampleRate / refresh.displayRefreshStepSkips));
 			}
 
 			// Prob button
@@ -825,13 +851,13 @@ struct GateSeq64 : Module {
 							attributes[sequence][stepIndexEdit].setGateP(false);
 						}
 						else {
-							displayProbInfo = (long) (displayProbInfoTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+							displayProbInfo = (long) (displayProbInfoTime * sampleRate / refresh.displayRefreshStepSkips);
 							attributes[sequence][stepIndexEdit].setGateP(true);							
 						}
 					}
 					else {// gate is off and pressed gatep button
 						attributes[sequence][stepIndexEdit].setGate(true);
-						displayProbInfo = (long) (displayProbInfoTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						displayProbInfo = (long) (displayProbInfoTime * sampleRate / refresh.displayRefreshStepSkips);
 						attributes[sequence][stepIndexEdit].setGateP(true);
 					}
 				}
@@ -848,7 +874,7 @@ struct GateSeq64 : Module {
 							attributes[sequence][stepIndexEdit].setGateMode(i);
 						}
 						else {
-							editingPpqn = (long) (editingPpqnTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+							editingPpqn = (long) (editingPpqnTime * sampleRate / refresh.displayRefreshStepSkips);
 						}
 					}
 				}
@@ -872,11 +898,11 @@ struct GateSeq64 : Module {
 						if (pval < 0)
 							pval = 0;
 						attributes[sequence][stepIndexEdit].setGatePVal(pval);
-						displayProbInfo = (long) (displayProbInfoTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						displayProbInfo = (long) (displayProbInfoTime * sampleRate / refresh.displayRefreshStepSkips);
 					}
 					else if (editingPpqn != 0) {
 						pulsesPerStep = indexToPpsGS(ppsToIndexGS(pulsesPerStep) + deltaKnob);// indexToPps() does clamping
-						editingPpqn = (long) (editingPpqnTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						editingPpqn = (long) (editingPpqnTime * sampleRate / refresh.displayRefreshStepSkips);
 					}
 					else if (displayState == DISP_MODES) {
 						if (editingSequence) {
@@ -909,7 +935,7 @@ struct GateSeq64 : Module {
 								newPhrase = newPhrase % MAX_SEQS;
 								phrase[phraseIndexEdit] = newPhrase;
 								if (running)
-									editingPhraseSongRunning = (long) (editingPhraseSongRunningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+									editingPhraseSongRunning = (long) (editingPhraseSongRunningTime * sampleRate / refresh.displayRefreshStepSkips);
 							}
 						}	
 					}					
@@ -924,7 +950,7 @@ struct GateSeq64 : Module {
 		
 		// Clock
 		if (running && clockIgnoreOnReset == 0l) {
-			if (clockTrigger.process(inputs[CLOCK_INPUT].getVoltage())) {
+			if (clockTrigger.process(getClockBusClock(inputs[CLOCK_INPUT], clockBusSource))) {
 				ppqnCount++;
 				if (ppqnCount >= pulsesPerStep)
 					ppqnCount = 0;
@@ -933,12 +959,12 @@ struct GateSeq64 : Module {
 				if (ppqnCount == 0) {
 					int oldStepIndexRun[4] = {stepIndexRun[0], stepIndexRun[1], stepIndexRun[2], stepIndexRun[3]};
 					if (editingSequence) {
-						moveIndexRunMode(&stepIndexRun[0], sequences[sequence].getLength(), sequences[sequence].getRunMode(), &stepIndexRunHistory);
+						moveIndexRunMode(&stepIndexRun[0], sequences[sequence].getLength(), sequences[sequence].getRunMode(), &stepIndexRunHistory, rng);
 					}
 					else {
-						if (moveIndexRunMode(&stepIndexRun[0], sequences[phrase[phraseIndexRun]].getLength(), sequences[phrase[phraseIndexRun]].getRunMode(), &stepIndexRunHistory)) {
+						if (moveIndexRunMode(&stepIndexRun[0], sequences[phrase[phraseIndexRun]].getLength(), sequences[phrase[phraseIndexRun]].getRunMode(), &stepIndexRunHistory, rng)) {
 							int oldPhraseIndexRun = phraseIndexRun;
-							bool songLoopOver = moveIndexRunMode(&phraseIndexRun, phrases, runModeSong, &phraseIndexRunHistory);
+							bool songLoopOver = moveIndexRunMode(&phraseIndexRun, phrases, runModeSong, &phraseIndexRunHistory, rng);
 							// check for end of song if needed
 							if (songLoopOver && stopAtEndOfSong) {
 								running = false;
@@ -961,13 +987,13 @@ struct GateSeq64 : Module {
 				}
 				for (int i = 0; i < 4; i += stepConfig) { 
 					if (gateCode[i] != -1 || ppqnCount == 0)
-						gateCode[i] = calcGateCode(attributes[newSeq][(i * 16) + stepIndexRun[i]], ppqnCount, pulsesPerStep);
+						gateCode[i] = calcGateCode(attributes[newSeq][(i * 16) + stepIndexRun[i]], ppqnCount, pulsesPerStep, rng);
 				}
 			}
 		}	
 		
 		// Reset
-		if (resetTrigger.process(inputs[RESET_INPUT].getVoltage() + params[RESET_PARAM].getValue())) {
+		if (resetTrigger.process(inputs[RESET_INPUT].getVoltage() + getClockBusChannel(inputs[CLOCK_INPUT], clockBusSource, CLKBUS_RESET) + params[RESET_PARAM].getValue())) {
 			initRun();// must be before SEQCV_INPUT below
 			resetLight = 1.0f;
 			displayState = DISP_GATE;
@@ -1020,7 +1046,7 @@ struct GateSeq64 : Module {
 						}
 						else {
 							float stepHereOffset = ((stepIndexRun[row] == col) && running) ? 0.71f : 1.0f;
-							long blinkCountMarker = (long) (0.67f * sampleRate / RefreshCounter::displayRefreshStepSkips);							
+							long blinkCountMarker = (long) (0.67f * sampleRate / refresh.displayRefreshStepSkips);							
 							if (attributes[sequence][i].getGate()) {
 								bool blinkEnableOn = (displayState != DISP_MODES) && (blinkCount < blinkCountMarker);
 								if (attributes[sequence][i].getGateP()) {
@@ -1101,7 +1127,7 @@ struct GateSeq64 : Module {
 			}
 		
 			// Reset light
-			lights[RESET_LIGHT].setSmoothBrightness(resetLight, args.sampleTime * (RefreshCounter::displayRefreshStepSkips >> 2));	
+			lights[RESET_LIGHT].setSmoothBrightness(resetLight, args.sampleTime * (refresh.displayRefreshStepSkips >> 2));	
 			resetLight = 0.0f;
 
 			// Run lights
@@ -1117,7 +1143,7 @@ struct GateSeq64 : Module {
 				displayProbInfo--;
 			if (modeHoldDetect.process(params[MODES_PARAM].getValue())) {
 				displayState = DISP_GATE;
-				editingPpqn = (long) (editingPpqnTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+				editingPpqn = (long) (editingPpqnTime * sampleRate / refresh.displayRefreshStepSkips);
 			}
 			if (editingPpqn > 0l)
 				editingPpqn--;
@@ -1130,16 +1156,19 @@ struct GateSeq64 : Module {
 			}
 			if (blinkNum > 0) {
 				blinkCount++;
-				if (blinkCount >= (long) (1.0f * sampleRate / RefreshCounter::displayRefreshStepSkips)) {
+				if (blinkCount >= (long) (1.0f * sampleRate / refresh.displayRefreshStepSkips)) {
 					blinkCount = 0l;
 					blinkNum--;
 				}
 			}		
 			// To Expander
 			if (rightExpander.module && rightExpander.module->model == modelGateSeq64Expander) {
-				float *messagesToExpander = (float*)(rightExpander.module->leftExpander.producerMessage);
+				float *messagesToExpander = toExpander.message;
 				messagesToExpander[0] = (float)panelTheme;
-				rightExpander.module->leftExpander.messageFlipRequested = true;
+				toExpander.sendRight(this);
+			}
+			else {
+				toExpander.reset();
 			}
 		}// lightRefreshCounter
 
@@ -1161,11 +1190,10 @@ struct GateSeq64 : Module {
 struct GateSeq64Widget : ModuleWidget {
 	SvgPanel* darkPanel;
 		
-	struct SequenceDisplayWidget : LightWidget {//TransparentWidget {
+	struct SequenceDisplayWidget : CachedDisplayWidget {
 		GateSeq64 *module;
 		std::shared_ptr<Font> font;
 		std::string fontPath;
-		char displayStr[16];
 		int lastNum = -1;// -1 means timedout; >= 0 means we have a first number potential, if ever second key comes fast enough
 		clock_t lastTime = 0;
 		
@@ -1202,7 +1230,7 @@ struct GateSeq64Widget : ModuleWidget {
 						}
 					}
 				}
-				module->editingPhraseSongRunning = (long) (GateSeq64::editingPhraseSongRunningTime * APP->engine->getSampleRate() / RefreshCounter::displayRefreshStepSkips);				
+				module->editingPhraseSongRunning = (long) (GateSeq64::editingPhraseSongRunningTime * APP->engine->getSampleRate() / module->refresh.displayRefreshStepSkips);				
 				if (num != -1) {
 					int totalNum = num;
 					if (num1 != -1) {
@@ -1248,7 +1276,7 @@ struct GateSeq64Widget : ModuleWidget {
 				snprintf(displayStr, 4, "%s", modeLabels[num].c_str());
 		}
 
-		void draw(const DrawArgs &args) override {
+		void drawDisplay(const DrawArgs &args) override {
 			if (!(font = APP->window->loadFont(fontPath))) {
 				return;
 			}
@@ -1257,8 +1285,11 @@ struct GateSeq64Widget : ModuleWidget {
 			Vec textPos = VecPx(6, 24);
 			nvgFillColor(args.vg, nvgTransRGBA(textColor, displayAlpha));
 			nvgText(args.vg, textPos.x, textPos.y, "~~~", NULL);
-			nvgFillColor(args.vg, textColor);				
-			
+			nvgFillColor(args.vg, textColor);
+			nvgText(args.vg, textPos.x, textPos.y, displayStr, NULL);
+		}
+
+		void updateDisplay() override {
 			if (module == NULL) {
 				snprintf(displayStr, 4, "  1");
 			}
@@ -1330,7 +1361,6 @@ struct GateSeq64Widget : ModuleWidget {
 					snprintf(displayStr, 4, "%c%2u", specialCode, (unsigned)(dispVal) + 1 );
 				}
 			}
-			nvgText(args.vg, textPos.x, textPos.y, displayStr, NULL);
 		}
 	};	
 		
@@ -1421,6 +1451,14 @@ struct GateSeq64Widget : ModuleWidget {
 		rorItem->module = module;
 		menu->addChild(rorItem);
 
+		ClockBusSourceItem *busItem = createMenuItem<ClockBusSourceItem>("Clock input is poly clock bus", RIGHT_ARROW);
+		busItem->clockBusSourcePtr = &module->clockBusSource;
+		menu->addChild(busItem);
+
+		RandomSeedItem *seedItem = createMenuItem<RandomSeedItem>("Random seed", RIGHT_ARROW);
+		seedItem->rngPtr = &module->rng;
+		menu->addChild(seedItem);
+
 		StopAtEndOfSongItem *loopItem = createMenuItem<StopAtEndOfSongItem>("Single shot song", CHECKMARK(module->stopAtEndOfSong));
 		loopItem->module = module;
 		menu->addChild(loopItem);
@@ -1650,8 +1688,7 @@ struct GateSeq64Widget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((GateSeq64*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((GateSeq64*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((GateSeq64*)module)->panelTheme);
 		}
 		Widget::step();
 	}
@@ -25,7 +25,8 @@ struct GateSeq64Expander : Module {
 
 
 	// Expander
-	float leftMessages[2][1] = {};// messages from mother
+	ExpanderChannel<float[1]> fromMother;// messages from mother
+	ExpanderSender<float[6]> toMother;// messages to mother
 
 
 	// No need to save
@@ -36,8 +37,7 @@ struct GateSeq64Expander : Module {
 	GateSeq64Expander() {
 		config(0, NUM_INPUTS, 0, 0);
 		
-		leftExpander.producerMessage = leftMessages[0];
-		leftExpander.consumerMessage = leftMessages[1];
+		fromMother.construct(&leftExpander);
 		
 		panelTheme = (loadDarkAsDefault() ? 1 : 0);
 	}
@@ -51,17 +51,22 @@ struct GateSeq64Expander : Module {
 			bool motherPresent = (leftExpander.module && leftExpander.module->model == modelGateSeq64);
 			if (motherPresent) {
 				// To Mother
-				float *messagesToMother = (float*)leftExpander.module->rightExpander.producerMessage;
+				float *messagesToMother = toMother.message;
 				messagesToMother[0] = (inputs[0].isConnected() ? inputs[0].getVoltage() : std::numeric_limits<float>::quiet_NaN());
 				messagesToMother[1] = (inputs[1].isConnected() ? inputs[1].getVoltage() : std::numeric_limits<float>::quiet_NaN());
 				for (int i = 2; i < NUM_INPUTS; i++) {
 					messagesToMother[i] = inputs[i].getVoltage();
 				}
-				leftExpander.module->rightExpander.messageFlipRequested = true;
+				toMother.sendLeft(this);
 
 				// From Mother
-				float *messagesFromMother = (float*)leftExpander.consumerMessage;
-				panelTheme = clamp((int)(messagesFromMother[0] + 0.5f), 0, 1);
+				if (fromMother.receive()) {
+					panelTheme = clamp((int)(fromMother.data()[0] + 0.5f), 0, 1);
+				}
+			}
+			else {
+				fromMother.reset();
+				toMother.reset();
 			}		
 		}// expanderRefreshCounter
 	}// process()
@@ -101,8 +106,7 @@ struct GateSeq64ExpanderWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((GateSeq64Expander*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((GateSeq64Expander*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((GateSeq64Expander*)module)->panelTheme);
 		}
 		Widget::step();
 	}
@@ -21,7 +21,7 @@ class StepAttributesGS {
 	static const unsigned short ATT_MSK_INITSTATE =  50;
 	
 	inline void init() {attributes = ATT_MSK_INITSTATE;}
-	inline void randomize() {attributes = ( (random::u32() % 101) | (random::u32() & (ATT_MSK_GATEP | ATT_MSK_GATE/* | ATT_MSK_GATEMODE*/)) );}
+	inline void randomize(ModuleRandom& rng) {attributes = ( (rng.u32() % 101) | (rng.u32() & (ATT_MSK_GATEP | ATT_MSK_GATE/* | ATT_MSK_GATEMODE*/)) );}
 		
 	inline bool getGate() {return (attributes & ATT_MSK_GATE) != 0;}
 	inline bool getGateP() {return (attributes & ATT_MSK_GATEP) != 0;}
@@ -52,7 +52,7 @@ class SeqAttributesGS {
 	static const unsigned short SEQ_MSK_RUNMODE =   0x0000FF00, runModeShift = 8;
 	
 	inline void init(int length, int runMode) {attributes = ((length) | (((unsigned short)runMode) << runModeShift));}
-	inline void randomize(int maxSteps, int numModes) {attributes = ( (2 + (random::u32() % (maxSteps - 1))) | (((unsigned short)(random::u32() % numModes) << runModeShift)) );}
+	inline void randomize(int maxSteps, int numModes, ModuleRandom& rng) {attributes = ( (2 + (rng.u32() % (maxSteps - 1))) | (((unsigned short)(rng.u32() % numModes) << runModeShift)) );}
 	
 	inline int getLength() {return (int)(attributes & SEQ_MSK_LENGTH);}
 	inline int getRunMode() {return (int)((attributes & SEQ_MSK_RUNMODE) >> runModeShift);}
@@ -83,25 +83,21 @@ inline int indexToPpsGS(int index) {// inverse map of ppsToIndex()
 	return 24; 
 }
 
-inline bool calcGate(int gateCode, Trigger clockTrigger) {
+inline bool calcGate(int gateCode, Trigger& clockTrigger) {
 	if (gateCode < 2) 
 		return gateCode == 1;
 	return clockTrigger.isHigh();
 }		
 
 
-//										1/4		DUO			D2			TR1		TR2		TR3 		TR23	   TRI
-const uint32_t advGateHitMaskGS[8] = {0x00003F, 0x03F03F, 0x03F000, 0x00000F, 0x000F00, 0x0F0000, 0x0F0F00, 0x0F0F0F};
-
 int getAdvGateGS(int ppqnCount, int pulsesPerStep, int gateMode) { 
-	uint32_t shiftAmt = ppqnCount * (24 / pulsesPerStep);
-	return (int)((advGateHitMaskGS[gateMode] >> shiftAmt) & (uint32_t)0x1);
+	return advGatePatternsGS[gateMode].isHit(ppqnCount, pulsesPerStep);
 }	
 
 
-int calcGateCode(StepAttributesGS attribute, int ppqnCount, int pulsesPerStep) {
+int calcGateCode(StepAttributesGS attribute, int ppqnCount, int pulsesPerStep, ModuleRandom& rng) {
 	// -1 = gate off for whole step, 0 = gate off for current ppqn, 1 = gate on, 2 = clock high
-	if (ppqnCount == 0 && attribute.getGateP() && !(random::uniform() < ((float)(attribute.getGatePVal())/100.0f)))// random::uniform is [0.0, 1.0), see include/util/common.hpp
+	if (ppqnCount == 0 && attribute.getGateP() && !(rng.uniform() < ((float)(attribute.getGatePVal())/100.0f)))// rng.uniform is [0.0, 1.0)
 		return -1;
 	if (!attribute.getGate())
 		return 0;
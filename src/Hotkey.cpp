@@ -286,6 +286,7 @@ struct Hotkey : Module {
 
 	
 	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
 	}		
 	
 	
@@ -329,7 +330,7 @@ struct Hotkey : Module {
 		
 		// lights
 		if (refresh.processLights()) {
-			float deltaTime = (float)args.sampleTime * (RefreshCounter::displayRefreshStepSkips);
+			float deltaTime = (float)args.sampleTime * (refresh.displayRefreshStepSkips);
 			lights[RECORD_KEY_LIGHT + 0].setSmoothBrightness(trigLightPulse.process(deltaTime) > 0.0f ? 1.0f : 0.0f, deltaTime);// green
 			lights[RECORD_KEY_LIGHT + 1].setBrightness(params[RECORD_KEY_PARAM].getValue());// red
 		}// lightRefreshCounter
@@ -420,8 +421,7 @@ struct HotkeyWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((Hotkey*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((Hotkey*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((Hotkey*)module)->panelTheme);
 		}
 		Widget::step();
 	}
@@ -13,6 +13,8 @@
 
 Plugin *pluginInstance;
 
+static void loadSettings();
+
 
 void init(rack::Plugin *p) {
 	pluginInstance = p;
@@ -45,6 +47,8 @@ void init(rack::Plugin *p) {
 	p->addModel(modelWriteSeq32);
 	p->addModel(modelWriteSeq64);
 	p->addModel(modelBlankPanel);
+
+	loadSettings();
 }
 
 
@@ -52,10 +56,61 @@ void init(rack::Plugin *p) {
 
 ClockMaster clockMaster;  
 
+// only used from the UI thread; there are only ever a few clock modules, so a plain vector is the fastest lookup
+static std::vector<ModuleWidget*> clockWidgets;
+
+void registerClockWidget(ModuleWidget* moduleWidget) {
+	clockWidgets.push_back(moduleWidget);
+}
+
+void unregisterClockWidget(ModuleWidget* moduleWidget) {
+	clockWidgets.erase(std::remove(clockWidgets.begin(), clockWidgets.end(), moduleWidget), clockWidgets.end());
+}
+
+ModuleWidget* findClockWidget(int id) {
+	for (ModuleWidget* moduleWidget : clockWidgets) {
+		if (moduleWidget->module->id == id) {
+			return moduleWidget;
+		}
+	}
+	return nullptr;
+}
+
 
 
 // General functions
 
+// Refresh slots, see RefreshCounter; the slot counts are plain variables since these are only written from the UI thread
+static const unsigned int NUM_REFRESH_SLOTS = 256;
+static int refreshSlotUseCounts[NUM_REFRESH_SLOTS] = {};
+std::atomic<RefreshCounter*> refreshLeader(nullptr);
+std::atomic<unsigned int> refreshFrame(0);
+
+unsigned int allocRefreshSlot() {
+	unsigned int slot = 0;
+	for (unsigned int i = 1; i < NUM_REFRESH_SLOTS; i++) {
+		if (refreshSlotUseCounts[i] < refreshSlotUseCounts[slot]) {
+			slot = i;
+		}
+	}
+	refreshSlotUseCounts[slot]++;
+	return slot;
+}
+
+void releaseRefreshSlot(unsigned int slot) {
+	refreshSlotUseCounts[slot]--;
+}
+
+unsigned int refreshSlotPhase(unsigned int slot, unsigned int stepSkips) {
+	// bit-reversed slot number, so that any run of consecutive slots is spread evenly over the refresh period
+	unsigned int reversed = 0;
+	for (unsigned int bit = 1; bit < NUM_REFRESH_SLOTS; bit <<= 1) {
+		reversed = (reversed << 1) | ((slot & bit) != 0 ? 1 : 0);
+	}
+	return (reversed * stepSkips) / NUM_REFRESH_SLOTS;
+}
+
+
 
 NVGcolor prepareDisplay(NVGcontext *vg, Rect *box, int fontSize) {
 	NVGcolor backgroundColor = nvgRGB(0x38, 0x38, 0x38); 
@@ -73,6 +128,34 @@ NVGcolor prepareDisplay(NVGcontext *vg, Rect *box, int fontSize) {
 }
 
 
+CachedDisplayWidget::CachedDisplayWidget() {
+	fb = new FramebufferWidget();
+	renderer = new DisplayRenderer();
+	renderer->display = this;
+	fb->addChild(renderer);
+	addChild(fb);
+}
+
+void CachedDisplayWidget::step() {
+	updateDisplay();
+	if (displayAux != lastDisplayAux || strncmp(displayStr, lastDisplayStr, 16) != 0) {
+		memcpy(lastDisplayStr, displayStr, 16);
+		lastDisplayAux = displayAux;
+		fb->dirty = true;
+	}
+	if (!fb->box.size.isEqual(box.size)) {// displays set their box after construction
+		fb->box.size = box.size;
+		renderer->box.size = box.size;
+		fb->dirty = true;
+	}
+	LightWidget::step();
+}
+
+void CachedDisplayWidget::draw(const DrawArgs &args) {
+	Widget::draw(args);// draws the framebuffer
+}
+
+
 static const char noteLettersSharp[12] = {'C', 'C', 'D', 'D', 'E', 'F', 'F', 'G', 'G', 'A', 'A', 'B'};
 static const char noteLettersFlat [12] = {'C', 'D', 'D', 'E', 'E', 'F', 'G', 'G', 'A', 'A', 'B', 'B'};
 static const char isBlackKey      [12] = { 0,   1,   0,   1,   0,   0,   1,   0,   1,   0,   1,   0 };
@@ -136,9 +219,13 @@ int moveIndex(int index, int indexNext, int numSteps) {
 }
 
 
-void saveDarkAsDefault(bool darkAsDefault) {
+// Plugin-wide user settings, read from disk once in init() and then kept in memory, 
+//   so that module constructors and context menus never touch the settings file
+static bool darkAsDefaultSetting = false;
+
+static void writeSettings() {
 	json_t *settingsJ = json_object();
-	json_object_set_new(settingsJ, "darkAsDefault", json_boolean(darkAsDefault));
+	json_object_set_new(settingsJ, "darkAsDefault", json_boolean(darkAsDefaultSetting));
 	std::string settingsFilename = asset::user("ImpromptuModular.json");
 	FILE *file = fopen(settingsFilename.c_str(), "w");
 	if (file) {
@@ -148,29 +235,39 @@ void saveDarkAsDefault(bool darkAsDefault) {
 	json_decref(settingsJ);
 }
 
-bool loadDarkAsDefault() {
-	bool ret = false;
+static void loadSettings() {
+	darkAsDefaultSetting = false;
 	std::string settingsFilename = asset::user("ImpromptuModular.json");
 	FILE *file = fopen(settingsFilename.c_str(), "r");
 	if (!file) {
-		saveDarkAsDefault(false);
-		return ret;
+		writeSettings();
+		return;
 	}
 	json_error_t error;
 	json_t *settingsJ = json_loadf(file, 0, &error);
 	if (!settingsJ) {
 		// invalid setting json file
 		fclose(file);
-		saveDarkAsDefault(false);
-		return ret;
+		writeSettings();
+		return;
 	}
 	json_t *darkAsDefaultJ = json_object_get(settingsJ, "darkAsDefault");
 	if (darkAsDefaultJ)
-		ret = json_boolean_value(darkAsDefaultJ);
+		darkAsDefaultSetting = json_boolean_value(darkAsDefaultJ);
 	
 	fclose(file);
 	json_decref(settingsJ);
-	return ret;
+}
+
+void saveDarkAsDefault(bool darkAsDefault) {
+	if (darkAsDefault != darkAsDefaultSetting) {
+		darkAsDefaultSetting = darkAsDefault;
+		writeSettings();
+	}
+}
+
+bool loadDarkAsDefault() {
+	return darkAsDefaultSetting;
 }
 
 
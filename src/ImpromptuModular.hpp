@@ -10,6 +10,7 @@
 #pragma once
 
 #include "rack.hpp"
+#include <atomic>
 #include "comp/DynamicComponents.hpp"
 #include "comp/GenericComponents.hpp"
 
@@ -61,6 +62,12 @@ static const unsigned int expanderRefreshStepSkips = 4;
 
 // General objects
 
+// Registry of the live clock module widgets (Clocked and Clkd), maintained by their widget constructors and destructors, 
+//   so that the clock master and the autopatch target are found without scanning every module in the rack
+void registerClockWidget(ModuleWidget* moduleWidget);
+void unregisterClockWidget(ModuleWidget* moduleWidget);
+ModuleWidget* findClockWidget(int id);// nullptr when no live clock module has this id
+
 struct ClockMaster {// should not need to have mutex since only menu driven
 	int id = -1;
 	bool resetClockOutputsHigh;
@@ -84,19 +91,105 @@ struct ClockMaster {// should not need to have mutex since only menu driven
 	}
 	
 	bool validateClockModule() {
-		for (Widget* widget : APP->scene->rack->moduleContainer->children) {
-			ModuleWidget* moduleWidget = dynamic_cast<ModuleWidget *>(widget);
-			if (moduleWidget && moduleWidget->module->id == id) {
-				if (moduleWidget->model->slug.substr(0, 7) == std::string("Clocked")) {
-					return true;
-				}
-			}
-		}
-		return false;
+		return findClockWidget(id) != nullptr;
 	}
 }; 
 extern ClockMaster clockMaster;
 
+// Clock bus: when enabled in Clocked or Clkd, their master clock output becomes polyphonic and also carries the sub-clocks, 
+//   reset, run and bpm, so that a sequencer can be driven with a single cable into its clock input
+enum ClockBusChannelIds {CLKBUS_MASTER, CLKBUS_SUB1, CLKBUS_SUB2, CLKBUS_SUB3, CLKBUS_RESET, CLKBUS_RUN, CLKBUS_BPM, CLKBUS_NUM_CHANNELS};
+
+// in sequencers, clockBusSource is 0 when the clock input is a regular clock, or 1 to 4 to decode a clock bus and use its master clock or clock 1 to 3
+inline bool isClockBus(Input& input, int clockBusSource) {
+	return clockBusSource != 0 && input.getChannels() >= CLKBUS_NUM_CHANNELS;
+}
+inline float getClockBusClock(Input& input, int clockBusSource) {
+	return isClockBus(input, clockBusSource) ? input.getVoltage(CLKBUS_MASTER + clockBusSource - 1) : input.getVoltage();
+}
+inline float getClockBusChannel(Input& input, int clockBusSource, int channel) {// reset or run, 0V when not decoding a clock bus
+	return isClockBus(input, clockBusSource) ? input.getVoltage(channel) : 0.0f;
+}
+
+
+// Expander messaging: the receiving module owns an ExpanderChannel<T> on the side the messages arrive (it holds the 
+//   producer/consumer double buffer), and the sending module owns an ExpanderSender<T>; each frame carries the sender's 
+//   module id and a version, so that a message is only written and flipped when it changed, and the receiver can skip 
+//   decoding frames it has already seen; T must be trivially copyable (a struct or an array of floats)
+template <typename T>
+struct ExpanderFrame {
+	T data;
+	int senderId;
+	uint32_t version;// 0 when nothing was sent yet
+};
+
+template <typename T>
+struct ExpanderChannel {
+	ExpanderFrame<T> frames[2] = {};
+	Module::Expander* expander;
+	int lastSenderId = -1;
+	uint32_t lastVersion = 0;
+	
+	void construct(Module::Expander* _expander) {// call in the module's constructor, with the expander side the messages arrive on
+		expander = _expander;
+		expander->producerMessage = &frames[0];
+		expander->consumerMessage = &frames[1];
+	}
+	
+	T& data() {// latest message, always valid (all zeros when nothing was received yet)
+		return ((ExpanderFrame<T>*)expander->consumerMessage)->data;
+	}
+	bool receive() {// true when data() holds a message that was not seen by a previous call
+		ExpanderFrame<T>* frame = (ExpanderFrame<T>*)expander->consumerMessage;
+		if (frame->version == 0 || (frame->senderId == lastSenderId && frame->version == lastVersion)) {
+			return false;
+		}
+		lastSenderId = frame->senderId;
+		lastVersion = frame->version;
+		return true;
+	}
+	void reset() {// call when the sender is not adjacent, so that the next receive() returns true for any message
+		lastSenderId = -1;
+		lastVersion = 0;
+	}
+};
+
+template <typename T>
+struct ExpanderSender {
+	T message;// fill this, then call sendLeft() or sendRight()
+	T lastSent;
+	uint32_t version = 0;
+	int receiverId = -1;// -1 when the next message must be sent even if it did not change
+	
+	void reset() {// call when no receiver is adjacent, so that the next one gets a message right away
+		receiverId = -1;
+	}
+	void sendRight(Module* sender) {
+		send(sender, sender->rightExpander.module, sender->rightExpander.module->leftExpander);
+	}
+	void sendLeft(Module* sender) {
+		send(sender, sender->leftExpander.module, sender->leftExpander.module->rightExpander);
+	}
+	
+	private:
+	
+	void send(Module* sender, Module* receiver, Module::Expander& receiverExpander) {
+		if (receiver->id == receiverId && std::memcmp(&message, &lastSent, sizeof(T)) == 0) {
+			return;
+		}
+		ExpanderFrame<T>* frame = (ExpanderFrame<T>*)receiverExpander.producerMessage;
+		std::memcpy(&frame->data, &message, sizeof(T));
+		frame->senderId = sender->id;
+		if (++version == 0) {
+			version = 1;
+		}
+		frame->version = version;
+		receiverExpander.messageFlipRequested = true;
+		std::memcpy(&lastSent, &message, sizeof(T));
+		receiverId = receiver->id;
+	}
+};
+
 
 struct VecPx : Vec {
 	// temporary method to avoid having to convert all px coordinates to mm; no use when making a new module (since mm is the standard)
@@ -108,29 +201,206 @@ struct VecPx : Vec {
 };
 
 
+// Plugin-wide refresh slot allocator, used by RefreshCounter to give each module instance its own refresh phase,
+//   so that the control-rate work of many modules is spread as evenly as possible over time
+struct RefreshCounter;
+unsigned int allocRefreshSlot();// least used slot first, so that slots of removed modules are reclaimed
+void releaseRefreshSlot(unsigned int slot);
+unsigned int refreshSlotPhase(unsigned int slot, unsigned int stepSkips);
+// the two below are shared by modules that the engine may process on different threads, hence atomic (relaxed, since 
+//   a momentarily stale value only shifts a refresh phase)
+extern std::atomic<RefreshCounter*> refreshLeader;// the counter that advances refreshFrame (only ever compared, never dereferenced)
+extern std::atomic<unsigned int> refreshFrame;// common time reference for all counters, in samples
+
+
 struct RefreshCounter {
 	// Note: because of stagger, and asyncronous dataFromJson, should not assume this processInputs() will return true on first run
 	// of module::process()
-	static const unsigned int displayRefreshStepSkips = 256;
-	static const unsigned int userInputsStepSkipMask = 0xF;// sub interval of displayRefreshStepSkips, since inputs should be more responsive than lights
-	// above value should make it such that inputs are sampled > 1kHz so as to not miss 1ms triggers
+	static constexpr float userInputsRate = 1000.0f;// Hz, inputs are scanned faster than this so as to not miss 1ms triggers
+	static constexpr float displayRefreshRate = 60.0f;// Hz, lights are refreshed at this rate or a bit faster
+	
+	// both below are powers of two derived from the sample rate (see onSampleRateChange()), so that the per-sample checks stay cheap
+	unsigned int displayRefreshStepSkips;
+	unsigned int userInputsStepSkipMask;// sub interval of displayRefreshStepSkips, since inputs should be more responsive than lights
+	unsigned int refreshCounter = 0;
+	unsigned int slot;
+	unsigned int phase;// offset of this counter with respect to refreshFrame, from its slot
+	unsigned int lastFrame = 0;// refreshFrame as seen at the previous light refresh, to detect a leader that stopped (removed or bypassed)
+	bool aligned = false;
+	
+	RefreshCounter() {
+		slot = allocRefreshSlot();
+		onSampleRateChange();
+	}
+	~RefreshCounter() {
+		releaseRefreshSlot(slot);
+		RefreshCounter* self = this;
+		refreshLeader.compare_exchange_strong(self, nullptr, std::memory_order_relaxed);
+	}
 	
-	unsigned int refreshCounter = (random::u32() % displayRefreshStepSkips);// stagger start values to avoid processing peaks when many Geo and Impromptu modules in the patch
+	void onSampleRateChange() {// must be called by the module's onSampleRateChange()
+		float sampleRate = APP->engine->getSampleRate();
+		unsigned int inputSkips = 1;
+		while ((float)(inputSkips << 1) < sampleRate / userInputsRate) {
+			inputSkips <<= 1;
+		}
+		displayRefreshStepSkips = inputSkips;
+		while ((float)(displayRefreshStepSkips << 1) <= sampleRate / displayRefreshRate) {
+			displayRefreshStepSkips <<= 1;
+		}
+		userInputsStepSkipMask = inputSkips - 1;
+		phase = refreshSlotPhase(slot, displayRefreshStepSkips);
+		aligned = false;
+	}
+	
+	void align() {
+		RefreshCounter* noLeader = nullptr;
+		refreshLeader.compare_exchange_strong(noLeader, this, std::memory_order_relaxed);
+		// lights are processed when (refreshFrame + phase) is a multiple of displayRefreshStepSkips
+		lastFrame = refreshFrame.load(std::memory_order_relaxed);
+		refreshCounter = (lastFrame + phase) & (displayRefreshStepSkips - 1);
+		aligned = true;
+	}
 	
 	bool processInputs() {
 		return ((refreshCounter & userInputsStepSkipMask) == 0);
 	}
-	bool processLights() {// this must be called even if module has no lights, since counter is decremented here
+	bool processLights() {// this must be called even if module has no lights, since counter is incremented here
+		if (refreshLeader.load(std::memory_order_relaxed) == this) {
+			refreshFrame.store(refreshFrame.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);// only the leader writes, except on a take over below
+		}
+		if (!aligned) {
+			align();
+		}
 		refreshCounter++;
 		bool process = refreshCounter >= displayRefreshStepSkips;
 		if (process) {
 			refreshCounter = 0;
+			unsigned int frame = refreshFrame.load(std::memory_order_relaxed);
+			if (frame == lastFrame) {// leader was removed or is bypassed, take over while keeping refreshFrame consistent with the other counters
+				refreshLeader.store(this, std::memory_order_relaxed);
+				frame += displayRefreshStepSkips - ((frame + phase) & (displayRefreshStepSkips - 1));
+				refreshFrame.store(frame, std::memory_order_relaxed);
+			}
+			lastFrame = frame;
 		}
 		return process;
 	}
 };
 
 
+struct SampleTimings {
+	// sample-rate dependent lengths, in samples, so that process() doesn't recompute them every sample
+	static constexpr float gateTriggerDuration = 0.01f;// seconds, length of the trigger gate type in the sequencers
+	
+	unsigned long gateTrigger;
+	long clockIgnoreOnReset;// see clockIgnoreOnResetDuration
+	
+	SampleTimings() {
+		onSampleRateChange();
+	}
+	
+	void onSampleRateChange() {// must be called by the module's onSampleRateChange()
+		float sampleRate = APP->engine->getSampleRate();
+		gateTrigger = (unsigned long) (sampleRate * gateTriggerDuration);
+		clockIgnoreOnReset = (long) (clockIgnoreOnResetDuration * sampleRate);
+	}
+};
+
+
+struct ModuleRandom {
+	// per-module random generator (xoshiro128**), so that a module's random values do not depend on other modules;
+	//   with a fixed seed (saved in the patch) a module produces the same random stream every time, 0 means unseeded
+	uint32_t seed = 0;
+	bool reseedOnReset = false;
+	uint32_t state[4];
+	
+	ModuleRandom() {
+		reseed();
+	}
+	
+	void reseed() {
+		// splitmix64 to spread the seed over the state, which must not be all zeros
+		uint64_t x = (seed != 0 ? seed : random::u64());
+		for (int i = 0; i < 4; i += 2) {
+			x += 0x9E3779B97F4A7C15ULL;
+			uint64_t z = x;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			z ^= (z >> 31);
+			state[i] = (uint32_t)z;
+			state[i + 1] = (uint32_t)(z >> 32);
+		}
+	}
+	void init() {// call in module's onReset()
+		seed = 0;
+		reseedOnReset = false;
+		reseed();
+	}
+	void onSeqReset() {// call when the sequencer is reset
+		if (reseedOnReset && seed != 0) {
+			reseed();
+		}
+	}
+	
+	uint32_t u32() {
+		uint32_t result = rotl(state[1] * 5, 7) * 9;
+		uint32_t t = state[1] << 9;
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = rotl(state[3], 11);
+		return result;
+	}
+	uint64_t u64() {
+		return ((uint64_t)u32() << 32) | u32();
+	}
+	float uniform() {// [0.0, 1.0), same as random::uniform()
+		return (u32() >> 8) * (1.0f / 16777216.0f);
+	}
+	float normal() {// Box-Muller, mean 0 and std dev 1
+		float u1 = 1.0f - uniform();// (0.0, 1.0]
+		float u2 = uniform();
+		return std::sqrt(-2.0f * std::log(u1)) * std::cos(2.0f * float(M_PI) * u2);
+	}
+	
+	// the state alone gives the rest of the stream, so that a copy can draw ahead and have its draws committed later
+	void getState(uint32_t* dest) const {
+		for (int i = 0; i < 4; i++)
+			dest[i] = state[i];
+	}
+	void setState(const uint32_t* src) {
+		for (int i = 0; i < 4; i++)
+			state[i] = src[i];
+	}
+	bool hasState(const uint32_t* src) const {
+		return state[0] == src[0] && state[1] == src[1] && state[2] == src[2] && state[3] == src[3];
+	}
+	
+	void dataToJson(json_t *rootJ) {
+		json_object_set_new(rootJ, "rngSeed", json_integer(seed));
+		json_object_set_new(rootJ, "rngReseedOnReset", json_boolean(reseedOnReset));
+	}
+	void dataFromJson(json_t *rootJ) {
+		json_t *seedJ = json_object_get(rootJ, "rngSeed");
+		if (seedJ)
+			seed = (uint32_t)json_integer_value(seedJ);
+		json_t *reseedOnResetJ = json_object_get(rootJ, "rngReseedOnReset");
+		if (reseedOnResetJ)
+			reseedOnReset = json_is_true(reseedOnResetJ);
+		reseed();
+	}
+	
+	private:
+	
+	static inline uint32_t rotl(uint32_t x, int k) {
+		return (x << k) | (x >> (32 - k));
+	}
+};
+
+
 struct Trigger : dsp::SchmittTrigger {
 	// implements a 0.1V - 1.0V SchmittTrigger (see include/dsp/digital.hpp) instead of 
 	//   calling SchmittTriggerInstance.process(math::rescale(in, 0.1f, 1.f, 0.f, 1.f))
@@ -220,6 +490,31 @@ inline bool calcWarningFlash(long count, long countInit) {
 
 NVGcolor prepareDisplay(NVGcontext *vg, Rect *box, int fontSize);
 
+struct CachedDisplayWidget : LightWidget {
+	// LED display drawn through a framebuffer: derived displays set displayStr (and displayAux for any other drawing state, 
+	//   such as a color) in updateDisplay(), which is called in every step(), and draw them in drawDisplay(), which is 
+	//   only called when displayStr or displayAux have changed since the last redraw
+	struct DisplayRenderer : TransparentWidget {
+		CachedDisplayWidget* display;
+		void draw(const DrawArgs &args) override {
+			display->drawDisplay(args);
+		}
+	};
+	
+	FramebufferWidget* fb;
+	DisplayRenderer* renderer;
+	char displayStr[16] = {};
+	int displayAux = 0;
+	char lastDisplayStr[16] = {};
+	int lastDisplayAux = 0;
+	
+	CachedDisplayWidget();
+	virtual void updateDisplay() = 0;
+	virtual void drawDisplay(const DrawArgs &args) = 0;
+	void step() override;
+	void draw(const DrawArgs &args) override;
+};
+
 inline void calcNoteAndOct(float cv, int* note12, int* oct0) {
 	// note12 is a note index (0 to 11) representing the C to B keys respectively
 	// oct0 is an octave number, 0 representing octave 4 (as in C4 for example)
@@ -230,8 +525,8 @@ int printNote(float cvVal, char* text, bool sharp);
 
 int moveIndex(int index, int indexNext, int numSteps);
 
-void saveDarkAsDefault(bool darkAsDefault);
-bool loadDarkAsDefault();
+void saveDarkAsDefault(bool darkAsDefault);// updates the cached setting and writes it to disk
+bool loadDarkAsDefault();// reads the cached setting only, never touches the disk
 
 struct DarkDefaultItem : MenuItem {
 	void onAction(const event::Action &e) override {
@@ -239,6 +534,82 @@ struct DarkDefaultItem : MenuItem {
 	}
 };	
 
+struct ClockBusSourceItem : MenuItem {
+	int *clockBusSourcePtr;
+	
+	struct ClockBusSourceSubItem : MenuItem {
+		int *clockBusSourcePtr;
+		int setVal;
+		void onAction(const event::Action &e) override {
+			*clockBusSourcePtr = setVal;
+		}
+	};
+	
+	Menu *createChildMenu() override {
+		Menu *menu = new Menu;
+		
+		const std::string sourceNames[5] = {"Off (regular clock)", "Master clock", "Clock 1", "Clock 2", "Clock 3"};
+		for (int i = 0; i < 5; i++) {
+			ClockBusSourceSubItem *srcItem = createMenuItem<ClockBusSourceSubItem>(sourceNames[i], CHECKMARK(*clockBusSourcePtr == i));
+			srcItem->clockBusSourcePtr = clockBusSourcePtr;
+			srcItem->setVal = i;
+			menu->addChild(srcItem);
+		}
+		
+		return menu;
+	}
+};
+
+struct RandomSeedItem : MenuItem {
+	ModuleRandom *rngPtr;
+	bool showReseedOnReset = true;
+	
+	struct UnseededItem : MenuItem {
+		ModuleRandom *rngPtr;
+		void onAction(const event::Action &e) override {
+			rngPtr->seed = 0;
+			rngPtr->reseed();
+		}
+	};
+	struct FixedSeedItem : MenuItem {
+		ModuleRandom *rngPtr;
+		void onAction(const event::Action &e) override {
+			if (rngPtr->seed == 0) {
+				rngPtr->seed = random::u32() | 0x1;// must not be 0
+			}
+			rngPtr->reseed();
+		}
+	};
+	struct ReseedOnResetItem : MenuItem {
+		ModuleRandom *rngPtr;
+		void onAction(const event::Action &e) override {
+			rngPtr->reseedOnReset = !rngPtr->reseedOnReset;
+		}
+	};
+	
+	Menu *createChildMenu() override {
+		Menu *menu = new Menu;
+		
+		UnseededItem *unseededItem = createMenuItem<UnseededItem>("Unseeded (different each time)", CHECKMARK(rngPtr->seed == 0));
+		unseededItem->rngPtr = rngPtr;
+		menu->addChild(unseededItem);
+
+		std::string fixedText = (rngPtr->seed == 0 ? "Fixed seed" : string::f("Fixed seed %08X (restart)", rngPtr->seed));
+		FixedSeedItem *fixedItem = createMenuItem<FixedSeedItem>(fixedText, CHECKMARK(rngPtr->seed != 0));
+		fixedItem->rngPtr = rngPtr;
+		menu->addChild(fixedItem);
+
+		if (showReseedOnReset) {
+			ReseedOnResetItem *reseedItem = createMenuItem<ReseedOnResetItem>("Reseed on reset", CHECKMARK(rngPtr->reseedOnReset));
+			reseedItem->rngPtr = rngPtr;
+			reseedItem->disabled = (rngPtr->seed == 0);
+			menu->addChild(reseedItem);
+		}
+		
+		return menu;
+	}
+};
+
 struct InstantiateExpanderItem : MenuItem {
 	Model *model;
 	Vec posit;
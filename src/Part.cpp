@@ -70,6 +70,11 @@ struct Part : Module {
 		showPlusMinus = true;
 		resetNonJson();
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+	}
+	
 	void resetNonJson() {
 	}
 	
@@ -146,11 +151,10 @@ struct Part : Module {
 struct PartWidget : ModuleWidget {
 	SvgPanel* darkPanel;
 
-	struct SplitDisplayWidget : LightWidget {//TransparentWidget {
+	struct SplitDisplayWidget : CachedDisplayWidget {// displayStr has two chars left of decimal point, then decimal point, then two chars right of decimal point, plus null
 		Part *module;
 		std::shared_ptr<Font> font;
 		std::string fontPath;
-		char displayStr[5 + 1];// room for two chars left of decimal point, then decimal point, then two chars right of decimal point, plus null
 		static const int textFontSize = 15;
 		static constexpr float textOffsetY = 19.9f;
 		
@@ -161,7 +165,7 @@ struct PartWidget : ModuleWidget {
 			fontPath = std::string(asset::plugin(pluginInstance, "res/fonts/Segment14.ttf"));
 		}
 
-		void draw(const DrawArgs &args) override {
+		void drawDisplay(const DrawArgs &args) override {
 			if (!(font = APP->window->loadFont(fontPath))) {
 				return;
 			}
@@ -171,17 +175,15 @@ struct PartWidget : ModuleWidget {
 			nvgTextLetterSpacing(args.vg, -0.4);
 
 			Vec textPos = VecPx(6.3f, textOffsetY);
-			printText();
 			nvgFillColor(args.vg, nvgTransRGBA(textColor, displayAlpha));
 			nvgText(args.vg, textPos.x, textPos.y, "~~", NULL);
 			nvgText(args.vg, textPos.x + offsetXfrac, textPos.y, ".~~", NULL);
 			nvgFillColor(args.vg, textColor);
 			nvgText(args.vg, textPos.x + offsetXfrac, textPos.y, &displayStr[2], NULL);// print decimal point and two chars to the right of decimal point
-			displayStr[2] = 0;
-			nvgText(args.vg, textPos.x, textPos.y, displayStr, NULL);// print two chars to the left of decimal point
+			nvgText(args.vg, textPos.x, textPos.y, displayStr, &displayStr[2]);// print two chars to the left of decimal point
 		}
 
-		void printText() {
+		void updateDisplay() override {
 			if (module == NULL) {
 				snprintf(displayStr, 6, " 0.00");
 			}
@@ -342,8 +344,7 @@ struct PartWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((Part*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((Part*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((Part*)module)->panelTheme);
 		}
 		Widget::step();
 	}
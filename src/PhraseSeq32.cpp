@@ -87,13 +87,35 @@ struct PhraseSeq32 : Module {
 	
 	
 	// Expander
-	float rightMessages[2][5] = {};// messages from expander
+	ExpanderChannel<float[5]> fromExpander;// messages from expander
+	ExpanderSender<float[1]> toExpander;// messages to expander: panelTheme
 
 
 	// Constants
 	enum DisplayStateIds {DISP_NORMAL, DISP_MODE, DISP_LENGTH, DISP_TRANSPOSE, DISP_ROTATE};
 
 
+	// Run state after the next clock edge, computed between clocks by calcNextStep() so that the clock edge only has to 
+	//   commit it; dropped on every user input scan (all edits are made there) and on reset, and computed again on the 
+	//   edge when rng was drawn from since then. What depends on the clock period and the knobs is done on the edge.
+	struct NextStep {
+		bool valid = false;
+		bool editingSequence;
+		uint32_t rngBefore[4];// rng state when computed
+		uint32_t rngAfter[4];
+		int ppqnCount;
+		int stepIndexRun[2];
+		unsigned long stepIndexRunHistory;
+		int phraseIndexRun;
+		unsigned long phraseIndexRunHistory;
+		bool stopRun;// end of song reached
+		int seq;
+		float slideFromCV[2];
+		float gate1ProbDraw[2];// only drawn on the first ppqn of an untied step with gate 1 probability
+		int gate1Code[2];// codes when the probability lets gate 1 through
+		int gate2Code[2];
+	};
+
 	// Need to save, no reset
 	int panelTheme;
 	
@@ -114,6 +136,8 @@ struct PhraseSeq32 : Module {
 	float cv[32][32];// [-3.0 : 3.917]. First index is patten number, 2nd index is step
 	StepAttributes attributes[32][32];// First index is patten number, 2nd index is step (see enum AttributeBitMasks for details)
 	bool resetOnRun;
+	int clockBusSource;// 0 when the clock input is a regular clock, 1 to 4 when it is a clock bus (see ClockBusChannelIds)
+	ModuleRandom rng;// only the seed options are saved
 	bool attached;
 	bool stopAtEndOfSong;
 
@@ -147,10 +171,12 @@ struct PhraseSeq32 : Module {
 	int gate2Code[2];
 	bool lastProbGate1Enable[2];	
 	unsigned long slideStepsRemain[2];// 0 when no slide under way, downward step counter when sliding
+	NextStep nextStep;
 	
 	// No need to save, no reset
 	int stepConfigSync = 0;// 0 means no sync requested, 1 means synchronous read of lengths requested
 	RefreshCounter refresh;
+	SampleTimings timings;
 	float slideCVdelta[2];// no need to initialize, this is a companion to slideStepsRemain	
 	float editingGateCV;// no need to initialize, this is a companion to editingGate (output this only when editingGate > 0)
 	int editingGateKeyLight;// no need to initialize, this is a companion to editingGate (use this only when editingGate > 0)
@@ -192,11 +218,11 @@ struct PhraseSeq32 : Module {
 	}
 
 	
-	void fillStepIndexRunVector(int runMode, int len) {
+	void fillStepIndexRunVector(int* indexRun, int runMode, int len, ModuleRandom& generator) {// indexRun is stepIndexRun or its next step
 		if (runMode != MODE_RN2) 
-			stepIndexRun[1] = stepIndexRun[0];
+			indexRun[1] = indexRun[0];
 		else
-			stepIndexRun[1] = random::u32() % len;
+			indexRun[1] = generator.u32() % len;
 	}
 	
 	void moveStepIndexEdit(int delta, bool _autostepLen) {// 2nd param is for rotate that uses this method also
@@ -216,11 +242,10 @@ struct PhraseSeq32 : Module {
 	PhraseSeq32() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		
-		rightExpander.producerMessage = rightMessages[0];
-		rightExpander.consumerMessage = rightMessages[1];
+		fromExpander.construct(&rightExpander);
 
 		// must init those that have no-connect info to non-connected, or else mother may read 0.0 init value if ever refresh limiters make it such that after a connection of expander the mother reads before the first pass through the expander's writing code, and this may do something undesired (ex: change track in Foundry on expander connected while track CV jack is empty)
-		rightMessages[1][4] = std::numeric_limits<float>::quiet_NaN();
+		fromExpander.frames[1].data[4] = std::numeric_limits<float>::quiet_NaN();
 
 		configParam(CONFIG_PARAM, 0.0f, 1.0f, 0.0f, "Configuration (1, 2 chan)");
 		char strBuf[32];
@@ -288,10 +313,18 @@ struct PhraseSeq32 : Module {
 			}
 		}
 		resetOnRun = false;
+		clockBusSource = 0;
+		rng.init();
 		attached = false;
 		stopAtEndOfSong = false;
 		resetNonJson(false);
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+		timings.onSampleRateChange();
+	}
+	
 	void resetNonJson(bool delayed) {// delay thread sensitive parts (i.e. schedule them so that process() will do them)
 		displayState = DISP_NORMAL;
 		for (int i = 0; i < 32; i++) {
@@ -322,13 +355,14 @@ struct PhraseSeq32 : Module {
 		}
 	}
 	void initRun() {// run button activated, or run edge in run input jack, or stepConfig switch changed, or fromJson()
-		clockIgnoreOnReset = (long) (clockIgnoreOnResetDuration * APP->engine->getSampleRate());
+		clockIgnoreOnReset = timings.clockIgnoreOnReset;
+		rng.onSeqReset();
 		phraseIndexRun = (runModeSong == MODE_REV ? phrases - 1 : 0);
 		phraseIndexRunHistory = 0;
 
 		int seq = (isEditingSequence() ? seqIndexEdit : phrase[phraseIndexRun]);
 		stepIndexRun[0] = (sequences[seq].getRunMode() == MODE_REV ? sequences[seq].getLength() - 1 : 0);
-		fillStepIndexRunVector(sequences[seq].getRunMode(), sequences[seq].getLength());
+		fillStepIndexRunVector(stepIndexRun, sequences[seq].getRunMode(), sequences[seq].getLength(), rng);
 		stepIndexRunHistory = 0;
 
 		ppqnCount = 0;
@@ -339,16 +373,17 @@ struct PhraseSeq32 : Module {
 		}
 		slideStepsRemain[0] = 0ul;
 		slideStepsRemain[1] = 0ul;
+		nextStep.valid = false;
 	}	
 
 	
 	void onRandomize() override {
 		if (isEditingSequence()) {
 			for (int s = 0; s < 32; s++) {
-				cv[seqIndexEdit][s] = ((float)(random::u32() % 5)) + ((float)(random::u32() % 12)) / 12.0f - 2.0f;
-				attributes[seqIndexEdit][s].randomize();
+				cv[seqIndexEdit][s] = ((float)(rng.u32() % 5)) + ((float)(rng.u32() % 12)) / 12.0f - 2.0f;
+				attributes[seqIndexEdit][s].randomize(rng);
 			}
-			sequences[seqIndexEdit].randomize(16 * stepConfig, NUM_MODES);// ok to use stepConfig since CONFIG_PARAM is not randomizable		
+			sequences[seqIndexEdit].randomize(16 * stepConfig, NUM_MODES, rng);// ok to use stepConfig since CONFIG_PARAM is not randomizable		
 		}
 	}
 	
@@ -417,6 +452,12 @@ struct PhraseSeq32 : Module {
 		// resetOnRun
 		json_object_set_new(rootJ, "resetOnRun", json_boolean(resetOnRun));
 		
+		// clockBusSource
+		json_object_set_new(rootJ, "clockBusSource", json_integer(clockBusSource));
+		
+		// rng
+		rng.dataToJson(rootJ);
+		
 		// stepIndexEdit
 		json_object_set_new(rootJ, "stepIndexEdit", json_integer(stepIndexEdit));
 	
@@ -607,6 +648,14 @@ struct PhraseSeq32 : Module {
 		if (resetOnRunJ)
 			resetOnRun = json_is_true(resetOnRunJ);
 
+		// clockBusSource
+		json_t *clockBusSourceJ = json_object_get(rootJ, "clockBusSource");
+		if (clockBusSourceJ)
+			clockBusSource = clamp((int)json_integer_value(clockBusSourceJ), 0, 4);
+
+		// rng
+		rng.dataFromJson(rootJ);
+
 		// stepIndexEdit
 		json_t *stepIndexEditJ = json_object_get(rootJ, "stepIndexEdit");
 		if (stepIndexEditJ)
@@ -696,26 +745,135 @@ struct PhraseSeq32 : Module {
 	
 
 	void calcGate1Code(StepAttributes attribute, int index) {
-		int gateType = attribute.getGate1Mode();
-		
 		if (ppqnCount == 0 && !attribute.getTied()) {
-			lastProbGate1Enable[index] = !attribute.getGate1P() || (random::uniform() < params[GATE1_KNOB_PARAM].getValue()); // random::uniform is [0.0, 1.0), see include/util/common.hpp
+			lastProbGate1Enable[index] = !attribute.getGate1P() || (rng.uniform() < params[GATE1_KNOB_PARAM].getValue());
 		}
-			
-		if (!attribute.getGate1() || !lastProbGate1Enable[index]) {
-			gate1Code[index] = 0;
+		gate1Code[index] = (lastProbGate1Enable[index] ? calcGate1CodeEnabled(attribute, ppqnCount) : 0);
+	}
+	int calcGate1CodeEnabled(StepAttributes attribute, int ppqn) {// gate 1 code when its probability lets it through
+		int gateType = attribute.getGate1Mode();
+		int code;
+		if (!attribute.getGate1()) {
+			code = 0;
 		}
 		else if (pulsesPerStep == 1 && gateType == 0) {
-			gate1Code[index] = 2;// clock high
+			code = 2;// clock high
 		}
 		else { 
 			if (gateType == 11) {
-				gate1Code[index] = (ppqnCount == 0 ? 3 : 0);
+				code = (ppqn == 0 ? 3 : 0);
+			}
+			else {
+				code = getAdvGate(ppqn, pulsesPerStep, gateType);
+			}
+		}
+		return code;
+	}
+	
+	
+	void calcNextStep(bool editingSequence) {// what the next clock edge does to the run state, on a copy of it and of rng
+		ModuleRandom nextRng = rng;
+		rng.getState(nextStep.rngBefore);
+		nextStep.editingSequence = editingSequence;
+		nextStep.ppqnCount = ppqnCount + 1;
+		if (nextStep.ppqnCount >= pulsesPerStep)
+			nextStep.ppqnCount = 0;
+		nextStep.stepIndexRun[0] = stepIndexRun[0];
+		nextStep.stepIndexRun[1] = stepIndexRun[1];
+		nextStep.stepIndexRunHistory = stepIndexRunHistory;
+		nextStep.phraseIndexRun = phraseIndexRun;
+		nextStep.phraseIndexRunHistory = phraseIndexRunHistory;
+		nextStep.stopRun = false;
+
+		int newSeq = seqIndexEdit;// good value when editingSequence, overwrite if not editingSequence
+		if (nextStep.ppqnCount == 0) {
+			if (editingSequence) {
+				for (int i = 0; i < 2; i += stepConfig)
+					nextStep.slideFromCV[i] = cv[seqIndexEdit][(i * 16) + stepIndexRun[i]];
+				//bool seqLoopOver = 
+				moveIndexRunMode(&nextStep.stepIndexRun[0], sequences[seqIndexEdit].getLength(), sequences[seqIndexEdit].getRunMode(), &nextStep.stepIndexRunHistory, nextRng);
+				// if (seqLoopOver && stopAtEndOfSong) {
+					// nextStep.stopRun = true;
+					// nextStep.stepIndexRun[0] = stepIndexRun[0];
+					// nextStep.stepIndexRun[1] = stepIndexRun[1];
+				// }
 			}
 			else {
-				gate1Code[index] = getAdvGate(ppqnCount, pulsesPerStep, gateType);
+				for (int i = 0; i < 2; i += stepConfig)
+					nextStep.slideFromCV[i] = cv[phrase[phraseIndexRun]][(i * 16) + stepIndexRun[i]];
+				if (moveIndexRunMode(&nextStep.stepIndexRun[0], sequences[phrase[phraseIndexRun]].getLength(), sequences[phrase[phraseIndexRun]].getRunMode(), &nextStep.stepIndexRunHistory, nextRng)) {
+					bool songLoopOver = moveIndexRunMode(&nextStep.phraseIndexRun, phrases, runModeSong, &nextStep.phraseIndexRunHistory, nextRng);
+					// check for end of song if needed
+					if (songLoopOver && stopAtEndOfSong) {
+						nextStep.stopRun = true;
+						nextStep.stepIndexRun[0] = stepIndexRun[0];
+						nextStep.stepIndexRun[1] = stepIndexRun[1];
+						nextStep.phraseIndexRun = phraseIndexRun;
+					}
+					else {
+						int seq = phrase[nextStep.phraseIndexRun];
+						nextStep.stepIndexRun[0] = (sequences[seq].getRunMode() == MODE_REV ? sequences[seq].getLength() - 1 : 0);// must always refresh after phraseIndexRun has changed
+					}
+				}
+				newSeq = phrase[nextStep.phraseIndexRun];
 			}
+			if (!nextStep.stopRun)
+				fillStepIndexRunVector(nextStep.stepIndexRun, sequences[newSeq].getRunMode(), sequences[newSeq].getLength(), nextRng);
 		}
+		else {
+			if (!editingSequence)
+				newSeq = phrase[phraseIndexRun];
+		}
+		
+		nextStep.seq = newSeq;
+		for (int i = 0; i < 2; i += stepConfig) {
+			StepAttributes attribute = attributes[newSeq][(i * 16) + nextStep.stepIndexRun[i]];
+			if (nextStep.ppqnCount == 0 && !attribute.getTied() && attribute.getGate1P())
+				nextStep.gate1ProbDraw[i] = nextRng.uniform();
+			nextStep.gate1Code[i] = calcGate1CodeEnabled(attribute, nextStep.ppqnCount);
+			nextStep.gate2Code[i] = calcGate2Code(attribute, nextStep.ppqnCount, pulsesPerStep);
+		}
+		nextRng.getState(nextStep.rngAfter);
+		nextStep.valid = true;
+	}
+	
+	void clockStep(bool editingSequence) {// clock edge: commits nextStep, computed now when it is missing or stale
+		if (!nextStep.valid || nextStep.editingSequence != editingSequence || !rng.hasState(nextStep.rngBefore))
+			calcNextStep(editingSequence);
+		
+		if (nextStep.stopRun)
+			running = false;
+		ppqnCount = nextStep.ppqnCount;
+		stepIndexRun[0] = nextStep.stepIndexRun[0];
+		stepIndexRun[1] = nextStep.stepIndexRun[1];
+		stepIndexRunHistory = nextStep.stepIndexRunHistory;
+		phraseIndexRun = nextStep.phraseIndexRun;
+		phraseIndexRunHistory = nextStep.phraseIndexRunHistory;
+		rng.setState(nextStep.rngAfter);
+		
+		for (int i = 0; i < 2; i += stepConfig) {
+			StepAttributes attribute = attributes[nextStep.seq][(i * 16) + stepIndexRun[i]];
+			if (ppqnCount == 0) {
+				// Slide
+				if (attribute.getSlide()) {
+					slideStepsRemain[i] = (unsigned long) (((float)clockPeriod  * pulsesPerStep) * params[SLIDE_KNOB_PARAM].getValue() / 2.0f);
+					if (slideStepsRemain[i] != 0ul) {
+						float slideToCV = cv[nextStep.seq][(i * 16) + stepIndexRun[i]];
+						slideCVdelta[i] = (slideToCV - nextStep.slideFromCV[i])/(float)slideStepsRemain[i];
+					}
+				}
+				else
+					slideStepsRemain[i] = 0ul;
+				
+				if (!attribute.getTied()) {
+					lastProbGate1Enable[i] = !attribute.getGate1P() || (nextStep.gate1ProbDraw[i] < params[GATE1_KNOB_PARAM].getValue());
+				}
+			}
+			gate1Code[i] = (lastProbGate1Enable[i] ? nextStep.gate1Code[i] : 0);
+			gate2Code[i] = nextStep.gate2Code[i];
+		}
+		clockPeriod = 0ul;
+		nextStep.valid = false;
 	}
 	
 
@@ -728,7 +886,7 @@ struct PhraseSeq32 : Module {
 		static const float editGateLengthTime = 3.5f;// seconds
 		
 		bool expanderPresent = (rightExpander.module && rightExpander.module->model == modelPhraseSeqExpander);
-		float *messagesFromExpander = (float*)rightExpander.consumerMessage;// could be invalid pointer when !expanderPresent, so read it only when expanderPresent
+		float *messagesFromExpander = fromExpander.data();// stale when !expanderPresent, so read it only when expanderPresent
 
 		
 		//********** Buttons, knobs, switches and inputs **********
@@ -737,7 +895,7 @@ struct PhraseSeq32 : Module {
 		bool editingSequence = isEditingSequence();// true = editing sequence, false = editing song
 		
 		// Run button
-		if (runningTrigger.process(params[RUN_PARAM].getValue() + inputs[RUNCV_INPUT].getVoltage())) {// no input refresh here, don't want to introduce startup skew
+		if (runningTrigger.process(params[RUN_PARAM].getValue() + inputs[RUNCV_INPUT].getVoltage() + getClockBusChannel(inputs[CLOCK_INPUT], clockBusSource, CLKBUS_RUN))) {// no input refresh here, don't want to introduce startup skew
 			running = !running;
 			if (running) {
 				if (resetOnRun) {
@@ -748,6 +906,8 @@ struct PhraseSeq32 : Module {
 		}
 
 		if (refresh.processInputs()) {
+			nextStep.valid = false;// edits below, and those of the UI thread since the last scan
+			
 			// Config switch
 			// switch may move in the pre-fromJson, but no problem, it will trigger the init lenght below, but then when
 			//    the lengths are loaded and we see the stepConfigSync request later,
@@ -829,16 +989,16 @@ struct PhraseSeq32 : Module {
 							phraseCPbuffer[i] = phrase[p];
 						seqCopied = false;// so that a cross paste can be detected
 					}
-					infoCopyPaste = (long) (revertDisplayTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					infoCopyPaste = (long) (revertDisplayTime * sampleRate / refresh.displayRefreshStepSkips);
 					displayState = DISP_NORMAL;
 				}
 				else
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 			}
 			// Paste button
 			if (pasteTrigger.process(params[PASTE_PARAM].getValue())) {
 				if (!attached) {
-					infoCopyPaste = (long) (-1 * revertDisplayTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					infoCopyPaste = (long) (-1 * revertDisplayTime * sampleRate / refresh.displayRefreshStepSkips);
 					startCP = 0;
 					if (countCP <= 8) {
 						startCP = editingSequence ? stepIndexEdit : phraseIndexEdit;
@@ -870,13 +1030,13 @@ struct PhraseSeq32 : Module {
 							}
 							else if (params[CPMODE_PARAM].getValue() < 0.5f) {// 4 (randomize CVs)
 								for (int s = 0; s < 32; s++)
-									cv[seqIndexEdit][s] = ((float)(random::u32() % 7)) + ((float)(random::u32() % 12)) / 12.0f - 3.0f;
+									cv[seqIndexEdit][s] = ((float)(rng.u32() % 7)) + ((float)(rng.u32() % 12)) / 12.0f - 3.0f;
 								sequences[seqIndexEdit].setTranspose(0);
 								sequences[seqIndexEdit].setRotate(0);
 							}
 							else {// 8 (randomize gate 1)
 								for (int s = 0; s < 32; s++)
-									if ( (random::u32() & 0x1) != 0)
+									if ( (rng.u32() & 0x1) != 0)
 										attributes[seqIndexEdit][s].toggleGate1();
 							}
 							startCP = 0;
@@ -900,7 +1060,7 @@ struct PhraseSeq32 : Module {
 							}
 							else {// 8 (randomize phrases)
 								for (int p = 0; p < 32; p++)
-									phrase[p] = random::u32() % 32;
+									phrase[p] = rng.u32() % 32;
 							}
 							startCP = 0;
 							countCP = 32;
@@ -910,7 +1070,7 @@ struct PhraseSeq32 : Module {
 					displayState = DISP_NORMAL;
 				}
 				else
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 			}
 			
 			// Write input (must be before Left and Right in case route gate simultaneously to Right and Write for example)
@@ -922,7 +1082,7 @@ struct PhraseSeq32 : Module {
 						cv[seqIndexEdit][stepIndexEdit] = inputs[CV_INPUT].getVoltage();
 						propagateCVtoTied(seqIndexEdit, stepIndexEdit);
 					}
-					editingGate = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					editingGate = (unsigned long) (gateTime * sampleRate / refresh.displayRefreshStepSkips);
 					editingGateCV = inputs[CV_INPUT].getVoltage();// cv[seqIndexEdit][stepIndexEdit];
 					editingGateKeyLight = -1;
 					editingChannel = (stepIndexEdit >= 16 * stepConfig) ? 1 : 0;
@@ -951,7 +1111,7 @@ struct PhraseSeq32 : Module {
 						stepIndexEdit = moveIndex(stepIndexEdit, stepIndexEdit + delta, 32);
 						if (!attributes[seqIndexEdit][stepIndexEdit].getTied()) {// play if non-tied step
 							if (!writeTrig) {// in case autostep when simultaneous writeCV and stepCV (keep what was done in Write Input block above)
-								editingGate = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+								editingGate = (unsigned long) (gateTime * sampleRate / refresh.displayRefreshStepSkips);
 								editingGateCV = cv[seqIndexEdit][stepIndexEdit];
 								editingGateKeyLight = -1;
 								editingChannel = (stepIndexEdit >= 16 * stepConfig) ? 1 : 0;
@@ -978,14 +1138,14 @@ struct PhraseSeq32 : Module {
 						sequences[seqIndexEdit].setLength((stepPressed % (16 * stepConfig)) + 1);
 					else
 						phrases = stepPressed + 1;
-					revertDisplay = (long) (revertDisplayTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					revertDisplay = (long) (revertDisplayTime * sampleRate / refresh.displayRefreshStepSkips);
 				}
 				else {
 					if (!running || !attached) {// not running or detached
 						if (editingSequence) {
 							stepIndexEdit = stepPressed;
 							if (!attributes[seqIndexEdit][stepIndexEdit].getTied()) {// play if non-tied step
-								editingGate = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+								editingGate = (unsigned long) (gateTime * sampleRate / refresh.displayRefreshStepSkips);
 								editingGateCV = cv[seqIndexEdit][stepIndexEdit];
 								editingGateKeyLight = -1;
 								editingChannel = (stepIndexEdit >= 16 * stepConfig) ? 1 : 0;
@@ -998,7 +1158,7 @@ struct PhraseSeq32 : Module {
 						}
 					}
 					else {// attached and running
-						attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 						if (editingSequence) {
 							if (stepPressed >= 16 && stepConfig == 1)
 								stepIndexEdit = stepIndexRun[1] + 16;
@@ -1021,10 +1181,10 @@ struct PhraseSeq32 : Module {
 						displayState = DISP_MODE;
 					else
 						displayState = DISP_NORMAL;
-					modeHoldDetect.start((long) (holdDetectTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+					modeHoldDetect.start((long) (holdDetectTime * sampleRate / refresh.displayRefreshStepSkips));
 				}
 				else
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 			}
 			
 			// Transpose/Rotate button
@@ -1040,7 +1200,7 @@ struct PhraseSeq32 : Module {
 						displayState = DISP_NORMAL;
 				}
 				else if (attached)
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 			}			
 			
 			// Sequence knob 
@@ -1054,7 +1214,7 @@ struct PhraseSeq32 : Module {
 					// any changes in here should may also require right click behavior to be updated in the knob's onMouseDown()
 					if (editingPpqn != 0) {
 						pulsesPerStep = indexToPps(ppsToIndex(pulsesPerStep) + deltaKnob);// indexToPps() does clamping
-						editingPpqn = (long) (editGateLengthTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						editingPpqn = (long) (editGateLengthTime * sampleRate / refresh.displayRefreshStepSkips);
 					}
 					else if (displayState == DISP_MODE) {
 						if (editingSequence) {
@@ -1129,7 +1289,7 @@ struct PhraseSeq32 : Module {
 								phrase[phraseIndexEdit] = newPhrase;
 							}
 							else 
-								attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+								attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 						}
 					}
 				}
@@ -1142,11 +1302,11 @@ struct PhraseSeq32 : Module {
 					if (editingSequence) {
 						displayState = DISP_NORMAL;
 						if (attributes[seqIndexEdit][stepIndexEdit].getTied())
-							tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+							tiedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 						else {			
 							cv[seqIndexEdit][stepIndexEdit] = applyNewOct(cv[seqIndexEdit][stepIndexEdit], 3 - i);
 							propagateCVtoTied(seqIndexEdit, stepIndexEdit);
-							editingGate = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+							editingGate = (unsigned long) (gateTime * sampleRate / refresh.displayRefreshStepSkips);
 							editingGateCV = cv[seqIndexEdit][stepIndexEdit];
 							editingGateKeyLight = -1;
 							editingChannel = (stepIndexEdit >= 16 * stepConfig) ? 1 : 0;
@@ -1166,26 +1326,26 @@ struct PhraseSeq32 : Module {
 							attributes[seqIndexEdit][stepIndexEdit].setGateMode(newMode, editingGateLength > 0l);
 							if (pkInfo.isRightClick) {
 								stepIndexEdit = moveIndex(stepIndexEdit, stepIndexEdit + 1, 32);
-								editingType = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+								editingType = (unsigned long) (gateTime * sampleRate / refresh.displayRefreshStepSkips);
 								editingGateKeyLight = pkInfo.key;
 								if ((APP->window->getMods() & RACK_MOD_MASK) == RACK_MOD_CTRL)
 									attributes[seqIndexEdit][stepIndexEdit].setGateMode(newMode, editingGateLength > 0l);
 							}
 						}
 						else
-							editingPpqn = (long) (editGateLengthTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+							editingPpqn = (long) (editGateLengthTime * sampleRate / refresh.displayRefreshStepSkips);
 					}
 					else if (attributes[seqIndexEdit][stepIndexEdit].getTied()) {
 						if (pkInfo.isRightClick)
 							stepIndexEdit = moveIndex(stepIndexEdit, stepIndexEdit + 1, 32);
 						else
-							tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+							tiedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 					}
 					else {			
 						float newCV = std::floor(cv[seqIndexEdit][stepIndexEdit]) + ((float) pkInfo.key) / 12.0f;
 						cv[seqIndexEdit][stepIndexEdit] = newCV;
 						propagateCVtoTied(seqIndexEdit, stepIndexEdit);
-						editingGate = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						editingGate = (unsigned long) (gateTime * sampleRate / refresh.displayRefreshStepSkips);
 						editingGateCV = cv[seqIndexEdit][stepIndexEdit];
 						editingGateKeyLight = -1;
 						editingChannel = (stepIndexEdit >= 16 * stepConfig) ? 1 : 0;
@@ -1224,7 +1384,7 @@ struct PhraseSeq32 : Module {
 				if (editingSequence) {
 					displayState = DISP_NORMAL;
 					if (attributes[seqIndexEdit][stepIndexEdit].getTied())
-						tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						tiedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 					else
 						attributes[seqIndexEdit][stepIndexEdit].toggleGate1P();
 				}
@@ -1239,7 +1399,7 @@ struct PhraseSeq32 : Module {
 				if (editingSequence) {
 					displayState = DISP_NORMAL;
 					if (attributes[seqIndexEdit][stepIndexEdit].getTied())
-						tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						tiedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 					else
 						attributes[seqIndexEdit][stepIndexEdit].toggleSlide();
 				}
@@ -1262,86 +1422,30 @@ struct PhraseSeq32 : Module {
 		//********** Clock and reset **********
 		
 		// Clock
+		bool clockedOrReset = false;
 		if (running && clockIgnoreOnReset == 0l) {
-			if (clockTrigger.process(inputs[CLOCK_INPUT].getVoltage())) {
-				ppqnCount++;
-				if (ppqnCount >= pulsesPerStep)
-					ppqnCount = 0;
-
-				int newSeq = seqIndexEdit;// good value when editingSequence, overwrite if not editingSequence
-				if (ppqnCount == 0) {
-					float slideFromCV[2] = {0.0f, 0.0f};
-					int oldStepIndexRun0 = stepIndexRun[0];
-					int oldStepIndexRun1 = stepIndexRun[1];
-					if (editingSequence) {
-						for (int i = 0; i < 2; i += stepConfig)
-							slideFromCV[i] = cv[seqIndexEdit][(i * 16) + stepIndexRun[i]];
-						//bool seqLoopOver = 
-						moveIndexRunMode(&stepIndexRun[0], sequences[seqIndexEdit].getLength(), sequences[seqIndexEdit].getRunMode(), &stepIndexRunHistory);
-						// if (seqLoopOver && stopAtEndOfSong) {
-							// running = false;
-							// stepIndexRun[0] = oldStepIndexRun0;
-							// stepIndexRun[1] = oldStepIndexRun1;
-						// }
-					}
-					else {
-						for (int i = 0; i < 2; i += stepConfig)
-							slideFromCV[i] = cv[phrase[phraseIndexRun]][(i * 16) + stepIndexRun[i]];
-						if (moveIndexRunMode(&stepIndexRun[0], sequences[phrase[phraseIndexRun]].getLength(), sequences[phrase[phraseIndexRun]].getRunMode(), &stepIndexRunHistory)) {
-							int oldPhraseIndexRun = phraseIndexRun;
-							bool songLoopOver = moveIndexRunMode(&phraseIndexRun, phrases, runModeSong, &phraseIndexRunHistory);
-							// check for end of song if needed
-							if (songLoopOver && stopAtEndOfSong) {
-								running = false;
-								stepIndexRun[0] = oldStepIndexRun0;
-								stepIndexRun[1] = oldStepIndexRun1;
-								phraseIndexRun = oldPhraseIndexRun;
-							}
-							else {
-								stepIndexRun[0] = (sequences[phrase[phraseIndexRun]].getRunMode() == MODE_REV ? sequences[phrase[phraseIndexRun]].getLength() - 1 : 0);// must always refresh after phraseIndexRun has changed
-							}
-						}
-						newSeq = phrase[phraseIndexRun];
-					}
-					if (running)// end of song may have stopped it
-						fillStepIndexRunVector(sequences[newSeq].getRunMode(), sequences[newSeq].getLength());
-
-					// Slide
-					for (int i = 0; i < 2; i += stepConfig) {
-						if (attributes[newSeq][(i * 16) + stepIndexRun[i]].getSlide()) {
-							slideStepsRemain[i] = (unsigned long) (((float)clockPeriod  * pulsesPerStep) * params[SLIDE_KNOB_PARAM].getValue() / 2.0f);
-							if (slideStepsRemain[i] != 0ul) {
-								float slideToCV = cv[newSeq][(i * 16) + stepIndexRun[i]];
-								slideCVdelta[i] = (slideToCV - slideFromCV[i])/(float)slideStepsRemain[i];
-							}
-						}
-						else
-							slideStepsRemain[i] = 0ul;
-					}
-				}
-				else {
-					if (!editingSequence)
-						newSeq = phrase[phraseIndexRun];
-				}
-				for (int i = 0; i < 2; i += stepConfig) {
-					calcGate1Code(attributes[newSeq][(i * 16) + stepIndexRun[i]], i);
-					gate2Code[i] = calcGate2Code(attributes[newSeq][(i * 16) + stepIndexRun[i]], ppqnCount, pulsesPerStep);	
-				}
-				clockPeriod = 0ul;
+			if (clockTrigger.process(getClockBusClock(inputs[CLOCK_INPUT], clockBusSource))) {
+				clockStep(editingSequence);
+				clockedOrReset = true;
 			}
 			clockPeriod++;
 		}
 		
 		// Reset
-		if (resetTrigger.process(inputs[RESET_INPUT].getVoltage() + params[RESET_PARAM].getValue())) {
+		if (resetTrigger.process(inputs[RESET_INPUT].getVoltage() + getClockBusChannel(inputs[CLOCK_INPUT], clockBusSource, CLKBUS_RESET) + params[RESET_PARAM].getValue())) {
 			initRun();// must be before SEQCV_INPUT below
 			resetLight = 1.0f;
 			displayState = DISP_NORMAL;
 			clockTrigger.reset();
 			if (inputs[SEQCV_INPUT].isConnected() && seqCVmethod == 2)
 				seqIndexEdit = 0;
+			clockedOrReset = true;
 		}
 		
+		// Next step, computed ahead of the clock edge that will use it
+		if (running && !clockedOrReset && !nextStep.valid)
+			calcNextStep(editingSequence);
+		
 		
 		//********** Outputs and lights **********
 				
@@ -1369,13 +1473,13 @@ struct PhraseSeq32 : Module {
 				slideOffset[i] = (slideStepsRemain[i] > 0ul ? (slideCVdelta[i] * (float)slideStepsRemain[i]) : 0.0f);
 			outputs[CVA_OUTPUT].setVoltage(cv[seq][step0] - slideOffset[0]);
 			bool retriggingOnReset = (clockIgnoreOnReset != 0l && retrigGatesOnReset);
-			outputs[GATE1A_OUTPUT].setVoltage((calcGate(gate1Code[0], clockTrigger, clockPeriod, sampleRate) && !muteGate1A && !retriggingOnReset) ? 10.0f : 0.0f);
-			outputs[GATE2A_OUTPUT].setVoltage((calcGate(gate2Code[0], clockTrigger, clockPeriod, sampleRate) && !muteGate2A && !retriggingOnReset) ? 10.0f : 0.0f);
+			outputs[GATE1A_OUTPUT].setVoltage((calcGate(gate1Code[0], clockTrigger, clockPeriod, timings.gateTrigger) && !muteGate1A && !retriggingOnReset) ? 10.0f : 0.0f);
+			outputs[GATE2A_OUTPUT].setVoltage((calcGate(gate2Code[0], clockTrigger, clockPeriod, timings.gateTrigger) && !muteGate2A && !retriggingOnReset) ? 10.0f : 0.0f);
 			if (stepConfig == 1) {// 2x16
 				int step1 = (editingSequence && !running) ? stepIndexEdit : stepIndexRun[1];
 				outputs[CVB_OUTPUT].setVoltage(cv[seq][16 + step1] - slideOffset[1]);
-				outputs[GATE1B_OUTPUT].setVoltage((calcGate(gate1Code[1], clockTrigger, clockPeriod, sampleRate) && !muteGate1B && !retriggingOnReset) ? 10.0f : 0.0f);
-				outputs[GATE2B_OUTPUT].setVoltage((calcGate(gate2Code[1], clockTrigger, clockPeriod, sampleRate) && !muteGate2B && !retriggingOnReset) ? 10.0f : 0.0f);
+				outputs[GATE1B_OUTPUT].setVoltage((calcGate(gate1Code[1], clockTrigger, clockPeriod, timings.gateTrigger) && !muteGate1B && !retriggingOnReset) ? 10.0f : 0.0f);
+				outputs[GATE2B_OUTPUT].setVoltage((calcGate(gate2Code[1], clockTrigger, clockPeriod, timings.gateTrigger) && !muteGate2B && !retriggingOnReset) ? 10.0f : 0.0f);
 			} 
 			else {// 1x32
 				outputs[CVB_OUTPUT].setVoltage(0.0f);
@@ -1501,7 +1605,7 @@ struct PhraseSeq32 : Module {
 					lights[OCTAVE_LIGHTS + i].setBrightness(0.0f);
 				else {
 					if (tiedWarning > 0l) {
-						bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+						bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips));
 						lights[OCTAVE_LIGHTS + i].setBrightness((warningFlashState && (i == (6 - octLightIndex))) ? 1.0f : 0.0f);
 					}
 					else				
@@ -1527,7 +1631,7 @@ struct PhraseSeq32 : Module {
 					float red = editingGateLength > 0l ? 0.45f : 1.0f;
 					if (editingType > 0ul) {
 						if (i == editingGateKeyLight) {
-							float dimMult = ((float) editingType / (float)(gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+							float dimMult = ((float) editingType / (float)(gateTime * sampleRate / refresh.displayRefreshStepSkips));
 							setGreenRed(KEY_LIGHTS + i * 2, green * dimMult, red * dimMult);
 						}
 						else
@@ -1553,12 +1657,12 @@ struct PhraseSeq32 : Module {
 						lights[KEY_LIGHTS + i * 2 + 1].setBrightness(0.0f);
 					else {
 						if (tiedWarning > 0l) {
-							bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+							bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips));
 							lights[KEY_LIGHTS + i * 2 + 1].setBrightness((warningFlashState && i == keyLightIndex) ? 1.0f : 0.0f);
 						}
 						else {
 							if (editingGate > 0ul && editingGateKeyLight != -1)
-								lights[KEY_LIGHTS + i * 2 + 1].setBrightness(i == editingGateKeyLight ? ((float) editingGate / (float)(gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips)) : 0.0f);
+								lights[KEY_LIGHTS + i * 2 + 1].setBrightness(i == editingGateKeyLight ? ((float) editingGate / (float)(gateTime * sampleRate / refresh.displayRefreshStepSkips)) : 0.0f);
 							else
 								lights[KEY_LIGHTS + i * 2 + 1].setBrightness(i == keyLightIndex ? 1.0f : 0.0f);
 						}
@@ -1596,7 +1700,7 @@ struct PhraseSeq32 : Module {
 				setGreenRed(GATE1_PROB_LIGHT, attributesVal.getGate1P() ? 1.0f : 0.0f, attributesVal.getGate1P() ? 1.0f : 0.0f);
 				lights[SLIDE_LIGHT].setBrightness(attributesVal.getSlide() ? 1.0f : 0.0f);
 				if (tiedWarning > 0l) {
-					bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+					bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips));
 					lights[TIE_LIGHT].setBrightness(warningFlashState ? 1.0f : 0.0f);
 				}
 				else
@@ -1605,14 +1709,14 @@ struct PhraseSeq32 : Module {
 			
 			// Attach light
 			if (attachedWarning > 0l) {
-				bool warningFlashState = calcWarningFlash(attachedWarning, (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+				bool warningFlashState = calcWarningFlash(attachedWarning, (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips));
 				lights[ATTACH_LIGHT].setBrightness(warningFlashState ? 1.0f : 0.0f);
 			}
 			else
 				lights[ATTACH_LIGHT].setBrightness(attached ? 1.0f : 0.0f);
 			
 			// Reset light
-			lights[RESET_LIGHT].setSmoothBrightness(resetLight, args.sampleTime * (RefreshCounter::displayRefreshStepSkips >> 2));
+			lights[RESET_LIGHT].setSmoothBrightness(resetLight, args.sampleTime * (refresh.displayRefreshStepSkips >> 2));
 			resetLight = 0.0f;
 			
 			// Run light
@@ -1636,7 +1740,7 @@ struct PhraseSeq32 : Module {
 				attachedWarning--;
 			if (modeHoldDetect.process(params[RUNMODE_PARAM].getValue())) {
 				displayState = DISP_NORMAL;
-				editingPpqn = (long) (editGateLengthTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+				editingPpqn = (long) (editGateLengthTime * sampleRate / refresh.displayRefreshStepSkips);
 			}
 			if (revertDisplay > 0l) {
 				if (revertDisplay == 1)
@@ -1646,9 +1750,12 @@ struct PhraseSeq32 : Module {
 			
 			// To Expander
 			if (rightExpander.module && rightExpander.module->model == modelPhraseSeqExpander) {
-				float *messagesToExpander = (float*)(rightExpander.module->leftExpander.producerMessage);
+				float *messagesToExpander = toExpander.message;
 				messagesToExpander[0] = (float)panelTheme;
-				rightExpander.module->leftExpander.messageFlipRequested = true;
+				toExpander.sendRight(this);
+			}
+			else {
+				toExpander.reset();
 			}
 		}// lightRefreshCounter
 				
@@ -1725,11 +1832,10 @@ struct PhraseSeq32 : Module {
 struct PhraseSeq32Widget : ModuleWidget {
 	SvgPanel* darkPanel;
 	
-	struct SequenceDisplayWidget : LightWidget {//TransparentWidget {
+	struct SequenceDisplayWidget : CachedDisplayWidget {
 		PhraseSeq32 *module;
 		std::shared_ptr<Font> font;
 		std::string fontPath;
-		char displayStr[16];
 		int lastNum = -1;// -1 means timedout; >= 0 means we have a first number potential, if ever second key comes fast enough
 		clock_t lastTime = 0;
 		
@@ -1811,7 +1917,7 @@ struct PhraseSeq32Widget : ModuleWidget {
 				snprintf(displayStr, 4, "%s", modeLabels[num].c_str());
 		}
 
-		void draw(const DrawArgs &args) override {
+		void drawDisplay(const DrawArgs &args) override {
 			if (!(font = APP->window->loadFont(fontPath))) {
 				return;
 			}
@@ -1821,7 +1927,10 @@ struct PhraseSeq32Widget : ModuleWidget {
 			nvgFillColor(args.vg, nvgTransRGBA(textColor, displayAlpha));
 			nvgText(args.vg, textPos.x, textPos.y, "~~~", NULL);
 			nvgFillColor(args.vg, textColor);
-					
+			nvgText(args.vg, textPos.x, textPos.y, displayStr, NULL);
+		}
+
+		void updateDisplay() override {
 			if (module == NULL) {
 				snprintf(displayStr, 4, "  1");
 			}
@@ -1882,7 +1991,6 @@ struct PhraseSeq32Widget : ModuleWidget {
 						module->seqIndexEdit : module->phrase[module->phraseIndexEdit]) + 1 );
 				}
 			}
-			nvgText(args.vg, textPos.x, textPos.y, displayStr, NULL);
 		}
 	};		
 	
@@ -2022,6 +2130,14 @@ struct PhraseSeq32Widget : ModuleWidget {
 		rorItem->module = module;
 		menu->addChild(rorItem);
 
+		ClockBusSourceItem *busItem = createMenuItem<ClockBusSourceItem>("Clock input is poly clock bus", RIGHT_ARROW);
+		busItem->clockBusSourcePtr = &module->clockBusSource;
+		menu->addChild(busItem);
+
+		RandomSeedItem *seedItem = createMenuItem<RandomSeedItem>("Random seed", RIGHT_ARROW);
+		seedItem->rngPtr = &module->rng;
+		menu->addChild(seedItem);
+
 		HoldTiedItem *holdItem = createMenuItem<HoldTiedItem>("Hold tied notes", CHECKMARK(module->holdTiedNotes));
 		holdItem->module = module;
 		menu->addChild(holdItem);
@@ -2063,12 +2179,12 @@ struct PhraseSeq32Widget : ModuleWidget {
 				// same code structure below as in sequence knob in main step()
 				if (module->editingPpqn != 0) {
 					module->pulsesPerStep = 1;
-					//editingPpqn = (long) (editGateLengthTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					//editingPpqn = (long) (editGateLengthTime * sampleRate / module->refresh.displayRefreshStepSkips);
 				}
 				else if (module->displayState == PhraseSeq32::DISP_MODE) {
 					if (module->isEditingSequence()) {
 						bool expanderPresent = (module->rightExpander.module && module->rightExpander.module->model == modelPhraseSeqExpander);
-						float *messagesFromExpander = (float*)module->rightExpander.consumerMessage;// could be invalid pointer when !expanderPresent, so read it only when expanderPresent						
+						float *messagesFromExpander = module->fromExpander.data();// stale when !expanderPresent, so read it only when expanderPresent						
 						if (!expanderPresent || std::isnan(messagesFromExpander[4])) {
 							module->sequences[module->seqIndexEdit].setRunMode(MODE_FWD);
 						}
@@ -2323,8 +2439,7 @@ struct PhraseSeq32Widget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((PhraseSeq32*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((PhraseSeq32*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((PhraseSeq32*)module)->panelTheme);
 		}
 		Widget::step();
 	}
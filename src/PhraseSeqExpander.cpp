@@ -26,7 +26,8 @@ struct PhraseSeqExpander : Module {
 
 
 	// Expander
-	float leftMessages[2][1] = {};// messages from mother
+	ExpanderChannel<float[1]> fromMother;// messages from mother
+	ExpanderSender<float[5]> toMother;// messages to mother
 
 
 	// No need to save
@@ -37,8 +38,7 @@ struct PhraseSeqExpander : Module {
 	PhraseSeqExpander() {
 		config(0, NUM_INPUTS, 0, 0);
 		
-		leftExpander.producerMessage = leftMessages[0];
-		leftExpander.consumerMessage = leftMessages[1];
+		fromMother.construct(&leftExpander);
 		
 		panelTheme = (loadDarkAsDefault() ? 1 : 0);
 	}
@@ -52,17 +52,22 @@ struct PhraseSeqExpander : Module {
 			bool motherPresent = leftExpander.module && (leftExpander.module->model == modelPhraseSeq16 || leftExpander.module->model == modelPhraseSeq32);
 			if (motherPresent) {
 				// To Mother
-				float *messagesToMother = (float*)leftExpander.module->rightExpander.producerMessage;
+				float *messagesToMother = toMother.message;
 				int i = 0;
 				for (; i < NUM_INPUTS - 1; i++) {
 					messagesToMother[i] = inputs[i].getVoltage();
 				}
 				messagesToMother[i] = (inputs[i].isConnected() ? inputs[i].getVoltage() : std::numeric_limits<float>::quiet_NaN());
-				leftExpander.module->rightExpander.messageFlipRequested = true;
+				toMother.sendLeft(this);
 					
 				// From Mother
-				float *messagesFromMother = (float*)leftExpander.consumerMessage;
-				panelTheme = clamp((int)(messagesFromMother[0] + 0.5f), 0, 1);
+				if (fromMother.receive()) {
+					panelTheme = clamp((int)(fromMother.data()[0] + 0.5f), 0, 1);
+				}
+			}
+			else {
+				fromMother.reset();
+				toMother.reset();
 			}		
 		}// expanderRefreshCounter			
 	}// process()
@@ -101,8 +106,7 @@ struct PhraseSeqExpanderWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((PhraseSeqExpander*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((PhraseSeqExpander*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((PhraseSeqExpander*)module)->panelTheme);
 		}
 		Widget::step();
 	}
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "ImpromptuModular.hpp"
+#include "GatePatterns.hpp"
 #include <time.h>
 #include "Interop.hpp"
 
@@ -14,7 +15,7 @@
 enum RunModeIds {MODE_FWD, MODE_REV, MODE_PPG, MODE_PEN, MODE_BRN, MODE_RND, MODE_FW2, MODE_FW3, MODE_FW4, MODE_RN2, NUM_MODES};
 static const std::string modeLabels[NUM_MODES] = {"FWD","REV","PPG","PEN","BRN","RND","FW2","FW3","FW4","RN2"};// PS16 and SMS16 use NUM_MODES - 1 since no RN2!!!
 
-static const int NUM_GATES = 12;// advanced gate types												
+static const int NUM_GATES = NUM_ADV_GATES;// advanced gate types, see GatePatterns.hpp												
 
 
 //*****************************************************************************
@@ -37,7 +38,7 @@ class StepAttributes {
 	
 	inline void clear() {attributes = 0u;}
 	inline void init() {attributes = ATT_MSK_INITSTATE;}
-	inline void randomize() {attributes = (random::u32() & (ATT_MSK_GATE1 | ATT_MSK_GATE1P | ATT_MSK_GATE2 | ATT_MSK_SLIDE /*| ATT_MSK_TIED | ATT_MSK_GATE1MODE | ATT_MSK_GATE2MODE*/));}
+	inline void randomize(ModuleRandom& rng) {attributes = (rng.u32() & (ATT_MSK_GATE1 | ATT_MSK_GATE1P | ATT_MSK_GATE2 | ATT_MSK_SLIDE /*| ATT_MSK_TIED | ATT_MSK_GATE1MODE | ATT_MSK_GATE2MODE*/));}
 	
 	inline bool getGate1() {return (attributes & ATT_MSK_GATE1) != 0;}
 	inline bool getGate1P() {return (attributes & ATT_MSK_GATE1P) != 0;}
@@ -88,7 +89,7 @@ class SeqAttributes {
 	static const unsigned long SEQ_MSK_ROTSIGN =   0x80000000;// manually implement sign bit (+ is right, - is left)
 	
 	inline void init(int length, int runMode) {attributes = ((length) | (((unsigned long)runMode) << runModeShift));}
-	inline void randomize(int maxSteps, int numModes) {attributes = ( (2 + (random::u32() % (maxSteps - 1))) | (((unsigned long)(random::u32() % numModes) << runModeShift)) );}
+	inline void randomize(int maxSteps, int numModes, ModuleRandom& rng) {attributes = ( (2 + (rng.u32() % (maxSteps - 1))) | (((unsigned long)(rng.u32() % numModes) << runModeShift)) );}
 	
 	inline int getLength() {return (int)(attributes & SEQ_MSK_LENGTH);}
 	inline int getRunMode() {return (int)((attributes & SEQ_MSK_RUNMODE) >> runModeShift);}
@@ -142,12 +143,12 @@ inline float applyNewOct(float cvVal, int newOct0) {
 	return cvVal - std::floor(cvVal) + (float)newOct0;
 }
 
-inline bool calcGate(int gateCode, Trigger clockTrigger, unsigned long clockStep, float sampleRate) {
+inline bool calcGate(int gateCode, Trigger& clockTrigger, unsigned long clockStep, unsigned long gateTriggerLength) {// gateTriggerLength from SampleTimings
 	if (gateCode < 2) 
 		return gateCode == 1;
 	if (gateCode == 2)
 		return clockTrigger.isHigh();
-	return clockStep < (unsigned long) (sampleRate * 0.01f);
+	return clockStep < gateTriggerLength;
 }
 
 inline int gateModeToKeyLightIndex(StepAttributes attribute, bool isGate1) {// keyLight index now matches gate modes, so no mapping table needed anymore
@@ -160,5 +161,5 @@ inline int gateModeToKeyLightIndex(StepAttributes attribute, bool isGate1) {// k
 
 int getAdvGate(int ppqnCount, int pulsesPerStep, int gateMode);
 int calcGate2Code(StepAttributes attribute, int ppqnCount, int pulsesPerStep);
-bool moveIndexRunMode(int* index, int numSteps, int runMode, unsigned long* history);
+bool moveIndexRunMode(int* index, int numSteps, int runMode, unsigned long* history, ModuleRandom& rng);// rng is only used by BRN, RND and RN2
 int keyIndexToGateMode(int keyIndex, int pulsesPerStep);
@@ -34,10 +34,22 @@ class ProbKernel {
 	float noteAnchors[12];// [0.0f : 1.0f];  0.5f=oct"4"=0V, 1.0f=oct"4+MAX_ANCHOR_DELTA"; not quantized
 	float noteRanges[7];// [0] is -3, [6] is +3
 	
+	// sampling tables for calcRandomCv(), rebuilt only when the members above or the params they depend on change
+	bool tablesDirty = true;
+	float tableOffset;
+	float tableSquash;
+	float tablePgain;
+	float tableOverlap;
+	float cumulProbs[12];
+	float probDiceScale;
+	float baseCvs[12];// base note with its anchor
+	float cumulRanges[7];
+	
 	
 	public:
 	
 	void reset() {
+		tablesDirty = true;
 		for (int i = 0; i < 12; i++) {
 			noteProbs[i] = 0.0f;
 			noteAnchors[i] = octToAnchor(0.0f);
@@ -87,6 +99,8 @@ class ProbKernel {
 	
 	
 	void dataFromJsonProb(json_t *probJ) {
+		tablesDirty = true;
+		
 		// noteProbs
 		json_t *noteProbsJ = json_object_get(probJ, "noteProbs");
 		if (noteProbsJ && json_is_array(noteProbsJ)) {
@@ -136,6 +150,7 @@ class ProbKernel {
 	
 	// setters
 	void setNoteProb(int note, float prob, bool withSymmetry) {
+		tablesDirty = true;
 		noteProbs[note] = prob;
 		if (withSymmetry) {
 			for (int i = 0; i < 12; i++) {
@@ -146,6 +161,7 @@ class ProbKernel {
 		}
 	}
 	void setNoteAnchor(int note, float anch, bool withSymmetry) {
+		tablesDirty = true;
 		if (withSymmetry) {
 			if (noteProbs[note] != 0.0f) {
 				for (int i = 0; i < 12; i++) {
@@ -160,6 +176,7 @@ class ProbKernel {
 		}
 	}
 	void setNoteRange(int note12, float range, bool withSymmetry) {
+		tablesDirty = true;
 		int note7 = key12to7(note12);
 		noteRanges[note7] = range;
 		if (withSymmetry) {
@@ -217,18 +234,42 @@ class ProbKernel {
 	}
 	
 	
-	float calcRandomCv(float offset, float squash, float pgain, float overlap) {
-		// not optimized for audio rate
-		// returns a cv value or IDEM_CV when a note gets randomly skipped (only possible when sum of probs < 1)
-		
-		// generate a (base) note according to noteProbs (base note only, C4=0 to B4)
-		float cumulProbs[12];
+	void calcTables(float offset, float squash, float pgain, float overlap) {
+		// cumulative distributions of the base notes and of the octave ranges, see calcRandomCv()
 		cumulProbs[0] = noteProbs[0] * pgain;
 		for (int i = 1; i < 12; i++) {
 			cumulProbs[i] = cumulProbs[i - 1] + noteProbs[i] * pgain;
 		}
+		probDiceScale = std::max(cumulProbs[11], 1.0f);
+		
+		for (int i = 0; i < 12; i++) {
+			baseCvs[i] = ((float)i) / 12.0f + anchorToOct(noteAnchors[i]);
+		}
+		
+		float noteRangesMod[7] = {};
+		calcOffsetAndSquash(noteRangesMod, offset, squash, overlap);
+		cumulRanges[0] = noteRangesMod[0];
+		for (int i = 1; i < 7; i++) {
+			cumulRanges[i] = cumulRanges[i - 1] + noteRangesMod[i];
+		}
 		
-		float dice = random::uniform() * std::max(cumulProbs[11], 1.0f);		
+		tableOffset = offset;
+		tableSquash = squash;
+		tablePgain = pgain;
+		tableOverlap = overlap;
+		tablesDirty = false;
+	}
+	
+	
+	float calcRandomCv(float offset, float squash, float pgain, float overlap, ModuleRandom& rng) {
+		// returns a cv value or IDEM_CV when a note gets randomly skipped (only possible when sum of probs < 1)
+		// the sampling tables are only rebuilt when something changed, so that a draw is two short fixed-size scans (audio rate poly triggers)
+		if (tablesDirty || offset != tableOffset || squash != tableSquash || pgain != tablePgain || overlap != tableOverlap) {
+			calcTables(offset, squash, pgain, overlap);
+		}
+		
+		// generate a (base) note according to noteProbs (base note only, C4=0 to B4)
+		float dice = rng.uniform() * probDiceScale;		
 		int note = 0;
 		for (; note < 12; note++) {
 			if (dice < cumulProbs[note]) {
@@ -238,24 +279,11 @@ class ProbKernel {
 		
 		float cv;
 		if (note < 12) {
-			// base note
-			cv = ((float)note) / 12.0f;
-			
-			// anchor
-			cv += anchorToOct(noteAnchors[note]);
+			// base note and anchor
+			cv = baseCvs[note];
 			
-			// offset and squash
-			float noteRangesMod[7] = {};
-			calcOffsetAndSquash(noteRangesMod, offset, squash, overlap);
-			
-			// probabilistically transpose note according to ranges
-			float cumulRanges[7];
-			cumulRanges[0] = noteRangesMod[0];
-			for (int i = 1; i < 7; i++) {
-				cumulRanges[i] = cumulRanges[i - 1] + noteRangesMod[i];
-			}
-			
-			float dice2 = random::uniform() * cumulRanges[6];
+			// probabilistically transpose note according to ranges (with offset and squash)
+			float dice2 = rng.uniform() * cumulRanges[6];
 			int oct = 0;
 			for (; oct < 7; oct++) {
 				if (dice2 < cumulRanges[oct]) {
@@ -276,6 +304,7 @@ class ProbKernel {
 	
 	
 	void transposeUp() {
+		tablesDirty = true;
 		// rotate noteProbs[] and noteAnchors[] right by 1, and increment noteAnchor of B note
 		// if noteAnchor of B note goes above MAX_ANCHOR_DELTA, do nothing
 		float noteAnchorB = noteAnchors[11] + 1.0f / (2.0f * MAX_ANCHOR_DELTA);
@@ -292,6 +321,7 @@ class ProbKernel {
 	
 	
 	void transposeDown() {
+		tablesDirty = true;
 		// rotate noteProbs[] and noteAnchors[] left by 1, and decrement noteAnchor of C note
 		// if noteAnchor of C note goes below -MAX_ANCHOR_DELTA, do nothing
 		float noteAnchorC = noteAnchors[0] - 1.0f / (2.0f * MAX_ANCHOR_DELTA);
@@ -344,14 +374,22 @@ class ProbKernel {
 class OutputKernel {
 	public:
 
-	static const int MAX_LENGTH = 16;
+	static const int MAX_LENGTH = 64;// must be a power of 2
+	static const int DEFAULT_LENGTH = 16;
 	
 	
 	private:
 	
+	static const int LENGTH_MASK = MAX_LENGTH - 1;
+	static constexpr float NO_MIN = 100.0f;
+	
+	// shiftReg is a ring buffer, logical index i (0 = newest) is at (head + i) & LENGTH_MASK, so shifting only moves head
 	float shiftReg[MAX_LENGTH];// holds CVs or ProbKernel::IDEM_CV
+	int head;
 	float lastCv;// sample and hold, must never hold ProbKernel::IDEM_CV
 	float minCv;
+	float winMin;// min of non IDEM_CV values in register[0:winLength0], NO_MIN if none
+	int winLength0;// length0 of window for which winMin is valid, -1 when a rescan is needed
 	
 	
 	public:
@@ -360,8 +398,10 @@ class OutputKernel {
 		for (int i = 0; i < MAX_LENGTH; i++) {
 			shiftReg[i] = 0.0f;
 		}
+		head = 0;
 		lastCv = 0.0f;
 		minCv = 0.0f;
+		winLength0 = -1;
 	}
 	
 	void randomize() {
@@ -369,10 +409,10 @@ class OutputKernel {
 	}
 	
 	void dataToJson(json_t *rootJ, int id) {
-		// shiftReg
+		// shiftReg (linearized, newest first)
 		json_t *shiftRegJ = json_array();
 		for (int i = 0; i < MAX_LENGTH; i++) {
-			json_array_insert_new(shiftRegJ, i, json_real(shiftReg[i]));
+			json_array_insert_new(shiftRegJ, i, json_real(getReg(i)));
 		}
 		json_object_set_new(rootJ, string::f("shiftReg%i", id).c_str(), shiftRegJ);
 		
@@ -385,15 +425,19 @@ class OutputKernel {
 	}
 	
 	void dataFromJson(json_t *rootJ, int id) {
-		// shiftReg
+		// shiftReg (linearized, newest first; older patches have fewer entries)
 		json_t *shiftRegJ = json_object_get(rootJ, string::f("shiftReg%i", id).c_str());
 		if (shiftRegJ) {
+			float linReg[MAX_LENGTH];
 			for (int i = 0; i < MAX_LENGTH; i++) {
 				json_t *shiftRegArrayJ = json_array_get(shiftRegJ, i);
-				if (shiftRegArrayJ) {
-					shiftReg[i] = json_number_value(shiftRegArrayJ);
-				}
+				linReg[i] = shiftRegArrayJ ? json_number_value(shiftRegArrayJ) : getReg(i);
 			}
+			for (int i = 0; i < MAX_LENGTH; i++) {
+				shiftReg[i] = linReg[i];
+			}
+			head = 0;
+			winLength0 = -1;
 		}
 
 		// lastCv
@@ -410,38 +454,49 @@ class OutputKernel {
 	}
 
 
-	void calcMinCv(int length0) {
-		// will leave minCv untouched if all CVs within length are IDEM_CV
-		float srMin = 100.0f;
+	void calcWinMin(int length0) {
+		winMin = NO_MIN;
 		for (int i = 0; i <= length0; i++) {
-			if (shiftReg[i] != ProbKernel::IDEM_CV && shiftReg[i] < srMin) {
-				srMin = shiftReg[i];
+			float cv = getReg(i);
+			if (cv != ProbKernel::IDEM_CV && cv < winMin) {
+				winMin = cv;
 			}
 		}
-		if (srMin != 100.0f) {
-			minCv = srMin;
+		winLength0 = length0;
+	}
+
+
+	void shiftIn(float newCv, int length0) {
+		// value leaving the window, only a rescan when it could have been the min or when length changed
+		float evicted = getReg(length0);
+		head = (head - 1) & LENGTH_MASK;
+		shiftReg[head] = newCv;
+		if (length0 != winLength0 || evicted == winMin) {
+			calcWinMin(length0);
+		}
+		else if (newCv != ProbKernel::IDEM_CV && newCv < winMin) {
+			winMin = newCv;
+		}
+		// will leave minCv untouched if all CVs within length are IDEM_CV
+		if (winMin != NO_MIN) {
+			minCv = winMin;
 		}
 	}
 
 
 	void shiftWithHold(int length0) {
-		for (int i = MAX_LENGTH - 1; i > 0; i--) {
-			shiftReg[i] = shiftReg[i - 1];
-		}
-		calcMinCv(length0);
+		shiftIn(shiftReg[head], length0);
 	}
 		
 	void shiftWithInsertNew(float newCv, int length0) {
-		shiftWithHold(length0);
-		shiftReg[0] = newCv;
-		if (shiftReg[0] != ProbKernel::IDEM_CV) {
-			lastCv = shiftReg[0];
-			minCv = std::min(minCv, lastCv);
+		shiftIn(newCv, length0);
+		if (newCv != ProbKernel::IDEM_CV) {
+			lastCv = newCv;
 		}
 	}
 		
 	void shiftWithRecycle(int length0) {
-		shiftWithInsertNew(shiftReg[length0], length0);
+		shiftWithInsertNew(getReg(length0), length0);
 	}
 	
 	float getCv() {
@@ -451,13 +506,14 @@ class OutputKernel {
 		return minCv;
 	}
 	float getReg(int i) {
-		return shiftReg[i];
+		return shiftReg[(head + i) & LENGTH_MASK];
 	}
 	void setReg(float cv, int i) {
-		shiftReg[i] = cv;
+		shiftReg[(head + i) & LENGTH_MASK] = cv;
+		winLength0 = -1;
 	}
 	bool getGateEnable() {
-		return shiftReg[0] != ProbKernel::IDEM_CV;
+		return shiftReg[head] != ProbKernel::IDEM_CV;
 	}
 };
 
@@ -469,11 +525,16 @@ class DisplayManager {
 	long dispCounter;
 	int dispMode;
 	char buf[5];// only used when dispMode != DISP_NORMAL
+	RefreshCounter* refreshPtr;
 	
 	public:
 	
 	enum DispIds {DISP_NORMAL, DISP_PROB, DISP_ANCHOR, DISP_LENGTH, DISP_COPY, DISP_PASTE};
 	
+	void construct(RefreshCounter* _refreshPtr) {
+		refreshPtr = _refreshPtr;
+	}
+	
 	int getMode() {
 		return dispMode;
 	}
@@ -498,7 +559,7 @@ class DisplayManager {
 	
 	void displayProb(float probVal) {
 		dispMode = DISP_PROB;
-		dispCounter = (long)(2.5f * (APP->engine->getSampleRate() / RefreshCounter::displayRefreshStepSkips));
+		dispCounter = (long)(2.5f * (APP->engine->getSampleRate() / refreshPtr->displayRefreshStepSkips));
 		int prob = (int)(probVal * 100.0f + 0.5f);
 		if ( prob>= 100) { 
 			snprintf(buf, 5, " 1,0");
@@ -512,23 +573,23 @@ class DisplayManager {
 	}
 	void displayAnchor(int key, int oct) {
 		dispMode = DISP_ANCHOR;
-		dispCounter = (long)(2.5f * (APP->engine->getSampleRate() / RefreshCounter::displayRefreshStepSkips));
+		dispCounter = (long)(2.5f * (APP->engine->getSampleRate() / refreshPtr->displayRefreshStepSkips));
 		float cv = (float)oct + ((float)key) / 12.0f;
 		printNote(cv, buf, true);
 		
 	}
 	void displayLength() {
 		dispMode = DISP_LENGTH;
-		dispCounter = (long)(2.5f * (APP->engine->getSampleRate() / RefreshCounter::displayRefreshStepSkips));
+		dispCounter = (long)(2.5f * (APP->engine->getSampleRate() / refreshPtr->displayRefreshStepSkips));
 	}
 	void displayCopy() {
 		dispMode = DISP_COPY;
-		dispCounter = (long)(1.0f * (APP->engine->getSampleRate() / RefreshCounter::displayRefreshStepSkips));
+		dispCounter = (long)(1.0f * (APP->engine->getSampleRate() / refreshPtr->displayRefreshStepSkips));
 		snprintf(buf, 5, "COPY");
 	}
 	void displayPaste() {
 		dispMode = DISP_PASTE;
-		dispCounter = (long)(1.0f * (APP->engine->getSampleRate() / RefreshCounter::displayRefreshStepSkips));
+		dispCounter = (long)(1.0f * (APP->engine->getSampleRate() / refreshPtr->displayRefreshStepSkips));
 		snprintf(buf, 5, "PSTE");
 	}
 	
@@ -580,12 +641,11 @@ struct ProbKey : Module {
 	
 	
 	// Expander
-	// none (nothing from ProbKeyExpander)
+	ExpanderSender<PkxInterface> toExpander;// nothing from ProbKeyExpander
 		
 	// Constants
 	enum ModeIds {MODE_PROB, MODE_ANCHOR, MODE_RANGE};
 	static const int NUM_INDEXES = 25;// C4 to C6 incl
-	static const int MAX_LENGTH = 16;
 	
 	// Need to save, no reset
 	int panelTheme;
@@ -595,6 +655,7 @@ struct ProbKey : Module {
 	float overlap;
 	ProbKernel probKernels[NUM_INDEXES];
 	OutputKernel outputKernels[PORT_MAX_CHANNELS];
+	ModuleRandom rng;// only the seed is saved
 	
 	// No need to save, with reset
 	DisplayManager dispManager;
@@ -653,8 +714,10 @@ struct ProbKey : Module {
 	ProbKey() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		
+		dispManager.construct(&refresh);
+		
 		configParam(INDEX_PARAM, 0.0f, 24.0f, 0.0f, "Index", "", 0.0f, 1.0f, 1.0f);// diplay params are: base, mult, offset
-		configParam(LENGTH_PARAM, 0.0f, (float)(OutputKernel::MAX_LENGTH - 1), (float)(OutputKernel::MAX_LENGTH - 1), "Lock length", "", 0.0f, 1.0f, 1.0f);
+		configParam(LENGTH_PARAM, 0.0f, (float)(OutputKernel::MAX_LENGTH - 1), (float)(OutputKernel::DEFAULT_LENGTH - 1), "Lock length", "", 0.0f, 1.0f, 1.0f);
 		configParam(LOCK_KNOB_PARAM, 0.0f, 1.0f, 0.0f, "Lock sequence", " %", 0.0f, 100.0f, 0.0f);
 		configParam(LOCK_BUTTON_PARAM, 0.0f, 1.0f, 0.0f, "Manual lock opposite");
 		configParam(OFFSET_PARAM, -3.0f, 3.0f, 0.0f, "Oct range offset", "");
@@ -685,8 +748,14 @@ struct ProbKey : Module {
 		for (int i = 0; i < PORT_MAX_CHANNELS; i++) {
 			outputKernels[i].reset();
 		}
+		rng.init();
 		resetNonJson();
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+	}
+	
 	void resetNonJson() {
 		dispManager.reset();
 	}
@@ -724,6 +793,9 @@ struct ProbKey : Module {
 			outputKernels[i].dataToJson(rootJ, i);
 		}
 		
+		// rng
+		rng.dataToJson(rootJ);
+		
 		return rootJ;
 	}
 
@@ -761,6 +833,9 @@ struct ProbKey : Module {
 			outputKernels[i].dataFromJson(rootJ, i);
 		}
 
+		// rng
+		rng.dataFromJson(rootJ);
+
 		resetNonJson();
 	}
 		
@@ -799,8 +874,8 @@ struct ProbKey : Module {
 		
 		// Populate steps in the sequencer
 		// must write outputKernel register backwards!, so all calls to setReg() should be mirrored
-		for (int i = 0; i < MAX_LENGTH; i++) {
-			outputKernels[0].setReg(ProbKernel::IDEM_CV, seqLen - 1 - i);
+		for (int i = 0; i < OutputKernel::MAX_LENGTH; i++) {
+			outputKernels[0].setReg(ProbKernel::IDEM_CV, i);
 		}
 		for (int i = 0; i < seqLen; i++) {
 			if (ioSteps[i].gate) {
@@ -915,7 +990,7 @@ struct ProbKey : Module {
 			if (gateInTriggers[i].process(inputs[GATE_INPUT].getVoltage(i))) {
 				// got rising edge on gate input poly channel i
 
-				if (getLock() > random::uniform()) {
+				if (getLock() > rng.uniform()) {
 					// recycle CV
 					outputKernels[i].shiftWithRecycle(length0);
 				}
@@ -926,7 +1001,7 @@ struct ProbKey : Module {
 						outputKernels[i].shiftWithHold(length0);
 					}
 					else {
-						float newCv = probKernels[index].calcRandomCv(getOffset(), getSquash(), getPgain(), overlap);
+						float newCv = probKernels[index].calcRandomCv(getOffset(), getSquash(), getPgain(), overlap, rng);
 						outputKernels[i].shiftWithInsertNew(newCv, length0);
 					}
 				}
@@ -986,10 +1061,13 @@ struct ProbKey : Module {
 		
 		// To Expander
 		if (rightExpander.module && rightExpander.module->model == modelProbKeyExpander) {
-			PkxInterface *messagesToExpander = (PkxInterface*)(rightExpander.module->leftExpander.producerMessage);
+			PkxInterface *messagesToExpander = &toExpander.message;
 			messagesToExpander->panelTheme = panelTheme;
 			messagesToExpander->minCvChan0 = outputKernels[0].getMinCv();
-			rightExpander.module->leftExpander.messageFlipRequested = true;
+			toExpander.sendRight(this);
+		}
+		else {
+			toExpander.reset();
 		}
 	}
 	
@@ -1149,7 +1227,7 @@ struct ProbKeyWidget : ModuleWidget {
 			ProbKey *module;
 			void onAction(const event::Action &e) override {
 				int seqLen;
-				IoStep* ioSteps = interopPasteSequence(16, &seqLen);
+				IoStep* ioSteps = interopPasteSequence(OutputKernel::MAX_LENGTH, &seqLen);
 				if (ioSteps != nullptr) {
 					module->emptyIoSteps(ioSteps, seqLen);
 					delete[] ioSteps;
@@ -1213,6 +1291,11 @@ struct ProbKeyWidget : ModuleWidget {
 		OverlapSlider *ovlpSlider = new OverlapSlider(&(module->overlap));
 		ovlpSlider->box.size.x = 200.0f;
 		menu->addChild(ovlpSlider);
+
+		RandomSeedItem *seedItem = createMenuItem<RandomSeedItem>("Random seed", RIGHT_ARROW);
+		seedItem->rngPtr = &module->rng;
+		seedItem->showReseedOnReset = false;// no reset input
+		menu->addChild(seedItem);
 	}	
 	
 	
@@ -1397,8 +1480,7 @@ struct ProbKeyWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((ProbKey*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((ProbKey*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((ProbKey*)module)->panelTheme);
 		}
 		Widget::step();
 	}
@@ -30,7 +30,7 @@ struct ProbKeyExpander : Module {
 
 
 	// Expander
-	PkxInterface leftMessages[2] = {};// messages from mother
+	ExpanderChannel<PkxInterface> fromMother;// messages from mother
 
 
 	// No need to save
@@ -41,8 +41,7 @@ struct ProbKeyExpander : Module {
 	ProbKeyExpander() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, 0);
 		
-		leftExpander.producerMessage = &(leftMessages[0]);
-		leftExpander.consumerMessage = &(leftMessages[1]);
+		fromMother.construct(&leftExpander);
 		
 		panelTheme = (loadDarkAsDefault() ? 1 : 0);
 	}
@@ -56,9 +55,14 @@ struct ProbKeyExpander : Module {
 			bool motherPresent = leftExpander.module && (leftExpander.module->model == modelProbKey);
 			if (motherPresent) {					
 				// From Mother
-				PkxInterface *messagesFromMother = (PkxInterface*)leftExpander.consumerMessage;
-				panelTheme = clamp(messagesFromMother->panelTheme, 0, 1);
-				outputs[MINCV_OUTPUT].setVoltage(messagesFromMother->minCvChan0);
+				if (fromMother.receive()) {
+					PkxInterface *messagesFromMother = &fromMother.data();
+					panelTheme = clamp(messagesFromMother->panelTheme, 0, 1);
+					outputs[MINCV_OUTPUT].setVoltage(messagesFromMother->minCvChan0);
+				}
+			}
+			else {
+				fromMother.reset();
 			}		
 		}// expanderRefreshCounter			
 	}// process()
@@ -95,8 +99,7 @@ struct ProbKeyExpanderWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((ProbKeyExpander*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((ProbKeyExpander*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((ProbKeyExpander*)module)->panelTheme);
 		}
 		Widget::step();
 	}
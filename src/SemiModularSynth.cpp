@@ -180,6 +180,27 @@ struct SemiModularSynth : Module {
 	// Constants
 	enum DisplayStateIds {DISP_NORMAL, DISP_MODE, DISP_LENGTH, DISP_TRANSPOSE, DISP_ROTATE};
 
+	// Run state after the next clock edge, computed between clocks by calcNextStep() so that the clock edge only has to 
+	//   commit it; dropped on every user input scan (all edits are made there) and on reset, and computed again on the 
+	//   edge when rng was drawn from since then. What depends on the clock period and the knobs is done on the edge.
+	struct NextStep {
+		bool valid = false;
+		bool editingSequence;
+		uint32_t rngBefore[4];// rng state when computed
+		uint32_t rngAfter[4];
+		int ppqnCount;
+		int stepIndexRun;
+		unsigned long stepIndexRunHistory;
+		int phraseIndexRun;
+		unsigned long phraseIndexRunHistory;
+		bool stopRun;// end of song reached
+		int seq;
+		float slideFromCV;
+		float gate1ProbDraw;// only drawn on the first ppqn of an untied step with gate 1 probability
+		int gate1Code;// code when the probability lets gate 1 through
+		int gate2Code;
+	};
+
 	// Need to save, no reset
 	int panelTheme;
 	
@@ -200,6 +221,7 @@ struct SemiModularSynth : Module {
 	int stepIndexEdit;
 	int phraseIndexEdit;
 	bool resetOnRun;
+	ModuleRandom rng;// only the seed options are saved, also used for the analog VCO drift and the VCF noise
 	bool attached;
 	bool stopAtEndOfSong;
 
@@ -232,6 +254,7 @@ struct SemiModularSynth : Module {
 	int gate2Code;
 	bool lastProbGate1Enable;	
 	unsigned long slideStepsRemain;// 0 when no slide under way, downward step counter when sliding
+	NextStep nextStep;
 	
 	// VCO
 	// none
@@ -251,6 +274,7 @@ struct SemiModularSynth : Module {
 	
 	// No need to save, no reset
 	RefreshCounter refresh;
+	SampleTimings timings;
 	float slideCVdelta;// no need to initialize, this goes with slideStepsRemain
 	float editingGateCV;// no need to initialize, this goes with editingGate (output this only when editingGate > 0)
 	int editingGateKeyLight;// no need to initialize, this goes with editingGate (use this only when editingGate > 0)
@@ -361,6 +385,7 @@ struct SemiModularSynth : Module {
 		
 		// VCO
 		oscillatorVco.soft = false;
+		oscillatorVco.rngPtr = &rng;
 		
 		// CLK 
 		oscillatorClk.offset = true;
@@ -397,6 +422,7 @@ struct SemiModularSynth : Module {
 			}
 		}
 		resetOnRun = false;
+		rng.init();
 		attached = false;
 		stopAtEndOfSong = false;
 		resetNonJson();
@@ -410,6 +436,12 @@ struct SemiModularSynth : Module {
 		// VCF
 		filter.reset();
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+		timings.onSampleRateChange();
+	}
+	
 	void resetNonJson() {
 		displayState = DISP_NORMAL;
 		for (int i = 0; i < 16; i++) {
@@ -434,7 +466,8 @@ struct SemiModularSynth : Module {
 		initRun();		
 	}
 	void initRun() {// run button activated or run edge in run input jack
-		clockIgnoreOnReset = (long) (clockIgnoreOnResetDuration * APP->engine->getSampleRate());
+		clockIgnoreOnReset = timings.clockIgnoreOnReset;
+		rng.onSeqReset();
 		phraseIndexRun = (runModeSong == MODE_REV ? phrases - 1 : 0);
 		phraseIndexRunHistory = 0;
 
@@ -447,16 +480,17 @@ struct SemiModularSynth : Module {
 		calcGate1Code(attributes[seq][stepIndexRun]);
 		gate2Code = calcGate2Code(attributes[seq][stepIndexRun], 0, pulsesPerStep);
 		slideStepsRemain = 0ul;
+		nextStep.valid = false;
 	}
 
 	
 	void onRandomize() override {
 		if (isEditingSequence()) {
 			for (int s = 0; s < 16; s++) {
-				cv[seqIndexEdit][s] = ((float)(random::u32() % 5)) + ((float)(random::u32() % 12)) / 12.0f - 2.0f;
-				attributes[seqIndexEdit][s].randomize();
+				cv[seqIndexEdit][s] = ((float)(rng.u32() % 5)) + ((float)(rng.u32() % 12)) / 12.0f - 2.0f;
+				attributes[seqIndexEdit][s].randomize(rng);
 			}
-			sequences[seqIndexEdit].randomize(16, NUM_MODES - 1);
+			sequences[seqIndexEdit].randomize(16, NUM_MODES - 1, rng);
 		}
 	}
 	
@@ -531,6 +565,9 @@ struct SemiModularSynth : Module {
 		// resetOnRun
 		json_object_set_new(rootJ, "resetOnRun", json_boolean(resetOnRun));
 		
+		// rng
+		rng.dataToJson(rootJ);
+		
 		// attached
 		json_object_set_new(rootJ, "attached", json_boolean(attached));
 
@@ -720,6 +757,9 @@ struct SemiModularSynth : Module {
 		if (resetOnRunJ)
 			resetOnRun = json_is_true(resetOnRunJ);
 
+		// rng
+		rng.dataFromJson(rootJ);
+
 		// attached
 		json_t *attachedJ = json_object_get(rootJ, "attached");
 		if (attachedJ)
@@ -803,26 +843,124 @@ struct SemiModularSynth : Module {
 	
 	
 	void calcGate1Code(StepAttributes attribute) {
-		int gateType = attribute.getGate1Mode();
-		
 		if (ppqnCount == 0 && !attribute.getTied()) {
-			lastProbGate1Enable = !attribute.getGate1P() || (random::uniform() < params[GATE1_KNOB_PARAM].getValue()); // random::uniform is [0.0, 1.0), see include/util/common.hpp
+			lastProbGate1Enable = !attribute.getGate1P() || (rng.uniform() < params[GATE1_KNOB_PARAM].getValue());
 		}
-			
-		if (!attribute.getGate1() || !lastProbGate1Enable) {
-			gate1Code = 0;
+		gate1Code = (lastProbGate1Enable ? calcGate1CodeEnabled(attribute, ppqnCount) : 0);
+	}
+	int calcGate1CodeEnabled(StepAttributes attribute, int ppqn) {// gate 1 code when its probability lets it through
+		int gateType = attribute.getGate1Mode();
+		int code;
+		if (!attribute.getGate1()) {
+			code = 0;
 		}
 		else if (pulsesPerStep == 1 && gateType == 0) {
-			gate1Code = 2;// clock high
+			code = 2;// clock high
 		}
 		else { 
 			if (gateType == 11) {
-				gate1Code = (ppqnCount == 0 ? 3 : 0);
+				code = (ppqn == 0 ? 3 : 0);
 			}
 			else {
-				gate1Code = getAdvGate(ppqnCount, pulsesPerStep, gateType);
+				code = getAdvGate(ppqn, pulsesPerStep, gateType);
 			}
 		}
+		return code;
+	}
+	
+	
+	void calcNextStep(bool editingSequence) {// what the next clock edge does to the run state, on a copy of it and of rng
+		ModuleRandom nextRng = rng;
+		rng.getState(nextStep.rngBefore);
+		nextStep.editingSequence = editingSequence;
+		nextStep.ppqnCount = ppqnCount + 1;
+		if (nextStep.ppqnCount >= pulsesPerStep)
+			nextStep.ppqnCount = 0;
+		nextStep.stepIndexRun = stepIndexRun;
+		nextStep.stepIndexRunHistory = stepIndexRunHistory;
+		nextStep.phraseIndexRun = phraseIndexRun;
+		nextStep.phraseIndexRunHistory = phraseIndexRunHistory;
+		nextStep.stopRun = false;
+
+		int newSeq = seqIndexEdit;// good value when editingSequence, overwrite if not editingSequence
+		if (nextStep.ppqnCount == 0) {
+			if (editingSequence) {
+				nextStep.slideFromCV = cv[seqIndexEdit][stepIndexRun];
+				//bool seqLoopOver = 
+				moveIndexRunMode(&nextStep.stepIndexRun, sequences[seqIndexEdit].getLength(), sequences[seqIndexEdit].getRunMode(), &nextStep.stepIndexRunHistory, nextRng);
+				// if (seqLoopOver && stopAtEndOfSong) {
+					// nextStep.stopRun = true;
+					// nextStep.stepIndexRun = stepIndexRun;
+				// }
+			}
+			else {
+				nextStep.slideFromCV = cv[phrase[phraseIndexRun]][stepIndexRun];
+				
+				if (moveIndexRunMode(&nextStep.stepIndexRun, sequences[phrase[phraseIndexRun]].getLength(), sequences[phrase[phraseIndexRun]].getRunMode(), &nextStep.stepIndexRunHistory, nextRng)) {
+					bool songLoopOver = moveIndexRunMode(&nextStep.phraseIndexRun, phrases, runModeSong, &nextStep.phraseIndexRunHistory, nextRng);
+					// check for end of song if needed
+					if (songLoopOver && stopAtEndOfSong) {
+						nextStep.stopRun = true;
+						nextStep.stepIndexRun = stepIndexRun;
+						nextStep.phraseIndexRun = phraseIndexRun;
+					}
+					else {
+						int seq = phrase[nextStep.phraseIndexRun];
+						nextStep.stepIndexRun = (sequences[seq].getRunMode() == MODE_REV ? sequences[seq].getLength() - 1 : 0);// must always refresh after phraseIndexRun has changed
+					}
+				}
+				newSeq = phrase[nextStep.phraseIndexRun];
+			}
+		}
+		else {
+			if (!editingSequence)
+				newSeq = phrase[phraseIndexRun];
+		}
+		
+		StepAttributes attribute = attributes[newSeq][nextStep.stepIndexRun];
+		nextStep.seq = newSeq;
+		if (nextStep.ppqnCount == 0 && !attribute.getTied() && attribute.getGate1P())
+			nextStep.gate1ProbDraw = nextRng.uniform();
+		nextStep.gate1Code = calcGate1CodeEnabled(attribute, nextStep.ppqnCount);
+		nextStep.gate2Code = calcGate2Code(attribute, nextStep.ppqnCount, pulsesPerStep);
+		nextRng.getState(nextStep.rngAfter);
+		nextStep.valid = true;
+	}
+	
+	void clockStep(bool editingSequence) {// clock edge: commits nextStep, computed now when it is missing or stale
+		if (!nextStep.valid || nextStep.editingSequence != editingSequence || !rng.hasState(nextStep.rngBefore))
+			calcNextStep(editingSequence);
+		
+		if (nextStep.stopRun)
+			running = false;
+		ppqnCount = nextStep.ppqnCount;
+		stepIndexRun = nextStep.stepIndexRun;
+		stepIndexRunHistory = nextStep.stepIndexRunHistory;
+		phraseIndexRun = nextStep.phraseIndexRun;
+		phraseIndexRunHistory = nextStep.phraseIndexRunHistory;
+		rng.setState(nextStep.rngAfter);
+		
+		StepAttributes attribute = attributes[nextStep.seq][stepIndexRun];
+		if (ppqnCount == 0) {
+			// Slide
+			if (attribute.getSlide()) {
+				slideStepsRemain =   (unsigned long) (((float)clockPeriod * pulsesPerStep) * params[SLIDE_KNOB_PARAM].getValue() / 2.0f);
+				if (slideStepsRemain != 0ul) {
+					float slideToCV = cv[nextStep.seq][stepIndexRun];
+					slideCVdelta = (slideToCV - nextStep.slideFromCV)/(float)slideStepsRemain;
+				}
+			}
+			else
+				slideStepsRemain = 0ul;
+			
+			if (!attribute.getTied()) {
+				lastProbGate1Enable = !attribute.getGate1P() || (nextStep.gate1ProbDraw < params[GATE1_KNOB_PARAM].getValue());
+			}
+		}
+		gate1Code = (lastProbGate1Enable ? nextStep.gate1Code : 0);
+		gate2Code = nextStep.gate2Code;
+		clockPeriod = 0ul;
+		nextStep.valid = false;
 	}
 	
 
@@ -855,6 +993,8 @@ struct SemiModularSynth : Module {
 		}
 
 		if (refresh.processInputs()) {
+			nextStep.valid = false;// edits below, and those of the UI thread since the last scan
+			
 			// Seq CV input
 			if (inputs[SEQCV_INPUT].isConnected()) {
 				if (seqCVmethod == 0) {// 0-10 V
@@ -907,16 +1047,16 @@ struct SemiModularSynth : Module {
 							phraseCPbuffer[i] = phrase[p];
 						seqCopied = false;// so that a cross paste can be detected
 					}
-					infoCopyPaste = (long) (revertDisplayTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					infoCopyPaste = (long) (revertDisplayTime * sampleRate / refresh.displayRefreshStepSkips);
 					displayState = DISP_NORMAL;
 				}
 				else
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 			}
 			// Paste button
 			if (pasteTrigger.process(params[PASTE_PARAM].getValue())) {
 				if (!attached) {
-					infoCopyPaste = (long) (-1 * revertDisplayTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					infoCopyPaste = (long) (-1 * revertDisplayTime * sampleRate / refresh.displayRefreshStepSkips);
 					startCP = 0;
 					if (countCP <= 8) {
 						startCP = editingSequence ? stepIndexEdit : phraseIndexEdit;
@@ -946,13 +1086,13 @@ struct SemiModularSynth : Module {
 							}
 							else if (params[CPMODE_PARAM].getValue() < 0.5f) {// 4 (randomize CVs)
 								for (int s = 0; s < 16; s++)
-									cv[seqIndexEdit][s] = ((float)(random::u32() % 7)) + ((float)(random::u32() % 12)) / 12.0f - 3.0f;
+									cv[seqIndexEdit][s] = ((float)(rng.u32() % 7)) + ((float)(rng.u32() % 12)) / 12.0f - 3.0f;
 								sequences[seqIndexEdit].setTranspose(0);
 								sequences[seqIndexEdit].setRotate(0);
 							}
 							else {// 8 (randomize gate 1)
 								for (int s = 0; s < 16; s++)
-									if ( (random::u32() & 0x1) != 0)
+									if ( (rng.u32() & 0x1) != 0)
 										attributes[seqIndexEdit][s].toggleGate1();
 							}
 							startCP = 0;
@@ -976,7 +1116,7 @@ struct SemiModularSynth : Module {
 							}
 							else {// 8 (randomize phrases)
 								for (int p = 0; p < 16; p++)
-									phrase[p] = random::u32() % 16;
+									phrase[p] = rng.u32() % 16;
 							}
 							startCP = 0;
 							countCP = 16;
@@ -986,7 +1126,7 @@ struct SemiModularSynth : Module {
 					displayState = DISP_NORMAL;
 				}
 				else
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 			}
 			
 			// Write input (must be before Left and Right in case route gate simultaneously to Right and Write for example)
@@ -998,7 +1138,7 @@ struct SemiModularSynth : Module {
 						cv[seqIndexEdit][stepIndexEdit] = inputs[CV_INPUT].getVoltage();
 						propagateCVtoTied(seqIndexEdit, stepIndexEdit);
 					}
-					editingGate = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					editingGate = (unsigned long) (gateTime * sampleRate / refresh.displayRefreshStepSkips);
 					editingGateCV = inputs[CV_INPUT].getVoltage();// cv[seqIndexEdit][stepIndexEdit];
 					editingGateKeyLight = -1;
 					// Autostep (after grab all active inputs)
@@ -1026,7 +1166,7 @@ struct SemiModularSynth : Module {
 						stepIndexEdit = moveIndex(stepIndexEdit, stepIndexEdit + delta, 16);
 						if (!attributes[seqIndexEdit][stepIndexEdit].getTied()) {// play if non-tied step
 							if (!writeTrig) {// in case autostep when simultaneous writeCV and stepCV (keep what was done in Write Input block above)
-								editingGate = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+								editingGate = (unsigned long) (gateTime * sampleRate / refresh.displayRefreshStepSkips);
 								editingGateCV = cv[seqIndexEdit][stepIndexEdit];
 								editingGateKeyLight = -1;
 							}
@@ -1052,14 +1192,14 @@ struct SemiModularSynth : Module {
 						sequences[seqIndexEdit].setLength(stepPressed + 1);
 					else
 						phrases = stepPressed + 1;
-					revertDisplay = (long) (revertDisplayTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					revertDisplay = (long) (revertDisplayTime * sampleRate / refresh.displayRefreshStepSkips);
 				}
 				else {
 					if (!running || !attached) {// not running or detached
 						if (editingSequence) {
 							stepIndexEdit = stepPressed;
 							if (!attributes[seqIndexEdit][stepIndexEdit].getTied()) {// play if non-tied step
-								editingGate = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+								editingGate = (unsigned long) (gateTime * sampleRate / refresh.displayRefreshStepSkips);
 								editingGateCV = cv[seqIndexEdit][stepIndexEdit];
 								editingGateKeyLight = -1;
 							}
@@ -1071,7 +1211,7 @@ struct SemiModularSynth : Module {
 						}
 					}
 					else {// attached and running
-						attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 					}
 					displayState = DISP_NORMAL;
 				}
@@ -1088,10 +1228,10 @@ struct SemiModularSynth : Module {
 						displayState = DISP_MODE;
 					else
 						displayState = DISP_NORMAL;
-					modeHoldDetect.start((long) (holdDetectTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+					modeHoldDetect.start((long) (holdDetectTime * sampleRate / refresh.displayRefreshStepSkips));
 				}
 				else
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 			}
 			
 			// Transpose/Rotate button
@@ -1107,7 +1247,7 @@ struct SemiModularSynth : Module {
 						displayState = DISP_NORMAL;
 				}
 				else if (attached)
-					attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 			}			
 			
 			// Sequence knob  
@@ -1121,7 +1261,7 @@ struct SemiModularSynth : Module {
 					// any changes in here should may also require right click behavior to be updated in the knob's onMouseDown()
 					if (editingPpqn != 0) {
 						pulsesPerStep = indexToPps(ppsToIndex(pulsesPerStep) + deltaKnob);// indexToPps() does clamping
-						editingPpqn = (long) (editGateLengthTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						editingPpqn = (long) (editGateLengthTime * sampleRate / refresh.displayRefreshStepSkips);
 					}
 					else if (displayState == DISP_MODE) {
 						if (editingSequence) {
@@ -1178,7 +1318,7 @@ struct SemiModularSynth : Module {
 							if (!attached || (attached && !running))
 								phrase[phraseIndexEdit] = clamp(phrase[phraseIndexEdit] + deltaKnob, 0, 16 - 1);
 							else
-								attachedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+								attachedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 						}
 					}
 				}
@@ -1191,11 +1331,11 @@ struct SemiModularSynth : Module {
 					if (editingSequence) {
 						displayState = DISP_NORMAL;
 						if (attributes[seqIndexEdit][stepIndexEdit].getTied())
-							tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+							tiedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 						else {			
 							cv[seqIndexEdit][stepIndexEdit] = applyNewOct(cv[seqIndexEdit][stepIndexEdit], 3 - i);
 							propagateCVtoTied(seqIndexEdit, stepIndexEdit);
-							editingGate = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+							editingGate = (unsigned long) (gateTime * sampleRate / refresh.displayRefreshStepSkips);
 							editingGateCV = cv[seqIndexEdit][stepIndexEdit];
 							editingGateKeyLight = -1;
 						}
@@ -1214,26 +1354,26 @@ struct SemiModularSynth : Module {
 							attributes[seqIndexEdit][stepIndexEdit].setGateMode(newMode, editingGateLength > 0l);
 							if (pkInfo.isRightClick) {
 								stepIndexEdit = moveIndex(stepIndexEdit, stepIndexEdit + 1, 16);
-								editingType = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+								editingType = (unsigned long) (gateTime * sampleRate / refresh.displayRefreshStepSkips);
 								editingGateKeyLight = pkInfo.key;
 								if ((APP->window->getMods() & RACK_MOD_MASK) == RACK_MOD_CTRL)
 									attributes[seqIndexEdit][stepIndexEdit].setGateMode(newMode, editingGateLength > 0l);
 							}
 						}
 						else
-							editingPpqn = (long) (editGateLengthTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+							editingPpqn = (long) (editGateLengthTime * sampleRate / refresh.displayRefreshStepSkips);
 					}
 					else if (attributes[seqIndexEdit][stepIndexEdit].getTied()) {
 						if (pkInfo.isRightClick)
 							stepIndexEdit = moveIndex(stepIndexEdit, stepIndexEdit + 1, 16);
 						else
-							tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+							tiedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 					}
 					else {			
 						float newCV = std::floor(cv[seqIndexEdit][stepIndexEdit]) + ((float) pkInfo.key) / 12.0f;
 						cv[seqIndexEdit][stepIndexEdit] = newCV;
 						propagateCVtoTied(seqIndexEdit, stepIndexEdit);
-						editingGate = (unsigned long) (gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						editingGate = (unsigned long) (gateTime * sampleRate / refresh.displayRefreshStepSkips);
 						editingGateCV = cv[seqIndexEdit][stepIndexEdit];
 						editingGateKeyLight = -1;
 						if (pkInfo.isRightClick) {
@@ -1271,7 +1411,7 @@ struct SemiModularSynth : Module {
 				if (editingSequence) {
 					displayState = DISP_NORMAL;
 					if (attributes[seqIndexEdit][stepIndexEdit].getTied())
-						tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						tiedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 					else
 						attributes[seqIndexEdit][stepIndexEdit].toggleGate1P();
 				}
@@ -1286,7 +1426,7 @@ struct SemiModularSynth : Module {
 				if (editingSequence) {
 					displayState = DISP_NORMAL;
 					if (attributes[seqIndexEdit][stepIndexEdit].getTied())
-						tiedWarning = (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+						tiedWarning = (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips);
 					else
 						attributes[seqIndexEdit][stepIndexEdit].toggleSlide();
 				}
@@ -1310,61 +1450,11 @@ struct SemiModularSynth : Module {
 		
 		// Clock
 		float clockInput = inputs[CLOCK_INPUT].isConnected() ? inputs[CLOCK_INPUT].getVoltage() : clkValue;// Pre-patching
+		bool clockedOrReset = false;
 		if (running && clockIgnoreOnReset == 0l) {
 			if (clockTrigger.process(clockInput)) {
-				ppqnCount++;
-				if (ppqnCount >= pulsesPerStep)
-					ppqnCount = 0;
-
-				int newSeq = seqIndexEdit;// good value when editingSequence, overwrite if not editingSequence
-				if (ppqnCount == 0) {
-					float slideFromCV = 0.0f;
-					int oldStepIndexRun = stepIndexRun;
-					if (editingSequence) {
-						slideFromCV = cv[seqIndexEdit][stepIndexRun];
-						//bool seqLoopOver = 
-						moveIndexRunMode(&stepIndexRun, sequences[seqIndexEdit].getLength(), sequences[seqIndexEdit].getRunMode(), &stepIndexRunHistory);
-						// if (seqLoopOver && stopAtEndOfSong) {
-							// running = false;
-							// stepIndexRun = oldStepIndexRun;
-						// }
-					}
-					else {
-						slideFromCV = cv[phrase[phraseIndexRun]][stepIndexRun];
-						if (moveIndexRunMode(&stepIndexRun, sequences[phrase[phraseIndexRun]].getLength(), sequences[phrase[phraseIndexRun]].getRunMode(), &stepIndexRunHistory)) {
-							int oldPhraseIndexRun = phraseIndexRun;
-							bool songLoopOver = moveIndexRunMode(&phraseIndexRun, phrases, runModeSong, &phraseIndexRunHistory);
-							// check for end of song if needed
-							if (songLoopOver && stopAtEndOfSong) {
-								running = false;
-								stepIndexRun = oldStepIndexRun;
-								phraseIndexRun = oldPhraseIndexRun;
-							}
-							else {
-								stepIndexRun = (sequences[phrase[phraseIndexRun]].getRunMode() == MODE_REV ? sequences[phrase[phraseIndexRun]].getLength() - 1 : 0);// must always refresh after phraseIndexRun has changed
-							}
-						}
-						newSeq = phrase[phraseIndexRun];
-					}
-					
-					// Slide
-					if (attributes[newSeq][stepIndexRun].getSlide()) {
-						slideStepsRemain =   (unsigned long) (((float)clockPeriod * pulsesPerStep) * params[SLIDE_KNOB_PARAM].getValue() / 2.0f);
-						if (slideStepsRemain != 0ul) {
-							float slideToCV = cv[newSeq][stepIndexRun];
-							slideCVdelta = (slideToCV - slideFromCV)/(float)slideStepsRemain;
-						}
-					}
-					else 
-						slideStepsRemain = 0ul;
-				}
-				else {
-					if (!editingSequence)
-						newSeq = phrase[phraseIndexRun];
-				}
-				calcGate1Code(attributes[newSeq][stepIndexRun]);
-				gate2Code = calcGate2Code(attributes[newSeq][stepIndexRun], ppqnCount, pulsesPerStep);
-				clockPeriod = 0ul;				
+				clockStep(editingSequence);
+				clockedOrReset = true;
 			}
 			clockPeriod++;
 		}	
@@ -1376,8 +1466,13 @@ struct SemiModularSynth : Module {
 			displayState = DISP_NORMAL;
 			if (inputs[SEQCV_INPUT].isConnected() && seqCVmethod == 2)
 				seqIndexEdit = 0;
+			clockedOrReset = true;
 		}
 		
+		// Next step, computed ahead of the clock edge that will use it
+		if (running && !clockedOrReset && !nextStep.valid)
+			calcNextStep(editingSequence);
+		
 		
 		//********** Outputs and lights **********
 				
@@ -1390,8 +1485,8 @@ struct SemiModularSynth : Module {
 			float slideOffset = (slideStepsRemain > 0ul ? (slideCVdelta * (float)slideStepsRemain) : 0.0f);
 			outputs[CV_OUTPUT].setVoltage(cv[seq][step] - slideOffset);
 			bool retriggingOnReset = (clockIgnoreOnReset != 0l && retrigGatesOnReset);
-			outputs[GATE1_OUTPUT].setVoltage((calcGate(gate1Code, clockTrigger, clockPeriod, sampleRate) && !muteGate1 && !retriggingOnReset) ? 10.0f : 0.0f);
-			outputs[GATE2_OUTPUT].setVoltage((calcGate(gate2Code, clockTrigger, clockPeriod, sampleRate) && !muteGate2 && !retriggingOnReset) ? 10.0f : 0.0f);
+			outputs[GATE1_OUTPUT].setVoltage((calcGate(gate1Code, clockTrigger, clockPeriod, timings.gateTrigger) && !muteGate1 && !retriggingOnReset) ? 10.0f : 0.0f);
+			outputs[GATE2_OUTPUT].setVoltage((calcGate(gate2Code, clockTrigger, clockPeriod, timings.gateTrigger) && !muteGate2 && !retriggingOnReset) ? 10.0f : 0.0f);
 		}
 		else {// not running 
 			outputs[CV_OUTPUT].setVoltage((editingGate > 0ul) ? editingGateCV : cv[seq][step]);
@@ -1473,7 +1568,7 @@ struct SemiModularSynth : Module {
 					lights[OCTAVE_LIGHTS + i].setBrightness(0.0f);
 				else {
 					if (tiedWarning > 0l) {
-						bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+						bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips));
 						lights[OCTAVE_LIGHTS + i].setBrightness((warningFlashState && (i == (6 - octLightIndex))) ? 1.0f : 0.0f);
 					}
 					else				
@@ -1499,7 +1594,7 @@ struct SemiModularSynth : Module {
 					float red = editingGateLength > 0l ? 0.45f : 1.0f;
 					if (editingType > 0ul) {
 						if (i == editingGateKeyLight) {
-							float dimMult = ((float) editingType / (float)(gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+							float dimMult = ((float) editingType / (float)(gateTime * sampleRate / refresh.displayRefreshStepSkips));
 							setGreenRed(KEY_LIGHTS + i * 2, green * dimMult, red * dimMult);
 						}
 						else
@@ -1524,12 +1619,12 @@ struct SemiModularSynth : Module {
 						lights[KEY_LIGHTS + i * 2 + 1].setBrightness(0.0f);
 					else {
 						if (tiedWarning > 0l) {
-							bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+							bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips));
 							lights[KEY_LIGHTS + i * 2 + 1].setBrightness((warningFlashState && i == keyLightIndex) ? 1.0f : 0.0f);
 						}
 						else {
 							if (editingGate > 0ul && editingGateKeyLight != -1)
-								lights[KEY_LIGHTS + i * 2 + 1].setBrightness(i == editingGateKeyLight ? ((float) editingGate / (float)(gateTime * sampleRate / RefreshCounter::displayRefreshStepSkips)) : 0.0f);
+								lights[KEY_LIGHTS + i * 2 + 1].setBrightness(i == editingGateKeyLight ? ((float) editingGate / (float)(gateTime * sampleRate / refresh.displayRefreshStepSkips)) : 0.0f);
 							else
 								lights[KEY_LIGHTS + i * 2 + 1].setBrightness(i == keyLightIndex ? 1.0f : 0.0f);
 						}
@@ -1566,7 +1661,7 @@ struct SemiModularSynth : Module {
 				setGreenRed(GATE1_PROB_LIGHT, attributesVal.getGate1P() ? 1.0f : 0.0f, attributesVal.getGate1P() ? 1.0f : 0.0f);
 				lights[SLIDE_LIGHT].setBrightness(attributesVal.getSlide() ? 1.0f : 0.0f);
 				if (tiedWarning > 0l) {
-					bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+					bool warningFlashState = calcWarningFlash(tiedWarning, (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips));
 					lights[TIE_LIGHT].setBrightness(warningFlashState ? 1.0f : 0.0f);
 				}
 				else
@@ -1575,14 +1670,14 @@ struct SemiModularSynth : Module {
 
 			// Attach light
 			if (attachedWarning > 0l) {
-				bool warningFlashState = calcWarningFlash(attachedWarning, (long) (warningTime * sampleRate / RefreshCounter::displayRefreshStepSkips));
+				bool warningFlashState = calcWarningFlash(attachedWarning, (long) (warningTime * sampleRate / refresh.displayRefreshStepSkips));
 				lights[ATTACH_LIGHT].setBrightness(warningFlashState ? 1.0f : 0.0f);
 			}
 			else
 				lights[ATTACH_LIGHT].setBrightness(attached ? 1.0f : 0.0f);
 			
 			// Reset light
-			lights[RESET_LIGHT].setSmoothBrightness(resetLight, args.sampleTime * (RefreshCounter::displayRefreshStepSkips >> 2));	
+			lights[RESET_LIGHT].setSmoothBrightness(resetLight, args.sampleTime * (refresh.displayRefreshStepSkips >> 2));	
 			resetLight = 0.0f;
 			
 			// Run light
@@ -1606,7 +1701,7 @@ struct SemiModularSynth : Module {
 				attachedWarning--;
 			if (modeHoldDetect.process(params[RUNMODE_PARAM].getValue())) {
 				displayState = DISP_NORMAL;
-				editingPpqn = (long) (editGateLengthTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+				editingPpqn = (long) (editGateLengthTime * sampleRate / refresh.displayRefreshStepSkips);
 			}
 			if (revertDisplay > 0l) {
 				if (revertDisplay == 1)
@@ -1718,7 +1813,7 @@ struct SemiModularSynth : Module {
 			float gain = std::pow(1.f + drive, 5);
 			input *= gain;
 			// Add -60dB noise to bootstrap self-oscillation
-			input += 1e-6f * (2.f * random::uniform() - 1.f);
+			input += 1e-6f * (2.f * rng.uniform() - 1.f);
 			// Set resonance
 			float res = clamp(params[VCF_RES_PARAM].getValue() + inputs[VCF_RES_INPUT].getVoltage() / 10.f, 0.f, 1.f);
 			filter.resonance = std::pow(res, 2) * 10.f;
@@ -1828,11 +1923,10 @@ struct SemiModularSynth : Module {
 struct SemiModularSynthWidget : ModuleWidget {
 	SvgPanel* darkPanel;
 
-	struct SequenceDisplayWidget : LightWidget {//TransparentWidget {
+	struct SequenceDisplayWidget : CachedDisplayWidget {
 		SemiModularSynth *module;
 		std::shared_ptr<Font> font;
 		std::string fontPath;
-		char displayStr[16];
 		int lastNum = -1;// -1 means timedout; >= 0 means we have a first number potential, if ever second key comes fast enough
 		clock_t lastTime = 0;
 		
@@ -1913,7 +2007,7 @@ struct SemiModularSynthWidget : ModuleWidget {
 				snprintf(displayStr, 4, "%s", modeLabels[num].c_str());
 		}
 
-		void draw(const DrawArgs &args) override {
+		void drawDisplay(const DrawArgs &args) override {
 			if (!(font = APP->window->loadFont(fontPath))) {
 				return;
 			}
@@ -1924,7 +2018,10 @@ struct SemiModularSynthWidget : ModuleWidget {
 			nvgFillColor(args.vg, nvgTransRGBA(textColor, displayAlpha));
 			nvgText(args.vg, textPos.x, textPos.y, "~~~", NULL);
 			nvgFillColor(args.vg, textColor);
-			
+			nvgText(args.vg, textPos.x, textPos.y, displayStr, NULL);
+		}
+
+		void updateDisplay() override {
 			if (module == NULL) {
 				snprintf(displayStr, 4, "  1");
 			}
@@ -1985,7 +2082,6 @@ struct SemiModularSynthWidget : ModuleWidget {
 						module->seqIndexEdit : module->phrase[module->phraseIndexEdit]) + 1 );
 				}
 			}
-			nvgText(args.vg, textPos.x, textPos.y, displayStr, NULL);
 		}
 	};		
 	
@@ -2125,6 +2221,10 @@ struct SemiModularSynthWidget : ModuleWidget {
 		rorItem->module = module;
 		menu->addChild(rorItem);
 
+		RandomSeedItem *seedItem = createMenuItem<RandomSeedItem>("Random seed", RIGHT_ARROW);
+		seedItem->rngPtr = &module->rng;
+		menu->addChild(seedItem);
+
 		HoldTiedItem *holdItem = createMenuItem<HoldTiedItem>("Hold tied notes", CHECKMARK(module->holdTiedNotes));
 		holdItem->module = module;
 		menu->addChild(holdItem);
@@ -2154,7 +2254,7 @@ struct SemiModularSynthWidget : ModuleWidget {
 				// same code structure below as in sequence knob in main step()
 				if (module->editingPpqn != 0) {
 					module->pulsesPerStep = 1;
-					//editingPpqn = (long) (editGateLengthTime * sampleRate / RefreshCounter::displayRefreshStepSkips);
+					//editingPpqn = (long) (editGateLengthTime * sampleRate / module->refresh.displayRefreshStepSkips);
 				}
 				else if (module->displayState == SemiModularSynth::DISP_MODE) {
 					if (module->isEditingSequence()) {
@@ -2502,8 +2602,7 @@ struct SemiModularSynthWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((SemiModularSynth*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((SemiModularSynth*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((SemiModularSynth*)module)->panelTheme);
 		}
 		Widget::step();
 	}
@@ -102,6 +102,11 @@ struct Tact : Module {
 		levelSensitiveTopBot = false;
 		resetNonJson();
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+	}
+	
 	void resetNonJson() {
 		infoStore = 0l;		
 	}
@@ -199,7 +204,7 @@ struct Tact : Module {
 				if (storeTriggers[i].process(params[STORE_PARAMS + i].getValue())) {
 					if ( !(i == 1 && isLinked()) ) {// ignore right channel store-button press when linked
 						storeCV[i] = cv[i];
-						infoStore = (long) (storeInfoTime * args.sampleRate / RefreshCounter::displayRefreshStepSkips) * (i == 0 ? 1l : -1l);
+						infoStore = (long) (storeInfoTime * args.sampleRate / refresh.displayRefreshStepSkips) * (i == 0 ? 1l : -1l);
 					}
 				}
 			}
@@ -303,11 +308,11 @@ struct Tact : Module {
 		if (refresh.processLights()) {
 			// Tactile lights
 			if (infoStore > 0l)
-				setTLightsStore(0, infoStore, (long) (storeInfoTime * args.sampleRate / RefreshCounter::displayRefreshStepSkips) );
+				setTLightsStore(0, infoStore, (long) (storeInfoTime * args.sampleRate / refresh.displayRefreshStepSkips) );
 			else
 				setTLights(0);
 			if (infoStore < 0l)
-				setTLightsStore(1, infoStore * -1l, (long) (storeInfoTime * args.sampleRate / RefreshCounter::displayRefreshStepSkips) );
+				setTLightsStore(1, infoStore * -1l, (long) (storeInfoTime * args.sampleRate / refresh.displayRefreshStepSkips) );
 			else
 				setTLights(1);
 			if (infoStore != 0l) {
@@ -318,7 +323,7 @@ struct Tact : Module {
 			}
 			// CV input lights
 			for (int i = 0; i < 2; i++) {
-				lights[CVIN_LIGHTS + i * 2].setSmoothBrightness(infoCVinLight[i], args.sampleTime * (RefreshCounter::displayRefreshStepSkips >> 2));
+				lights[CVIN_LIGHTS + i * 2].setSmoothBrightness(infoCVinLight[i], args.sampleTime * (refresh.displayRefreshStepSkips >> 2));
 				infoCVinLight[i] = 0.0f;
 			}
 		}
@@ -555,8 +560,7 @@ struct TactWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((Tact*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((Tact*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((Tact*)module)->panelTheme);
 		}
 		Widget::step();
 	}
@@ -625,6 +629,11 @@ struct Tact1 : Module {
 		autoReturn = -1;
 		// resetNonJson();
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+	}
+	
 	// void resetNonJson() {
 		// none
 	// }
@@ -837,8 +846,7 @@ struct Tact1Widget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((Tact1*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((Tact1*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((Tact1*)module)->panelTheme);
 		}
 		Widget::step();
 	}
@@ -915,6 +923,11 @@ struct TactG : Module {
 		autoReturn = -1;
 		resetNonJson();
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+	}
+	
 	void resetNonJson() {
 		gate = 0;
 	}
@@ -1145,8 +1158,7 @@ struct TactGWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((TactG*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((TactG*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((TactG*)module)->panelTheme);
 		}
 		Widget::step();
 	}
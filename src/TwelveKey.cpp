@@ -43,7 +43,8 @@ struct TwelveKey : Module {
 	
 	
 	// Expander
-	float leftMessages[2][3] = {};// messages from TwelveKey placed to the left (Max Vel, Invert Vel, Bipol)
+	ExpanderChannel<float[3]> fromLeft;// messages from TwelveKey placed to the left (Max Vel, Invert Vel, Bipol)
+	ExpanderSender<float[3]> toRight;// same, to TwelveKey placed to the right
 		
 	
 	// Need to save, no reset
@@ -82,8 +83,7 @@ struct TwelveKey : Module {
 	TwelveKey() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		
-		leftExpander.producerMessage = leftMessages[0];
-		leftExpander.consumerMessage = leftMessages[1];
+		fromLeft.construct(&leftExpander);
 
 		configParam(OCTDEC_PARAM, 0.0, 1.0, 0.0, "Oct down");
 		configParam(OCTINC_PARAM, 0.0, 1.0, 0.0, "Oct up");
@@ -109,6 +109,11 @@ struct TwelveKey : Module {
 		pkInfo.key = 0;
 		resetNonJson();
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+	}
+	
 	void resetNonJson() {
 		noteLightCounter = 0ul;
 	}
@@ -236,8 +241,8 @@ struct TwelveKey : Module {
 		if (refresh.processInputs()) {
 			// From previous TwelveKey to the left
 			if (linkVelSettings && leftExpander.module && leftExpander.module->model == modelTwelveKey) {
-				// Get consumer message
-				float *message = (float*) leftExpander.consumerMessage;
+				// Get consumer message (applied on every refresh, since local edits must be overridden while linked)
+				float *message = fromLeft.data();
 				maxVel = message[0];
 				invertVel = message[1] > 0.5f;
 				params[VELPOL_PARAM].setValue(message[2]);
@@ -264,7 +269,7 @@ struct TwelveKey : Module {
 		if (keyTrigger.process(pkInfo.gate)) {
 			cv = ((float)(octaveNum - 4)) + ((float) pkInfo.key) / 12.0f;
 			stateInternal = true;
-			noteLightCounter = (unsigned long) (noteLightTime * args.sampleRate / RefreshCounter::displayRefreshStepSkips);
+			noteLightCounter = (unsigned long) (noteLightTime * args.sampleRate / refresh.displayRefreshStepSkips);
 		}
 		if (gateInputTrigger.process(inputs[GATE_INPUT].getVoltage())) {// no input refresh here, don't want propagation lag in long 12-key chain
 			cv = inputs[CV_INPUT].getVoltage();
@@ -360,11 +365,14 @@ struct TwelveKey : Module {
 			
 			// To next TweleveKey to the right
 			if (rightExpander.module && rightExpander.module->model == modelTwelveKey) {
-				float *messageToExpander = (float*)(rightExpander.module->leftExpander.producerMessage);
+				float *messageToExpander = toRight.message;
 				messageToExpander[0] = maxVel;
 				messageToExpander[1] = (float)invertVel;
 				messageToExpander[2] = params[VELPOL_PARAM].getValue();
-				rightExpander.module->leftExpander.messageFlipRequested = true;
+				toRight.sendRight(this);
+			}
+			else {
+				toRight.reset();
 			}
 		}// processLights()
 	}
@@ -596,8 +604,7 @@ struct TwelveKeyWidget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((TwelveKey*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((TwelveKey*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((TwelveKey*)module)->panelTheme);
 		}
 		Widget::step();
 	}
@@ -72,6 +72,7 @@ struct WriteSeq32 : Module {
 	float cv[4][32];
 	int gates[4][32];
 	bool resetOnRun;
+	int clockBusSource;// 0 when the clock input is a regular clock, 1 to 4 when it is a clock bus (see ClockBusChannelIds)
 	int stepRotates;
 
 	// No need to save, with reset
@@ -143,9 +144,15 @@ struct WriteSeq32 : Module {
 			}
 		}
 		resetOnRun = false;
+		clockBusSource = 0;
 		stepRotates = 0;
 		resetNonJson();
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+	}
+	
 	void resetNonJson() {
 		clockIgnoreOnReset = (long) (clockIgnoreOnResetDuration * APP->engine->getSampleRate());
 		for (int s = 0; s < 32; s++) {
@@ -207,6 +214,9 @@ struct WriteSeq32 : Module {
 		// resetOnRun
 		json_object_set_new(rootJ, "resetOnRun", json_boolean(resetOnRun));
 		
+		// clockBusSource
+		json_object_set_new(rootJ, "clockBusSource", json_integer(clockBusSource));
+		
 		// stepRotates
 		json_object_set_new(rootJ, "stepRotates", json_integer(stepRotates));
 
@@ -265,6 +275,11 @@ struct WriteSeq32 : Module {
 		json_t *resetOnRunJ = json_object_get(rootJ, "resetOnRun");
 		if (resetOnRunJ)
 			resetOnRun = json_is_true(resetOnRunJ);
+
+		// clockBusSource
+		json_t *clockBusSourceJ = json_object_get(rootJ, "clockBusSource");
+		if (clockBusSourceJ)
+			clockBusSource = clamp((int)json_integer_value(clockBusSourceJ), 0, 4);
 		
 		// stepRotates
 		json_t *stepRotatesJ = json_object_get(rootJ, "stepRotates");
@@ -351,7 +366,7 @@ struct WriteSeq32 : Module {
 		bool canEdit = !running || (indexChannel == 3);
 		
 		// Run state button
-		if (runningTrigger.process(params[RUN_PARAM].getValue() + inputs[RUNCV_INPUT].getVoltage())) {// no input refresh here, don't want to introduce startup skew
+		if (runningTrigger.process(params[RUN_PARAM].getValue() + inputs[RUNCV_INPUT].getVoltage() + getClockBusChannel(inputs[CLOCK_INPUT], clockBusSource, CLKBUS_RUN))) {// no input refresh here, don't want to introduce startup skew
 			running = !running;
 			//pendingPaste = 0;// no pending pastes across run state toggles
 			if (running) {
@@ -366,7 +381,7 @@ struct WriteSeq32 : Module {
 		if (refresh.processInputs()) {
 			// Copy button
 			if (copyTrigger.process(params[COPY_PARAM].getValue())) {
-				infoCopyPaste = (long) (copyPasteInfoTime * args.sampleRate / RefreshCounter::displayRefreshStepSkips);
+				infoCopyPaste = (long) (copyPasteInfoTime * args.sampleRate / refresh.displayRefreshStepSkips);
 				for (int s = 0; s < 32; s++) {
 					cvCPbuffer[s] = cv[indexChannel][s];
 					gateCPbuffer[s] = gates[indexChannel][s];
@@ -377,7 +392,7 @@ struct WriteSeq32 : Module {
 			if (pasteTrigger.process(params[PASTE_PARAM].getValue())) {
 				if (params[PASTESYNC_PARAM].getValue() < 0.5f || indexChannel == 3) {
 					// Paste realtime, no pending to schedule
-					infoCopyPaste = (long) (-1 * copyPasteInfoTime * args.sampleRate / RefreshCounter::displayRefreshStepSkips);
+					infoCopyPaste = (long) (-1 * copyPasteInfoTime * args.sampleRate / refresh.displayRefreshStepSkips);
 					for (int s = 0; s < 32; s++) {
 						cv[indexChannel][s] = cvCPbuffer[s];
 						gates[indexChannel][s] = gateCPbuffer[s];
@@ -426,7 +441,7 @@ struct WriteSeq32 : Module {
 					if (inputs[GATE_INPUT].isConnected())
 						gates[indexChannel][index] = (inputs[GATE_INPUT].getVoltage() >= 1.0f) ? 1 : 0;
 					// Editing gate
-					editingGate = (unsigned long) (gateTime * args.sampleRate / RefreshCounter::displayRefreshStepSkips);
+					editingGate = (unsigned long) (gateTime * args.sampleRate / refresh.displayRefreshStepSkips);
 					editingGateCV = cv[indexChannel][index];
 					// Autostep
 					if (params[AUTOSTEP_PARAM].getValue() > 0.5f) {
@@ -456,7 +471,7 @@ struct WriteSeq32 : Module {
 					}
 					// Editing gate
 					int index = (indexChannel == 3 ? indexStepStage : indexStep);
-					editingGate = (unsigned long) (gateTime * args.sampleRate / RefreshCounter::displayRefreshStepSkips);
+					editingGate = (unsigned long) (gateTime * args.sampleRate / refresh.displayRefreshStepSkips);
 					editingGateCV = cv[indexChannel][index];
 				}
 				else {
@@ -484,13 +499,13 @@ struct WriteSeq32 : Module {
 		
 		// Clock
 		if (running && clockIgnoreOnReset == 0l) {
-			if (clockTrigger.process(inputs[CLOCK_INPUT].getVoltage())) {
+			if (clockTrigger.process(getClockBusClock(inputs[CLOCK_INPUT], clockBusSource))) {
 				indexStep = moveIndex(indexStep, indexStep + 1, numSteps);
 				
 				// Pending paste on clock or end of seq
 				if ( ((pendingPaste&0x3) == 1) || ((pendingPaste&0x3) == 2 && indexStep == 0) ) {
 					int pasteChannel = pendingPaste>>2;
-					infoCopyPaste = (long) (-1 * copyPasteInfoTime * args.sampleRate / RefreshCounter::displayRefreshStepSkips);
+					infoCopyPaste = (long) (-1 * copyPasteInfoTime * args.sampleRate / refresh.displayRefreshStepSkips);
 					for (int s = 0; s < 32; s++) {
 						cv[pasteChannel][s] = cvCPbuffer[s];
 						gates[pasteChannel][s] = gateCPbuffer[s];
@@ -501,7 +516,7 @@ struct WriteSeq32 : Module {
 		}
 		
 		// Reset
-		if (resetTrigger.process(inputs[RESET_INPUT].getVoltage())) {
+		if (resetTrigger.process(inputs[RESET_INPUT].getVoltage() + getClockBusChannel(inputs[CLOCK_INPUT], clockBusSource, CLKBUS_RESET))) {
 			clockIgnoreOnReset = (long) (clockIgnoreOnResetDuration * args.sampleRate);
 			indexStep = 0;
 			indexStepStage = 0;	
@@ -777,6 +792,10 @@ struct WriteSeq32Widget : ModuleWidget {
 		ResetOnRunItem *rorItem = createMenuItem<ResetOnRunItem>("Reset on run", CHECKMARK(module->resetOnRun));
 		rorItem->module = module;
 		menu->addChild(rorItem);
+
+		ClockBusSourceItem *busItem = createMenuItem<ClockBusSourceItem>("Clock input is poly clock bus", RIGHT_ARROW);
+		busItem->clockBusSourcePtr = &module->clockBusSource;
+		menu->addChild(busItem);
 	}	
 	
 	
@@ -945,8 +964,7 @@ struct WriteSeq32Widget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((WriteSeq32*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((WriteSeq32*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((WriteSeq32*)module)->panelTheme);
 		}
 		Widget::step();
 	}
@@ -71,6 +71,7 @@ struct WriteSeq64 : Module {
 	float cv[5][64];
 	int gates[5][64];
 	bool resetOnRun;
+	int clockBusSource;// 0 when the clock input is a regular clock, 1 to 4 when it is a clock bus (see ClockBusChannelIds)
 	int stepRotates;
 
 	// No need to save, with reset
@@ -142,9 +143,15 @@ struct WriteSeq64 : Module {
 			}
 		}
 		resetOnRun = false;
+		clockBusSource = 0;
 		stepRotates = 0;
 		resetNonJson();
 	}
+	
+	void onSampleRateChange() override {
+		refresh.onSampleRateChange();
+	}
+	
 	void resetNonJson() {
 		clockIgnoreOnReset = (long) (clockIgnoreOnResetDuration * APP->engine->getSampleRate());
 		for (int s = 0; s < 64; s++) {
@@ -208,6 +215,9 @@ struct WriteSeq64 : Module {
 		// resetOnRun
 		json_object_set_new(rootJ, "resetOnRun", json_boolean(resetOnRun));
 		
+		// clockBusSource
+		json_object_set_new(rootJ, "clockBusSource", json_integer(clockBusSource));
+		
 		// stepRotates
 		json_object_set_new(rootJ, "stepRotates", json_integer(stepRotates));
 
@@ -273,6 +283,11 @@ struct WriteSeq64 : Module {
 		if (resetOnRunJ)
 			resetOnRun = json_is_true(resetOnRunJ);
 
+		// clockBusSource
+		json_t *clockBusSourceJ = json_object_get(rootJ, "clockBusSource");
+		if (clockBusSourceJ)
+			clockBusSource = clamp((int)json_integer_value(clockBusSourceJ), 0, 4);
+
 		// stepRotates
 		json_t *stepRotatesJ = json_object_get(rootJ, "stepRotates");
 		if (stepRotatesJ)
@@ -359,7 +374,7 @@ struct WriteSeq64 : Module {
 		bool canEdit = !running || (indexChannel == 4);
 		
 		// Run state button
-		if (runningTrigger.process(params[RUN_PARAM].getValue() + inputs[RUNCV_INPUT].getVoltage())) {// no input refresh here, don't want to introduce startup skew
+		if (runningTrigger.process(params[RUN_PARAM].getValue() + inputs[RUNCV_INPUT].getVoltage() + getClockBusChannel(inputs[CLOCK12_INPUT], clockBusSource, CLKBUS_RUN))) {// no input refresh here, don't want to introduce startup skew
 			running = !running;
 			//pendingPaste = 0;// no pending pastes across run state toggles
 			if (running) {
@@ -374,7 +389,7 @@ struct WriteSeq64 : Module {
 		if (refresh.processInputs()) {
 			// Copy button
 			if (copyTrigger.process(params[COPY_PARAM].getValue())) {
-				infoCopyPaste = (long) (copyPasteInfoTime * args.sampleRate / RefreshCounter::displayRefreshStepSkips);
+				infoCopyPaste = (long) (copyPasteInfoTime * args.sampleRate / refresh.displayRefreshStepSkips);
 				for (int s = 0; s < 64; s++) {
 					cvCPbuffer[s] = cv[indexChannel][s];
 					gateCPbuffer[s] = gates[indexChannel][s];
@@ -386,7 +401,7 @@ struct WriteSeq64 : Module {
 			if (pasteTrigger.process(params[PASTE_PARAM].getValue())) {
 				if (params[PASTESYNC_PARAM].getValue() < 0.5f || indexChannel == 4) {
 					// Paste realtime, no pending to schedule
-					infoCopyPaste = (long) (-1 * copyPasteInfoTime * args.sampleRate / RefreshCounter::displayRefreshStepSkips);
+					infoCopyPaste = (long) (-1 * copyPasteInfoTime * args.sampleRate / refresh.displayRefreshStepSkips);
 					for (int s = 0; s < 64; s++) {
 						cv[indexChannel][s] = cvCPbuffer[s];
 						gates[indexChannel][s] = gateCPbuffer[s];
@@ -444,7 +459,7 @@ struct WriteSeq64 : Module {
 					if (inputs[GATE_INPUT].isConnected())
 						gates[indexChannel][indexStep[indexChannel]] = (inputs[GATE_INPUT].getVoltage() >= 1.0f) ? 1 : 0;
 					// Editing gate
-					editingGate = (unsigned long) (gateTime * args.sampleRate / RefreshCounter::displayRefreshStepSkips);
+					editingGate = (unsigned long) (gateTime * args.sampleRate / refresh.displayRefreshStepSkips);
 					editingGateCV = cv[indexChannel][indexStep[indexChannel]];
 					// Autostep
 					if (params[AUTOSTEP_PARAM].getValue() > 0.5f)
@@ -464,7 +479,7 @@ struct WriteSeq64 : Module {
 					// step mode
 					indexStep[indexChannel] = moveIndex(indexStep[indexChannel], indexStep[indexChannel] + delta, indexSteps[indexChannel]); 
 					// Editing gate
-					editingGate = (unsigned long) (gateTime * args.sampleRate / RefreshCounter::displayRefreshStepSkips);
+					editingGate = (unsigned long) (gateTime * args.sampleRate / refresh.displayRefreshStepSkips);
 					editingGateCV = cv[indexChannel][indexStep[indexChannel]];
 				}
 				else {
@@ -480,7 +495,7 @@ struct WriteSeq64 : Module {
 		
 		// Clock
 		if (running && clockIgnoreOnReset == 0l) {
-			bool clk12step = clock12Trigger.process(inputs[CLOCK12_INPUT].getVoltage());
+			bool clk12step = clock12Trigger.process(getClockBusClock(inputs[CLOCK12_INPUT], clockBusSource));
 			bool clk34step = ((!inputs[CLOCK34_INPUT].isConnected()) && clk12step) || 
 							  clock34Trigger.process(inputs[CLOCK34_INPUT].getVoltage());
 			if (clk12step) {
@@ -496,7 +511,7 @@ struct WriteSeq64 : Module {
 			if ( ((pendingPaste&0x3) == 1) || ((pendingPaste&0x3) == 2 && indexStep[indexChannel] == 0) ) {
 				if ( (clk12step && (indexChannel == 0 || indexChannel == 1)) ||
 					 (clk34step && (indexChannel == 2 || indexChannel == 3)) ) {
-					infoCopyPaste = (long) (-1 * copyPasteInfoTime * args.sampleRate / RefreshCounter::displayRefreshStepSkips);
+					infoCopyPaste = (long) (-1 * copyPasteInfoTime * args.sampleRate / refresh.displayRefreshStepSkips);
 					int pasteChannel = pendingPaste>>2;
 					for (int s = 0; s < 64; s++) {
 						cv[pasteChannel][s] = cvCPbuffer[s];
@@ -511,7 +526,7 @@ struct WriteSeq64 : Module {
 		}
 		
 		// Reset
-		if (resetTrigger.process(inputs[RESET_INPUT].getVoltage() + params[RESET_PARAM].getValue())) {
+		if (resetTrigger.process(inputs[RESET_INPUT].getVoltage() + getClockBusChannel(inputs[CLOCK12_INPUT], clockBusSource, CLKBUS_RESET) + params[RESET_PARAM].getValue())) {
 			clockIgnoreOnReset = (long) (clockIgnoreOnResetDuration * args.sampleRate);
 			for (int t = 0; t < 5; t++)
 				indexStep[t] = 0;
@@ -560,7 +575,7 @@ struct WriteSeq64 : Module {
 			lights[GATE_LIGHT + 1].setBrightness(red);
 			
 			// Reset light
-			lights[RESET_LIGHT].setSmoothBrightness(resetLight, args.sampleTime * (RefreshCounter::displayRefreshStepSkips >> 2));	
+			lights[RESET_LIGHT].setSmoothBrightness(resetLight, args.sampleTime * (refresh.displayRefreshStepSkips >> 2));	
 			resetLight = 0.0f;
 
 			// Run light
@@ -832,6 +847,10 @@ struct WriteSeq64Widget : ModuleWidget {
 		ResetOnRunItem *rorItem = createMenuItem<ResetOnRunItem>("Reset on run", CHECKMARK(module->resetOnRun));
 		rorItem->module = module;
 		menu->addChild(rorItem);
+
+		ClockBusSourceItem *busItem = createMenuItem<ClockBusSourceItem>("Clock input is poly clock bus", RIGHT_ARROW);
+		busItem->clockBusSourcePtr = &module->clockBusSource;
+		menu->addChild(busItem);
 	}	
 	
 	
@@ -994,8 +1013,7 @@ struct WriteSeq64Widget : ModuleWidget {
 	
 	void step() override {
 		if (module) {
-			panel->visible = ((((WriteSeq64*)module)->panelTheme) == 0);
-			darkPanel->visible  = ((((WriteSeq64*)module)->panelTheme) == 1);
+			stepPanelTheme(this, darkPanel, ((WriteSeq64*)module)->panelTheme);
 		}
 		Widget::step();
 	}
@@ -9,6 +9,46 @@
 
 
 
+// Panel theme notification
+
+void notifyPanelThemeChange(Widget* widget, int panelTheme) {
+	for (Widget* child : widget->children) {
+		PanelThemeListener* listener = dynamic_cast<PanelThemeListener*>(child);
+		if (listener) {
+			listener->onPanelThemeChange(panelTheme);
+		}
+		else {
+			notifyPanelThemeChange(child, panelTheme);
+		}
+	}
+}
+
+void stepPanelTheme(ModuleWidget* moduleWidget, SvgPanel* darkPanel, int panelTheme) {
+	// the light panel and frames are the ones shown at construction, so no notification is needed until the theme is not 0
+	bool dark = (panelTheme == 1);
+	if (darkPanel->visible != dark) {
+		moduleWidget->panel->visible = !dark;
+		darkPanel->visible = dark;
+		notifyPanelThemeChange(moduleWidget, panelTheme);
+	}
+}
+
+
+
+// Svg cache
+
+std::shared_ptr<Svg> loadSvgCached(const std::string& filename) {
+	// only called from the UI thread, so no mutex needed
+	static std::map<std::string, std::shared_ptr<Svg>> svgCache;
+	std::shared_ptr<Svg>& svg = svgCache[filename];
+	if (!svg) {
+		svg = APP->window->loadSvg(filename);
+	}
+	return svg;
+}
+
+
+
 // Dynamic SVGWidget
 
 void DynamicSVGScrew::addFrame(std::shared_ptr<Svg> svg) {
@@ -18,17 +58,15 @@ void DynamicSVGScrew::addFrame(std::shared_ptr<Svg> svg) {
 	}
 }
 
-void DynamicSVGScrew::step() {
-    if(mode != NULL && *mode != oldMode) {
-        if (*mode > 0 && !frameAltName.empty()) {// JIT loading of alternate skin
-			frames.push_back(APP->window->loadSvg(frameAltName));
-			frameAltName.clear();// don't reload!
-		}
-        sw->setSvg(frames[*mode]);
-        oldMode = *mode;
-        fb->dirty = true;
-    }
-	SvgScrew::step();
+void DynamicSVGScrew::onPanelThemeChange(int panelTheme) {
+	if (mode == NULL)
+		return;
+	if (panelTheme > 0 && !frameAltName.empty()) {// JIT loading of alternate skin
+		frames.push_back(loadSvgCached(frameAltName));
+		frameAltName.clear();// don't reload!
+	}
+	sw->setSvg(frames[panelTheme]);
+	fb->dirty = true;
 }
 
 
@@ -42,17 +80,15 @@ void DynamicSVGPort::addFrame(std::shared_ptr<Svg> svg) {
 	}
 }
 
-void DynamicSVGPort::step() {
-    if(mode != NULL && *mode != oldMode) {
-        if (*mode > 0 && !frameAltName.empty()) {// JIT loading of alternate skin
-			frames.push_back(APP->window->loadSvg(frameAltName));
-			frameAltName.clear();// don't reload!
-		}
-        sw->setSvg(frames[*mode]);
-        oldMode = *mode;
-        fb->dirty = true;
-    }
-	SvgPort::step();
+void DynamicSVGPort::onPanelThemeChange(int panelTheme) {
+	if (mode == NULL)
+		return;
+	if (panelTheme > 0 && !frameAltName.empty()) {// JIT loading of alternate skin
+		frames.push_back(loadSvgCached(frameAltName));
+		frameAltName.clear();// don't reload!
+	}
+	sw->setSvg(frames[panelTheme]);
+	fb->dirty = true;
 }
 
 
@@ -67,27 +103,26 @@ void DynamicSVGSwitch::addFrameAll(std::shared_ptr<Svg> svg) {
 	}
 }
 
-void DynamicSVGSwitch::step() {
-    if(mode != NULL && *mode != oldMode) {
-        if (*mode > 0 && !frameAltName0.empty() && !frameAltName1.empty()) {// JIT loading of alternate skin
-			framesAll.push_back(APP->window->loadSvg(frameAltName0));
-			framesAll.push_back(APP->window->loadSvg(frameAltName1));
-			frameAltName0.clear();// don't reload!
-			frameAltName1.clear();// don't reload!
-		}
-		if ((*mode) == 0) {
-			frames[0]=framesAll[0];
-			frames[1]=framesAll[1];
-		}
-		else {
-			frames[0]=framesAll[2];
-			frames[1]=framesAll[3];
-		}
-        oldMode = *mode;
-		onChange(*(new event::Change()));// required because of the way SVGSwitch changes images, we only change the frames above.
-		fb->dirty = true;// dirty is not sufficient when changing via frames assignments above (i.e. onChange() is required)
-    }
-	SvgSwitch::step();
+void DynamicSVGSwitch::onPanelThemeChange(int panelTheme) {
+	if (mode == NULL)
+		return;
+	if (panelTheme > 0 && !frameAltName0.empty() && !frameAltName1.empty()) {// JIT loading of alternate skin
+		framesAll.push_back(loadSvgCached(frameAltName0));
+		framesAll.push_back(loadSvgCached(frameAltName1));
+		frameAltName0.clear();// don't reload!
+		frameAltName1.clear();// don't reload!
+	}
+	if (panelTheme == 0) {
+		frames[0]=framesAll[0];
+		frames[1]=framesAll[1];
+	}
+	else {
+		frames[0]=framesAll[2];
+		frames[1]=framesAll[3];
+	}
+	event::Change eChange;
+	onChange(eChange);// required because of the way SVGSwitch changes images, we only change the frames above.
+	fb->dirty = true;// dirty is not sufficient when changing via frames assignments above (i.e. onChange() is required)
 }
 
 
@@ -101,29 +136,26 @@ void DynamicSVGKnob::addFrameAll(std::shared_ptr<Svg> svg) {
 	}
 }
 
-void DynamicSVGKnob::step() {
-    if(mode != NULL && *mode != oldMode) {
-        if (*mode > 0 && !frameAltName.empty() && !frameEffectName.empty()) {// JIT loading of alternate skin
-			framesAll.push_back(APP->window->loadSvg(frameAltName));
-			effect = new SvgWidget();
-			effect->setSvg(APP->window->loadSvg(frameEffectName));
+void DynamicSVGKnob::onPanelThemeChange(int panelTheme) {
+	if (mode == NULL)
+		return;
+	if (panelTheme > 0 && !frameAltName.empty() && !frameEffectName.empty()) {// JIT loading of alternate skin
+		framesAll.push_back(loadSvgCached(frameAltName));
+		effect = new SvgWidget();
+		effect->setSvg(loadSvgCached(frameEffectName));
+		effect->visible = false;
+		addChild(effect);
+		frameAltName.clear();// don't reload!
+		frameEffectName.clear();// don't reload!
+	}
+	if (panelTheme == 0) {
+		setSvg(framesAll[0]);
+		if (effect != NULL)
 			effect->visible = false;
-			addChild(effect);
-			frameAltName.clear();// don't reload!
-			frameEffectName.clear();// don't reload!
-		}
-        if ((*mode) == 0) {
-			setSvg(framesAll[0]);
-			if (effect != NULL)
-				effect->visible = false;
-		}
-		else {
-			setSvg(framesAll[1]);
-			effect->visible = true;
-		}
-        oldMode = *mode;
-		fb->dirty = true;
-    }
-	SvgKnob::step();
+	}
+	else {
+		setSvg(framesAll[1]);
+		effect->visible = true;
+	}
+	fb->dirty = true;
 }
-
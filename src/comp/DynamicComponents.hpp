@@ -17,6 +17,23 @@ static const float blurRadiusRatio = 0.06f;
 
 
 
+// ******** Panel theme notification and Svg cache ********
+
+// Dynamic widgets do not poll their mode in step(); instead, the module widget calls 
+//   stepPanelTheme() in its own step(), which notifies its children only when the theme changes
+struct PanelThemeListener {
+	virtual void onPanelThemeChange(int panelTheme) = 0;
+	virtual ~PanelThemeListener() {}
+};
+
+void notifyPanelThemeChange(Widget* widget, int panelTheme);
+void stepPanelTheme(ModuleWidget* moduleWidget, SvgPanel* darkPanel, int panelTheme);
+
+// Plugin-wide Svg cache, so that alternate skins are loaded only once per process
+std::shared_ptr<Svg> loadSvgCached(const std::string& filename);
+
+
+
 // ******** Dynamic Widgets ********
 
 // General Dynamic Widget creation
@@ -27,15 +44,14 @@ TWidget* createDynamicWidget(Vec pos, int* mode) {
 	return dynWidget;
 }
 
-struct DynamicSVGScrew : SvgScrew {
+struct DynamicSVGScrew : SvgScrew, PanelThemeListener {
     int* mode = NULL;
-    int oldMode = -1;
     std::vector<std::shared_ptr<Svg>> frames;
 	std::string frameAltName;
 
     void addFrame(std::shared_ptr<Svg> svg);
     void addFrameAlt(std::string filename) {frameAltName = filename;}
-    void step() override;
+    void onPanelThemeChange(int panelTheme) override;
 };
 
 
@@ -65,15 +81,14 @@ TDynamicPort* createDynamicPortCentered(Vec pos, bool isInput, Module *module, i
 	return dynPort;
 }
 
-struct DynamicSVGPort : SvgPort {
+struct DynamicSVGPort : SvgPort, PanelThemeListener {
     int* mode = NULL;
-    int oldMode = -1;
     std::vector<std::shared_ptr<Svg>> frames;
 	std::string frameAltName;
 
     void addFrame(std::shared_ptr<Svg> svg);
     void addFrameAlt(std::string filename) {frameAltName = filename;}
-    void step() override;
+    void onPanelThemeChange(int panelTheme) override;
 };
 
 
@@ -103,9 +118,8 @@ TDynamicParam* createDynamicParamCentered(Vec pos, Module *module, int paramId,
 	return dynParam;
 }
 
-struct DynamicSVGSwitch : SvgSwitch {
+struct DynamicSVGSwitch : SvgSwitch, PanelThemeListener {
     int* mode = NULL;
-    int oldMode = -1;
 	std::vector<std::shared_ptr<Svg>> framesAll;
 	std::string frameAltName0;
 	std::string frameAltName1;
@@ -113,12 +127,11 @@ struct DynamicSVGSwitch : SvgSwitch {
 	void addFrameAll(std::shared_ptr<Svg> svg);
     void addFrameAlt0(std::string filename) {frameAltName0 = filename;}
     void addFrameAlt1(std::string filename) {frameAltName1 = filename;}
-    void step() override;
+    void onPanelThemeChange(int panelTheme) override;
 };
 
-struct DynamicSVGKnob : SvgKnob {
+struct DynamicSVGKnob : SvgKnob, PanelThemeListener {
     int* mode = NULL;
-    int oldMode = -1;
 	std::vector<std::shared_ptr<Svg>> framesAll;
 	SvgWidget* effect = NULL;
 	std::string frameAltName;
@@ -127,7 +140,7 @@ struct DynamicSVGKnob : SvgKnob {
 	void addFrameAll(std::shared_ptr<Svg> svg);
     void addFrameAlt(std::string filename) {frameAltName = filename;}	
 	void addFrameEffect(std::string filename) {frameEffectName = filename;}	
-    void step() override;
+    void onPanelThemeChange(int panelTheme) override;
 };
 
 